@@ -0,0 +1,179 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Content Hash Benchmark
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * Throughput of the spam filter's content hash: the old byte-at-a-time
+ * DJB2 over the raw message against content_fingerprint, which normalizes
+ * and hashes in one pass. Also checks that the usual dodges of the
+ * duplicate check - case, zero-width characters, extra whitespace - no
+ * longer change the hash.
+ */
+
+#include "content_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SET_BYTES (256 << 10)           /* Messages per run fill about this much, so they stay cached */
+#define TARGET_BYTES (512L << 20)       /* Hashed per run */
+#define LONG_LENGTH 2000                /* Discord's limit, in characters */
+#define SHORT_LENGTH 40
+
+static uint32_t djb2(const char *content) {
+    uint32_t hash = 5381;
+    int c;
+    while ((c = *content++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static const char *ascii_words[] = {
+    "the", "Discord", "server", "is", "GIVING", "away", "free", "nitro", "to", "everyone",
+    "who", "joins", "before", "midnight,", "click", "here:", "https://example.com/gift", "lol",
+};
+
+static const char *cyrillic_words[] = {
+    "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82",         /* Привет */
+    "\xd0\xb1\xd0\xb5\xd1\x81\xd0\xbf\xd0\xbb\xd0\xb0\xd1\x82\xd0\xbd\xd0\xbe", /* бесплатно */
+    "\xd0\xbd\xd0\xb8\xd1\x82\xd1\x80\xd0\xbe",                 /* нитро */
+    "\xd0\xb4\xd0\xbb\xd1\x8f",                                 /* для */
+    "\xd0\xb2\xd1\x81\xd0\xb5\xd1\x85",                         /* всех */
+    "\xd0\xbd\xd0\xb0",                                         /* на */
+    "\xd1\x81\xd0\xb5\xd1\x80\xd0\xb2\xd0\xb5\xd1\x80\xd0\xb5", /* сервере */
+    "\xf0\x9f\x8e\x81",                                         /* 🎁 */
+    "nitro",
+};
+
+/* Messages of roughly length characters built from words, one space apart */
+static char **build(uint64_t *state, const char **words, int word_count, int length, int count) {
+    char **messages = malloc(sizeof(char *) * count);
+    for (int i = 0; i < count; i++) {
+        char *m = malloc((size_t)length * 4 + 64);
+        int chars = 0;
+        size_t used = 0;
+        while (chars < length) {
+            const char *w = words[rng_next(state) % (uint64_t)word_count];
+            size_t n = strlen(w);
+            memcpy(m + used, w, n);
+            used += n;
+            m[used++] = ' ';
+            for (size_t k = 0; k <= n; k++) {
+                chars += ((unsigned char)w[k] & 0xC0) != 0x80;
+            }
+        }
+        m[used - 1] = '\0';
+        messages[i] = m;
+    }
+    return messages;
+}
+
+static void run(const char *name, char **messages, int count) {
+    size_t *lengths = malloc(sizeof(size_t) * count);
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        lengths[i] = strlen(messages[i]);
+        total += lengths[i];
+    }
+    long rounds = TARGET_BYTES / (long)total + 1;
+    double mb = (double)total * rounds / (1 << 20);
+    uint64_t sink = 0;
+
+    double start = now_ms();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) sink += djb2(messages[i]);
+    }
+    double old_ms = now_ms() - start;
+
+    start = now_ms();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) sink += content_fingerprint(messages[i], lengths[i]);
+    }
+    double new_ms = now_ms() - start;
+
+    printf("\n%s (%zu bytes on average)\n", name, total / count);
+    printf("  %-28s %8.1f MB/s  %7.1f ns/msg\n", "DJB2, raw bytes",
+           mb / (old_ms / 1000.0), old_ms * 1e6 / ((double)rounds * count));
+    printf("  %-28s %8.1f MB/s  %7.1f ns/msg\n", "normalize + XXH64, fused",
+           mb / (new_ms / 1000.0), new_ms * 1e6 / ((double)rounds * count));
+    if (sink == 42) printf("  (unlikely)\n");
+
+    free(lengths);
+}
+
+static void free_messages(char **messages, int count) {
+    for (int i = 0; i < count; i++) free(messages[i]);
+    free(messages);
+}
+
+/* Returns the number of dodges that still change the hash */
+static int check_dodges(void) {
+    static const char *original = "Free Nitro for everyone, click here";
+    static const char *dodges[] = {
+        "free nitro for everyone, click here",
+        "FREE NITRO FOR EVERYONE, CLICK HERE",
+        "Free Ni\xe2\x80\x8btro for everyone, click here",              /* Zero-width space */
+        "Free Nitro for\xe2\x80\x8d everyone, click\xef\xbb\xbf here",  /* Joiner, BOM */
+        "Free  Nitro\tfor\n\neveryone,   click here   ",
+        "  Free Nitro for everyone, click here",
+        "Free\xc2\xa0Nitro for everyone,\xe3\x80\x80" "click here",     /* NBSP, ideographic space */
+        "\xef\xbc\xa6ree Nitro for everyone, click here",               /* Fullwidth F */
+        "Fre\xcc\x81" "e\xcc\x81 Nitro for everyone, click here",       /* Combining accents */
+    };
+    uint64_t want = content_fingerprint(original, strlen(original));
+    int missed = 0;
+
+    printf("\nDuplicate-check dodges (same hash as \"%s\")\n", original);
+    for (size_t i = 0; i < sizeof(dodges) / sizeof(dodges[0]); i++) {
+        int old_same = djb2(dodges[i]) == djb2(original);
+        int new_same = content_fingerprint(dodges[i], strlen(dodges[i])) == want;
+        missed += !new_same;
+        printf("  %-4s %-4s  %zu\n", old_same ? "yes" : "no", new_same ? "yes" : "no", i + 1);
+    }
+    printf("  (old, new)\n");
+    return missed;
+}
+
+int main(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int ascii_count = (int)(sizeof(ascii_words) / sizeof(ascii_words[0]));
+    int cyrillic_count = (int)(sizeof(cyrillic_words) / sizeof(cyrillic_words[0]));
+    int long_count = SET_BYTES / LONG_LENGTH;
+    int short_count = SET_BYTES / SHORT_LENGTH;
+    char **messages;
+
+    messages = build(&state, ascii_words, ascii_count, LONG_LENGTH, long_count);
+    run("2000-character ASCII messages", messages, long_count);
+    free_messages(messages, long_count);
+
+    messages = build(&state, cyrillic_words, cyrillic_count, LONG_LENGTH, long_count);
+    run("2000-character Cyrillic and emoji messages", messages, long_count);
+    free_messages(messages, long_count);
+
+    messages = build(&state, ascii_words, ascii_count, SHORT_LENGTH, short_count);
+    run("40-character chat lines", messages, short_count);
+    free_messages(messages, short_count);
+
+    int missed = check_dodges();
+    if (missed) {
+        printf("\n%d dodges still change the hash\n", missed);
+        return 1;
+    }
+    printf("\nEvery dodge hashes the same as the original\n");
+    return 0;
+}
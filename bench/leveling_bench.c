@@ -0,0 +1,108 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Leveling Benchmark
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * Compares level_for_xp against the old (int)sqrt(xp / 100.0) formula and a
+ * binary search over the thresholds for speed, and checks them against the
+ * exact definition 100 * L^2 <= xp.
+ */
+
+#include "leveling.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define SAMPLES 4096
+#define ROUNDS 20000
+#define SEARCH_LEVELS 256               /* Enough for every sample below 2M XP */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int old_level(int64_t xp) {
+    return (int)sqrt(xp / 100.0);
+}
+
+/* Lower bound over the thresholds, only valid below SEARCH_LEVELS */
+static int search_level(int64_t xp) {
+    int lo = 0, hi = SEARCH_LEVELS;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (level_threshold(mid) <= xp) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Exact by definition - checked with 128-bit products */
+static int is_exact(int64_t xp, int level) {
+    __int128 at = (__int128)LEVEL_XP_FACTOR * level * level;
+    __int128 next = (__int128)LEVEL_XP_FACTOR * (level + 1) * (level + 1);
+    return at <= xp && xp < next;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void run(const char *label, const int64_t *xp, int (*level_fn)(int64_t)) {
+    volatile unsigned sink = 0;
+    double start = now_ms();
+
+    for (int r = 0; r < ROUNDS; r++) {
+        unsigned acc = 0;
+        for (int i = 0; i < SAMPLES; i++) {
+            acc += (unsigned)level_fn(xp[i]);
+        }
+        sink += acc;
+    }
+
+    double elapsed = now_ms() - start;
+    printf("  %-10s %8.2f ms  %6.2f ns/call\n", label, elapsed,
+           elapsed * 1e6 / ((double)SAMPLES * ROUNDS));
+    (void)sink;
+}
+
+int main(void) {
+    static int64_t xp[SAMPLES];
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+    /* Typical guilds */
+    for (int i = 0; i < SAMPLES; i++) {
+        xp[i] = (int64_t)(rng_next(&state) % 2000000);
+    }
+    printf("XP below 2M:\n");
+    run("sqrt", xp, old_level);
+    run("bsearch", xp, search_level);
+    run("leveling", xp, level_for_xp);
+
+    /* Huge totals - past level 2^23 (about 7e15 XP) a double root can be off by one */
+    for (int i = 0; i < SAMPLES; i++) {
+        xp[i] = (int64_t)(rng_next(&state) >> 2);
+    }
+    printf("XP up to 2^62:\n");
+    run("sqrt", xp, old_level);
+    run("leveling", xp, level_for_xp);
+
+    /* Every threshold and its neighbours - sqrt only goes wrong past level 2^23 */
+    long old_wrong = 0, new_wrong = 0, checked = 0;
+    for (int64_t level = 1; level < 303700049; level += (level < 100000 ? 1 : 997)) {
+        int64_t t = LEVEL_XP_FACTOR * level * level;
+        for (int64_t d = -1; d <= 1; d++) {
+            old_wrong += !is_exact(t + d, old_level(t + d));
+            new_wrong += !is_exact(t + d, level_for_xp(t + d));
+            checked++;
+        }
+    }
+    printf("Thresholds: %ld checked, sqrt wrong %ld, leveling wrong %ld\n", checked, old_wrong, new_wrong);
+
+    return new_wrong == 0 ? 0 : 1;
+}
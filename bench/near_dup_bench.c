@@ -0,0 +1,192 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Near-Duplicate Window Benchmark
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * Per-message cost of the raid check: content_hashes against the plain
+ * content_fingerprint it replaces, and near_dup_add on a busy guild's
+ * window. Then a raid of slightly varied copies, each from a fresh
+ * account, mixed into ordinary chatter - how many of the copies are
+ * caught, and whether any chatter is.
+ */
+
+#include "content_hash.h"
+#include "near_dup.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MESSAGES 2000000
+#define MESSAGE_SET 4096                /* Distinct chat lines, reused round-robin */
+#define MEMBERS 5000
+#define MESSAGES_PER_SECOND 20          /* A very busy guild */
+#define RAID_ACCOUNTS 50
+#define RAID_USERS 5                    /* raid_similar_users */
+#define RAID_SECONDS 30                 /* raid_similar_seconds */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static const char *words[] = {
+    "hey", "what", "is", "going", "on", "today", "anyone", "playing", "tonight", "the", "new",
+    "update", "out", "lol", "guys", "check", "this", "cool", "thing", "I", "found", "yesterday",
+    "at", "school", "my", "cat", "did", "something", "funny", "again", "who", "wants", "to",
+    "join", "voice", "later", "gg", "that", "was", "close", "brb", "dinner", "same",
+};
+
+/* Chat lines of 2 to 15 words */
+static char *chat_line(uint64_t *state) {
+    char *m = malloc(256);
+    int count = 2 + (int)(rng_next(state) % 14);
+    size_t used = 0;
+    for (int i = 0; i < count; i++) {
+        const char *w = words[rng_next(state) % (sizeof(words) / sizeof(words[0]))];
+        size_t n = strlen(w);
+        memcpy(m + used, w, n);
+        used += n;
+        m[used++] = ' ';
+    }
+    m[used - 1] = '\0';
+    return m;
+}
+
+/* The raid's message with what spammers vary between accounts: a greeting,
+ * an invite code, a random tag, zero-width characters and case */
+static void raid_line(char *m, size_t size, uint64_t *state) {
+    static const char *greetings[] = { "", "hey ", "yo ", "@everyone " };
+    uint64_t r = rng_next(state);
+    snprintf(m, size, "%s%s nitro giveaway, claim yours at discord.gg/fr%ce%s %04x",
+             greetings[r & 3], r & 4 ? "FREE" : "free", (int)('a' + (r >> 8) % 3),
+             r & 8 ? "\xe2\x80\x8b" : "", (unsigned)(r >> 16) & 0xffff);
+}
+
+static void time_hashes(char **lines, size_t *lengths) {
+    long rounds = MESSAGES / MESSAGE_SET;
+    uint64_t sink = 0;
+
+    double start = now_ms();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < MESSAGE_SET; i++) sink += content_fingerprint(lines[i], lengths[i]);
+    }
+    double fingerprint_ms = now_ms() - start;
+
+    start = now_ms();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < MESSAGE_SET; i++) {
+            content_hashes_t hashes;
+            content_hashes(lines[i], lengths[i], &hashes);
+            sink += hashes.fingerprint ^ hashes.simhash;
+        }
+    }
+    double both_ms = now_ms() - start;
+
+    double messages = (double)rounds * MESSAGE_SET;
+    printf("\nHashing chat lines\n");
+    printf("  %-30s %7.1f ns/msg\n", "content_fingerprint", fingerprint_ms * 1e6 / messages);
+    printf("  %-30s %7.1f ns/msg\n", "content_hashes (+ SimHash)", both_ms * 1e6 / messages);
+    if (sink == 42) printf("  (unlikely)\n");
+}
+
+static void time_window(char **lines, size_t *lengths, uint64_t *state) {
+    uint64_t *simhashes = malloc(sizeof(uint64_t) * MESSAGE_SET);
+    uint64_t *members = malloc(sizeof(uint64_t) * MEMBERS);
+    near_dup_window_t *window = malloc(sizeof(near_dup_window_t));
+    long similar = 0;
+
+    for (int i = 0; i < MESSAGE_SET; i++) {
+        content_hashes_t hashes;
+        content_hashes(lines[i], lengths[i], &hashes);
+        simhashes[i] = hashes.simhash;
+    }
+    for (int i = 0; i < MEMBERS; i++) members[i] = rng_next(state);
+    near_dup_reset(window);
+
+    double start = now_ms();
+    for (int i = 0; i < MESSAGES; i++) {
+        uint64_t member = members[(rng_next(state) >> 8) % MEMBERS];
+        similar += near_dup_add(window, member, simhashes[i % MESSAGE_SET],
+                                (uint32_t)(i / MESSAGES_PER_SECOND), RAID_SECONDS, RAID_USERS);
+    }
+    double ms = now_ms() - start;
+
+    printf("\nnear_dup_add, %d messages a second (%zu-byte window)\n", MESSAGES_PER_SECOND, sizeof(near_dup_window_t));
+    printf("  %-30s %7.1f ns/msg  (%.2f similar users on average)\n", "lookup + insert",
+           ms * 1e6 / MESSAGES, (double)similar / MESSAGES);
+
+    free(simhashes);
+    free(members);
+    free(window);
+}
+
+/* Returns 0 when the raid is caught and no chatter is */
+static int check_raid(char **lines, size_t *lengths, uint64_t *state) {
+    near_dup_window_t *window = malloc(sizeof(near_dup_window_t));
+    int caught = 0, first = -1, false_positives = 0;
+    uint32_t now = 0;
+
+    near_dup_reset(window);
+    for (int i = 0; i < RAID_ACCOUNTS; i++) {
+        /* Three chat lines between each raid message */
+        for (int k = 0; k < 3; k++) {
+            int line = (int)(rng_next(state) % MESSAGE_SET);
+            content_hashes_t hashes;
+            content_hashes(lines[line], lengths[line], &hashes);
+            false_positives += near_dup_add(window, rng_next(state) % MEMBERS, hashes.simhash,
+                                            now, RAID_SECONDS, RAID_USERS) >= RAID_USERS;
+        }
+
+        char m[128];
+        content_hashes_t hashes;
+        raid_line(m, sizeof(m), state);
+        content_hashes(m, strlen(m), &hashes);
+        if (near_dup_add(window, 1000000 + (uint64_t)i, hashes.simhash, now, RAID_SECONDS, RAID_USERS) >= RAID_USERS) {
+            caught++;
+            if (first < 0) first = i;
+        }
+        now += i & 1;
+    }
+
+    printf("\nRaid of %d fresh accounts posting varied copies between chat lines\n", RAID_ACCOUNTS);
+    printf("  copies caught: %d (first at account %d, %d needed)\n", caught, first + 1, RAID_USERS);
+    printf("  chat lines caught: %d of %d\n", false_positives, RAID_ACCOUNTS * 3);
+
+    free(window);
+    return caught >= RAID_ACCOUNTS / 2 && false_positives == 0 ? 0 : 1;
+}
+
+int main(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    char **lines = malloc(sizeof(char *) * MESSAGE_SET);
+    size_t *lengths = malloc(sizeof(size_t) * MESSAGE_SET);
+
+    for (int i = 0; i < MESSAGE_SET; i++) {
+        lines[i] = chat_line(&state);
+        lengths[i] = strlen(lines[i]);
+    }
+
+    time_hashes(lines, lengths);
+    time_window(lines, lengths, &state);
+    int wrong = check_raid(lines, lengths, &state);
+
+    for (int i = 0; i < MESSAGE_SET; i++) free(lines[i]);
+    free(lines);
+    free(lengths);
+
+    if (wrong) {
+        printf("\nThe raid was missed or chatter was mistaken for one\n");
+        return 1;
+    }
+    printf("\nThe raid was caught without flagging chatter\n");
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Spam History Benchmark
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * Per-message cost of the spam filter's history work - find the member,
+ * record the message, run the rate and duplicate checks - with the old
+ * array of 16-byte records walked twice with a modulo per step, and with
+ * spam_history's packed arrays checked in one vector pass. Content hashing
+ * is the same either way and left out.
+ */
+
+#include "spam_history.h"
+#include "u64map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MESSAGES 4000000
+#define SMALL_MEMBERS 1024              /* The old MAX_TRACKED_USERS */
+#define LARGE_MEMBERS 27776             /* What the default spam_memory_kb holds */
+#define SECONDS_BETWEEN_POSTS 8         /* For an average member - the hot ones post 16x as often */
+#define CONTENTS 64                     /* Distinct messages from an average member */
+#define HOT_CONTENTS 2                  /* The hot ones repeat themselves */
+#define INTERVAL 5
+#define MAX_PER_INTERVAL 5
+#define DUPLICATES 3
+
+/* ---- Old layout, as spam_filter.c had it ---- */
+
+#define OLD_HISTORY 10
+
+typedef struct {
+    time_t timestamp;
+    uint32_t content_hash;
+} old_record_t;
+
+typedef struct {
+    uint64_t user_id;
+    uint64_t guild_id;
+    old_record_t history[OLD_HISTORY];
+    int history_head;
+    int history_count;
+    int guild_prev;
+    int guild_next;
+    uint8_t clock;
+} old_entry_t;
+
+static int old_is_rate_spam(const old_entry_t *user, time_t now) {
+    int recent_count = 0;
+    int count = user->history_count;
+    int idx = user->history_head;
+
+    for (int i = 0; i < count; i++) {
+        idx = (idx - 1 + OLD_HISTORY) % OLD_HISTORY;
+        if (now - user->history[idx].timestamp <= INTERVAL) {
+            recent_count++;
+        }
+    }
+    return recent_count >= MAX_PER_INTERVAL;
+}
+
+static int old_is_duplicate_spam(const old_entry_t *user, uint32_t content_hash) {
+    int duplicates = 0;
+    int count = user->history_count;
+    int idx = user->history_head;
+
+    for (int i = 0; i < count; i++) {
+        idx = (idx - 1 + OLD_HISTORY) % OLD_HISTORY;
+        if (user->history[idx].content_hash == content_hash) {
+            duplicates++;
+        }
+    }
+    return duplicates >= DUPLICATES;
+}
+
+static inline void old_add(old_entry_t *user, time_t now, uint32_t content_hash) {
+    user->history[user->history_head].timestamp = now;
+    user->history[user->history_head].content_hash = content_hash;
+    user->history_head = (user->history_head + 1) % OLD_HISTORY;
+    if (user->history_count < OLD_HISTORY) {
+        user->history_count++;
+    }
+}
+
+/* ---- New layout ---- */
+
+typedef struct {
+    uint64_t user_id;
+    uint64_t guild_id;
+    spam_history_t history;
+    int guild_prev;
+    int guild_next;
+    uint8_t clock;
+} new_entry_t;
+
+/* ---- Runs ---- */
+
+typedef struct {
+    uint32_t member;
+    uint32_t content;
+} bench_message_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Returns 0 when both layouts flag the same messages */
+static int run(int members, uint64_t *state) {
+    uint32_t hashes[CONTENTS];
+    uint64_t *users = malloc(sizeof(uint64_t) * members);
+    bench_message_t *stream = malloc(sizeof(bench_message_t) * MESSAGES);
+    old_entry_t *old_entries = calloc((size_t)members, sizeof(old_entry_t));
+    new_entry_t *new_entries = calloc((size_t)members, sizeof(new_entry_t));
+    uint64_t guild = rng_next(state);
+    u64map_t index;
+
+    for (int i = 0; i < CONTENTS; i++) hashes[i] = (uint32_t)rng_next(state);
+    u64map_init(&index, (size_t)members);
+    for (int i = 0; i < members; i++) {
+        users[i] = rng_next(state);
+        *u64map_insert(&index, users[i], guild, NULL) = (uint64_t)i;
+        old_entries[i].user_id = new_entries[i].user_id = users[i];
+        old_entries[i].guild_id = new_entries[i].guild_id = guild;
+        spam_history_reset(&new_entries[i].history);
+    }
+
+    /* A quarter of the traffic comes from 1/64 of the members, so those trip the checks */
+    int per_second = members / SECONDS_BETWEEN_POSTS;
+    for (int i = 0; i < MESSAGES; i++) {
+        uint64_t r = rng_next(state);
+        int hot = (r & 3) == 0;
+        stream[i].member = (uint32_t)((r >> 8) % (uint64_t)(hot ? (members + 63) / 64 : members));
+        stream[i].content = (uint32_t)((r >> 40) % (hot ? HOT_CONTENTS : CONTENTS));
+    }
+
+    printf("\n%d members (%zu -> %zu bytes each), %d messages\n",
+           members, sizeof(old_entry_t), sizeof(new_entry_t), MESSAGES);
+
+    long old_spam = 0;
+    double start = now_ms();
+    for (int i = 0; i < MESSAGES; i++) {
+        const bench_message_t *m = &stream[i];
+        time_t now = 1700000000 + i / per_second;
+        old_entry_t *user = &old_entries[*u64map_find(&index, users[m->member], guild)];
+        old_add(user, now, hashes[m->content]);
+        old_spam += old_is_rate_spam(user, now) || old_is_duplicate_spam(user, hashes[m->content]);
+    }
+    double old_ms = now_ms() - start;
+
+    long new_spam = 0;
+    start = now_ms();
+    for (int i = 0; i < MESSAGES; i++) {
+        const bench_message_t *m = &stream[i];
+        uint32_t now = (uint32_t)(i / per_second);
+        new_entry_t *user = &new_entries[*u64map_find(&index, users[m->member], guild)];
+        int recent, duplicates;
+        spam_history_add(&user->history, now, hashes[m->content]);
+        spam_history_count(&user->history, now, INTERVAL, hashes[m->content], &recent, &duplicates);
+        new_spam += recent >= MAX_PER_INTERVAL || duplicates >= DUPLICATES;
+    }
+    double new_ms = now_ms() - start;
+
+    printf("  %-28s %8.2f ms  %6.2f ns/msg\n", "records + two walks", old_ms, old_ms * 1e6 / MESSAGES);
+    printf("  %-28s %8.2f ms  %6.2f ns/msg\n", "packed + one vector pass", new_ms, new_ms * 1e6 / MESSAGES);
+    printf("  flagged %ld / %ld messages\n", old_spam, new_spam);
+
+    u64map_free(&index);
+    free(users);
+    free(stream);
+    free(old_entries);
+    free(new_entries);
+    return old_spam == new_spam ? 0 : 1;
+}
+
+int main(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    int wrong = run(SMALL_MEMBERS, &state);
+    wrong |= run(LARGE_MEMBERS, &state);
+
+    if (wrong) {
+        printf("\nThe layouts disagree on which messages are spam\n");
+        return 1;
+    }
+    printf("\nBoth layouts flag the same messages\n");
+    return 0;
+}
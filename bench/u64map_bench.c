@@ -0,0 +1,428 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Hash Map Benchmark
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * Compares u64map against the tables it replaced: the prime-bucket chained
+ * table with a free list (spam filter, auto-cleaner), the int-slot linear
+ * probing table (XP batcher) and the zero-keyed linear probing table with
+ * backward-shift deletion (voice XP, level roles, cooldowns, rank index,
+ * leaderboard, settings cache, bot bans), on snowflake-shaped (user, guild)
+ * keys. Runs at the spam filter's old capacity and at a size well past the
+ * L2 cache.
+ */
+
+#include "u64map.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SMALL_KEYS 1024                 /* The spam filter's old MAX_TRACKED_USERS */
+#define SMALL_BUCKETS 1543              /* SPAM_HASH_SIZE */
+#define LARGE_KEYS 100000
+#define LARGE_BUCKETS 150001            /* Prime, about 1.5x the keys */
+#define OPS_PER_RUN 2000000             /* Each size repeats until it has done this many of each op */
+
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+} bench_key_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/* Discord snowflake: ms timestamp, worker, process, increment */
+static uint64_t snowflake(uint64_t *state) {
+    uint64_t ms = 1400000000000ULL + rng_next(state) % 300000000000ULL;
+    return (ms << 22) | (rng_next(state) & 0x3FFFFF);
+}
+
+/* ---- Chained table as in the old spam filter ---- */
+
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+    int next;
+    int in_use;
+} chained_entry_t;
+
+typedef struct {
+    chained_entry_t *entries;
+    int *buckets;
+    uint32_t bucket_count;
+    int free_head;
+} chained_t;
+
+static inline uint32_t chained_hash(const chained_t *t, uint64_t a, uint64_t b) {
+    uint64_t h = 14695981039346656037ULL;
+    h ^= a;
+    h *= 1099511628211ULL;
+    h ^= b;
+    h *= 1099511628211ULL;
+    return (uint32_t)(h % t->bucket_count);
+}
+
+static void chained_init(chained_t *t, int keys, uint32_t buckets) {
+    t->entries = malloc(sizeof(chained_entry_t) * keys);
+    t->buckets = malloc(sizeof(int) * buckets);
+    t->bucket_count = buckets;
+    memset(t->buckets, 0xff, sizeof(int) * buckets);
+    for (int i = 0; i < keys; i++) {
+        t->entries[i].next = i + 1 < keys ? i + 1 : -1;
+        t->entries[i].in_use = 0;
+    }
+    t->free_head = 0;
+}
+
+static int chained_find(const chained_t *t, uint64_t a, uint64_t b) {
+    for (int i = t->buckets[chained_hash(t, a, b)]; i >= 0; i = t->entries[i].next) {
+        if (t->entries[i].in_use && t->entries[i].a == a && t->entries[i].b == b) return i;
+    }
+    return -1;
+}
+
+/* The modules always looked the key up first */
+static void chained_insert(chained_t *t, uint64_t a, uint64_t b) {
+    if (chained_find(t, a, b) >= 0) return;
+    int i = t->free_head;
+    t->free_head = t->entries[i].next;
+    uint32_t bucket = chained_hash(t, a, b);
+    t->entries[i] = (chained_entry_t){ a, b, t->buckets[bucket], 1 };
+    t->buckets[bucket] = i;
+}
+
+static void chained_remove(chained_t *t, uint64_t a, uint64_t b) {
+    int *prev = &t->buckets[chained_hash(t, a, b)];
+    while (*prev >= 0) {
+        chained_entry_t *e = &t->entries[*prev];
+        if (e->a == a && e->b == b) {
+            int i = *prev;
+            *prev = e->next;
+            e->in_use = 0;
+            e->next = t->free_head;
+            t->free_head = i;
+            return;
+        }
+        prev = &e->next;
+    }
+}
+
+/* ---- Int-slot linear probing as in the old XP batcher (no deletion) ---- */
+
+typedef struct {
+    bench_key_t *keys;
+    int *slots;
+    int count;
+    int slot_count;
+} probing_t;
+
+static inline uint32_t probing_hash(uint64_t a, uint64_t b, int slot_count) {
+    uint64_t h = (a ^ (b * 2654435761ULL)) * 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(h >> 32) & (uint32_t)(slot_count - 1);
+}
+
+static void probing_init(probing_t *t, int keys) {
+    t->slot_count = 16;
+    while (t->slot_count < keys * 2) t->slot_count *= 2;
+    t->keys = malloc(sizeof(bench_key_t) * keys);
+    t->slots = malloc(sizeof(int) * t->slot_count);
+    memset(t->slots, 0xff, sizeof(int) * t->slot_count);
+    t->count = 0;
+}
+
+static int probing_find(const probing_t *t, uint64_t a, uint64_t b) {
+    uint32_t mask = (uint32_t)t->slot_count - 1;
+    for (uint32_t s = probing_hash(a, b, t->slot_count); t->slots[s] >= 0; s = (s + 1) & mask) {
+        const bench_key_t *k = &t->keys[t->slots[s]];
+        if (k->a == a && k->b == b) return t->slots[s];
+    }
+    return -1;
+}
+
+static void probing_insert(probing_t *t, uint64_t a, uint64_t b) {
+    if (probing_find(t, a, b) >= 0) return;
+    uint32_t mask = (uint32_t)t->slot_count - 1;
+    uint32_t s = probing_hash(a, b, t->slot_count);
+    while (t->slots[s] >= 0) s = (s + 1) & mask;
+    t->keys[t->count] = (bench_key_t){ a, b };
+    t->slots[s] = t->count++;
+}
+
+/* ---- Zero-keyed linear probing with backward shift, as in the modules ---- */
+
+typedef struct {
+    uint64_t a;                         /* 0 = empty */
+    uint64_t b;
+    uint64_t value;
+} shift_slot_t;
+
+typedef struct {
+    shift_slot_t *slots;
+    size_t capacity;                    /* Power of two */
+    size_t count;
+} shift_t;
+
+static inline size_t shift_hash(uint64_t a, uint64_t b, size_t capacity) {
+    uint64_t h = a * 0x9E3779B97F4A7C15ULL ^ b * 0xBF58476D1CE4E5B9ULL;
+    return (size_t)(h ^ (h >> 29)) & (capacity - 1);
+}
+
+static void shift_init(shift_t *t, size_t capacity) {
+    t->capacity = capacity;
+    t->count = 0;
+    t->slots = calloc(capacity, sizeof(shift_slot_t));
+}
+
+static shift_slot_t *shift_find(const shift_t *t, uint64_t a, uint64_t b) {
+    size_t mask = t->capacity - 1;
+    for (size_t i = shift_hash(a, b, t->capacity); t->slots[i].a != 0; i = (i + 1) & mask) {
+        if (t->slots[i].a == a && t->slots[i].b == b) return &t->slots[i];
+    }
+    return NULL;
+}
+
+static void shift_place(shift_t *t, shift_slot_t slot) {
+    size_t mask = t->capacity - 1;
+    size_t i = shift_hash(slot.a, slot.b, t->capacity);
+    while (t->slots[i].a != 0) i = (i + 1) & mask;
+    t->slots[i] = slot;
+}
+
+/* Doubles past half full, as the module tables did */
+static void shift_insert(shift_t *t, uint64_t a, uint64_t b, uint64_t value) {
+    shift_slot_t *slot = shift_find(t, a, b);
+    if (slot) {
+        slot->value = value;
+        return;
+    }
+    if ((t->count + 1) * 2 > t->capacity) {
+        shift_t grown;
+        shift_init(&grown, t->capacity * 2);
+        for (size_t i = 0; i < t->capacity; i++) {
+            if (t->slots[i].a != 0) shift_place(&grown, t->slots[i]);
+        }
+        grown.count = t->count;
+        free(t->slots);
+        *t = grown;
+    }
+    shift_place(t, (shift_slot_t){ a, b, value });
+    t->count++;
+}
+
+static void shift_remove(shift_t *t, uint64_t a, uint64_t b) {
+    shift_slot_t *slot = shift_find(t, a, b);
+    if (!slot) return;
+
+    size_t mask = t->capacity - 1;
+    size_t hole = (size_t)(slot - t->slots);
+    for (size_t i = (hole + 1) & mask; t->slots[i].a != 0; i = (i + 1) & mask) {
+        size_t home = shift_hash(t->slots[i].a, t->slots[i].b, t->capacity);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            t->slots[hole] = t->slots[i];
+            hole = i;
+        }
+    }
+    t->slots[hole].a = 0;
+    t->count--;
+}
+
+/* ---- Runs ---- */
+
+static void report(const char *label, double ms, long ops) {
+    printf("  %-28s %8.2f ms  %6.2f ns/op\n", label, ms, ms * 1e6 / (double)ops);
+}
+
+/* Returns how far the lookups were from finding every inserted key and no other */
+static long run(int keys, uint32_t buckets, uint64_t *state) {
+    bench_key_t *inserts = malloc(sizeof(bench_key_t) * keys);
+    bench_key_t *lookups = malloc(sizeof(bench_key_t) * keys);
+    bench_key_t *misses = malloc(sizeof(bench_key_t) * keys);
+    int rounds = OPS_PER_RUN / keys;
+    long ops = (long)keys * rounds;
+    long found = 0;
+    uint64_t guilds[16];
+
+    for (int i = 0; i < 16; i++) guilds[i] = snowflake(state);
+    for (int i = 0; i < keys; i++) {
+        inserts[i] = (bench_key_t){ snowflake(state), guilds[rng_next(state) % 16] };
+        misses[i] = (bench_key_t){ snowflake(state), guilds[rng_next(state) % 16] };
+    }
+
+    /* Hits come in a different order than the inserts, otherwise the tables
+     * that keep entries in insertion order would read them sequentially */
+    memcpy(lookups, inserts, sizeof(bench_key_t) * keys);
+    for (int i = keys - 1; i > 0; i--) {
+        int j = (int)(rng_next(state) % (uint64_t)(i + 1));
+        bench_key_t tmp = lookups[i];
+        lookups[i] = lookups[j];
+        lookups[j] = tmp;
+    }
+
+    printf("\n%d (user, guild) keys, %d rounds\n", keys, rounds);
+
+    /* Chained */
+    double insert_ms = 0, hit_ms = 0, miss_ms = 0, churn_ms = 0;
+    for (int r = 0; r < rounds; r++) {
+        chained_t t;
+        chained_init(&t, keys, buckets);
+        double start = now_ms();
+        for (int i = 0; i < keys; i++) chained_insert(&t, inserts[i].a, inserts[i].b);
+        insert_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += chained_find(&t, lookups[i].a, lookups[i].b) >= 0;
+        hit_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += chained_find(&t, misses[i].a, misses[i].b) >= 0;
+        miss_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) {
+            chained_remove(&t, inserts[i].a, inserts[i].b);
+            chained_insert(&t, misses[i].a, misses[i].b);
+        }
+        churn_ms += now_ms() - start;
+        free(t.entries);
+        free(t.buckets);
+    }
+    printf("chained (%u prime buckets, free list):\n", buckets);
+    report("insert", insert_ms, ops);
+    report("find hit", hit_ms, ops);
+    report("find miss", miss_ms, ops);
+    report("remove + insert", churn_ms, ops);
+
+    /* Int-slot linear probing */
+    insert_ms = hit_ms = miss_ms = 0;
+    for (int r = 0; r < rounds; r++) {
+        probing_t t;
+        probing_init(&t, keys);
+        double start = now_ms();
+        for (int i = 0; i < keys; i++) probing_insert(&t, inserts[i].a, inserts[i].b);
+        insert_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += probing_find(&t, lookups[i].a, lookups[i].b) >= 0;
+        hit_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += probing_find(&t, misses[i].a, misses[i].b) >= 0;
+        miss_ms += now_ms() - start;
+        free(t.keys);
+        free(t.slots);
+    }
+    printf("int slots (linear probing, no deletion):\n");
+    report("insert", insert_ms, ops);
+    report("find hit", hit_ms, ops);
+    report("find miss", miss_ms, ops);
+
+    /* Zero-keyed linear probing, grown from 64 slots and presized */
+    double grow_ms = 0;
+    insert_ms = hit_ms = miss_ms = churn_ms = 0;
+    for (int r = 0; r < rounds; r++) {
+        shift_t t;
+        shift_init(&t, 64);
+        double start = now_ms();
+        for (int i = 0; i < keys; i++) shift_insert(&t, inserts[i].a, inserts[i].b, (uint64_t)i);
+        grow_ms += now_ms() - start;
+        free(t.slots);
+
+        size_t capacity = 64;
+        while (capacity < (size_t)keys * 2) capacity <<= 1;
+        shift_init(&t, capacity);
+        start = now_ms();
+        for (int i = 0; i < keys; i++) shift_insert(&t, inserts[i].a, inserts[i].b, (uint64_t)i);
+        insert_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += shift_find(&t, lookups[i].a, lookups[i].b) != NULL;
+        hit_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += shift_find(&t, misses[i].a, misses[i].b) != NULL;
+        miss_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) {
+            shift_remove(&t, inserts[i].a, inserts[i].b);
+            shift_insert(&t, misses[i].a, misses[i].b, (uint64_t)i);
+        }
+        churn_ms += now_ms() - start;
+        free(t.slots);
+    }
+    printf("zero-keyed slots (linear probing, backward shift):\n");
+    report("insert from 64", grow_ms, ops);
+    report("insert presized", insert_ms, ops);
+    report("find hit", hit_ms, ops);
+    report("find miss", miss_ms, ops);
+    report("remove + insert", churn_ms, ops);
+
+    /* u64map, grown from empty, presized like the XP buffer, and reserved
+     * the way the modules size their indexes from a known count */
+    double reserve_ms = 0;
+    grow_ms = 0;
+    insert_ms = hit_ms = miss_ms = churn_ms = 0;
+    for (int r = 0; r < rounds; r++) {
+        u64map_t map;
+        u64map_init(&map, 0);
+        double start = now_ms();
+        for (int i = 0; i < keys; i++) *u64map_insert(&map, inserts[i].a, inserts[i].b, NULL) = (uint64_t)i;
+        grow_ms += now_ms() - start;
+        u64map_free(&map);
+
+        u64map_init(&map, 64);
+        start = now_ms();
+        u64map_reserve(&map, (size_t)keys);
+        for (int i = 0; i < keys; i++) *u64map_insert(&map, inserts[i].a, inserts[i].b, NULL) = (uint64_t)i;
+        reserve_ms += now_ms() - start;
+        u64map_free(&map);
+
+        u64map_init(&map, (size_t)keys * 2);
+        start = now_ms();
+        for (int i = 0; i < keys; i++) *u64map_insert(&map, inserts[i].a, inserts[i].b, NULL) = (uint64_t)i;
+        insert_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += u64map_find(&map, lookups[i].a, lookups[i].b) != NULL;
+        hit_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) found += u64map_find(&map, misses[i].a, misses[i].b) != NULL;
+        miss_ms += now_ms() - start;
+        start = now_ms();
+        for (int i = 0; i < keys; i++) {
+            u64map_remove(&map, inserts[i].a, inserts[i].b);
+            *u64map_insert(&map, misses[i].a, misses[i].b, NULL) = (uint64_t)i;
+        }
+        churn_ms += now_ms() - start;
+        u64map_free(&map);
+    }
+    printf("u64map (group probing, backward shift):\n");
+    report("insert from empty", grow_ms, ops);
+    report("insert reserved", reserve_ms, ops);
+    report("insert presized", insert_ms, ops);
+    report("find hit", hit_ms, ops);
+    report("find miss", miss_ms, ops);
+    report("remove + insert", churn_ms, ops);
+
+    free(inserts);
+    free(lookups);
+    free(misses);
+
+    /* Every table sees each key once per round as a hit and never as a miss */
+    return found - ops * 4;
+}
+
+int main(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    long wrong = run(SMALL_KEYS, SMALL_BUCKETS, &state);
+    wrong += run(LARGE_KEYS, LARGE_BUCKETS, &state);
+
+    if (wrong != 0) {
+        printf("\nLookups disagree with the inserted keys (off by %ld)\n", wrong);
+        return 1;
+    }
+    printf("\nAll lookups agree with the inserted keys\n");
+    return 0;
+}
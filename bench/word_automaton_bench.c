@@ -0,0 +1,157 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Banned Word Automaton Benchmark
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ *
+ * Time per message of the word filter's scan against lists of 10 to
+ * 10000 words, next to the obvious loop: normalize once, then strstr()
+ * for every word. The loop grows with the list, the automaton shouldn't.
+ * Also checks both find the words planted in the messages.
+ */
+
+#include "word_automaton.h"
+#include "content_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MESSAGE_COUNT 512
+#define RUN_MS 200.0                    /* Each measurement repeats for at least this long */
+#define PLANT_EVERY 8                   /* One message in this many holds a banned word */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static uint64_t rng_next(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static const char *chat_words[] = {
+    "the", "Discord", "server", "is", "so", "good", "today", "lol", "who", "wants", "to",
+    "play", "later?", "I'm", "down", "for", "a", "match", "gg", "nice", "one!", "\xf0\x9f\x92\x95",
+};
+
+/* Random lowercase words - with 'q' in every one they never turn up in chat_words */
+static char **build_words(uint64_t *state, int count) {
+    char **words = malloc(sizeof(char *) * count);
+    for (int i = 0; i < count; i++) {
+        int length = 4 + (int)(rng_next(state) % 7);
+        words[i] = malloc((size_t)length + 1);
+        words[i][0] = 'q';
+        for (int k = 1; k < length; k++) {
+            words[i][k] = (char)('a' + rng_next(state) % 26);
+        }
+        words[i][length] = '\0';
+    }
+    return words;
+}
+
+/* Chat lines of roughly length bytes, every PLANT_EVERY-th with one of words in it */
+static char **build_messages(uint64_t *state, char **words, int word_count, int length) {
+    int chat_count = (int)(sizeof(chat_words) / sizeof(chat_words[0]));
+    char **messages = malloc(sizeof(char *) * MESSAGE_COUNT);
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+        char *m = malloc((size_t)length + 64);
+        size_t used = 0;
+        int plant_at = i % PLANT_EVERY == 0 ? (int)(rng_next(state) % (uint64_t)(length / 2)) : -1;
+        while ((int)used < length) {
+            const char *w = chat_words[rng_next(state) % (uint64_t)chat_count];
+            if (plant_at >= 0 && (int)used >= plant_at) {
+                w = words[rng_next(state) % (uint64_t)word_count];
+                plant_at = -1;
+            }
+            size_t n = strlen(w);
+            memcpy(m + used, w, n);
+            used += n;
+            m[used++] = ' ';
+        }
+        m[used - 1] = '\0';
+        messages[i] = m;
+    }
+    return messages;
+}
+
+static int scan_naive(char **words, int word_count, const char *content, size_t length, char *buf) {
+    buf[content_normalize(content, length, buf)] = '\0';
+    for (int i = 0; i < word_count; i++) {
+        if (strstr(buf, words[i])) return i;
+    }
+    return -1;
+}
+
+static void run(int word_count, int length) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL ^ (uint64_t)word_count;
+    char **words = build_words(&state, word_count);
+    char **messages = build_messages(&state, words, word_count, length);
+    size_t *lengths = malloc(sizeof(size_t) * MESSAGE_COUNT);
+    char *buf = malloc((size_t)length + 64);
+    for (int i = 0; i < MESSAGE_COUNT; i++) lengths[i] = strlen(messages[i]);
+
+    word_automaton_t automaton;
+    double start = now_ms();
+    if (word_automaton_build(&automaton, (const char *const *)words, (size_t)word_count) != 0) {
+        printf("  build failed\n");
+        exit(1);
+    }
+    double build_ms = now_ms() - start;
+
+    int found_naive = 0, found_automaton = 0;
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+        found_naive += scan_naive(words, word_count, messages[i], lengths[i], buf) >= 0;
+        found_automaton += word_automaton_scan(&automaton, messages[i], lengths[i]) >= 0;
+    }
+
+    long sink = 0, naive_scans = 0, automaton_scans = 0;
+    double naive_ms, automaton_ms;
+
+    start = now_ms();
+    do {
+        for (int i = 0; i < MESSAGE_COUNT; i++) sink += scan_naive(words, word_count, messages[i], lengths[i], buf);
+        naive_scans += MESSAGE_COUNT;
+    } while ((naive_ms = now_ms() - start) < RUN_MS);
+
+    start = now_ms();
+    do {
+        for (int i = 0; i < MESSAGE_COUNT; i++) sink += word_automaton_scan(&automaton, messages[i], lengths[i]);
+        automaton_scans += MESSAGE_COUNT;
+    } while ((automaton_ms = now_ms() - start) < RUN_MS);
+
+    printf("  %6d words  %5d bytes  %10.1f ns/msg  %8.1f ns/msg  %6u states  %6zu KB  %7.2f ms build  %3d/%d found\n",
+           word_count, length, naive_ms * 1e6 / (double)naive_scans, automaton_ms * 1e6 / (double)automaton_scans,
+           automaton.states, automaton.size * sizeof(word_cell_t) / 1024, build_ms,
+           found_automaton, found_naive);
+    if (sink == 42) printf("  (unlikely)\n");
+    if (found_automaton != found_naive || found_automaton != MESSAGE_COUNT / PLANT_EVERY) {
+        printf("  automaton and strstr disagree\n");
+        exit(1);
+    }
+
+    word_automaton_free(&automaton);
+    for (int i = 0; i < MESSAGE_COUNT; i++) free(messages[i]);
+    for (int i = 0; i < word_count; i++) free(words[i]);
+    free(messages);
+    free(words);
+    free(lengths);
+    free(buf);
+}
+
+int main(void) {
+    static const int word_counts[] = { 10, 100, 500, 1000, 10000 };
+    static const int lengths[] = { 80, 2000 };
+
+    printf("Banned word scan, normalize + strstr per word against one automaton pass\n");
+    printf("  %6s words  %5s bytes  %10s         %8s\n", "", "", "strstr", "automaton");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        for (size_t w = 0; w < sizeof(word_counts) / sizeof(word_counts[0]); w++) {
+            run(word_counts[w], lengths[l]);
+        }
+    }
+    return 0;
+}
@@ -7,22 +7,75 @@
 #ifndef YUNO_BOT_H
 #define YUNO_BOT_H
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <concord/discord.h>
 #include "config.h"
 #include "database.h"
+#include "db_writer.h"
+#include "xp_journal.h"
+#include "leaderboard.h"
+#include "rank_index.h"
+#include "xp_cooldown.h"
+#include "u64map.h"
 
-/* XP Batcher for batching XP updates with hash table */
-#define MAX_PENDING_XP 256
-#define XP_HASH_SIZE 389  /* Prime number larger than MAX_PENDING_XP */
+/* XP Batcher - message handlers add into the active buffer while a
+ * background thread swaps it out and hands it to the database writer */
+#define XP_BUFFER_INITIAL_CAPACITY 256  /* Entries, grows on demand */
+#define XP_FLUSH_THRESHOLD 256          /* Wake the flusher early at this many entries */
+#define LEVEL_UP_BATCH_LIMIT 25         /* Most level-ups one announcement may list */
 
 typedef struct {
-    pending_xp_t pending[MAX_PENDING_XP];
-    int hash_table[XP_HASH_SIZE];  /* Hash buckets -> index in pending[], -1 = empty */
-    int hash_next[MAX_PENDING_XP]; /* Chain for hash collisions */
+    pending_xp_t *pending;
+    u64map_t index;                /* (user, guild) -> index in pending[] */
     int count;
-    int64_t last_flush;
+    int capacity;                  /* pending[] size */
+} xp_buffer_t;
+
+typedef struct {
+    xp_buffer_t buffers[2];
+    int active;                    /* Buffer currently receiving adds */
+    pthread_mutex_t lock;          /* Guards the active buffer and the swap */
+    pthread_cond_t wakeup;
+    pthread_t thread;
+    int running;
+    int flush_requested;
+    int flush_interval;            /* Seconds between timed flushes */
+    xp_journal_t journal;          /* Crash log of the active buffer */
+    uint64_t carried_first;        /* Generations whose entries were put back into the */
+    uint64_t carried_last;         /* active buffer without being journaled again (0 = none) */
+
+    /* Statistics */
+    atomic_uint_fast64_t flushes;        /* Batches handed to the writer */
+    atomic_uint_fast64_t entries;        /* Entries committed */
+    atomic_uint_fast64_t dropped;        /* Entries lost to allocation or commit failures */
+    atomic_uint_fast64_t requeued;       /* Entries put back because the writer queue was full */
+    atomic_uint_fast64_t last_flush_us;  /* Swap to commit, most recent batch */
+    atomic_uint_fast64_t max_flush_us;
+    atomic_uint_fast64_t total_flush_us;
+    atomic_uint_fast64_t level_ups;      /* Level-ups announced */
+    atomic_uint_fast64_t level_up_messages; /* Messages those announcements took */
 } xp_batcher_t;
 
+typedef struct {
+    int pending;
+    int capacity;
+    uint64_t flushes;
+    uint64_t entries;
+    uint64_t dropped;
+    uint64_t requeued;
+    uint64_t last_flush_us;
+    uint64_t max_flush_us;
+    uint64_t avg_flush_us;
+    uint64_t level_ups;
+    uint64_t level_up_messages;
+    int journal_enabled;
+    uint64_t journal_records;
+    uint64_t journal_syncs;
+    uint64_t journal_errors;
+    uint64_t journal_replayed;
+} xp_batcher_stats_t;
+
 /* Connection state for auto-reconnection */
 typedef struct {
     int is_connected;
@@ -34,8 +87,12 @@ typedef struct {
     struct discord *client;
     yuno_config_t config;
     yuno_database_t database;
+    db_writer_t db_writer;
     int running;
     xp_batcher_t xp_batcher;
+    leaderboard_cache_t leaderboard;
+    rank_index_t ranks;
+    xp_cooldown_t xp_cooldown;
     connection_state_t connection;
 } yuno_bot_t;
 
@@ -52,18 +109,38 @@ void bot_stop(yuno_bot_t *bot);
 void on_ready(struct discord *client, const struct discord_ready *event);
 void on_message_create(struct discord *client, const struct discord_message *message);
 void on_interaction_create(struct discord *client, const struct discord_interaction *interaction);
+void on_voice_state_update(struct discord *client, const struct discord_voice_state *state);
+void on_guild_create(struct discord *client, const struct discord_guild *guild);
+void on_guild_update(struct discord *client, const struct discord_guild *guild);
+void on_guild_delete(struct discord *client, const struct discord_guild *guild);
+void on_guild_member_update(struct discord *client, const struct discord_guild_member_update *event);
+void on_guild_role_create(struct discord *client, const struct discord_guild_role_create *event);
+void on_guild_role_update(struct discord *client, const struct discord_guild_role_update *event);
+void on_guild_role_delete(struct discord *client, const struct discord_guild_role_delete *event);
+void on_guild_member_add(struct discord *client, const struct discord_guild_member *member);
 
 /* Slash command registration */
 int bot_register_commands(yuno_bot_t *bot);
 
 /* Utility functions */
 int bot_is_master_user(yuno_bot_t *bot, uint64_t user_id);
+
+/* Master users, or members holding any of permissions (administrators and the
+ * guild owner hold them all) - the GUILD_PERM_* bits in modules/guild_roles.h */
+int bot_interaction_allowed(yuno_bot_t *bot, const struct discord_interaction *interaction, uint64_t permissions);
+int bot_message_allowed(yuno_bot_t *bot, const struct discord_message *msg, uint64_t permissions);
+void bot_format_insufficient_permissions(yuno_bot_t *bot, uint64_t user_id, char *out, size_t len);
 uint64_t parse_user_mention(const char *mention);
 void format_duration(int64_t seconds, char *buffer, size_t len);
 
-/* XP batching */
-void xp_batcher_init(xp_batcher_t *batcher);
+/* XP batching - stop flushes whatever is still pending before returning */
+int xp_batcher_init(xp_batcher_t *batcher, int flush_interval);
+int xp_batcher_start(yuno_bot_t *bot);
+void xp_batcher_stop(yuno_bot_t *bot);
+void xp_batcher_cleanup(xp_batcher_t *batcher);
 void xp_batcher_add(yuno_bot_t *bot, uint64_t user_id, uint64_t guild_id, uint64_t channel_id, int xp);
+void xp_batcher_add_many(yuno_bot_t *bot, const pending_xp_t *entries, int count);
 void xp_batcher_flush(yuno_bot_t *bot);
+void xp_batcher_get_stats(xp_batcher_t *batcher, xp_batcher_stats_t *stats);
 
 #endif /* YUNO_BOT_H */
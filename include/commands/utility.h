@@ -18,6 +18,10 @@ void cmd_auto_clean(struct discord *client, const struct discord_interaction *in
 void cmd_delay(struct discord *client, const struct discord_interaction *interaction);
 void cmd_xp(struct discord *client, const struct discord_interaction *interaction);
 void cmd_leaderboard(struct discord *client, const struct discord_interaction *interaction);
+void cmd_xp_cooldown(struct discord *client, const struct discord_interaction *interaction);
+void cmd_level_role(struct discord *client, const struct discord_interaction *interaction);
+void cmd_spam_policy(struct discord *client, const struct discord_interaction *interaction);
+void cmd_word_filter(struct discord *client, const struct discord_interaction *interaction);
 
 /* Prefix command handlers */
 void cmd_ping_prefix(struct discord *client, const struct discord_message *msg, const char *args);
@@ -28,5 +32,9 @@ void cmd_auto_clean_prefix(struct discord *client, const struct discord_message
 void cmd_delay_prefix(struct discord *client, const struct discord_message *msg, const char *args);
 void cmd_xp_prefix(struct discord *client, const struct discord_message *msg, const char *args);
 void cmd_leaderboard_prefix(struct discord *client, const struct discord_message *msg, const char *args);
+void cmd_xp_cooldown_prefix(struct discord *client, const struct discord_message *msg, const char *args);
+void cmd_level_role_prefix(struct discord *client, const struct discord_message *msg, const char *args);
+void cmd_spam_policy_prefix(struct discord *client, const struct discord_message *msg, const char *args);
+void cmd_word_filter_prefix(struct discord *client, const struct discord_message *msg, const char *args);
 
 #endif /* YUNO_COMMANDS_UTILITY_H */
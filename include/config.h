@@ -22,6 +22,16 @@ typedef struct {
     char master_users[MAX_MASTER_USERS][32];
     int master_user_count;
     int spam_max_warnings;
+    int xp_flush_interval;      /* Seconds between XP flushes to the database */
+    int xp_journal_enabled;     /* Journal pending XP so a crash loses nothing */
+    int level_up_batch_max;     /* Level-ups announced per message when a flush groups them */
+    int spam_memory_kb;         /* Memory for spam filter histories, shared by all guilds */
+    int spam_guild_quota_percent;   /* Share of those histories one guild may hold */
+    int raid_similar_users;     /* Accounts posting near-identical messages that make a raid, 0 = off */
+    int raid_similar_seconds;   /* ...within this many seconds */
+    int raid_memory_kb;         /* Memory for per-guild windows of recent messages */
+    int raid_lockdown_seconds;  /* How long a join, new account or mention surge locks a guild down, 0 = never */
+    int raid_slowmode_seconds;  /* Slowmode for its active channels meanwhile, 0 = leave them */
     char ban_default_image[MAX_PATH_LEN];
     char dm_message[MAX_MESSAGE_LEN];
     char insufficient_permissions_message[MAX_MESSAGE_LEN];
@@ -0,0 +1,42 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Message Content Fingerprints
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_CONTENT_HASH_H
+#define YUNO_CONTENT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 64-bit hash of a message after normalization, so trivial edits of a
+ * repeated message land on the same value. In the same pass it:
+ *   - folds case (ASCII, Latin-1, Latin Extended-A, Greek, Cyrillic)
+ *     and fullwidth forms down to ASCII
+ *   - strips accents from Latin-1 letters and drops combining marks, so
+ *     precomposed and decomposed text agree
+ *   - drops zero-width and other invisible format characters
+ *   - collapses whitespace runs to one space and trims both ends
+ * Invalid UTF-8 is hashed byte for byte. The hash is XXH64 of the
+ * normalized text, which is never materialized. */
+uint64_t content_fingerprint(const char *content, size_t length);
+
+#define CONTENT_SIMHASH_FEATURES 255    /* Shingles a SimHash looks at, from the start - one byte of votes */
+
+typedef struct {
+    uint64_t fingerprint;   /* content_fingerprint() */
+    uint64_t simhash;       /* Near-identical texts differ in only a few bits */
+    size_t length;          /* Of the normalized text */
+} content_hashes_t;
+
+/* The fingerprint plus, from the same pass, a SimHash over the normalized
+ * text's 4-byte shingles */
+void content_hashes(const char *content, size_t length, content_hashes_t *hashes);
+
+/* The normalized text itself, for matching rather than hashing. Folding
+ * never lengthens a character, so out needs at most length bytes. Returns
+ * the normalized length; out is not NUL-terminated. */
+size_t content_normalize(const char *content, size_t length, char *out);
+
+#endif /* YUNO_CONTENT_HASH_H */
@@ -10,15 +10,45 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <sqlite3.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "u64map.h"
 
 #define MAX_REASON_LEN 512
 #define MAX_PREFIX_LEN 16
+#define DEFAULT_XP_COOLDOWN 60    /* Seconds between XP awards per member */
+
+/* Spam policy - a guild without its own uses these */
+#define DEFAULT_SPAM_INTERVAL 5         /* Seconds the limits count over */
+#define DEFAULT_SPAM_MAX_MESSAGES 5     /* Messages in the interval that count as flooding */
+#define DEFAULT_SPAM_MAX_DUPLICATES 3   /* Copies of one message that count as repeating */
+#define MAX_SPAM_INTERVAL 60
+#define MAX_SPAM_LIMIT 10               /* Messages a spam history remembers */
+#define MIN_SPAM_LIMIT 2                /* 1 would flag every message */
+
+/* A raid lockdown cuts each limit to 3/5, rounding up - 5 becomes 3, 3 becomes 2 */
+#define SPAM_LOCKDOWN_LIMIT(limit) (((limit) * 3 + 4) / 5)
+
+/* Every distinct (interval, messages, duplicates) combination fits */
+#define SPAM_POLICY_TABLE_SIZE (MAX_SPAM_INTERVAL * (MAX_SPAM_LIMIT - MIN_SPAM_LIMIT + 1) * \
+                                (MAX_SPAM_LIMIT - MIN_SPAM_LIMIT + 1))
+
+/* A compiled spam policy - lockdown limits are worked out once, not per message */
+typedef struct {
+    uint8_t interval;
+    uint8_t max_messages;
+    uint8_t max_duplicates;
+    uint8_t lockdown_messages;
+    uint8_t lockdown_duplicates;
+} spam_policy_t;
 
 typedef struct {
     uint64_t guild_id;
     char prefix[MAX_PREFIX_LEN];
     int spam_filter_enabled;
     int leveling_enabled;
+    int xp_cooldown;              /* Seconds, 0 = every message earns XP */
+    uint32_t spam_policy;         /* Index in the spam policy table, 0 = the defaults */
 } guild_settings_t;
 
 typedef struct {
@@ -55,6 +85,18 @@ typedef struct {
     int ignore_afk;
 } voice_xp_config_t;
 
+/* A banned word or phrase, stored normalized */
+#define MAX_BANNED_WORD_LEN 100
+typedef struct {
+    char word[MAX_BANNED_WORD_LEN + 1];
+} banned_word_t;
+
+/* Role handed out on reaching a level */
+typedef struct {
+    int level;
+    uint64_t role_id;
+} level_role_t;
+
 /* Activity log entry */
 typedef struct {
     int64_t id;
@@ -94,8 +136,139 @@ typedef struct {
     int64_t added_at;
 } pending_xp_t;
 
+/* Outcome of applying one pending XP entry */
+typedef struct {
+    uint64_t user_id;
+    uint64_t guild_id;
+    uint64_t channel_id;
+    int64_t old_xp;
+    int64_t new_xp;
+    int old_level;
+    int new_level;
+} xp_flush_result_t;
+
+/* Cached prepared statements - one per db_* query */
+typedef enum {
+    DB_STMT_GET_GUILD_SETTINGS,
+    DB_STMT_SET_GUILD_SETTINGS,
+    DB_STMT_SET_SPAM_POLICY,
+    DB_STMT_REMOVE_SPAM_POLICY,
+    DB_STMT_GET_USER_XP,
+    DB_STMT_ADD_XP,
+    DB_STMT_SET_LEVEL,
+    DB_STMT_UPSERT_XP,
+    DB_STMT_GET_LEADERBOARD,
+    DB_STMT_GET_XP_DISTRIBUTION,
+    DB_STMT_LOG_MOD_ACTION,
+    DB_STMT_GET_MOD_ACTIONS,
+    DB_STMT_GET_MOD_STATS,
+    DB_STMT_GET_AUTO_CLEAN_CONFIG,
+    DB_STMT_SET_AUTO_CLEAN_CONFIG,
+    DB_STMT_REMOVE_AUTO_CLEAN_CONFIG,
+    DB_STMT_GET_ALL_AUTO_CLEAN_CONFIGS,
+    DB_STMT_ADD_SPAM_WARNING,
+    DB_STMT_GET_SPAM_WARNINGS,
+    DB_STMT_RESET_SPAM_WARNINGS,
+    DB_STMT_GET_LEVEL_ROLES,
+    DB_STMT_SET_LEVEL_ROLE,
+    DB_STMT_REMOVE_LEVEL_ROLE,
+    DB_STMT_GET_MEMBER_LEVELS,
+    DB_STMT_GET_VOICE_XP_CONFIG,
+    DB_STMT_SET_VOICE_XP_CONFIG,
+    DB_STMT_LOG_ACTIVITY,
+    DB_STMT_GET_ACTIVITY_LOGS,
+    DB_STMT_SAVE_DM,
+    DB_STMT_GET_DMS,
+    DB_STMT_MARK_DM_READ,
+    DB_STMT_GET_UNREAD_DM_COUNT,
+    DB_STMT_ADD_BOT_BAN,
+    DB_STMT_REMOVE_BOT_BAN,
+    DB_STMT_GET_BOT_BANS,
+    DB_STMT_MARK_XP_GENERATION,
+    DB_STMT_PRUNE_XP_GENERATIONS,
+    DB_STMT_IS_XP_GENERATION_COMMITTED,
+    DB_STMT_GET_MAX_XP_GENERATION,
+    DB_STMT_GET_BANNED_WORDS,
+    DB_STMT_ADD_BANNED_WORD,
+    DB_STMT_REMOVE_BANNED_WORD,
+    DB_STMT_GET_BANNED_WORD_GUILDS,
+    DB_STMT_COUNT
+} db_stmt_id_t;
+
+#define DB_READ_POOL_SIZE 4
+#define XP_GENERATIONS_KEPT 1024  /* Committed journal generations remembered for replay */
+#define SETTINGS_CACHE_INITIAL_CAPACITY 256
+#define BAN_FILTER_MIN_BITS 8192             /* Power of two */
+#define BAN_FILTER_BITS_PER_BAN 16           /* ~0.2% false positives with 4 probes */
+#define BAN_FILTER_HASHES 4
+#define BAN_SET_INITIAL_CAPACITY 64
+
+typedef struct {
+    guild_settings_t settings;
+    int present;  /* 0 = guild has no settings row (negative cache) */
+} settings_cache_entry_t;
+
+/* Guild settings cache - the index holds only ids, so a lookup touches its
+ * slots instead of whole rows. */
+typedef struct {
+    u64map_t index;                  /* (guild, 0) -> index in entries[] */
+    settings_cache_entry_t *entries;
+    size_t capacity;
+    size_t count;
+    pthread_rwlock_t lock;
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+} settings_cache_t;
+
+/* Spam policies, each distinct one compiled once. Guilds share entries by
+ * index, and an entry never changes or moves once handed out, so readers
+ * holding an index from the settings cache need no lock. */
+typedef struct {
+    spam_policy_t *policies;         /* SPAM_POLICY_TABLE_SIZE, [0] = the defaults */
+    uint32_t count;
+    u64map_t index;                  /* (packed policy, 0) -> index in policies[] */
+    pthread_mutex_t lock;            /* Serializes compiling new entries */
+} spam_policy_table_t;
+
+/* Bot-ban index - a Bloom filter answers "not banned" for almost every
+ * author, and only its positives are confirmed against the exact set. */
+typedef struct {
+    uint64_t *bloom;
+    size_t bloom_bits;               /* Power of two */
+    u64map_t ids;                    /* (user, 0) -> unused */
+    size_t stale;                    /* Removals still set in the Bloom filter */
+    pthread_rwlock_t lock;
+    atomic_uint_fast64_t filtered;   /* Lookups rejected by the Bloom filter alone */
+    atomic_uint_fast64_t probed;     /* Lookups that had to check the set */
+    atomic_uint_fast64_t false_positives;
+} ban_filter_t;
+
+/* Read-only WAL connection - checked out by one query at a time */
 typedef struct {
     sqlite3 *db;
+    sqlite3_stmt *stmts[DB_STMT_COUNT]; /* Only the read-pool statements are prepared */
+    uint64_t stmt_prepares;
+    uint64_t stmt_reuses;
+    int in_use;
+} db_reader_t;
+
+typedef struct {
+    sqlite3 *db;                        /* The single writer connection */
+    sqlite3_stmt *stmts[DB_STMT_COUNT]; /* Prepared once at db_open, reset per call */
+    pthread_mutex_t lock;               /* Serializes use of the connection - recursive, held for a whole transaction */
+    uint64_t stmt_prepares;             /* Times a statement had to be compiled */
+    uint64_t stmt_reuses;               /* Times a cached statement was reused */
+
+    /* Read pool so slow queries never wait behind writes */
+    db_reader_t readers[DB_READ_POOL_SIZE];
+    int reader_count;
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_cond;
+    uint64_t reader_waits;              /* Checkouts that had to wait for a free reader */
+
+    settings_cache_t settings_cache;    /* Write-through cache of guild_settings */
+    spam_policy_table_t spam_policies;  /* Indexed by guild_settings_t.spam_policy */
+    ban_filter_t ban_filter;            /* In-memory mirror of bot_bans */
 } yuno_database_t;
 
 /* Database lifecycle */
@@ -103,17 +276,59 @@ int db_open(yuno_database_t *database, const char *path);
 void db_close(yuno_database_t *database);
 int db_initialize(yuno_database_t *database);
 
+/* Explicit transactions for batched writes - begin locks the connection
+ * until commit succeeds or rollback is called, which a failed commit needs */
+int db_begin(yuno_database_t *database);
+int db_commit(yuno_database_t *database);
+int db_rollback(yuno_database_t *database);
+
+/* Statement cache and read pool statistics */
+void db_get_stmt_stats(yuno_database_t *database, uint64_t *prepares, uint64_t *reuses);
+void db_get_pool_stats(yuno_database_t *database, int *readers, int *busy, uint64_t *waits);
+void db_get_settings_cache_stats(yuno_database_t *database, uint64_t *hits, uint64_t *misses, size_t *count);
+void db_get_ban_filter_stats(yuno_database_t *database, uint64_t *filtered, uint64_t *probed,
+                             uint64_t *false_positives, size_t *count);
+
 /* Guild settings */
 int db_get_guild_settings(yuno_database_t *database, uint64_t guild_id, guild_settings_t *settings);
 int db_set_guild_settings(yuno_database_t *database, const guild_settings_t *settings);
 int db_get_prefix(yuno_database_t *database, uint64_t guild_id, const char *default_prefix, char *out_prefix, size_t out_len);
 int db_set_prefix(yuno_database_t *database, uint64_t guild_id, const char *prefix);
+int db_set_xp_cooldown(yuno_database_t *database, uint64_t guild_id, const char *default_prefix, int seconds);
+
+/* Spam policies - set validates the limits and applies them to the next message */
+int db_set_spam_policy(yuno_database_t *database, uint64_t guild_id, const char *default_prefix,
+                       int interval, int max_messages, int max_duplicates);
+int db_reset_spam_policy(yuno_database_t *database, uint64_t guild_id);
+size_t db_get_spam_policy_count(yuno_database_t *database);
+
+/* The policy behind a guild_settings_t.spam_policy index */
+static inline const spam_policy_t *db_spam_policy(yuno_database_t *database, uint32_t index) {
+    return &database->spam_policies.policies[index];
+}
 
 /* XP/Leveling */
 int db_get_user_xp(yuno_database_t *database, uint64_t user_id, uint64_t guild_id, user_xp_t *xp);
 int db_add_xp(yuno_database_t *database, uint64_t user_id, uint64_t guild_id, int64_t amount);
 int db_set_level(yuno_database_t *database, uint64_t user_id, uint64_t guild_id, int level);
+int db_apply_xp_batch(yuno_database_t *database, const pending_xp_t *entries, int count,
+                      uint64_t first_generation, uint64_t last_generation, xp_flush_result_t *results);
 int db_get_leaderboard(yuno_database_t *database, uint64_t guild_id, user_xp_t *results, int max_results, int *count);
+int db_get_xp_distribution(yuno_database_t *database, uint64_t guild_id, int64_t **xp_values,
+                           uint32_t **member_counts, size_t *count);
+
+/* Level role rewards - rewards come back sorted by level, members by user id */
+int db_get_level_roles(yuno_database_t *database, uint64_t guild_id, level_role_t **roles, size_t *count);
+int db_set_level_role(yuno_database_t *database, uint64_t guild_id, int level, uint64_t role_id);
+int db_remove_level_role(yuno_database_t *database, uint64_t guild_id, int level);
+int db_get_member_levels(yuno_database_t *database, uint64_t guild_id, int min_level,
+                         uint64_t **user_ids, int **levels, size_t *count);
+
+/* Banned words - add returns 1 if the word was already there, remove 1 if it wasn't */
+int db_get_banned_words(yuno_database_t *database, uint64_t guild_id, banned_word_t **words, size_t *count);
+int db_add_banned_word(yuno_database_t *database, uint64_t guild_id, const char *word);
+int db_remove_banned_word(yuno_database_t *database, uint64_t guild_id, const char *word);
+int db_get_banned_word_guilds(yuno_database_t *database, uint64_t **guild_ids, size_t *count);
 
 /* Mod actions */
 int db_log_mod_action(yuno_database_t *database, const mod_action_t *action);
@@ -151,4 +366,8 @@ int db_remove_bot_ban(yuno_database_t *database, uint64_t user_id);
 int db_is_bot_banned(yuno_database_t *database, uint64_t user_id);
 int db_get_bot_bans(yuno_database_t *database, bot_ban_t *bans, int max_bans, int *count);
 
+/* XP journal generations - recorded in the same transaction as their batch */
+int db_is_xp_generation_committed(yuno_database_t *database, uint64_t generation);
+int db_get_max_xp_generation(yuno_database_t *database, uint64_t *generation);
+
 #endif /* YUNO_DATABASE_H */
@@ -0,0 +1,113 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Database Write-Behind Thread
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_DB_WRITER_H
+#define YUNO_DB_WRITER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "database.h"
+
+#define DB_WRITE_QUEUE_SIZE 1024  /* Must be a power of two */
+#define DB_WRITE_BATCH_MAX 256    /* Commands grouped into one transaction */
+
+/* Called exactly once per XP batch on the writer thread - with the results
+ * once committed, or with NULL and count -1 if the batch was rolled back */
+typedef void (*db_xp_done_fn)(void *user_data, const xp_flush_result_t *results, int count);
+
+typedef enum {
+    DB_WRITE_SAVE_DM,
+    DB_WRITE_LOG_MOD_ACTION,
+    DB_WRITE_ADD_SPAM_WARNING,
+    DB_WRITE_RESET_SPAM_WARNINGS,
+    DB_WRITE_XP_BATCH
+} db_write_type_t;
+
+typedef struct {
+    db_write_type_t type;
+    union {
+        dm_inbox_t dm;
+        mod_action_t mod_action;
+        struct {
+            uint64_t user_id;
+            uint64_t guild_id;
+        } spam;
+        struct {
+            pending_xp_t *entries;  /* Owned by the writer once queued */
+            int count;
+            uint64_t first_generation;
+            uint64_t last_generation;
+            db_xp_done_fn on_done;
+            void *user_data;
+        } xp;
+    } data;
+} db_write_cmd_t;
+
+/* One slot of the bounded MPSC ring - seq tells producers/consumer whose turn it is */
+typedef struct {
+    atomic_size_t seq;
+    db_write_cmd_t cmd;
+} db_write_cell_t;
+
+typedef struct {
+    yuno_database_t *database;
+    db_write_cell_t cells[DB_WRITE_QUEUE_SIZE];
+    atomic_size_t enqueue_pos;
+    atomic_size_t dequeue_pos;
+    sem_t wakeup;
+    pthread_t thread;
+    atomic_int running;
+    atomic_int producers;                /* Threads inside enqueue - stop waits for them */
+
+    /* Statistics */
+    atomic_uint_fast64_t commands;       /* Commands applied */
+    atomic_uint_fast64_t dropped;        /* XP batches turned away because the queue was full */
+    atomic_uint_fast64_t waits;          /* Writes that waited for room in the queue */
+    atomic_uint_fast64_t direct;         /* Writes made on the caller's thread after stop */
+    atomic_uint_fast64_t batches;        /* Transactions committed */
+    atomic_uint_fast64_t failed_batches; /* Transactions rolled back */
+    atomic_uint_fast64_t last_commit_us; /* Duration of the most recent transaction */
+    atomic_uint_fast64_t max_commit_us;
+    atomic_uint_fast64_t total_commit_us;
+} db_writer_t;
+
+typedef struct {
+    uint64_t queue_depth;
+    uint64_t commands;
+    uint64_t dropped;
+    uint64_t waits;
+    uint64_t direct;
+    uint64_t batches;
+    uint64_t failed_batches;
+    uint64_t last_commit_us;
+    uint64_t max_commit_us;
+    uint64_t avg_commit_us;
+} db_writer_stats_t;
+
+/* Writer lifecycle - stop drains everything still queued before returning */
+int db_writer_start(db_writer_t *writer, yuno_database_t *database);
+void db_writer_stop(db_writer_t *writer);
+
+/* Queue a write - waits for room if the queue is full, and writes directly
+ * once the writer has stopped. If the batch it lands in fails to commit it's
+ * written again on its own, and only logged if that fails too. */
+int db_writer_save_dm(db_writer_t *writer, const dm_inbox_t *dm);
+int db_writer_log_mod_action(db_writer_t *writer, const mod_action_t *action);
+int db_writer_add_spam_warning(db_writer_t *writer, uint64_t user_id, uint64_t guild_id);
+int db_writer_reset_spam_warnings(db_writer_t *writer, uint64_t user_id, uint64_t guild_id);
+
+/* Queue an XP batch - takes ownership of entries (malloc'd) only on success,
+ * returns -1 (and counts a drop) at once if the queue is full.
+ * Journal generations first..last (0 = none) are marked committed together with the batch. */
+int db_writer_submit_xp(db_writer_t *writer, pending_xp_t *entries, int count,
+                        uint64_t first_generation, uint64_t last_generation,
+                        db_xp_done_fn on_done, void *user_data);
+
+void db_writer_get_stats(db_writer_t *writer, db_writer_stats_t *stats);
+
+#endif /* YUNO_DB_WRITER_H */
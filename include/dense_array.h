@@ -0,0 +1,28 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Dense Array Growth
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_DENSE_ARRAY_H
+#define YUNO_DENSE_ARRAY_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define DENSE_ARRAY_INITIAL_CAPACITY 64
+
+/* Make room for one more element in a dense array, doubling it when full -
+ * the arrays a u64map indexes into, swap-removed so they never have holes */
+static inline int dense_array_reserve(void **array, size_t *capacity, size_t count, size_t size) {
+    if (count < *capacity) return 0;
+
+    size_t new_capacity = *capacity ? *capacity * 2 : DENSE_ARRAY_INITIAL_CAPACITY;
+    void *grown = realloc(*array, new_capacity * size);
+    if (!grown) return -1;
+    *array = grown;
+    *capacity = new_capacity;
+    return 0;
+}
+
+#endif /* YUNO_DENSE_ARRAY_H */
@@ -0,0 +1,58 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Leaderboard Cache
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_LEADERBOARD_H
+#define YUNO_LEADERBOARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "database.h"
+#include "u64map.h"
+
+#define LEADERBOARD_TOP_N 25               /* Ranks kept per guild */
+#define LEADERBOARD_INITIAL_CAPACITY 64    /* Guilds before the cache first grows */
+
+/* A guild's top ranks, sorted by xp descending. While count < LEADERBOARD_TOP_N
+ * the list holds every ranked member of the guild. */
+typedef struct {
+    uint64_t guild_id;
+    user_xp_t top[LEADERBOARD_TOP_N];
+    int count;
+} leaderboard_entry_t;
+
+/* Per-guild top-N, loaded once from the (guild_id, xp DESC) index and then
+ * kept current from committed XP flush results. XP only ever grows, which is
+ * what makes the incremental update exact - anything that lowers XP must
+ * call leaderboard_invalidate. */
+typedef struct {
+    u64map_t index;                  /* (guild, 0) -> index in entries[] */
+    leaderboard_entry_t *entries;    /* Dense, swap-removed on invalidate */
+    size_t capacity;
+    size_t count;
+    pthread_rwlock_t lock;
+    atomic_uint_fast64_t apply_seq;  /* Bumped by every leaderboard_apply */
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t misses;
+    atomic_uint_fast64_t updates;    /* Rank changes applied from flushes */
+} leaderboard_cache_t;
+
+int leaderboard_init(leaderboard_cache_t *cache);
+void leaderboard_free(leaderboard_cache_t *cache);
+
+/* Copy up to max_results of a guild's top ranks, loading the guild on first use */
+int leaderboard_get(leaderboard_cache_t *cache, yuno_database_t *database, uint64_t guild_id,
+                    user_xp_t *results, int max_results, int *count);
+
+/* Fold committed XP results into every cached guild they touch */
+void leaderboard_apply(leaderboard_cache_t *cache, const xp_flush_result_t *results, int count);
+
+void leaderboard_invalidate(leaderboard_cache_t *cache, uint64_t guild_id);
+void leaderboard_get_stats(leaderboard_cache_t *cache, uint64_t *hits, uint64_t *misses,
+                           uint64_t *updates, size_t *guilds);
+
+#endif /* YUNO_LEADERBOARD_H */
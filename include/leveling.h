@@ -0,0 +1,24 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Leveling Curve
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_LEVELING_H
+#define YUNO_LEVELING_H
+
+#include <stdint.h>
+
+/* Reaching level L takes LEVEL_XP_FACTOR * L^2 total XP */
+#define LEVEL_XP_FACTOR 100
+
+/* Highest level whose threshold xp has reached - exact at every threshold */
+int level_for_xp(int64_t xp);
+
+/* Total XP needed to reach level */
+int64_t level_threshold(int level);
+
+/* How far xp is toward the level after level, 0-100 */
+int level_progress(int64_t xp, int level);
+
+#endif /* YUNO_LEVELING_H */
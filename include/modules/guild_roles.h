@@ -0,0 +1,72 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Guild Roles Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_MODULES_GUILD_ROLES_H
+#define YUNO_MODULES_GUILD_ROLES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <concord/discord.h>
+#include "u64map.h"
+
+/* Permission bits the bot's commands check */
+#define GUILD_PERM_ADMINISTRATOR ((uint64_t)1 << 3)
+#define GUILD_PERM_MANAGE_GUILD  ((uint64_t)1 << 5)
+#define GUILD_PERM_MANAGE_ROLES  ((uint64_t)1 << 28)
+
+typedef struct {
+    uint64_t role_id;
+    uint64_t permissions;
+    int position;
+} guild_role_t;
+
+/* What the gateway told us about one guild's roles */
+typedef struct {
+    uint64_t guild_id;
+    uint64_t owner_id;
+    guild_role_t *roles;        /* Unsorted - a guild has at most a few hundred */
+    size_t role_count;
+    size_t role_capacity;
+    uint64_t *bot_roles;        /* Roles the bot itself holds here */
+    size_t bot_role_count;
+} guild_roles_guild_t;
+
+typedef struct {
+    guild_roles_guild_t *guilds;
+    size_t guild_count;
+    size_t guild_capacity;
+    u64map_t index;             /* guild -> index in guilds[] */
+    uint64_t self_id;           /* The bot's user, from READY */
+    pthread_mutex_t lock;
+} guild_roles_t;
+
+/* Forward declaration - include bot.h for full definition */
+#include "bot.h"
+
+/* Guild roles lifecycle */
+int guild_roles_init(yuno_bot_t *bot);
+void guild_roles_cleanup(void);
+
+/* Gateway events - guild create and guild update both replace the guild's roles */
+void guild_roles_on_ready(const struct discord_ready *event);
+void guild_roles_on_guild(const struct discord_guild *guild);
+void guild_roles_on_guild_delete(const struct discord_guild *guild);
+void guild_roles_on_role(uint64_t guild_id, const struct discord_role *role);
+void guild_roles_on_role_delete(uint64_t guild_id, uint64_t role_id);
+void guild_roles_on_member_update(uint64_t guild_id, uint64_t user_id, const struct snowflakes *roles);
+
+/* Guild-wide permissions of a member holding roles - every bit for the owner
+ * and administrators, none for a guild that hasn't been seen yet */
+uint64_t guild_roles_permissions(uint64_t guild_id, uint64_t user_id, const struct snowflakes *roles);
+
+/* 1 if the bot's (or a member's) highest role sits above role_id, 0 if not,
+ * -1 if the guild or role isn't known. The owner outranks every role. */
+int guild_roles_bot_outranks(uint64_t guild_id, uint64_t role_id);
+int guild_roles_member_outranks(uint64_t guild_id, uint64_t user_id, const struct snowflakes *roles,
+                                uint64_t role_id);
+
+#endif /* YUNO_MODULES_GUILD_ROLES_H */
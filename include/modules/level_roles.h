@@ -0,0 +1,127 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Level Role Rewards Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_MODULES_LEVEL_ROLES_H
+#define YUNO_MODULES_LEVEL_ROLES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <concord/discord.h>
+#include "database.h"
+#include "u64map.h"
+
+#define MAX_LEVEL_ROLES 25                  /* Rewards per guild */
+#define LEVEL_ROLES_GUILD_INTERVAL_MS 1000  /* Member role changes per guild - one a second... */
+#define LEVEL_ROLES_GUILD_BURST 5           /* ...after an initial burst of five */
+#define LEVEL_ROLES_GLOBAL_INTERVAL_MS 100  /* All guilds together, well under the global limit */
+#define LEVEL_ROLES_GLOBAL_BURST 10
+#define LEVEL_ROLES_PAGE_SIZE 1000          /* Members per list request during a resync */
+#define LEVEL_ROLES_POLL_MS 100             /* Drain interval while anything is queued */
+#define LEVEL_ROLES_SEND_BATCH 16           /* Changes sent per lock release */
+#define LEVEL_ROLES_INDEX_INITIAL_CAPACITY 256  /* Starting size of both maps */
+
+/* A role change on its way out */
+typedef struct {
+    uint64_t guild_id;
+    uint64_t user_id;
+    uint64_t role_id;
+    uint8_t remove;
+} role_change_t;
+
+/* A member's role waiting its turn in a guild's queue */
+typedef struct {
+    uint64_t user_id;
+    uint64_t role_id;
+} role_ref_t;
+
+typedef struct {
+    uint64_t guild_id;
+
+    level_role_t *rewards;          /* Sorted by level */
+    size_t reward_count;
+    int loaded;
+    uint32_t generation;            /* Bumped on config change, a stale load is dropped */
+
+    role_ref_t *queue;              /* Ring of changes in arrival order */
+    size_t head;
+    size_t queued;
+    size_t queue_capacity;
+    uint64_t next_ms;               /* GCRA theoretical arrival time */
+
+    int resync;                     /* Walking the member list */
+    uint64_t resync_after;          /* Last member seen */
+    uint64_t *resync_users;         /* Level snapshot, sorted by user id */
+    int *resync_levels;
+    size_t resync_count;
+    int resync_loaded;
+} level_roles_guild_t;
+
+/* Level-up handed over from an XP flush */
+typedef struct {
+    uint64_t guild_id;
+    uint64_t user_id;
+    int old_level;
+    int new_level;
+} level_roles_up_t;
+
+typedef struct {
+    level_roles_guild_t *guilds;
+    size_t guild_count;
+    size_t guild_capacity;
+    u64map_t guild_index;           /* (guild, 0) -> index in guilds[] */
+    size_t cursor;                  /* Round-robin position for the drain */
+    size_t resyncing;               /* Guilds with a resync in progress */
+
+    u64map_t pending;               /* (user, role) -> remove - at most one per key, newest wins */
+
+    level_roles_up_t *ups;
+    size_t up_count;
+    size_t up_capacity;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_t thread;
+    int running;
+    uint64_t global_next_ms;
+
+    uint64_t granted;
+    uint64_t removed;
+    uint64_t deduped;
+    uint64_t failed;
+    uint64_t resyncs;
+    uint64_t pages;
+} level_roles_t;
+
+typedef struct {
+    size_t guilds;
+    size_t queued;
+    uint64_t granted;
+    uint64_t removed;
+    uint64_t deduped;               /* Changes folded into one already queued */
+    uint64_t failed;
+    uint64_t resyncs;
+    uint64_t pages;
+} level_roles_stats_t;
+
+/* Forward declaration - include bot.h for full definition */
+#include "bot.h"
+
+/* Level roles lifecycle */
+int level_roles_init(yuno_bot_t *bot);
+int level_roles_start(void);
+void level_roles_stop(void);
+void level_roles_cleanup(void);
+
+/* Hand a flush's level-ups to the queue - runs on the DB writer thread */
+void level_roles_on_flushed(const xp_flush_result_t *results, int count);
+
+/* Drop the cached rewards and reconcile every member of the guild against them */
+void level_roles_resync(uint64_t guild_id);
+
+void level_roles_get_stats(level_roles_stats_t *stats);
+
+#endif /* YUNO_MODULES_LEVEL_ROLES_H */
@@ -0,0 +1,134 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Raid Guard Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_MODULES_RAID_GUARD_H
+#define YUNO_MODULES_RAID_GUARD_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <concord/discord.h>
+#include "u64map.h"
+#include "rate_window.h"
+
+#define RAID_GUARD_MAX_GUILDS 4096          /* Tracked at once - allocated up front */
+#define RAID_GUARD_CHANNELS 8               /* Recently active channels a lockdown slows */
+#define RAID_GUARD_NEW_ACCOUNT_DAYS 7       /* Younger accounts count as new */
+#define RAID_GUARD_EVERYONE_MENTIONS 10     /* What an @everyone or @here counts as */
+#define RAID_GUARD_POLL_SECONDS 2           /* Lockdown upkeep while any is running */
+#define RAID_GUARD_BATCH 16                 /* Channel changes sent per lock release */
+#define RAID_GUARD_LOCK_SLOTS 1024          /* Power of two - lockdowns readable without the lock */
+#define RAID_GUARD_LOCK_PROBES 8            /* Slots a lockdown may land in past its home */
+#define RAID_DEFAULT_LOCKDOWN_SECONDS 600   /* raid_lockdown_seconds */
+#define RAID_DEFAULT_SLOWMODE_SECONDS 10    /* raid_slowmode_seconds */
+
+/* Reaching any limit starts a lockdown, in the last 1, 10 and 60 seconds */
+#define RAID_JOIN_LIMITS { 8, 20, 50 }
+#define RAID_NEW_ACCOUNT_LIMITS { 10, 40, 120 }     /* Messages from new accounts */
+#define RAID_MENTION_LIMITS { 30, 100, 300 }
+
+/* What a guild's rates count */
+enum {
+    RAID_JOINS,
+    RAID_NEW_ACCOUNT_MESSAGES,
+    RAID_MENTIONS,
+    RAID_SIGNALS
+};
+
+/* Channel slowmode through a lockdown */
+enum {
+    RAID_CHANNEL_IDLE,
+    RAID_CHANNEL_SLOW,          /* Waiting to be slowed */
+    RAID_CHANNEL_SLOWED,        /* restore holds its own rate limit */
+    RAID_CHANNEL_RESTORE        /* Waiting to get it back */
+};
+
+typedef struct {
+    uint64_t channel_id;
+    int32_t restore;
+    uint8_t state;
+} raid_channel_t;
+
+typedef struct {
+    uint64_t guild_id;
+    int32_t lru_prev;           /* Evictable guilds, most recently active first - -1 ends */
+    int32_t lru_next;
+    uint8_t listed;             /* On that list - neither locked nor holding channels */
+    int16_t lock_slot;          /* Its entry in locks[] while locked, -1 if none was free */
+    rate_window_t rates[RAID_SIGNALS];
+    raid_channel_t channels[RAID_GUARD_CHANNELS];   /* Ring of recently active ones */
+    uint8_t channel_next;
+    uint8_t held;               /* Channels not idle - the guild can't be dropped */
+    uint8_t locked;
+    uint8_t cause;              /* RAID_* that started the lockdown */
+    uint32_t until;             /* Lockdown end, monotonic seconds */
+    uint32_t last_event;
+} raid_guard_guild_t;
+
+/* A lockdown as raid_guard_locked sees it. Written under the guard's lock,
+ * read without it - seq is odd while a write is under way. */
+typedef struct {
+    atomic_uint seq;
+    _Atomic uint64_t guild_id;
+    _Atomic uint32_t until;     /* Monotonic seconds, 0 = free */
+} raid_lock_slot_t;
+
+typedef struct {
+    raid_guard_guild_t *guilds; /* RAID_GUARD_MAX_GUILDS, dense */
+    int guild_count;
+    int lru_head;               /* Most recently active evictable guild */
+    int lru_tail;               /* Next to be reused once full */
+    u64map_t index;             /* (guild, 0) -> index in guilds[], sized never to grow */
+    atomic_int locked_count;    /* Read without the lock by raid_guard_locked */
+    raid_lock_slot_t locks[RAID_GUARD_LOCK_SLOTS];
+    atomic_int lock_overflow;   /* Lockdowns that found no slot - checked under the lock */
+    int pending;                /* Channels waiting on the thread */
+    uint32_t lockdown_seconds;  /* 0 = counting only */
+    int slowmode_seconds;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_t thread;
+    int running;
+
+    uint64_t lockdowns;
+    uint64_t extended;          /* Limits reached again during a lockdown */
+    uint64_t slowed;
+    uint64_t restored;
+    uint64_t failed;
+    uint64_t untracked;         /* Events lost with every tracked guild locked */
+} raid_guard_t;
+
+typedef struct {
+    int guilds;
+    int locked;
+    uint64_t lockdowns;
+    uint64_t extended;
+    uint64_t slowed;            /* Channels put into slowmode */
+    uint64_t restored;
+    uint64_t failed;
+    uint64_t untracked;
+} raid_guard_stats_t;
+
+/* Forward declaration - include bot.h for full definition */
+#include "bot.h"
+
+/* Raid guard lifecycle */
+int raid_guard_init(yuno_bot_t *bot);
+int raid_guard_start(void);
+void raid_guard_stop(void);
+void raid_guard_cleanup(void);
+
+/* Gateway events - only for guilds with the spam filter on */
+void raid_guard_on_member_join(const struct discord_guild_member *member);
+void raid_guard_on_message(const struct discord_message *msg);
+
+/* Whether the guild is in lockdown - XP pauses and the spam filter tightens */
+int raid_guard_locked(uint64_t guild_id);
+
+void raid_guard_get_stats(raid_guard_stats_t *stats);
+
+#endif /* YUNO_MODULES_RAID_GUARD_H */
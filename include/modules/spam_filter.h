@@ -9,39 +9,106 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 #include <concord/discord.h>
+#include "u64map.h"
+#include "spam_history.h"
+#include "near_dup.h"
 
-#define MAX_TRACKED_USERS 1024
-#define MAX_MESSAGE_HISTORY 10
-#define SPAM_INTERVAL_SECONDS 5
-#define MAX_MESSAGES_PER_INTERVAL 5
-#define DUPLICATE_THRESHOLD 3
+#define SPAM_CLOCK_MAX 3            /* Sweeps a busy history survives once the table is full */
+#define SPAM_DEFAULT_MEMORY_KB 8192 /* spam_memory_kb - roughly 28k histories */
+#define SPAM_DEFAULT_GUILD_PERCENT 10   /* spam_guild_quota_percent */
+#define SPAM_MIN_USERS 64           /* Histories kept however small the budget */
+#define SPAM_INITIAL_USERS 1024     /* Allocated at startup, doubled up to the budget */
+#define SPAM_GUILD_MIN_QUOTA 32     /* A guild may always hold this many */
+#define SPAM_DEFAULT_RAID_USERS 5   /* raid_similar_users */
+#define SPAM_DEFAULT_RAID_SECONDS 30    /* raid_similar_seconds */
+#define SPAM_DEFAULT_RAID_MEMORY_KB 2048    /* raid_memory_kb - about 190 guild windows */
+#define SPAM_RAID_MIN_LENGTH 24     /* Shorter messages ("gm", "same lol") repeat innocently */
 
-/* Hash table size - should be prime and larger than MAX_TRACKED_USERS */
-#define SPAM_HASH_SIZE 1543
-
-typedef struct {
-    time_t timestamp;
-    uint32_t content_hash;
-} message_record_t;
+/* spam_filter_check results */
+#define SPAM_FLAG_USER 1            /* One member flooding or repeating themselves */
+#define SPAM_FLAG_RAID 2            /* Many members posting near-identical messages */
 
 typedef struct {
     uint64_t user_id;
     uint64_t guild_id;
-    message_record_t history[MAX_MESSAGE_HISTORY];
-    int history_head;       /* Circular buffer head (next write position) */
-    int history_count;      /* Number of valid entries */
-    int hash_next;          /* Next index in hash chain (-1 = end) */
-    int in_use;             /* 1 if entry is active */
+    spam_history_t history;
+    int guild_prev;         /* Ring of the guild's histories */
+    int guild_next;
+    int warnings;           /* Authoritative while tracked - the database only catches up, -1 = not read yet */
+    uint8_t clock;          /* Raised on each message, lowered as the eviction hand passes */
 } user_message_history_t;
 
 typedef struct {
-    user_message_history_t users[MAX_TRACKED_USERS];
-    int hash_table[SPAM_HASH_SIZE]; /* Hash buckets -> index in users[], -1 = empty */
+    uint64_t guild_id;
+    int count;
+    int hand;               /* Next quota eviction candidate in the guild's ring */
+    int window;             /* Index in raid_windows, or -1 */
+} spam_guild_t;
+
+typedef struct {
+    uint64_t guild_id;
+    uint32_t last_used;     /* The least recently used window moves once all are taken */
+    uint32_t last_signal;   /* When this guild's raid last flagged a message */
+    int raiding;
+    near_dup_window_t recent;
+} spam_raid_window_t;
+
+/* Budgeted per history: the entry, a guild record in case it is the guild's
+ * only one, and for each the map slots at their sparsest right after a resize */
+#define SPAM_BYTES_PER_HISTORY (sizeof(user_message_history_t) + sizeof(spam_guild_t) + \
+                                2 * 3 * (sizeof(u64map_slot_t) + 1))
+
+typedef struct {
+    user_message_history_t *users;  /* Dense, grown on demand up to max_users */
     int user_count;
-    int free_head;          /* Head of free list */
+    int user_capacity;
+    int max_users;          /* From spam_memory_kb */
+    int guild_quota;        /* Histories one guild may hold, from spam_guild_quota_percent */
+    u64map_t index;         /* (user, guild) -> index in users[] */
+    spam_guild_t *guilds;   /* Dense, one per guild with a history */
+    int guild_count;
+    int guild_capacity;
+    u64map_t guild_index;   /* (guild, 0) -> index in guilds[] */
+    int clock_hand;         /* Next eviction candidate once max_users is reached */
+    spam_raid_window_t *raid_windows;   /* Dense, grown on demand up to raid_window_limit */
+    int raid_window_count;
+    int raid_window_capacity;
+    int raid_window_limit;  /* From raid_memory_kb */
+    int raid_users;         /* Distinct posters that make a raid, 0 = off */
+    uint32_t raid_seconds;
+    time_t epoch;           /* History times count seconds from here */
+    pthread_mutex_t lock;
+
+    uint64_t evictions;
+    uint64_t quota_evictions;   /* Of those, a guild at its quota replacing its own */
+    uint64_t evicted_active;    /* Evicted with a message inside the default spam interval */
+    uint64_t second_chances;    /* Hand passes that spared a history */
+    uint64_t raid_signals;      /* Raids reported */
+    uint64_t raid_flagged;      /* Messages caught as part of one */
+    uint64_t window_moves;      /* Raid windows taken from a quieter guild */
 } spam_filter_t;
 
+typedef struct {
+    int tracked;
+    int allocated;
+    int max_users;
+    int guilds;
+    int largest_guild;
+    int guild_quota;
+    size_t bytes;           /* Histories, guild records, both maps and raid windows */
+    uint64_t evictions;
+    uint64_t quota_evictions;
+    uint64_t evicted_active;
+    uint64_t second_chances;
+    int raid_windows;
+    int raid_window_limit;
+    uint64_t raid_signals;
+    uint64_t raid_flagged;
+    uint64_t window_moves;
+} spam_filter_stats_t;
+
 /* Forward declaration - include bot.h for full definition */
 #include "bot.h"
 
@@ -49,16 +116,19 @@ typedef struct {
 void spam_filter_init(yuno_bot_t *bot);
 void spam_filter_cleanup(void);
 
-/* Check message for spam, returns 1 if spam detected */
-int spam_filter_check(uint64_t user_id, uint64_t guild_id, const char *content);
+/* Check message for spam against the guild's policy, returns SPAM_FLAG_* bits - 0 if it's fine */
+int spam_filter_check(uint64_t user_id, uint64_t guild_id, const char *content, const spam_policy_t *policy);
 
 /* Handle spam detection - returns 1 if message was spam */
-int spam_filter_handle(yuno_bot_t *bot, const struct discord_message *msg);
+int spam_filter_handle(yuno_bot_t *bot, const struct discord_message *msg, const spam_policy_t *policy);
 
 /* Clear user history */
 void spam_filter_clear_user(uint64_t user_id, uint64_t guild_id);
 
-/* Hash function for content */
+void spam_filter_get_stats(spam_filter_stats_t *stats);
+
+/* Hash of the content after case folding and whitespace/invisible character
+ * cleanup, so small edits still count as duplicates */
 uint32_t hash_content(const char *content);
 
 #endif /* YUNO_MODULES_SPAM_FILTER_H */
@@ -23,5 +23,6 @@ void terminal_cmd_botban(const char *args);
 void terminal_cmd_botunban(const char *args);
 void terminal_cmd_botbanlist(void);
 void terminal_cmd_status(const char *args);
+void terminal_cmd_stats(void);
 
 #endif /* YUNO_TERMINAL_H */
@@ -0,0 +1,102 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Voice XP Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_MODULES_VOICE_XP_H
+#define YUNO_MODULES_VOICE_XP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <concord/discord.h>
+#include "u64map.h"
+
+#define VOICE_XP_TICK_SECONDS 60
+#define VOICE_INDEX_INITIAL_CAPACITY 256   /* Each index's starting size */
+
+/* Someone sitting in a voice channel */
+typedef struct {
+    uint64_t user_id;
+    uint64_t guild_id;
+    uint64_t channel_id;
+    uint32_t joined;            /* Monotonic seconds */
+    uint8_t is_bot;
+    uint8_t deafened;
+} voice_member_t;
+
+/* Occupancy of one voice channel */
+typedef struct {
+    uint64_t channel_id;
+    uint64_t guild_id;
+    int occupants;
+    int humans;                 /* Occupants that aren't bots - what min_users counts */
+} voice_channel_t;
+
+typedef struct {
+    uint64_t guild_id;
+    uint64_t afk_channel_id;
+    int members;                /* Tracked members in this guild */
+} voice_guild_t;
+
+typedef struct {
+    voice_member_t *members;    /* Dense - the tick walks this straight through */
+    size_t member_count;
+    size_t member_capacity;
+    u64map_t member_index;     /* (guild, user) -> index in members[] */
+
+    voice_channel_t *channels;
+    size_t channel_count;
+    size_t channel_capacity;
+    u64map_t channel_index;     /* (channel, 0) */
+
+    voice_guild_t *guilds;
+    size_t guild_count;
+    size_t guild_capacity;
+    u64map_t guild_index;       /* (guild, 0) */
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_t thread;
+    int running;
+    uint32_t last_tick;         /* Members who joined after this sit out the next tick */
+
+    uint64_t ticks;
+    uint64_t last_awarded;
+    uint64_t total_awarded;
+    uint64_t total_xp;
+} voice_xp_t;
+
+typedef struct {
+    size_t members;
+    size_t channels;
+    uint64_t ticks;
+    uint64_t last_awarded;      /* Members paid on the most recent tick */
+    uint64_t total_awarded;
+    uint64_t total_xp;
+} voice_xp_stats_t;
+
+/* Forward declaration - include bot.h for full definition */
+#include "bot.h"
+
+/* Voice XP lifecycle */
+int voice_xp_init(yuno_bot_t *bot);
+int voice_xp_start(void);
+void voice_xp_stop(void);
+void voice_xp_cleanup(void);
+
+/* Gateway events - guild create seeds (or resets) a guild's occupancy, guild delete drops it */
+void voice_xp_on_voice_state(const struct discord_voice_state *state);
+void voice_xp_on_guild_create(const struct discord_guild *guild);
+void voice_xp_on_guild_delete(const struct discord_guild *guild);
+
+/* Member updates carry the user, and so settle whether a tracked member is a bot */
+void voice_xp_on_member_update(uint64_t guild_id, const struct discord_user *user);
+
+/* Pay every eligible member for the last minute - runs on the tick thread */
+void voice_xp_tick(void);
+
+void voice_xp_get_stats(voice_xp_stats_t *stats);
+
+#endif /* YUNO_MODULES_VOICE_XP_H */
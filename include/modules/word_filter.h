@@ -0,0 +1,98 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Banned Word Filter Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_MODULES_WORD_FILTER_H
+#define YUNO_MODULES_WORD_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <concord/discord.h>
+#include "u64map.h"
+#include "word_automaton.h"
+
+#define WORD_FILTER_MAX_WORDS 500           /* Words and phrases per guild */
+#define WORD_FILTER_INITIAL_GUILDS 64       /* Grown on demand */
+
+/* A guild's compiled list. Scans take a reference so a rebuild can swap
+ * in its replacement at any time - the last one out frees it. */
+typedef struct {
+    atomic_int refs;            /* The guild's slot holds one, each scan in progress another */
+    word_automaton_t automaton;
+} word_filter_set_t;
+
+typedef struct {
+    uint64_t guild_id;
+    word_filter_set_t *set;     /* NULL = no words */
+} word_filter_guild_t;
+
+typedef struct {
+    word_filter_guild_t *guilds;    /* Dense, one per guild that ever had words */
+    int guild_count;
+    int guild_capacity;
+    u64map_t index;             /* (guild, 0) -> index in guilds[] */
+    pthread_rwlock_t lock;      /* Scans read, swaps write */
+    atomic_int active;          /* Guilds with a set - 0 skips the lookup entirely */
+
+    uint64_t *dirty;            /* Guilds waiting for a rebuild */
+    size_t dirty_count;
+    size_t dirty_capacity;
+    pthread_mutex_t queue_lock;
+    pthread_cond_t wakeup;
+    pthread_t thread;
+    int running;
+
+    /* Statistics */
+    atomic_uint_fast64_t scans;
+    atomic_uint_fast64_t matches;
+    atomic_uint_fast64_t last_scan_ns;
+    atomic_uint_fast64_t max_scan_ns;
+    atomic_uint_fast64_t total_scan_ns;
+    uint64_t rebuilds;          /* Under queue_lock, like the rest below */
+    uint64_t failed;
+    uint64_t last_build_us;
+} word_filter_t;
+
+typedef struct {
+    int guilds;                 /* With a compiled list */
+    size_t bytes;               /* Their automata */
+    size_t queued;
+    uint64_t scans;
+    uint64_t matches;
+    uint64_t last_scan_ns;
+    uint64_t max_scan_ns;
+    uint64_t avg_scan_ns;
+    uint64_t rebuilds;
+    uint64_t failed;
+    uint64_t last_build_us;
+} word_filter_stats_t;
+
+/* Forward declaration - include bot.h for full definition */
+#include "bot.h"
+
+/* Word filter lifecycle - start compiles every guild's list in the background */
+int word_filter_init(yuno_bot_t *bot);
+int word_filter_start(void);
+void word_filter_stop(void);
+void word_filter_cleanup(void);
+
+/* Edit a guild's list - the word is stored normalized and the new list
+ * swaps in once rebuilt. Add returns 1 if it was already there, 2 if the
+ * list is full or the word has nothing to match; remove 1 if it wasn't
+ * there. -1 on errors. */
+int word_filter_add(uint64_t guild_id, const char *word);
+int word_filter_remove(uint64_t guild_id, const char *word);
+
+/* Whether the message holds a banned word - one pass, timed */
+int word_filter_check(uint64_t guild_id, const char *content);
+
+/* Delete a message with a banned word - returns 1 if it had one */
+int word_filter_handle(yuno_bot_t *bot, const struct discord_message *msg);
+
+void word_filter_get_stats(word_filter_stats_t *stats);
+
+#endif /* YUNO_MODULES_WORD_FILTER_H */
@@ -0,0 +1,45 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Near-Duplicate Message Window
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_NEAR_DUP_H
+#define YUNO_NEAR_DUP_H
+
+#include <stdint.h>
+
+#define NEAR_DUP_WINDOW 128         /* Messages remembered per guild */
+#define NEAR_DUP_BANDS 10           /* 6-bit bands of the SimHash, the top 4 bits unused */
+#define NEAR_DUP_BAND_BITS 6
+#define NEAR_DUP_BUCKETS (1 << NEAR_DUP_BAND_BITS)
+#define NEAR_DUP_MAX_DISTANCE 10    /* Differing bits that still count as the same message */
+#define NEAR_DUP_MAX_USERS 64       /* Most distinct users one lookup counts */
+
+typedef struct {
+    uint64_t simhash;
+    uint64_t user_id;
+    uint32_t time;
+    uint32_t next[NEAR_DUP_BANDS];  /* Older message in the same bucket */
+} near_dup_entry_t;
+
+/* A guild's recent messages, bucketed by each band of their SimHash. Two
+ * hashes within 9 bits always share a band and ones within 10 nearly always do,
+ * so a lookup only compares against its own buckets. Messages are numbered
+ * from 1 and number n sits in entries[n % NEAR_DUP_WINDOW] until the window
+ * wraps - links to anything older are recognised as stale, never cleared. */
+typedef struct {
+    near_dup_entry_t entries[NEAR_DUP_WINDOW];
+    uint32_t heads[NEAR_DUP_BANDS][NEAR_DUP_BUCKETS];  /* Newest message per bucket, 0 = none */
+    uint32_t count;                                     /* Messages added */
+} near_dup_window_t;
+
+void near_dup_reset(near_dup_window_t *window);
+
+/* Adds a message. Returns how many distinct users, its poster included,
+ * sent one within NEAR_DUP_MAX_DISTANCE bits of it in the last interval
+ * seconds - counting stops at limit (at most NEAR_DUP_MAX_USERS). */
+int near_dup_add(near_dup_window_t *window, uint64_t user_id, uint64_t simhash,
+                 uint32_t now, uint32_t interval, int limit);
+
+#endif /* YUNO_NEAR_DUP_H */
@@ -0,0 +1,65 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Rank Index
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_RANK_INDEX_H
+#define YUNO_RANK_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "database.h"
+#include "u64map.h"
+
+#define RANK_INDEX_INITIAL_CAPACITY 64  /* Guilds before the map first grows */
+
+/* One distinct XP value - the tree is a treap ordered by xp, heap-ordered by priority */
+typedef struct {
+    int64_t xp;
+    uint32_t members;                   /* Members holding exactly this xp */
+    uint32_t size;                      /* Members in this subtree */
+    uint32_t left;
+    uint32_t right;
+    uint32_t priority;
+} rank_node_t;
+
+/* Array-backed treap - indices instead of pointers, nodes[0] is the nil sentinel */
+typedef struct {
+    rank_node_t *nodes;
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t free_list;
+    uint32_t root;
+    uint32_t rng;
+    int broken;                         /* Out of memory or out of sync - reload */
+} rank_tree_t;
+
+/* Per-guild order statistics over XP. A member's rank is 1 + the number of
+ * members with more XP, answered in O(log n) without touching SQLite. */
+typedef struct {
+    u64map_t trees;                     /* (guild, 0) -> rank_tree_t * */
+    pthread_rwlock_t lock;
+    atomic_uint_fast64_t apply_seq;     /* Bumped by every flush that starts or lands */
+    atomic_int in_flight;               /* XP batches submitted but not yet applied */
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t loads;
+} rank_index_t;
+
+int rank_index_init(rank_index_t *index);
+void rank_index_free(rank_index_t *index);
+
+/* Rank of a member holding xp - rank is 0 for members without XP */
+int rank_index_get(rank_index_t *index, yuno_database_t *database, uint64_t guild_id, int64_t xp,
+                   uint64_t *rank, uint64_t *members);
+
+/* Bracket every XP batch - begin before it is queued, end once it is
+ * committed (with its results) or abandoned (with NULL) */
+void rank_index_flush_begin(rank_index_t *index);
+void rank_index_flush_end(rank_index_t *index, const xp_flush_result_t *results, int count);
+
+void rank_index_get_stats(rank_index_t *index, uint64_t *hits, uint64_t *loads, size_t *guilds, size_t *nodes);
+
+#endif /* YUNO_RANK_INDEX_H */
@@ -0,0 +1,44 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Multi-Resolution Event Rate
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_RATE_WINDOW_H
+#define YUNO_RATE_WINDOW_H
+
+#include <stdint.h>
+
+#define RATE_WINDOW_SECONDS 10      /* 1-second buckets, covering the 10-second window */
+#define RATE_WINDOW_TENS 6          /* 10-second buckets, covering the minute */
+
+/* Windows rate_window_read reports */
+enum {
+    RATE_1S,
+    RATE_10S,
+    RATE_60S,
+    RATE_RESOLUTIONS
+};
+
+/* Events counted in two rings of buckets, each with its running total, so
+ * reading a window is a load and moving time on clears at most 16 buckets.
+ * The current second and current ten seconds are still filling, so the
+ * minute reads anything from the last 51 to 60 seconds. Times are seconds
+ * on any clock - one that steps back is treated as standing still. */
+typedef struct {
+    uint32_t seconds[RATE_WINDOW_SECONDS];  /* Second t is seconds[t % 10] */
+    uint32_t tens[RATE_WINDOW_TENS];        /* Ten seconds t / 10 is tens[t / 10 % 6] */
+    uint32_t ten_total;                     /* Sum of seconds[] */
+    uint32_t minute_total;                  /* Sum of tens[] */
+    uint32_t now;                           /* Time of the newest bucket */
+} rate_window_t;
+
+void rate_window_reset(rate_window_t *window, uint32_t now);
+
+/* Count n events at now */
+void rate_window_add(rate_window_t *window, uint32_t now, uint32_t n);
+
+/* Events in the last second, 10 seconds and minute, indexed by RATE_* */
+void rate_window_read(rate_window_t *window, uint32_t now, uint32_t counts[RATE_RESOLUTIONS]);
+
+#endif /* YUNO_RATE_WINDOW_H */
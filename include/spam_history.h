@@ -0,0 +1,36 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Spam Message History
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_SPAM_HISTORY_H
+#define YUNO_SPAM_HISTORY_H
+
+#include <stdint.h>
+
+#define SPAM_HISTORY_LEN 10         /* Messages remembered per member */
+#define SPAM_HISTORY_LANES 12       /* Padded to whole 4-lane vectors */
+
+/* A member's recent messages as packed arrays, so one vector pass checks
+ * both rate and duplicates. Neither check cares about order: the buffer
+ * fills lanes [0, count) and then overwrites the oldest at head. */
+typedef struct {
+    uint32_t times[SPAM_HISTORY_LANES];     /* Seconds since the filter started */
+    uint32_t hashes[SPAM_HISTORY_LANES];
+    uint8_t head;                           /* Next write position */
+    uint8_t count;                          /* Valid lanes */
+} spam_history_t;
+
+void spam_history_reset(spam_history_t *history);
+void spam_history_add(spam_history_t *history, uint32_t now, uint32_t hash);
+
+/* Time of the newest message - only meaningful when count > 0 */
+uint32_t spam_history_last(const spam_history_t *history);
+
+/* In one pass: messages at most interval seconds before now, and messages
+ * with the given hash */
+void spam_history_count(const spam_history_t *history, uint32_t now, uint32_t interval,
+                        uint32_t hash, int *recent, int *duplicates);
+
+#endif /* YUNO_SPAM_HISTORY_H */
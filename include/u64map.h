@@ -0,0 +1,61 @@
+/*
+ * Yuno Gasai 2 (C Edition) - (u64, u64) Hash Map
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_U64MAP_H
+#define YUNO_U64MAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define U64MAP_GROUP 16                 /* Control bytes scanned per probe step */
+#define U64MAP_MIN_CAPACITY 16          /* Power of two, at least one group */
+
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+    uint64_t value;
+} u64map_slot_t;
+
+/* Open addressing map from a (u64, u64) key to a u64 value, Swiss-table style:
+ * a control byte per slot holds 7 bits of the hash (or EMPTY), and probes
+ * compare a whole group of control bytes at once before touching any keys.
+ * Probing is linear per slot, so deletion shifts the run back instead of
+ * leaving tombstones. The table grows past 3/4 full and shrinks below 1/8. */
+typedef struct {
+    uint8_t *ctrl;                      /* capacity + U64MAP_GROUP - 1, the tail mirrors the head */
+    u64map_slot_t *slots;
+    size_t capacity;
+    size_t count;
+    size_t min_capacity;
+} u64map_t;
+
+int u64map_init(u64map_t *map, size_t capacity);
+void u64map_free(u64map_t *map);
+void u64map_clear(u64map_t *map);
+
+/* Grow once so count keys fit without further resizes - for callers that
+ * know how many are coming. Doesn't raise the size the map shrinks back to. */
+int u64map_reserve(u64map_t *map, size_t count);
+
+/* Value for a key, NULL if absent. Pointers stay valid until the next insert
+ * or remove. */
+uint64_t *u64map_find(const u64map_t *map, uint64_t a, uint64_t b);
+
+/* Find or add a key - a new key's value starts at 0 and *inserted is set.
+ * Returns NULL only when growing the table fails. */
+uint64_t *u64map_insert(u64map_t *map, uint64_t a, uint64_t b, int *inserted);
+
+/* Returns 1 if the key was there, 0 if not */
+int u64map_remove(u64map_t *map, uint64_t a, uint64_t b);
+
+static inline size_t u64map_count(const u64map_t *map) {
+    return map->count;
+}
+
+/* Walk the occupied slots - for (size_t i = 0; (slot = u64map_next(map, &i)) != NULL;) */
+const u64map_slot_t *u64map_next(const u64map_t *map, size_t *pos);
+
+#endif /* YUNO_U64MAP_H */
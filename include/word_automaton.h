@@ -0,0 +1,49 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Banned Word Automaton
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_WORD_AUTOMATON_H
+#define YUNO_WORD_AUTOMATON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WORD_MAX_LENGTH 100         /* Bytes in one word or phrase */
+
+/* Text is matched after content_normalize(), one symbol per byte: every
+ * run of ASCII other than letters and digits is a single separator, and
+ * UTF-8 bytes count as letters. Words are wrapped in separators, so they
+ * only match whole - "ass" never fires inside "class". */
+#define WORD_SEPARATOR 1
+#define WORD_ALPHABET 166           /* Separator, a-z, 0-9, bytes 0x80-0xFF */
+
+/* One state of the double array. A move from s on symbol c lands on
+ * t = s.base + c, and is real only if t.check == s. fail and match ride
+ * in the same cell so a step reads one 16-byte slot. */
+typedef struct {
+    int32_t base;
+    int32_t check;                  /* Parent state, -1 = free, -2 = the root */
+    int32_t fail;                   /* Longest proper suffix that is also a state */
+    int32_t match;                  /* Word ending here or at a suffix, -1 = none */
+} word_cell_t;
+
+/* Aho-Corasick over a guild's words, packed into a double array. A scan
+ * reads each byte once - the time grows with the message, not the list. */
+typedef struct {
+    word_cell_t *cells;
+    uint32_t size;                  /* Cells, states and holes */
+    uint32_t states;
+    uint32_t words;                 /* Words that compiled - empty ones are skipped */
+} word_automaton_t;
+
+/* Compile count words. Returns 0, or -1 if out of memory. */
+int word_automaton_build(word_automaton_t *automaton, const char *const *words, size_t count);
+void word_automaton_free(word_automaton_t *automaton);
+
+/* Index in the build's words of one found in the text, -1 if none. Takes
+ * the raw message and normalizes it first. */
+int word_automaton_scan(const word_automaton_t *automaton, const char *content, size_t length);
+
+#endif /* YUNO_WORD_AUTOMATON_H */
@@ -0,0 +1,39 @@
+/*
+ * Yuno Gasai 2 (C Edition) - XP Cooldowns
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_XP_COOLDOWN_H
+#define YUNO_XP_COOLDOWN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "u64map.h"
+
+#define XP_COOLDOWN_INITIAL_CAPACITY 1024   /* Members tracked before the first sweep */
+
+/* Expiring hash of (user, guild) -> start and end of cooldown, in seconds
+ * on the table's clock. Expired entries are reused in place, and swept out
+ * together once the map holds twice what was live after the last sweep. */
+typedef struct {
+    u64map_t entries;
+    size_t sweep_at;                        /* Entries, live or expired, that trigger a sweep */
+    pthread_mutex_t lock;
+    atomic_uint_fast64_t allowed;
+    atomic_uint_fast64_t suppressed;
+} xp_cooldown_t;
+
+int xp_cooldown_init(xp_cooldown_t *cooldown);
+void xp_cooldown_free(xp_cooldown_t *cooldown);
+
+/* Returns 1 and starts a new cooldown if the member may earn XP now, 0 while
+ * they are still cooling down. A cooldown of 0 seconds always allows, and a
+ * shorter cooldown than the one running cuts it short. */
+int xp_cooldown_try(xp_cooldown_t *cooldown, uint64_t user_id, uint64_t guild_id, int cooldown_seconds);
+
+void xp_cooldown_get_stats(xp_cooldown_t *cooldown, uint64_t *allowed, uint64_t *suppressed, size_t *tracked);
+
+#endif /* YUNO_XP_COOLDOWN_H */
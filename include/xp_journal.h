@@ -0,0 +1,87 @@
+/*
+ * Yuno Gasai 2 (C Edition) - XP Journal
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#ifndef YUNO_XP_JOURNAL_H
+#define YUNO_XP_JOURNAL_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "config.h"
+#include "database.h"
+
+/*
+ * Append-only log of XP increments that are still only in memory.
+ * Every batcher buffer swap starts a new generation file next to the
+ * database (<database_path>-xpjournal.<generation>). A generation is
+ * deleted once its batch commits, and the commit records the generation
+ * in xp_journal_commits, so a replay never applies a batch twice.
+ *
+ * Appends only copy the record into memory - the flusher thread writes
+ * them out with the periodic sync and at rotation, so a crash loses at
+ * most one sync interval.
+ */
+
+#define XP_JOURNAL_SUFFIX "-xpjournal"
+#define XP_JOURNAL_MAGIC 0x59504a58u     /* "XJPY" */
+#define XP_JOURNAL_SYNC_INTERVAL_MS 1000 /* Write + fdatasync cadence for the open generation */
+#define XP_JOURNAL_INITIAL_RECORDS 256
+
+typedef struct {
+    uint64_t user_id;
+    uint64_t guild_id;
+    uint64_t channel_id;
+    int64_t xp_amount;
+    uint32_t magic;
+    uint32_t crc;                        /* CRC-32 of every field above */
+} xp_journal_record_t;
+
+typedef struct {
+    char base_path[MAX_PATH_LEN];
+    int fd;                              /* -1 when journaling is disabled */
+    uint64_t generation;                 /* Generation the fd belongs to */
+    uint64_t generation_records;
+
+    pthread_mutex_t lock;                /* Guards the buffered records only */
+    xp_journal_record_t *buffered;       /* Appended, not yet written */
+    size_t buffered_count;
+    size_t buffered_capacity;
+    xp_journal_record_t *spare;          /* Swapped in while the flusher writes */
+    size_t spare_capacity;
+
+    /* Statistics */
+    atomic_uint_fast64_t records;
+    atomic_uint_fast64_t syncs;
+    atomic_uint_fast64_t write_errors;
+    atomic_uint_fast64_t replayed;       /* Entries recovered at startup */
+} xp_journal_t;
+
+/* Lifecycle - init leaves the journal disabled until open succeeds,
+ * close writes out whatever is still buffered */
+void xp_journal_init(xp_journal_t *journal);
+int xp_journal_open(xp_journal_t *journal, const char *database_path, uint64_t generation);
+void xp_journal_close(xp_journal_t *journal);
+int xp_journal_enabled(const xp_journal_t *journal);
+
+/* Buffer one increment - the caller serializes appends with rotation */
+int xp_journal_append(xp_journal_t *journal, const pending_xp_t *entry);
+
+/* Write out the open generation, start the next and return the one just closed
+ * (0 if disabled). Rotation and sync must run on the same thread. */
+uint64_t xp_journal_rotate(xp_journal_t *journal);
+
+/* Write buffered records to the open generation and fdatasync it */
+void xp_journal_sync(xp_journal_t *journal);
+
+/* Delete a generation once its batch has been committed */
+void xp_journal_discard(xp_journal_t *journal, uint64_t generation);
+
+/* Apply every uncommitted generation left by a previous run, then delete
+ * them - next_generation receives the first generation free for this run */
+int xp_journal_replay(xp_journal_t *journal, const char *database_path, yuno_database_t *database,
+                      uint64_t *next_generation);
+
+#endif /* YUNO_XP_JOURNAL_H */
@@ -10,116 +10,433 @@
 #include "commands/fun.h"
 #include "modules/terminal.h"
 #include "modules/spam_filter.h"
+#include "modules/voice_xp.h"
+#include "modules/level_roles.h"
+#include "modules/raid_guard.h"
+#include "modules/word_filter.h"
+#include "modules/guild_roles.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include <math.h>
 #include <time.h>
 
 /* Global bot instance for callbacks */
 yuno_bot_t *g_bot = NULL;
 
-/* XP Batcher implementation with hash table */
-#define XP_FLUSH_INTERVAL 10 /* seconds */
+/* XP Batcher implementation - double-buffered, flushed from a background thread */
 
-/* Hash function for user+guild - O(1) lookup */
-static inline uint32_t xp_hash_user_guild(uint64_t user_id, uint64_t guild_id) {
-    uint64_t h = user_id ^ (guild_id * 2654435761ULL);
-    return (uint32_t)(h % XP_HASH_SIZE);
+/* Per-flush context so the commit callback can measure swap-to-disk latency */
+typedef struct {
+    yuno_bot_t *bot;
+    int count;
+    uint64_t first_generation;     /* Journal generations holding these entries */
+    uint64_t generation;
+    uint64_t started_us;
+} xp_flush_ctx_t;
+
+static inline uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static int xp_buffer_alloc(xp_buffer_t *buffer, int capacity) {
+    buffer->pending = malloc(sizeof(pending_xp_t) * capacity);
+    if (!buffer->pending || u64map_init(&buffer->index, (size_t)capacity * 2) != 0) {
+        free(buffer->pending);
+        buffer->pending = NULL;
+        return -1;
+    }
+    buffer->capacity = capacity;
+    buffer->count = 0;
+    return 0;
+}
+
+static void xp_buffer_reset(xp_buffer_t *buffer) {
+    buffer->count = 0;
+    u64map_clear(&buffer->index);
+}
+
+/* Merge XP into the buffer - returns -1 only if a new entry couldn't be stored */
+static int xp_buffer_add(xp_buffer_t *buffer, const pending_xp_t *entry) {
+    int inserted;
+    uint64_t *idx = u64map_insert(&buffer->index, entry->user_id, entry->guild_id, &inserted);
+    if (!idx) {
+        return -1;
+    }
+
+    if (!inserted) {
+        /* Found existing entry - update it */
+        pending_xp_t *pending = &buffer->pending[*idx];
+        pending->xp_amount += entry->xp_amount;
+        pending->channel_id = entry->channel_id;
+        return 0;
+    }
+
+    if (buffer->count == buffer->capacity) {
+        pending_xp_t *pending = realloc(buffer->pending, sizeof(pending_xp_t) * buffer->capacity * 2);
+        if (!pending) {
+            u64map_remove(&buffer->index, entry->user_id, entry->guild_id);
+            return -1;
+        }
+        buffer->pending = pending;
+        buffer->capacity *= 2;
+    }
+
+    *idx = (uint64_t)buffer->count;
+    buffer->pending[buffer->count++] = *entry;
+    return 0;
 }
 
-void xp_batcher_init(xp_batcher_t *batcher) {
+int xp_batcher_init(xp_batcher_t *batcher, int flush_interval) {
     memset(batcher, 0, sizeof(xp_batcher_t));
-    batcher->last_flush = time(NULL);
+    batcher->flush_interval = flush_interval > 0 ? flush_interval : 1;
+    xp_journal_init(&batcher->journal);
+
+    for (int i = 0; i < 2; i++) {
+        if (xp_buffer_alloc(&batcher->buffers[i], XP_BUFFER_INITIAL_CAPACITY) != 0) {
+            xp_batcher_cleanup(batcher);
+            return -1;
+        }
+    }
 
-    /* Initialize hash table to -1 (empty) */
-    for (int i = 0; i < XP_HASH_SIZE; i++) {
-        batcher->hash_table[i] = -1;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&batcher->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&batcher->lock, NULL);
+    return 0;
+}
+
+void xp_batcher_cleanup(xp_batcher_t *batcher) {
+    xp_journal_close(&batcher->journal);
+    for (int i = 0; i < 2; i++) {
+        free(batcher->buffers[i].pending);
+        u64map_free(&batcher->buffers[i].index);
+        batcher->buffers[i].pending = NULL;
     }
 }
 
 void xp_batcher_add(yuno_bot_t *bot, uint64_t user_id, uint64_t guild_id, uint64_t channel_id, int xp) {
+    pending_xp_t entry = {
+        .user_id = user_id,
+        .guild_id = guild_id,
+        .channel_id = channel_id,
+        .xp_amount = xp,
+        .added_at = time(NULL)
+    };
+    xp_batcher_add_many(bot, &entry, 1);
+}
+
+/* Merge a whole batch under one lock hold - voice ticks pay everyone at once */
+void xp_batcher_add_many(yuno_bot_t *bot, const pending_xp_t *entries, int count) {
     xp_batcher_t *batcher = &bot->xp_batcher;
 
-    /* O(1) hash lookup instead of O(n) linear search */
-    uint32_t bucket = xp_hash_user_guild(user_id, guild_id);
-    int idx = batcher->hash_table[bucket];
+    pthread_mutex_lock(&batcher->lock);
+    xp_buffer_t *buffer = &batcher->buffers[batcher->active];
+    for (int i = 0; i < count; i++) {
+        if (xp_buffer_add(buffer, &entries[i]) != 0) {
+            atomic_fetch_add_explicit(&batcher->dropped, 1, memory_order_relaxed);
+        } else {
+            xp_journal_append(&batcher->journal, &entries[i]);
+        }
+    }
 
-    while (idx >= 0) {
-        if (batcher->pending[idx].user_id == user_id &&
-            batcher->pending[idx].guild_id == guild_id) {
-            /* Found existing entry - update it */
-            batcher->pending[idx].xp_amount += xp;
-            batcher->pending[idx].channel_id = channel_id;
-            return;
+    /* Don't wait for the timer once a full batch is ready */
+    if (buffer->count >= XP_FLUSH_THRESHOLD && !batcher->flush_requested) {
+        batcher->flush_requested = 1;
+        pthread_cond_signal(&batcher->wakeup);
+    }
+    pthread_mutex_unlock(&batcher->lock);
+}
+
+/* Ask the flusher to run now instead of at the next interval */
+void xp_batcher_flush(yuno_bot_t *bot) {
+    xp_batcher_t *batcher = &bot->xp_batcher;
+
+    pthread_mutex_lock(&batcher->lock);
+    batcher->flush_requested = 1;
+    pthread_cond_signal(&batcher->wakeup);
+    pthread_mutex_unlock(&batcher->lock);
+}
+
+typedef struct {
+    uint64_t channel_id;
+    uint64_t user_id;
+    int level;
+    int order;                     /* Position in the flush, keeps each channel's list stable */
+} level_up_t;
+
+static int compare_level_ups(const void *a, const void *b) {
+    const level_up_t *x = a, *y = b;
+    if (x->channel_id != y->channel_id) return x->channel_id < y->channel_id ? -1 : 1;
+    return x->order - y->order;
+}
+
+static void send_level_ups(yuno_bot_t *bot, const level_up_t *ups, int count) {
+    char level_msg[2048];
+
+    if (count == 1) {
+        snprintf(level_msg, sizeof(level_msg),
+            "✨ **Level Up!** ✨\nCongratulations <@%lu>! You've reached level **%d**! 💕",
+            (unsigned long)ups[0].user_id, ups[0].level);
+    } else {
+        int len = snprintf(level_msg, sizeof(level_msg), "✨ **Level Up!** ✨\nCongratulations~ 💕");
+        for (int i = 0; i < count && len < (int)sizeof(level_msg); i++) {
+            len += snprintf(level_msg + len, sizeof(level_msg) - (size_t)len,
+                "\n<@%lu> reached level **%d**!", (unsigned long)ups[i].user_id, ups[i].level);
         }
-        idx = batcher->hash_next[idx];
     }
 
-    /* Add new entry if space available */
-    if (batcher->count < MAX_PENDING_XP) {
-        idx = batcher->count;
-        batcher->pending[idx].user_id = user_id;
-        batcher->pending[idx].guild_id = guild_id;
-        batcher->pending[idx].channel_id = channel_id;
-        batcher->pending[idx].xp_amount = xp;
-        batcher->pending[idx].added_at = time(NULL);
+    struct discord_create_message params = { .content = level_msg };
+    discord_create_message(bot->client, ups[0].channel_id, &params, NULL);
+}
+
+/* One message per channel per flush, split every level_up_batch_max members */
+static void announce_level_ups(yuno_bot_t *bot, const xp_flush_result_t *results, int count) {
+    xp_batcher_t *batcher = &bot->xp_batcher;
+    if (!bot->client) return;
 
-        /* Add to hash table */
-        batcher->hash_next[idx] = batcher->hash_table[bucket];
-        batcher->hash_table[bucket] = idx;
-        batcher->count++;
+    int announced = 0;
+    for (int i = 0; i < count; i++) {
+        announced += results[i].new_level > results[i].old_level && results[i].channel_id != 0;
     }
+    if (announced == 0) return;
 
-    /* Flush if batch is full or time elapsed */
-    if (batcher->count >= MAX_PENDING_XP || (time(NULL) - batcher->last_flush) >= XP_FLUSH_INTERVAL) {
-        xp_batcher_flush(bot);
+    level_up_t *ups = malloc(sizeof(level_up_t) * (size_t)announced);
+    if (!ups) return;
+
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        const xp_flush_result_t *r = &results[i];
+        if (r->new_level > r->old_level && r->channel_id != 0) {
+            ups[n] = (level_up_t){ r->channel_id, r->user_id, r->new_level, n };
+            n++;
+        }
     }
+    qsort(ups, (size_t)n, sizeof(level_up_t), compare_level_ups);
+
+    int batch_max = bot->config.level_up_batch_max;
+    if (batch_max < 1) batch_max = 1;
+    if (batch_max > LEVEL_UP_BATCH_LIMIT) batch_max = LEVEL_UP_BATCH_LIMIT;
+
+    uint64_t messages = 0;
+    for (int start = 0; start < n;) {
+        int end = start + 1;
+        while (end < n && end - start < batch_max && ups[end].channel_id == ups[start].channel_id) {
+            end++;
+        }
+        send_level_ups(bot, &ups[start], end - start);
+        messages++;
+        start = end;
+    }
+    free(ups);
+
+    atomic_fetch_add_explicit(&batcher->level_ups, (uint_fast64_t)n, memory_order_relaxed);
+    atomic_fetch_add_explicit(&batcher->level_up_messages, messages, memory_order_relaxed);
 }
 
-void xp_batcher_flush(yuno_bot_t *bot) {
+/* Runs on the database writer thread once a flushed batch is committed (or rolled back) */
+static void xp_batcher_on_flushed(void *user_data, const xp_flush_result_t *results, int count) {
+    xp_flush_ctx_t *ctx = user_data;
+    yuno_bot_t *bot = ctx->bot;
     xp_batcher_t *batcher = &bot->xp_batcher;
 
-    if (batcher->count == 0) return;
+    if (count < 0) {
+        rank_index_flush_end(&bot->ranks, NULL, 0);
+        if (ctx->generation != 0) {
+            fprintf(stderr, "💔 XP batch rolled back - journal generations %lu-%lu kept for replay\n",
+                    (unsigned long)ctx->first_generation, (unsigned long)ctx->generation);
+        } else {
+            atomic_fetch_add_explicit(&batcher->dropped, (uint_fast64_t)ctx->count, memory_order_relaxed);
+        }
+        free(ctx);
+        return;
+    }
+    for (uint64_t g = ctx->first_generation; g != 0 && g <= ctx->generation; g++) {
+        xp_journal_discard(&batcher->journal, g);
+    }
+    leaderboard_apply(&bot->leaderboard, results, count);
+    rank_index_flush_end(&bot->ranks, results, count);
+
+    uint64_t elapsed = monotonic_us() - ctx->started_us;
+    atomic_fetch_add_explicit(&batcher->flushes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&batcher->entries, (uint_fast64_t)count, memory_order_relaxed);
+    atomic_store_explicit(&batcher->last_flush_us, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&batcher->total_flush_us, elapsed, memory_order_relaxed);
+    if (elapsed > atomic_load_explicit(&batcher->max_flush_us, memory_order_relaxed)) {
+        atomic_store_explicit(&batcher->max_flush_us, elapsed, memory_order_relaxed);
+    }
+    free(ctx);
+
+    announce_level_ups(bot, results, count);
+    level_roles_on_flushed(results, count);
+}
+
+/* Hand the swapped-out buffer to the writer - runs on the flusher thread only */
+static void xp_batcher_submit(yuno_bot_t *bot, xp_buffer_t *buffer, uint64_t first_generation,
+                              uint64_t generation, uint64_t started_us) {
+    xp_batcher_t *batcher = &bot->xp_batcher;
+    int count = buffer->count;
+
+    if (count == 0) {
+        xp_journal_discard(&batcher->journal, generation);
+        return;
+    }
 
-    for (int i = 0; i < batcher->count; i++) {
-        const pending_xp_t *p = &batcher->pending[i];
+    pending_xp_t *entries = malloc(sizeof(pending_xp_t) * count);
+    xp_flush_ctx_t *ctx = malloc(sizeof(xp_flush_ctx_t));
+    if (entries && ctx) {
+        memcpy(entries, buffer->pending, sizeof(pending_xp_t) * count);
+        ctx->bot = bot;
+        ctx->count = count;
+        ctx->first_generation = first_generation;
+        ctx->generation = generation;
+        ctx->started_us = started_us;
+
+        rank_index_flush_begin(&bot->ranks);
+        if (db_writer_submit_xp(&bot->db_writer, entries, count, first_generation, generation,
+                                xp_batcher_on_flushed, ctx) == 0) {
+            xp_buffer_reset(buffer);
+            return;
+        }
+        rank_index_flush_end(&bot->ranks, NULL, 0);
+    }
+    free(entries);
+    free(ctx);
+
+    /* Writer queue full - merge back into the active buffer for the next flush. The entries
+     * stay in their own generations, which that flush marks committed along with its own,
+     * so there's never a moment where a replay would find them twice. */
+    pthread_mutex_lock(&batcher->lock);
+    xp_buffer_t *active = &batcher->buffers[batcher->active];
+    for (int i = 0; i < count; i++) {
+        if (xp_buffer_add(active, &buffer->pending[i]) != 0) {
+            atomic_fetch_add_explicit(&batcher->dropped, 1, memory_order_relaxed);
+        }
+    }
+    if (generation != 0) {
+        if (batcher->carried_first == 0) batcher->carried_first = first_generation;
+        batcher->carried_last = generation;
+    }
+    pthread_mutex_unlock(&batcher->lock);
 
-        /* Get current XP */
-        user_xp_t user_xp;
-        db_get_user_xp(&bot->database, p->user_id, p->guild_id, &user_xp);
+    atomic_fetch_add_explicit(&batcher->requeued, (uint_fast64_t)count, memory_order_relaxed);
+    xp_buffer_reset(buffer);
+}
 
-        /* Add XP */
-        db_add_xp(&bot->database, p->user_id, p->guild_id, p->xp_amount);
+static void *xp_batcher_loop(void *arg) {
+    yuno_bot_t *bot = arg;
+    xp_batcher_t *batcher = &bot->xp_batcher;
 
-        /* Calculate new level */
-        int64_t new_total = user_xp.xp + p->xp_amount;
-        int new_level = (int)sqrt(new_total / 100.0);
+    uint64_t interval_us = (uint64_t)batcher->flush_interval * 1000000ULL;
+    uint64_t sync_us = (uint64_t)XP_JOURNAL_SYNC_INTERVAL_MS * 1000ULL;
 
-        /* Check for level up */
-        if (new_level > user_xp.level) {
-            db_set_level(&bot->database, p->user_id, p->guild_id, new_level);
+    pthread_mutex_lock(&batcher->lock);
+    for (;;) {
+        uint64_t next_flush = monotonic_us() + interval_us;
 
-            /* Send level up message */
-            if (bot->client && p->channel_id != 0) {
-                char level_msg[256];
-                snprintf(level_msg, sizeof(level_msg),
-                    "✨ **Level Up!** ✨\nCongratulations <@%lu>! You've reached level **%d**! 💕",
-                    (unsigned long)p->user_id, new_level);
+        /* Sleep until the flush is due, waking up to fdatasync the journal meanwhile */
+        while (batcher->running && !batcher->flush_requested) {
+            uint64_t now = monotonic_us();
+            if (now >= next_flush) break;
 
-                struct discord_create_message params = { .content = level_msg };
-                discord_create_message(bot->client, p->channel_id, &params, NULL);
+            uint64_t wake = next_flush;
+            if (xp_journal_enabled(&batcher->journal) && now + sync_us < wake) {
+                wake = now + sync_us;
             }
+            struct timespec deadline = {
+                .tv_sec = (time_t)(wake / 1000000ULL),
+                .tv_nsec = (long)(wake % 1000000ULL) * 1000L
+            };
+            if (pthread_cond_timedwait(&batcher->wakeup, &batcher->lock, &deadline) != 0) {
+                pthread_mutex_unlock(&batcher->lock);
+                xp_journal_sync(&batcher->journal);
+                pthread_mutex_lock(&batcher->lock);
+            }
+        }
+
+        /* Swap buffers - message handlers keep adding (to a new journal generation)
+         * while this batch is written */
+        int stopping = !batcher->running;
+        xp_buffer_t *flushing = &batcher->buffers[batcher->active];
+        uint64_t generation = xp_journal_rotate(&batcher->journal);
+        uint64_t first_generation = generation;
+        if (batcher->carried_first != 0) {
+            first_generation = batcher->carried_first;
+            if (generation == 0) generation = batcher->carried_last;
+            batcher->carried_first = batcher->carried_last = 0;
         }
+        batcher->active ^= 1;
+        batcher->flush_requested = 0;
+        pthread_mutex_unlock(&batcher->lock);
+
+        xp_batcher_submit(bot, flushing, first_generation, generation, monotonic_us());
+
+        pthread_mutex_lock(&batcher->lock);
+        /* On shutdown keep going until nothing was put back by a full writer queue */
+        if (stopping && batcher->buffers[batcher->active].count == 0) break;
     }
+    pthread_mutex_unlock(&batcher->lock);
+    return NULL;
+}
+
+int xp_batcher_start(yuno_bot_t *bot) {
+    xp_batcher_t *batcher = &bot->xp_batcher;
+
+    batcher->running = 1;
+    if (pthread_create(&batcher->thread, NULL, xp_batcher_loop, bot) != 0) {
+        batcher->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void xp_batcher_stop(yuno_bot_t *bot) {
+    xp_batcher_t *batcher = &bot->xp_batcher;
 
-    /* Reset batcher */
-    batcher->count = 0;
-    for (int i = 0; i < XP_HASH_SIZE; i++) {
-        batcher->hash_table[i] = -1;
+    pthread_mutex_lock(&batcher->lock);
+    if (!batcher->running) {
+        pthread_mutex_unlock(&batcher->lock);
+        return;
     }
-    batcher->last_flush = time(NULL);
+    batcher->running = 0;
+    pthread_cond_signal(&batcher->wakeup);
+    pthread_mutex_unlock(&batcher->lock);
+
+    pthread_join(batcher->thread, NULL);
+}
+
+void xp_batcher_get_stats(xp_batcher_t *batcher, xp_batcher_stats_t *stats) {
+    pthread_mutex_lock(&batcher->lock);
+    stats->pending = batcher->buffers[batcher->active].count;
+    stats->capacity = batcher->buffers[batcher->active].capacity;
+    pthread_mutex_unlock(&batcher->lock);
+
+    stats->flushes = atomic_load(&batcher->flushes);
+    stats->entries = atomic_load(&batcher->entries);
+    stats->dropped = atomic_load(&batcher->dropped);
+    stats->requeued = atomic_load(&batcher->requeued);
+    stats->last_flush_us = atomic_load(&batcher->last_flush_us);
+    stats->max_flush_us = atomic_load(&batcher->max_flush_us);
+    stats->avg_flush_us = stats->flushes > 0 ? atomic_load(&batcher->total_flush_us) / stats->flushes : 0;
+    stats->level_ups = atomic_load(&batcher->level_ups);
+    stats->level_up_messages = atomic_load(&batcher->level_up_messages);
+
+    stats->journal_enabled = xp_journal_enabled(&batcher->journal);
+    stats->journal_records = atomic_load(&batcher->journal.records);
+    stats->journal_syncs = atomic_load(&batcher->journal.syncs);
+    stats->journal_errors = atomic_load(&batcher->journal.write_errors);
+    stats->journal_replayed = atomic_load(&batcher->journal.replayed);
+}
+
+/* In-memory XP state - bot_init zeroes it first, so this is safe after a partial init */
+static void bot_free_xp_state(yuno_bot_t *bot) {
+    leaderboard_free(&bot->leaderboard);
+    rank_index_free(&bot->ranks);
+    xp_cooldown_free(&bot->xp_cooldown);
 }
 
 int bot_init(yuno_bot_t *bot, const yuno_config_t *config) {
@@ -132,16 +449,63 @@ int bot_init(yuno_bot_t *bot, const yuno_config_t *config) {
         return -1;
     }
 
+    /* Top ranks and per-member ranks are kept current from committed XP flushes */
+    if (leaderboard_init(&bot->leaderboard) != 0 || rank_index_init(&bot->ranks) != 0 ||
+        xp_cooldown_init(&bot->xp_cooldown) != 0) {
+        fprintf(stderr, "💔 Failed to allocate XP caches\n");
+        bot_free_xp_state(bot);
+        db_close(&bot->database);
+        return -1;
+    }
+
+    /* Start the write-behind thread so event handlers never wait on disk */
+    if (db_writer_start(&bot->db_writer, &bot->database) != 0) {
+        fprintf(stderr, "💔 Failed to start database writer\n");
+        bot_free_xp_state(bot);
+        db_close(&bot->database);
+        return -1;
+    }
+
     /* Create Discord client */
     bot->client = discord_init(config->discord_token);
     if (!bot->client) {
         fprintf(stderr, "💔 Failed to initialize Discord client\n");
+        db_writer_stop(&bot->db_writer);
+        bot_free_xp_state(bot);
+        db_close(&bot->database);
+        return -1;
+    }
+
+    /* Initialize XP batcher and its background flusher */
+    if (xp_batcher_init(&bot->xp_batcher, config->xp_flush_interval) != 0) {
+        fprintf(stderr, "💔 Failed to start XP batcher\n");
+        discord_cleanup(bot->client);
+        bot->client = NULL;
+        db_writer_stop(&bot->db_writer);
+        bot_free_xp_state(bot);
         db_close(&bot->database);
         return -1;
     }
 
-    /* Initialize XP batcher */
-    xp_batcher_init(&bot->xp_batcher);
+    /* Recover XP a crash left in the journal before the gateway connects */
+    if (config->xp_journal_enabled) {
+        uint64_t generation = 1;
+        xp_journal_replay(&bot->xp_batcher.journal, config->database_path, &bot->database, &generation);
+        if (xp_journal_open(&bot->xp_batcher.journal, config->database_path, generation) != 0) {
+            fprintf(stderr, "💔 XP journal unavailable - pending XP won't survive a crash\n");
+        }
+    }
+
+    if (xp_batcher_start(bot) != 0) {
+        fprintf(stderr, "💔 Failed to start XP batcher\n");
+        xp_batcher_cleanup(&bot->xp_batcher);
+        discord_cleanup(bot->client);
+        bot->client = NULL;
+        db_writer_stop(&bot->db_writer);
+        bot_free_xp_state(bot);
+        db_close(&bot->database);
+        return -1;
+    }
 
     /* Initialize connection state */
     bot->connection.is_connected = 0;
@@ -155,6 +519,20 @@ int bot_init(yuno_bot_t *bot, const yuno_config_t *config) {
     discord_set_on_ready(bot->client, on_ready);
     discord_set_on_message_create(bot->client, on_message_create);
     discord_set_on_interaction_create(bot->client, on_interaction_create);
+    discord_set_on_voice_state_update(bot->client, on_voice_state_update);
+    discord_set_on_guild_create(bot->client, on_guild_create);
+    discord_set_on_guild_update(bot->client, on_guild_update);
+    discord_set_on_guild_delete(bot->client, on_guild_delete);
+    discord_set_on_guild_member_add(bot->client, on_guild_member_add);
+    discord_set_on_guild_member_update(bot->client, on_guild_member_update);
+    discord_set_on_guild_role_create(bot->client, on_guild_role_create);
+    discord_set_on_guild_role_update(bot->client, on_guild_role_update);
+    discord_set_on_guild_role_delete(bot->client, on_guild_role_delete);
+
+    /* Roles and owners from the gateway, so commands can check who may use them */
+    if (guild_roles_init(bot) != 0) {
+        fprintf(stderr, "💔 Failed to set up the role cache - prefix admin commands are master users only\n");
+    }
 
     /* Initialize terminal interface */
     terminal_init(bot);
@@ -162,12 +540,36 @@ int bot_init(yuno_bot_t *bot, const yuno_config_t *config) {
     /* Initialize spam filter */
     spam_filter_init(bot);
 
+    /* Lockdowns are lifted and channel slowmode undone off the event thread */
+    if (raid_guard_init(bot) != 0 || raid_guard_start() != 0) {
+        fprintf(stderr, "💔 Failed to start the raid guard - surges won't lock guilds down\n");
+    }
+
+    /* Banned word lists compile in the background and swap in when ready */
+    if (word_filter_init(bot) != 0 || word_filter_start() != 0) {
+        fprintf(stderr, "💔 Failed to start the word filter - banned words won't be removed\n");
+    }
+
+    /* Voice XP runs on its own minute tick */
+    if (voice_xp_init(bot) != 0 || voice_xp_start() != 0) {
+        fprintf(stderr, "💔 Failed to start voice XP - voice channels won't earn XP\n");
+    }
+
+    /* Role rewards are granted off their own queue, paced to the rate limit */
+    if (level_roles_init(bot) != 0 || level_roles_start() != 0) {
+        fprintf(stderr, "💔 Failed to start level role rewards - level-ups won't grant roles\n");
+    }
+
     return 0;
 }
 
 void bot_cleanup(yuno_bot_t *bot) {
-    /* Flush any remaining XP */
-    xp_batcher_flush(bot);
+    /* No more voice ticks or role changes, then flush any remaining XP */
+    voice_xp_stop();
+    level_roles_stop();
+    raid_guard_stop();
+    word_filter_stop();
+    xp_batcher_stop(bot);
 
     /* Stop terminal */
     terminal_stop();
@@ -175,6 +577,16 @@ void bot_cleanup(yuno_bot_t *bot) {
 
     /* Stop spam filter */
     spam_filter_cleanup();
+    raid_guard_cleanup();
+    word_filter_cleanup();
+    voice_xp_cleanup();
+    guild_roles_cleanup();
+
+    /* Drain queued writes (and level up messages) before the client goes away */
+    db_writer_stop(&bot->db_writer);
+    xp_batcher_cleanup(&bot->xp_batcher);
+    level_roles_cleanup();
+    bot_free_xp_state(bot);
 
     if (bot->client) {
         discord_cleanup(bot->client);
@@ -200,6 +612,7 @@ void bot_stop(yuno_bot_t *bot) {
 void on_ready(struct discord *client, const struct discord_ready *event) {
     (void)client;
     printf("💕 Yuno is online! Logged in as %s~ 💕\n", event->user->username);
+    guild_roles_on_ready(event);
     printf("💗 I'm watching over your servers for you~ 💗\n");
 
     /* Mark as connected */
@@ -261,6 +674,10 @@ static const command_entry_t g_commands[] = {
     /* Utility commands */
     { "source",     NULL,       cmd_source_prefix,     cmd_source },
     { "prefix",     NULL,       cmd_prefix_prefix,     cmd_prefix },
+    { "xp-cooldown", "xpcooldown", cmd_xp_cooldown_prefix, cmd_xp_cooldown },
+    { "level-role", "levelrole", cmd_level_role_prefix, cmd_level_role },
+    { "spam-policy", "spampolicy", cmd_spam_policy_prefix, cmd_spam_policy },
+    { "word-filter", "wordfilter", cmd_word_filter_prefix, cmd_word_filter },
     { "auto-clean", "autoclean", cmd_auto_clean_prefix, cmd_auto_clean },
     { "delay",      NULL,       cmd_delay_prefix,      cmd_delay },
 };
@@ -338,7 +755,7 @@ void on_message_create(struct discord *client, const struct discord_message *msg
         };
         strncpy(dm.username, msg->author->username, sizeof(dm.username) - 1);
         strncpy(dm.content, msg->content, sizeof(dm.content) - 1);
-        db_save_dm(&g_bot->database, &dm);
+        db_writer_save_dm(&g_bot->db_writer, &dm);
 
         /* Notify in terminal - avoid strlen in printf */
         content_len = strlen(msg->content);
@@ -352,23 +769,34 @@ void on_message_create(struct discord *client, const struct discord_message *msg
         return;
     }
 
-    /* Run spam filter */
+    /* One cached settings lookup serves the spam check, prefix and leveling */
     guild_settings_t settings;
-    if (db_get_guild_settings(&g_bot->database, msg->guild_id, &settings) == 0 && settings.spam_filter_enabled) {
-        if (spam_filter_handle(g_bot, msg)) {
+    int has_settings = (db_get_guild_settings(&g_bot->database, msg->guild_id, &settings) == 0);
+
+    /* Run spam filter - the raid guard counts every message before it */
+    if (has_settings && settings.spam_filter_enabled) {
+        raid_guard_on_message(msg);
+        if (spam_filter_handle(g_bot, msg, db_spam_policy(&g_bot->database, settings.spam_policy))) {
             return; /* Message was spam, already handled */
         }
     }
 
     /* Get guild prefix */
-    db_get_prefix(&g_bot->database, msg->guild_id, g_bot->config.default_prefix, prefix, sizeof(prefix));
+    strncpy(prefix, has_settings ? settings.prefix : g_bot->config.default_prefix, sizeof(prefix) - 1);
+    prefix[sizeof(prefix) - 1] = '\0';
     prefix_len = strlen(prefix);
 
     /* Check for prefix */
     if (strncmp(msg->content, prefix, prefix_len) != 0) {
+        if (word_filter_handle(g_bot, msg)) {
+            return; /* Had a banned word, already removed */
+        }
+
         /* Add XP for chatting using batcher */
-        guild_settings_t lvl_settings;
-        if (db_get_guild_settings(&g_bot->database, msg->guild_id, &lvl_settings) != 0 || lvl_settings.leveling_enabled) {
+        /* Messages inside the member's cooldown or a raid lockdown earn nothing and never reach the batcher */
+        if ((!has_settings || settings.leveling_enabled) && !raid_guard_locked(msg->guild_id) &&
+            xp_cooldown_try(&g_bot->xp_cooldown, msg->author->id, msg->guild_id,
+                            has_settings ? settings.xp_cooldown : DEFAULT_XP_COOLDOWN)) {
             /* Better random distribution */
             int xp_gain = 15 + (rand() % 11);
             xp_batcher_add(g_bot, msg->author->id, msg->guild_id, msg->channel_id, xp_gain);
@@ -401,6 +829,12 @@ void on_message_create(struct discord *client, const struct discord_message *msg
 
     /* Hash-based command dispatch */
     prefix_cmd_handler_t handler = find_prefix_handler(command);
+
+    /* Commands are filtered too - word-filter checks its own message, letting
+     * through only the word of an edit that went through */
+    if (handler != cmd_word_filter_prefix && word_filter_handle(g_bot, msg)) {
+        return;
+    }
     if (handler) {
         handler(client, msg, args);
     }
@@ -418,6 +852,60 @@ void on_interaction_create(struct discord *client, const struct discord_interact
     }
 }
 
+void on_voice_state_update(struct discord *client, const struct discord_voice_state *state) {
+    (void)client;
+    voice_xp_on_voice_state(state);
+}
+
+void on_guild_create(struct discord *client, const struct discord_guild *guild) {
+    (void)client;
+    guild_roles_on_guild(guild);
+    voice_xp_on_guild_create(guild);
+}
+
+void on_guild_update(struct discord *client, const struct discord_guild *guild) {
+    (void)client;
+    guild_roles_on_guild(guild);
+}
+
+void on_guild_delete(struct discord *client, const struct discord_guild *guild) {
+    (void)client;
+    guild_roles_on_guild_delete(guild);
+    voice_xp_on_guild_delete(guild);
+}
+
+void on_guild_member_update(struct discord *client, const struct discord_guild_member_update *event) {
+    (void)client;
+    if (event->user) {
+        guild_roles_on_member_update(event->guild_id, event->user->id, event->roles);
+        voice_xp_on_member_update(event->guild_id, event->user);
+    }
+}
+
+void on_guild_role_create(struct discord *client, const struct discord_guild_role_create *event) {
+    (void)client;
+    guild_roles_on_role(event->guild_id, event->role);
+}
+
+void on_guild_role_update(struct discord *client, const struct discord_guild_role_update *event) {
+    (void)client;
+    guild_roles_on_role(event->guild_id, event->role);
+}
+
+void on_guild_role_delete(struct discord *client, const struct discord_guild_role_delete *event) {
+    (void)client;
+    guild_roles_on_role_delete(event->guild_id, event->role_id);
+}
+
+void on_guild_member_add(struct discord *client, const struct discord_guild_member *member) {
+    (void)client;
+    guild_settings_t settings;
+    if (db_get_guild_settings(&g_bot->database, member->guild_id, &settings) == 0 &&
+        settings.spam_filter_enabled) {
+        raid_guard_on_member_join(member);
+    }
+}
+
 int bot_register_commands(yuno_bot_t *bot) {
     struct discord_application_command commands[] = {
         /* Utility commands */
@@ -439,6 +927,39 @@ int bot_is_master_user(yuno_bot_t *bot, uint64_t user_id) {
     return config_is_master_user(&bot->config, user_str);
 }
 
+static int has_any(uint64_t held, uint64_t permissions) {
+    return (held & GUILD_PERM_ADMINISTRATOR) || (held & permissions);
+}
+
+/* Slash commands come with the caller's permissions worked out by Discord */
+int bot_interaction_allowed(yuno_bot_t *bot, const struct discord_interaction *interaction, uint64_t permissions) {
+    const struct discord_guild_member *member = interaction->member;
+    if (!member || !member->user) return 0;
+    if (bot_is_master_user(bot, member->user->id)) return 1;
+    return member->permissions && has_any(strtoull(member->permissions, NULL, 10), permissions);
+}
+
+/* Messages only carry the author's roles - their permissions come from the role cache */
+int bot_message_allowed(yuno_bot_t *bot, const struct discord_message *msg, uint64_t permissions) {
+    if (!msg->author) return 0;
+    if (bot_is_master_user(bot, msg->author->id)) return 1;
+    if (!msg->member || msg->guild_id == 0) return 0;
+    return has_any(guild_roles_permissions(msg->guild_id, msg->author->id, msg->member->roles), permissions);
+}
+
+/* insufficient_permissions_message with ${author} filled in */
+void bot_format_insufficient_permissions(yuno_bot_t *bot, uint64_t user_id, char *out, size_t len) {
+    const char *template = bot->config.insufficient_permissions_message;
+    const char *mark = strstr(template, "${author}");
+
+    if (!mark) {
+        snprintf(out, len, "%s", template);
+        return;
+    }
+    snprintf(out, len, "%.*s<@%lu>%s", (int)(mark - template), template, (unsigned long)user_id,
+             mark + strlen("${author}"));
+}
+
 uint64_t parse_user_mention(const char *mention) {
     const char *start;
     char *end;
@@ -52,7 +52,7 @@ void cmd_ban(struct discord *client, const struct discord_interaction *interacti
     };
     strncpy(action.action_type, "ban", sizeof(action.action_type));
     strncpy(action.reason, reason, sizeof(action.reason) - 1);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     /* Send response */
     char response_msg[512];
@@ -113,7 +113,7 @@ void cmd_ban_prefix(struct discord *client, const struct discord_message *msg, c
     };
     strncpy(action.action_type, "ban", sizeof(action.action_type));
     strncpy(action.reason, reason, sizeof(action.reason) - 1);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
@@ -160,7 +160,7 @@ void cmd_kick(struct discord *client, const struct discord_interaction *interact
     };
     strncpy(action.action_type, "kick", sizeof(action.action_type));
     strncpy(action.reason, reason, sizeof(action.reason) - 1);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
@@ -215,7 +215,7 @@ void cmd_kick_prefix(struct discord *client, const struct discord_message *msg,
     };
     strncpy(action.action_type, "kick", sizeof(action.action_type));
     strncpy(action.reason, reason, sizeof(action.reason) - 1);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
@@ -262,7 +262,7 @@ void cmd_unban(struct discord *client, const struct discord_interaction *interac
     };
     strncpy(action.action_type, "unban", sizeof(action.action_type));
     strncpy(action.reason, reason, sizeof(action.reason) - 1);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
@@ -317,7 +317,7 @@ void cmd_unban_prefix(struct discord *client, const struct discord_message *msg,
     };
     strncpy(action.action_type, "unban", sizeof(action.action_type));
     strncpy(action.reason, reason, sizeof(action.reason) - 1);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
@@ -376,7 +376,7 @@ void cmd_timeout(struct discord *client, const struct discord_interaction *inter
     };
     strncpy(action.action_type, "timeout", sizeof(action.action_type));
     snprintf(action.reason, sizeof(action.reason), "%s (%ld minutes)", reason, (long)minutes);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
@@ -443,7 +443,7 @@ void cmd_timeout_prefix(struct discord *client, const struct discord_message *ms
     };
     strncpy(action.action_type, "timeout", sizeof(action.action_type));
     snprintf(action.reason, sizeof(action.reason), "%s (%ld minutes)", reason, (long)minutes);
-    db_log_mod_action(&g_bot->database, &action);
+    db_writer_log_mod_action(&g_bot->db_writer, &action);
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
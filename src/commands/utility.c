@@ -6,11 +6,46 @@
 
 #include "commands/utility.h"
 #include "bot.h"
+#include "leveling.h"
+#include "modules/level_roles.h"
+#include "modules/word_filter.h"
+#include "modules/guild_roles.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include <math.h>
+
+/* Turn the caller away with insufficient_permissions_message unless they hold
+ * one of permissions - returns 1 if they were turned away */
+static int refuse_interaction(struct discord *client, const struct discord_interaction *interaction,
+                              uint64_t permissions) {
+    if (bot_interaction_allowed(g_bot, interaction, permissions)) return 0;
+
+    char response_msg[MAX_MESSAGE_LEN + 32];
+    uint64_t user_id = interaction->member && interaction->member->user ? interaction->member->user->id : 0;
+    bot_format_insufficient_permissions(g_bot, user_id, response_msg, sizeof(response_msg));
+
+    struct discord_interaction_response response = {
+        .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
+        .data = &(struct discord_interaction_callback_data){
+            .content = response_msg,
+            .flags = DISCORD_MESSAGE_EPHEMERAL
+        }
+    };
+    discord_create_interaction_response(client, interaction->id, interaction->token, &response, NULL);
+    return 1;
+}
+
+static int refuse_message(struct discord *client, const struct discord_message *msg, uint64_t permissions) {
+    if (bot_message_allowed(g_bot, msg, permissions)) return 0;
+
+    char response_msg[MAX_MESSAGE_LEN + 32];
+    bot_format_insufficient_permissions(g_bot, msg->author ? msg->author->id : 0, response_msg, sizeof(response_msg));
+
+    struct discord_create_message params = { .content = response_msg };
+    discord_create_message(client, msg->channel_id, &params, NULL);
+    return 1;
+}
 
 void cmd_ping(struct discord *client, const struct discord_interaction *interaction) {
     char response_msg[] = "💓 **Pong!**\nI'm always here for you~ 💕";
@@ -42,12 +77,16 @@ void cmd_help(struct discord *client, const struct discord_interaction *interact
         "`/ping` - Check latency\n"
         "`/prefix` - Set server prefix\n"
         "`/auto-clean` - Configure auto-clean\n"
+        "`/spam-policy` - Server spam limits\n"
+        "`/word-filter` - Banned words and phrases\n"
         "`/delay` - Delay auto-clean\n"
         "`/source` - View source code\n"
         "`/help` - This menu\n\n"
         "**✨ Leveling**\n"
         "`/xp` - Check XP and level\n"
-        "`/leaderboard` - Server rankings\n\n"
+        "`/leaderboard` - Server rankings\n"
+        "`/xp-cooldown` - Seconds between XP awards\n"
+        "`/level-role` - Roles earned by level\n\n"
         "**🎱 Fun**\n"
         "`/8ball` - Ask the magic 8-ball\n\n"
         "💕 *Yuno is always watching over you~* 💕";
@@ -79,12 +118,16 @@ void cmd_help_prefix(struct discord *client, const struct discord_message *msg,
         "**⚙️ Utility**\n"
         "`ping` - Check latency\n"
         "`prefix` - Set server prefix\n"
+        "`spam-policy` - Server spam limits\n"
+        "`word-filter` - Banned words and phrases\n"
         "`delay` - Delay auto-clean\n"
         "`source` - View source code\n"
         "`help` - This menu\n\n"
         "**✨ Leveling**\n"
         "`xp` - Check XP and level\n"
-        "`leaderboard` - Server rankings\n\n"
+        "`leaderboard` - Server rankings\n"
+        "`xp-cooldown` - Seconds between XP awards\n"
+        "`level-role` - Roles earned by level\n\n"
         "**🎱 Fun**\n"
         "`8ball` - Ask the magic 8-ball\n\n"
         "💕 *Yuno is always watching over you~* 💕", prefix);
@@ -241,17 +284,22 @@ void cmd_xp(struct discord *client, const struct discord_interaction *interactio
     user_xp_t user_xp;
     db_get_user_xp(&g_bot->database, user_id, interaction->guild_id, &user_xp);
 
-    int next_level = user_xp.level + 1;
-    int64_t xp_for_next = next_level * next_level * 100;
-    int progress = (user_xp.xp * 100) / (xp_for_next > 0 ? xp_for_next : 1);
+    int progress = level_progress(user_xp.xp, user_xp.level);
+
+    char rank_text[64] = "Unranked";
+    uint64_t rank, members;
+    if (rank_index_get(&g_bot->ranks, &g_bot->database, interaction->guild_id, user_xp.xp, &rank, &members) == 0 && rank > 0) {
+        snprintf(rank_text, sizeof(rank_text), "#%lu of %lu", (unsigned long)rank, (unsigned long)members);
+    }
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
         "✨ **XP Stats**\n<@%lu>'s progress~ 💕\n\n"
+        "**Rank:** %s\n"
         "**Level:** %d\n"
         "**XP:** %ld\n"
         "**Progress to Next:** %d%%",
-        (unsigned long)user_id, user_xp.level, (long)user_xp.xp, progress);
+        (unsigned long)user_id, rank_text, user_xp.level, (long)user_xp.xp, progress);
 
     struct discord_interaction_response response = {
         .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
@@ -267,17 +315,22 @@ void cmd_xp_prefix(struct discord *client, const struct discord_message *msg, co
     user_xp_t user_xp;
     db_get_user_xp(&g_bot->database, user_id, msg->guild_id, &user_xp);
 
-    int next_level = user_xp.level + 1;
-    int64_t xp_for_next = next_level * next_level * 100;
-    int progress = (user_xp.xp * 100) / (xp_for_next > 0 ? xp_for_next : 1);
+    int progress = level_progress(user_xp.xp, user_xp.level);
+
+    char rank_text[64] = "Unranked";
+    uint64_t rank, members;
+    if (rank_index_get(&g_bot->ranks, &g_bot->database, msg->guild_id, user_xp.xp, &rank, &members) == 0 && rank > 0) {
+        snprintf(rank_text, sizeof(rank_text), "#%lu of %lu", (unsigned long)rank, (unsigned long)members);
+    }
 
     char response_msg[512];
     snprintf(response_msg, sizeof(response_msg),
         "✨ **XP Stats**\n<@%lu>'s progress~ 💕\n\n"
+        "**Rank:** %s\n"
         "**Level:** %d\n"
         "**XP:** %ld\n"
         "**Progress to Next:** %d%%",
-        (unsigned long)user_id, user_xp.level, (long)user_xp.xp, progress);
+        (unsigned long)user_id, rank_text, user_xp.level, (long)user_xp.xp, progress);
 
     struct discord_create_message params = { .content = response_msg };
     discord_create_message(client, msg->channel_id, &params, NULL);
@@ -286,7 +339,7 @@ void cmd_xp_prefix(struct discord *client, const struct discord_message *msg, co
 void cmd_leaderboard(struct discord *client, const struct discord_interaction *interaction) {
     user_xp_t top_users[10];
     int count;
-    db_get_leaderboard(&g_bot->database, interaction->guild_id, top_users, 10, &count);
+    leaderboard_get(&g_bot->leaderboard, &g_bot->database, interaction->guild_id, top_users, 10, &count);
 
     char response_msg[2048];
     char *ptr = response_msg;
@@ -321,7 +374,7 @@ void cmd_leaderboard_prefix(struct discord *client, const struct discord_message
     (void)args;
     user_xp_t top_users[10];
     int count;
-    db_get_leaderboard(&g_bot->database, msg->guild_id, top_users, 10, &count);
+    leaderboard_get(&g_bot->leaderboard, &g_bot->database, msg->guild_id, top_users, 10, &count);
 
     char response_msg[2048];
     char *ptr = response_msg;
@@ -348,3 +401,535 @@ void cmd_leaderboard_prefix(struct discord *client, const struct discord_message
     struct discord_create_message params = { .content = response_msg };
     discord_create_message(client, msg->channel_id, &params, NULL);
 }
+
+#define MAX_XP_COOLDOWN 3600
+
+/* Parse a cooldown in seconds - -1 if it isn't a whole number in range */
+static int parse_xp_cooldown(const char *text) {
+    char *end;
+    long seconds = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || seconds < 0 || seconds > MAX_XP_COOLDOWN) {
+        return -1;
+    }
+    return (int)seconds;
+}
+
+void cmd_xp_cooldown(struct discord *client, const struct discord_interaction *interaction) {
+    struct discord_application_command_interaction_data_option *options = interaction->data->options;
+    const char *value = NULL;
+
+    for (int i = 0; options && i < interaction->data->options->size; i++) {
+        if (strcmp(options[i].name, "seconds") == 0) {
+            value = options[i].value;
+        }
+    }
+
+    if (refuse_interaction(client, interaction, GUILD_PERM_MANAGE_GUILD)) {
+        return;
+    }
+
+    char response_msg[256];
+    int seconds = value ? parse_xp_cooldown(value) : -1;
+    if (seconds < 0) {
+        snprintf(response_msg, sizeof(response_msg),
+            "💔 Cooldown must be 0 to %d seconds~", MAX_XP_COOLDOWN);
+        struct discord_interaction_response response = {
+            .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
+            .data = &(struct discord_interaction_callback_data){
+                .content = response_msg,
+                .flags = DISCORD_MESSAGE_EPHEMERAL
+            }
+        };
+        discord_create_interaction_response(client, interaction->id, interaction->token, &response, NULL);
+        return;
+    }
+
+    db_set_xp_cooldown(&g_bot->database, interaction->guild_id, g_bot->config.default_prefix, seconds);
+
+    snprintf(response_msg, sizeof(response_msg),
+        "⏳ **XP Cooldown Updated!**\nMembers now earn XP at most once every %d seconds 💕", seconds);
+
+    struct discord_interaction_response response = {
+        .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
+        .data = &(struct discord_interaction_callback_data){ .content = response_msg }
+    };
+    discord_create_interaction_response(client, interaction->id, interaction->token, &response, NULL);
+}
+
+void cmd_xp_cooldown_prefix(struct discord *client, const struct discord_message *msg, const char *args) {
+    char response_msg[256];
+
+    if (!args || strlen(args) == 0) {
+        guild_settings_t settings;
+        int seconds = db_get_guild_settings(&g_bot->database, msg->guild_id, &settings) == 0
+            ? settings.xp_cooldown : DEFAULT_XP_COOLDOWN;
+
+        snprintf(response_msg, sizeof(response_msg), "⏳ Current XP cooldown: %d seconds 💕", seconds);
+        struct discord_create_message params = { .content = response_msg };
+        discord_create_message(client, msg->channel_id, &params, NULL);
+        return;
+    }
+
+    /* Reading the cooldown is open to everyone, changing it isn't */
+    if (refuse_message(client, msg, GUILD_PERM_MANAGE_GUILD)) {
+        return;
+    }
+
+    int seconds = parse_xp_cooldown(args);
+    if (seconds < 0) {
+        snprintf(response_msg, sizeof(response_msg),
+            "💔 Cooldown must be 0 to %d seconds~", MAX_XP_COOLDOWN);
+        struct discord_create_message params = { .content = response_msg };
+        discord_create_message(client, msg->channel_id, &params, NULL);
+        return;
+    }
+
+    db_set_xp_cooldown(&g_bot->database, msg->guild_id, g_bot->config.default_prefix, seconds);
+
+    snprintf(response_msg, sizeof(response_msg),
+        "⏳ **XP Cooldown Updated!**\nMembers now earn XP at most once every %d seconds 💕", seconds);
+
+    struct discord_create_message params = { .content = response_msg };
+    discord_create_message(client, msg->channel_id, &params, NULL);
+}
+
+/* Whole number in [min, max] - -1 if it isn't one */
+static int parse_spam_limit(const char *text, int min, int max) {
+    char *end;
+    long value = text ? strtol(text, &end, 10) : 0;
+    if (!text || end == text || *end != '\0' || value < min || value > max) {
+        return -1;
+    }
+    return (int)value;
+}
+
+/* Anything but show changes how the guild is moderated */
+static int spam_policy_edits(const char *action) {
+    return action && strcmp(action, "show") != 0;
+}
+
+/* Shared by the slash and prefix forms - writes the reply into out */
+static void run_spam_policy(uint64_t guild_id, const char *action, const char *interval_text,
+                            const char *messages_text, const char *duplicates_text, char *out, size_t len) {
+    if (!action || strcmp(action, "show") == 0) {
+        guild_settings_t settings;
+        const spam_policy_t *policy = db_spam_policy(&g_bot->database,
+            db_get_guild_settings(&g_bot->database, guild_id, &settings) == 0 ? settings.spam_policy : 0);
+        snprintf(out, len,
+            "🛡️ **Spam Policy**\n"
+            "%d messages or %d copies of one message within %d seconds counts as spam "
+            "(%d and %d during a raid lockdown) 💕",
+            policy->max_messages, policy->max_duplicates, policy->interval,
+            policy->lockdown_messages, policy->lockdown_duplicates);
+        return;
+    }
+
+    if (strcmp(action, "set") == 0) {
+        int interval = parse_spam_limit(interval_text, 1, MAX_SPAM_INTERVAL);
+        int max_messages = parse_spam_limit(messages_text, MIN_SPAM_LIMIT, MAX_SPAM_LIMIT);
+        int max_duplicates = parse_spam_limit(duplicates_text, MIN_SPAM_LIMIT, MAX_SPAM_LIMIT);
+        if (interval < 0 || max_messages < 0 || max_duplicates < 0) {
+            snprintf(out, len, "💔 Usage: `spam-policy set <seconds 1-%d> <messages %d-%d> <duplicates %d-%d>`~",
+                     MAX_SPAM_INTERVAL, MIN_SPAM_LIMIT, MAX_SPAM_LIMIT, MIN_SPAM_LIMIT, MAX_SPAM_LIMIT);
+            return;
+        }
+        if (db_set_spam_policy(&g_bot->database, guild_id, g_bot->config.default_prefix,
+                               interval, max_messages, max_duplicates) != 0) {
+            snprintf(out, len, "💔 Couldn't save that policy~");
+            return;
+        }
+        snprintf(out, len, "🛡️ **Spam Policy Updated!**\n%d messages or %d copies within %d seconds is spam now 💕",
+                 max_messages, max_duplicates, interval);
+        return;
+    }
+
+    if (strcmp(action, "reset") == 0) {
+        if (db_reset_spam_policy(&g_bot->database, guild_id) != 0) {
+            snprintf(out, len, "💔 Couldn't reset the policy~");
+            return;
+        }
+        snprintf(out, len, "🛡️ **Spam Policy Reset!**\nBack to %d messages or %d copies within %d seconds 💕",
+                 DEFAULT_SPAM_MAX_MESSAGES, DEFAULT_SPAM_MAX_DUPLICATES, DEFAULT_SPAM_INTERVAL);
+        return;
+    }
+
+    snprintf(out, len, "💔 Usage: `spam-policy [show | set <seconds> <messages> <duplicates> | reset]`~");
+}
+
+void cmd_spam_policy(struct discord *client, const struct discord_interaction *interaction) {
+    struct discord_application_command_interaction_data_option *options = interaction->data->options;
+    const char *action = NULL, *interval = NULL, *messages = NULL, *duplicates = NULL;
+
+    for (int i = 0; options && i < interaction->data->options->size; i++) {
+        if (strcmp(options[i].name, "action") == 0) action = options[i].value;
+        else if (strcmp(options[i].name, "seconds") == 0) interval = options[i].value;
+        else if (strcmp(options[i].name, "messages") == 0) messages = options[i].value;
+        else if (strcmp(options[i].name, "duplicates") == 0) duplicates = options[i].value;
+    }
+
+    if (spam_policy_edits(action) && refuse_interaction(client, interaction, GUILD_PERM_MANAGE_GUILD)) {
+        return;
+    }
+
+    char response_msg[512];
+    run_spam_policy(interaction->guild_id, action, interval, messages, duplicates,
+                    response_msg, sizeof(response_msg));
+
+    struct discord_interaction_response response = {
+        .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
+        .data = &(struct discord_interaction_callback_data){ .content = response_msg }
+    };
+    discord_create_interaction_response(client, interaction->id, interaction->token, &response, NULL);
+}
+
+void cmd_spam_policy_prefix(struct discord *client, const struct discord_message *msg, const char *args) {
+    char action[16] = "", interval[16] = "", messages[16] = "", duplicates[16] = "";
+    int fields = args ? sscanf(args, "%15s %15s %15s %15s", action, interval, messages, duplicates) : 0;
+
+    if (spam_policy_edits(fields >= 1 ? action : NULL) && refuse_message(client, msg, GUILD_PERM_MANAGE_GUILD)) {
+        return;
+    }
+
+    char response_msg[512];
+    run_spam_policy(msg->guild_id, fields >= 1 ? action : NULL, fields >= 2 ? interval : NULL,
+                    fields >= 3 ? messages : NULL, fields >= 4 ? duplicates : NULL,
+                    response_msg, sizeof(response_msg));
+
+    struct discord_create_message params = { .content = response_msg };
+    discord_create_message(client, msg->channel_id, &params, NULL);
+}
+
+/* Shared by the slash and prefix forms - writes the reply into out.
+ * Returns 1 if the list was edited, 0 otherwise. */
+static int run_word_filter(uint64_t guild_id, const char *action, const char *word, char *out, size_t len) {
+    if (!action || strcmp(action, "list") == 0) {
+        banned_word_t *words;
+        size_t count;
+        if (db_get_banned_words(&g_bot->database, guild_id, &words, &count) != 0) {
+            snprintf(out, len, "💔 Couldn't read the banned words~");
+            return 0;
+        }
+        int written = snprintf(out, len, "🚫 **Banned Words** (%zu/%d)\n*\"No one gets to say that around you~\"* 💕\n\n",
+                               count, WORD_FILTER_MAX_WORDS);
+        size_t shown = 0;
+        /* Leave room for the "and more" line */
+        while (shown < count && written > 0 && (size_t)written + strlen(words[shown].word) + 48 < len) {
+            written += snprintf(out + written, len - (size_t)written, "%s||%s||", shown ? ", " : "", words[shown].word);
+            shown++;
+        }
+        if (count == 0) {
+            snprintf(out + written, len - (size_t)written, "No banned words yet~");
+        } else if (shown < count) {
+            snprintf(out + written, len - (size_t)written, "\n...and %zu more", count - shown);
+        }
+        free(words);
+        return 0;
+    }
+
+    if (strcmp(action, "add") == 0) {
+        if (!word || !*word) {
+            snprintf(out, len, "💔 Usage: `word-filter add <word or phrase>`~");
+            return 0;
+        }
+        int rc = word_filter_add(guild_id, word);
+        if (rc < 0) {
+            snprintf(out, len, "💔 Couldn't save that word~");
+        } else if (rc == 1) {
+            snprintf(out, len, "💔 That's already banned~");
+        } else if (rc == 2) {
+            snprintf(out, len, "💔 Words need a letter or digit, at most %d characters, and a server can ban at most %d~",
+                     MAX_BANNED_WORD_LEN, WORD_FILTER_MAX_WORDS);
+        } else {
+            snprintf(out, len, "🚫 **Word Banned!**\nMessages with it will be removed in a moment 💕");
+        }
+        return rc == 0;
+    }
+
+    if (strcmp(action, "remove") == 0) {
+        if (!word || !*word) {
+            snprintf(out, len, "💔 Usage: `word-filter remove <word or phrase>`~");
+            return 0;
+        }
+        int rc = word_filter_remove(guild_id, word);
+        if (rc < 0) {
+            snprintf(out, len, "💔 Couldn't remove that word~");
+        } else if (rc > 0) {
+            snprintf(out, len, "💔 That word isn't banned~");
+        } else {
+            snprintf(out, len, "🚫 **Word Unbanned!**\nI'll stop removing it in a moment 💕");
+        }
+        return rc == 0;
+    }
+
+    snprintf(out, len, "💔 Usage: `word-filter [list | add <word or phrase> | remove <word or phrase>]`~");
+    return 0;
+}
+
+void cmd_word_filter(struct discord *client, const struct discord_interaction *interaction) {
+    struct discord_application_command_interaction_data_option *options = interaction->data->options;
+    const char *action = NULL, *word = NULL;
+
+    for (int i = 0; options && i < interaction->data->options->size; i++) {
+        if (strcmp(options[i].name, "action") == 0) action = options[i].value;
+        else if (strcmp(options[i].name, "word") == 0) word = options[i].value;
+    }
+
+    /* Even the list is for moderators only */
+    if (refuse_interaction(client, interaction, GUILD_PERM_MANAGE_GUILD)) {
+        return;
+    }
+
+    char response_msg[2000];    /* Discord's limit */
+    run_word_filter(interaction->guild_id, action, word, response_msg, sizeof(response_msg));
+
+    /* Only the moderator sees the list */
+    struct discord_interaction_response response = {
+        .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
+        .data = &(struct discord_interaction_callback_data){
+            .content = response_msg,
+            .flags = DISCORD_MESSAGE_EPHEMERAL
+        }
+    };
+    discord_create_interaction_response(client, interaction->id, interaction->token, &response, NULL);
+}
+
+/* The prefix form's list goes to the caller's DMs, not the channel */
+typedef struct {
+    uint64_t channel_id;        /* Where the command was run, for the failure notice */
+    char content[2000];         /* Discord's limit */
+} word_list_dm_t;
+
+static void word_list_dm_done(struct discord *client, struct discord_response *resp, const struct discord_channel *channel) {
+    word_list_dm_t *dm = resp->data;
+    struct discord_create_message params = { .content = dm->content };
+    discord_create_message(client, channel->id, &params, NULL);
+}
+
+static void word_list_dm_fail(struct discord *client, struct discord_response *resp) {
+    word_list_dm_t *dm = resp->data;
+    struct discord_create_message params = {
+        .content = "💔 I couldn't DM you the list - open your DMs or use `/word-filter list`~"
+    };
+    discord_create_message(client, dm->channel_id, &params, NULL);
+}
+
+static void word_list_dm_cleanup(struct discord *client, void *data) {
+    (void)client;
+    free(data);
+}
+
+void cmd_word_filter_prefix(struct discord *client, const struct discord_message *msg, const char *args) {
+    char action[16] = "";
+    const char *word = NULL;
+    int fields = args ? sscanf(args, "%15s", action) : 0;
+
+    /* Everything after the action is the word or phrase */
+    if (fields == 1) {
+        word = strstr(args, action) + strlen(action);
+        while (*word == ' ' || *word == '\t') word++;
+    }
+
+    /* Only the word of an edit that goes through is let past the filter -
+     * anything else, edits from members who may not make them included,
+     * is checked like any other message */
+    int editing = fields == 1 && (strcmp(action, "add") == 0 || strcmp(action, "remove") == 0) &&
+                  bot_message_allowed(g_bot, msg, GUILD_PERM_MANAGE_GUILD);
+    if (!editing && word_filter_handle(g_bot, msg)) {
+        return;
+    }
+    if (refuse_message(client, msg, GUILD_PERM_MANAGE_GUILD)) {
+        return;
+    }
+
+    if (fields == 0 || strcmp(action, "list") == 0) {
+        word_list_dm_t *dm = malloc(sizeof(word_list_dm_t));
+        if (!dm) return;
+        dm->channel_id = msg->channel_id;
+        run_word_filter(msg->guild_id, "list", NULL, dm->content, sizeof(dm->content));
+
+        discord_create_dm(client, &(struct discord_create_dm){ .recipient_id = msg->author->id },
+            &(struct discord_ret_channel){
+                .done = word_list_dm_done,
+                .fail = word_list_dm_fail,
+                .data = dm,
+                .cleanup = word_list_dm_cleanup
+            });
+
+        struct discord_create_message params = { .content = "📬 Sent you the list in DMs~" };
+        discord_create_message(client, msg->channel_id, &params, NULL);
+        return;
+    }
+
+    char response_msg[512];
+    int edited = run_word_filter(msg->guild_id, action, word, response_msg, sizeof(response_msg));
+    if (editing && !edited && word_filter_handle(g_bot, msg)) {
+        return;
+    }
+
+    struct discord_create_message params = { .content = response_msg };
+    discord_create_message(client, msg->channel_id, &params, NULL);
+}
+
+/* Role mention <@&123> or a raw role ID - 0 if neither */
+static uint64_t parse_role_mention(const char *text) {
+    char *end;
+    if (text[0] == '<' && text[1] == '@' && text[2] == '&') {
+        uint64_t id = strtoull(text + 3, &end, 10);
+        return *end == '>' ? id : 0;
+    }
+    uint64_t id = strtoull(text, &end, 10);
+    return *end == '\0' ? id : 0;
+}
+
+#define LEVEL_ROLE_PERMISSIONS (GUILD_PERM_MANAGE_ROLES | GUILD_PERM_MANAGE_GUILD)
+
+/* Anything but list changes who gets which roles */
+static int level_role_edits(const char *action) {
+    return action && strcmp(action, "list") != 0;
+}
+
+/* Shared by the slash and prefix forms - writes the reply into out. The caller
+ * has been let through already; their roles bound which roles they may reward. */
+static void run_level_role(uint64_t guild_id, uint64_t caller_id, const struct snowflakes *caller_roles,
+                           const char *action, const char *level_text, const char *role_text,
+                           char *out, size_t len) {
+    char *end;
+    long level = level_text ? strtol(level_text, &end, 10) : 0;
+    int level_ok = level_text && end != level_text && *end == '\0' && level >= 1 && level <= 100000;
+
+    if (!action || strcmp(action, "list") == 0) {
+        level_role_t *roles;
+        size_t count;
+        if (db_get_level_roles(&g_bot->database, guild_id, &roles, &count) != 0) {
+            snprintf(out, len, "💔 Couldn't read the level rewards~");
+            return;
+        }
+        int written = snprintf(out, len, "🎀 **Level Rewards**\n*\"Keep talking to me and I'll give you more~\"* 💕\n\n");
+        for (size_t i = 0; i < count && written > 0 && (size_t)written < len; i++) {
+            written += snprintf(out + written, len - (size_t)written, "Level %d - <@&%lu>\n",
+                                roles[i].level, (unsigned long)roles[i].role_id);
+        }
+        if (count == 0 && (size_t)written < len) {
+            snprintf(out + written, len - (size_t)written, "No level rewards yet~");
+        }
+        free(roles);
+        return;
+    }
+
+    if (strcmp(action, "add") == 0) {
+        uint64_t role_id = role_text ? parse_role_mention(role_text) : 0;
+        level_role_t *roles;
+        size_t count;
+        if (!level_ok || role_id == 0) {
+            snprintf(out, len, "💔 Usage: `level-role add <level> <@role>`~");
+            return;
+        }
+
+        /* Discord won't let the bot hand out roles at or above its own, nor
+         * should it hand out roles the caller couldn't give themselves */
+        int bot_outranks = guild_roles_bot_outranks(guild_id, role_id);
+        if (bot_outranks < 0 || role_id == guild_id) {
+            snprintf(out, len, "💔 I don't know that role - is it one of this server's?~");
+            return;
+        }
+        if (!bot_outranks) {
+            snprintf(out, len, "💔 <@&%lu> is at or above my highest role, so I can't hand it out~",
+                     (unsigned long)role_id);
+            return;
+        }
+        if (!bot_is_master_user(g_bot, caller_id) &&
+            guild_roles_member_outranks(guild_id, caller_id, caller_roles, role_id) != 1) {
+            snprintf(out, len, "💔 You can only reward roles below your own highest role~");
+            return;
+        }
+        if (db_get_level_roles(&g_bot->database, guild_id, &roles, &count) != 0) {
+            snprintf(out, len, "💔 Couldn't read the level rewards~");
+            return;
+        }
+        int replacing = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (roles[i].level == (int)level) replacing = 1;
+        }
+        free(roles);
+        if (!replacing && count >= MAX_LEVEL_ROLES) {
+            snprintf(out, len, "💔 A server can have at most %d level rewards~", MAX_LEVEL_ROLES);
+            return;
+        }
+        if (db_set_level_role(&g_bot->database, guild_id, (int)level, role_id) != 0) {
+            snprintf(out, len, "💔 Couldn't save that reward~");
+            return;
+        }
+        level_roles_resync(guild_id);
+        snprintf(out, len, "🎀 **Level Reward Added!**\nReaching level %ld now earns <@&%lu>. "
+                 "I'll catch everyone up a few at a time 💕", level, (unsigned long)role_id);
+        return;
+    }
+
+    if (strcmp(action, "remove") == 0) {
+        if (!level_ok) {
+            snprintf(out, len, "💔 Usage: `level-role remove <level>`~");
+            return;
+        }
+        int rc = db_remove_level_role(&g_bot->database, guild_id, (int)level);
+        if (rc < 0) {
+            snprintf(out, len, "💔 Couldn't remove that reward~");
+        } else if (rc > 0) {
+            snprintf(out, len, "💔 There's no reward at level %ld~", level);
+        } else {
+            level_roles_resync(guild_id);
+            snprintf(out, len, "🎀 **Level Reward Removed!**\nMembers keep roles they already earned 💕");
+        }
+        return;
+    }
+
+    if (strcmp(action, "sync") == 0) {
+        level_roles_resync(guild_id);
+        snprintf(out, len, "🎀 **Resyncing Level Rewards!**\nI'll fix everyone's roles a few at a time 💕");
+        return;
+    }
+
+    snprintf(out, len, "💔 Usage: `level-role [list | add <level> <@role> | remove <level> | sync]`~");
+}
+
+void cmd_level_role(struct discord *client, const struct discord_interaction *interaction) {
+    struct discord_application_command_interaction_data_option *options = interaction->data->options;
+    const char *action = NULL, *level = NULL, *role = NULL;
+
+    for (int i = 0; options && i < interaction->data->options->size; i++) {
+        if (strcmp(options[i].name, "action") == 0) action = options[i].value;
+        else if (strcmp(options[i].name, "level") == 0) level = options[i].value;
+        else if (strcmp(options[i].name, "role") == 0) role = options[i].value;
+    }
+
+    if (level_role_edits(action) && refuse_interaction(client, interaction, LEVEL_ROLE_PERMISSIONS)) {
+        return;
+    }
+
+    char response_msg[2048];
+    const struct discord_guild_member *member = interaction->member;
+    run_level_role(interaction->guild_id, member && member->user ? member->user->id : 0,
+                   member ? member->roles : NULL, action, level, role, response_msg, sizeof(response_msg));
+
+    struct discord_interaction_response response = {
+        .type = DISCORD_INTERACTION_CHANNEL_MESSAGE_WITH_SOURCE,
+        .data = &(struct discord_interaction_callback_data){ .content = response_msg }
+    };
+    discord_create_interaction_response(client, interaction->id, interaction->token, &response, NULL);
+}
+
+void cmd_level_role_prefix(struct discord *client, const struct discord_message *msg, const char *args) {
+    char action[16] = "", level[32] = "", role[64] = "";
+    int fields = args ? sscanf(args, "%15s %31s %63s", action, level, role) : 0;
+
+    if (level_role_edits(fields >= 1 ? action : NULL) && refuse_message(client, msg, LEVEL_ROLE_PERMISSIONS)) {
+        return;
+    }
+
+    char response_msg[2048];
+    run_level_role(msg->guild_id, msg->author->id, msg->member ? msg->member->roles : NULL,
+                   fields >= 1 ? action : NULL, fields >= 2 ? level : NULL,
+                   fields >= 3 ? role : NULL, response_msg, sizeof(response_msg));
+
+    struct discord_create_message params = { .content = response_msg };
+    discord_create_message(client, msg->channel_id, &params, NULL);
+}
@@ -15,6 +15,16 @@ void config_init_defaults(yuno_config_t *config) {
     strncpy(config->default_prefix, ".", sizeof(config->default_prefix) - 1);
     strncpy(config->database_path, "yuno.db", sizeof(config->database_path) - 1);
     config->spam_max_warnings = 3;
+    config->xp_flush_interval = 120;
+    config->xp_journal_enabled = 1;
+    config->level_up_batch_max = 10;
+    config->spam_memory_kb = 8192;
+    config->spam_guild_quota_percent = 10;
+    config->raid_similar_users = 5;
+    config->raid_similar_seconds = 30;
+    config->raid_memory_kb = 2048;
+    config->raid_lockdown_seconds = 600;
+    config->raid_slowmode_seconds = 10;
     strncpy(config->dm_message, "I'm just a bot :'(. I can't answer to you.", sizeof(config->dm_message) - 1);
     strncpy(config->insufficient_permissions_message, "${author} You don't have permission to do that~", sizeof(config->insufficient_permissions_message) - 1);
 }
@@ -85,6 +95,56 @@ int config_load(yuno_config_t *config, const char *path) {
         config->spam_max_warnings = json_object_get_int(value);
     }
 
+    /* Parse xp_flush_interval */
+    if (json_object_object_get_ex(root, "xp_flush_interval", &value)) {
+        config->xp_flush_interval = json_object_get_int(value);
+    }
+
+    /* Parse xp_journal */
+    if (json_object_object_get_ex(root, "xp_journal", &value)) {
+        config->xp_journal_enabled = json_object_get_boolean(value);
+    }
+
+    /* Parse level_up_batch_max */
+    if (json_object_object_get_ex(root, "level_up_batch_max", &value)) {
+        config->level_up_batch_max = json_object_get_int(value);
+    }
+
+    /* Parse spam_memory_kb */
+    if (json_object_object_get_ex(root, "spam_memory_kb", &value)) {
+        config->spam_memory_kb = json_object_get_int(value);
+    }
+
+    /* Parse spam_guild_quota_percent */
+    if (json_object_object_get_ex(root, "spam_guild_quota_percent", &value)) {
+        config->spam_guild_quota_percent = json_object_get_int(value);
+    }
+
+    /* Parse raid_similar_users */
+    if (json_object_object_get_ex(root, "raid_similar_users", &value)) {
+        config->raid_similar_users = json_object_get_int(value);
+    }
+
+    /* Parse raid_similar_seconds */
+    if (json_object_object_get_ex(root, "raid_similar_seconds", &value)) {
+        config->raid_similar_seconds = json_object_get_int(value);
+    }
+
+    /* Parse raid_memory_kb */
+    if (json_object_object_get_ex(root, "raid_memory_kb", &value)) {
+        config->raid_memory_kb = json_object_get_int(value);
+    }
+
+    /* Parse raid_lockdown_seconds */
+    if (json_object_object_get_ex(root, "raid_lockdown_seconds", &value)) {
+        config->raid_lockdown_seconds = json_object_get_int(value);
+    }
+
+    /* Parse raid_slowmode_seconds */
+    if (json_object_object_get_ex(root, "raid_slowmode_seconds", &value)) {
+        config->raid_slowmode_seconds = json_object_get_int(value);
+    }
+
     /* Parse ban_default_image */
     if (json_object_object_get_ex(root, "ban_default_image", &value)) {
         if (!json_object_is_type(value, json_type_null)) {
@@ -127,6 +187,11 @@ int config_load_from_env(yuno_config_t *config) {
         config->spam_max_warnings = atoi(spam_warnings);
     }
 
+    const char *xp_interval = getenv("XP_FLUSH_INTERVAL");
+    if (xp_interval) {
+        config->xp_flush_interval = atoi(xp_interval);
+    }
+
     const char *master = getenv("MASTER_USER");
     if (master) {
         strncpy(config->master_users[0], master, 31);
@@ -0,0 +1,478 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Message Content Fingerprints
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "content_hash.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+#define STRIPE 32                   /* Four 8-byte lanes */
+#define BUFFER 256                  /* Hashed whenever this much is waiting */
+
+/* Normalized text is written to buf and hashed in whole stripes as it fills,
+ * so the message is only walked once */
+typedef struct {
+    uint64_t acc[4];
+    uint64_t hashed;                /* Bytes already folded into acc */
+    size_t len;                     /* Bytes waiting in buf */
+    int pending_space;              /* Whitespace since the last character */
+    uint8_t buf[BUFFER + STRIPE];   /* Room for one more write past BUFFER */
+    uint8_t *copy;                  /* content_normalize - buf drains here instead of into acc */
+
+    /* SimHash, when asked for */
+    int simhash;
+    uint32_t window;                /* Last four normalized bytes */
+    uint32_t shingles;
+    uint64_t planes[8];             /* Byte j of planes[k] counts shingles with bit 8j + k */
+} fingerprint_t;
+
+static void add_shingles(fingerprint_t *fp, const uint8_t *p, size_t n);
+
+/* ---- XXH64 ---- */
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    return rotl64(acc, 31) * PRIME1;
+}
+
+static inline uint64_t xxh_merge(uint64_t h, uint64_t acc) {
+    h ^= xxh_round(0, acc);
+    return h * PRIME1 + PRIME4;
+}
+
+/* The lanes don't depend on each other, so their multiplies overlap */
+static void consume_stripes(fingerprint_t *fp) {
+    if (fp->copy) {
+        memcpy(fp->copy, fp->buf, fp->len);
+        fp->copy += fp->len;
+        fp->hashed += fp->len;
+        fp->len = 0;
+        return;
+    }
+
+    size_t whole = fp->len & ~(size_t)(STRIPE - 1);
+    uint64_t a0 = fp->acc[0], a1 = fp->acc[1], a2 = fp->acc[2], a3 = fp->acc[3];
+
+    for (const uint8_t *p = fp->buf; p < fp->buf + whole; p += STRIPE) {
+        a0 = xxh_round(a0, read64(p));
+        a1 = xxh_round(a1, read64(p + 8));
+        a2 = xxh_round(a2, read64(p + 16));
+        a3 = xxh_round(a3, read64(p + 24));
+    }
+    fp->acc[0] = a0;
+    fp->acc[1] = a1;
+    fp->acc[2] = a2;
+    fp->acc[3] = a3;
+
+    if (fp->simhash) add_shingles(fp, fp->buf, whole);
+    memmove(fp->buf, fp->buf + whole, fp->len - whole);
+    fp->hashed += whole;
+    fp->len -= whole;
+}
+
+static inline int started(const fingerprint_t *fp) {
+    return fp->hashed + fp->len != 0;
+}
+
+static uint64_t finish(fingerprint_t *fp) {
+    consume_stripes(fp);
+
+    uint64_t total = fp->hashed + fp->len;
+    uint64_t h;
+    if (total >= STRIPE) {
+        h = rotl64(fp->acc[0], 1) + rotl64(fp->acc[1], 7) + rotl64(fp->acc[2], 12) + rotl64(fp->acc[3], 18);
+        for (int i = 0; i < 4; i++) {
+            h = xxh_merge(h, fp->acc[i]);
+        }
+    } else {
+        h = PRIME5;
+    }
+    h += total;
+
+    const uint8_t *p = fp->buf;
+    size_t n = fp->len;
+    for (; n >= 8; p += 8, n -= 8) {
+        h ^= xxh_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME1 + PRIME4;
+    }
+    if (n >= 4) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        h ^= (uint64_t)v * PRIME1;
+        h = rotl64(h, 23) * PRIME2 + PRIME3;
+        p += 4;
+        n -= 4;
+    }
+    for (; n; p++, n--) {
+        h ^= *p * PRIME5;
+        h = rotl64(h, 11) * PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* ---- SimHash ---- */
+
+#define ONES 0x0101010101010101ULL
+
+/* Every byte ends a shingle - the first three are short ones - and each
+ * shingle's hash votes on all 64 bits. Spreading the hash over eight planes
+ * lets one add count eight bits at once, and capping the shingles at 255
+ * means a byte never wraps. */
+static void add_shingles(fingerprint_t *fp, const uint8_t *p, size_t n) {
+    size_t room = CONTENT_SIMHASH_FEATURES - fp->shingles;
+    if (n > room) n = room;
+
+    uint32_t window = fp->window;
+    uint64_t planes[8];
+    memcpy(planes, fp->planes, sizeof(planes));
+
+    for (size_t i = 0; i < n; i++) {
+        window = (window << 8) | p[i];
+        uint64_t h = window * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 32;
+        h *= 0xD6E8FEB86659FD93ULL;
+        h ^= h >> 32;
+
+        planes[0] += h & ONES;
+        planes[1] += (h >> 1) & ONES;
+        planes[2] += (h >> 2) & ONES;
+        planes[3] += (h >> 3) & ONES;
+        planes[4] += (h >> 4) & ONES;
+        planes[5] += (h >> 5) & ONES;
+        planes[6] += (h >> 6) & ONES;
+        planes[7] += (h >> 7) & ONES;
+    }
+
+    memcpy(fp->planes, planes, sizeof(planes));
+    fp->window = window;
+    fp->shingles += (uint32_t)n;
+}
+
+/* Bit 8j + k is set when more than half the shingles voted for it, i.e.
+ * byte j of planes[k] is over half = shingles / 2 (at most 127). Bytes with
+ * the top bit set are; the rest are once (127 - half) is added, which can't
+ * carry into the next byte. */
+static uint64_t finish_simhash(const fingerprint_t *fp) {
+    uint64_t over = (127 - fp->shingles / 2) * ONES;
+    uint64_t h = 0;
+    for (int k = 0; k < 8; k++) {
+        uint64_t c = fp->planes[k];
+        uint64_t majority = (c | ((c & (0x7F * ONES)) + over)) & (0x80 * ONES);
+        h |= (majority >> 7) << k;
+    }
+    return h;
+}
+
+/* ---- Normalization ---- */
+
+/* Latin-1 letters U+00C0-U+00FF, lowercased and with accents stripped -
+ * the same result as dropping the combining mark from the decomposed form */
+static const uint8_t latin1_fold[64] = {
+    'a', 'a', 'a', 'a', 'a', 'a', 0xE6, 'c', 'e', 'e', 'e', 'e', 'i', 'i', 'i', 'i',
+    0xF0, 'n', 'o', 'o', 'o', 'o', 'o', 0xD7, 0xF8, 'u', 'u', 'u', 'u', 'y', 0xFE, 0xDF,
+    'a', 'a', 'a', 'a', 'a', 'a', 0xE6, 'c', 'e', 'e', 'e', 'e', 'i', 'i', 'i', 'i',
+    0xF0, 'n', 'o', 'o', 'o', 'o', 'o', 0xF7, 0xF8, 'u', 'u', 'u', 'u', 'y', 0xFE, 'y',
+};
+
+static inline int is_continuation(uint8_t c) {
+    return (c & 0xC0) == 0x80;
+}
+
+/* Decodes the sequence at s[*pos]. A malformed byte comes back on its own as
+ * a lone surrogate U+DC80-U+DCFF - never a real character, and left alone by
+ * the rules below, so the byte is copied through as is. */
+static inline uint32_t decode_utf8(const uint8_t *s, size_t len, size_t *pos) {
+    size_t i = *pos;
+    uint32_t c = s[i];
+
+    if (c >= 0xC2 && c <= 0xDF && i + 1 < len && is_continuation(s[i + 1])) {
+        *pos = i + 2;
+        return ((c & 0x1F) << 6) | (s[i + 1] & 0x3F);
+    }
+    if (c >= 0xE0 && c <= 0xEF && i + 2 < len && is_continuation(s[i + 1]) && is_continuation(s[i + 2])) {
+        uint32_t cp = ((c & 0x0F) << 12) | ((uint32_t)(s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+        if (cp >= 0x800 && (cp < 0xD800 || cp > 0xDFFF)) {
+            *pos = i + 3;
+            return cp;
+        }
+    }
+    if (c >= 0xF0 && c <= 0xF4 && i + 3 < len && is_continuation(s[i + 1]) &&
+        is_continuation(s[i + 2]) && is_continuation(s[i + 3])) {
+        uint32_t cp = ((c & 0x07) << 18) | ((uint32_t)(s[i + 1] & 0x3F) << 12) |
+                      ((uint32_t)(s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F);
+        if (cp >= 0x10000 && cp <= 0x10FFFF) {
+            *pos = i + 4;
+            return cp;
+        }
+    }
+    *pos = i + 1;
+    return 0xDC00 | c;
+}
+
+static inline size_t encode_utf8(uint32_t cp, uint8_t *out) {
+    if (cp < 0x80) {
+        out[0] = (uint8_t)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (uint8_t)(0xC0 | (cp >> 6));
+        out[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (uint8_t)(0xE0 | (cp >> 12));
+        out[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (uint8_t)(0xF0 | (cp >> 18));
+    out[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/* Most scripts and all emoji are neither whitespace nor invisible - one
+ * test for those instead of every range below */
+static inline int is_ordinary(uint32_t cp) {
+    return (cp >= 0x370 && cp < 0x1680 && cp != 0x61C) || (cp > 0x3000 && cp < 0xFE00) ||
+           (cp >= 0x1F000 && cp < 0xE0000);
+}
+
+static inline int is_space(uint32_t cp) {
+    return cp == 0x85 || cp == 0xA0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) ||
+           cp == 0x2028 || cp == 0x2029 || cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+/* Combining marks, zero-width characters, bidi controls, variation selectors
+ * and tags - nothing a reader would see */
+static inline int is_invisible(uint32_t cp) {
+    return cp == 0xAD || (cp >= 0x300 && cp <= 0x36F) || cp == 0x61C || cp == 0x180E ||
+           (cp >= 0x1AB0 && cp <= 0x1AFF) || (cp >= 0x1DC0 && cp <= 0x1DFF) ||
+           (cp >= 0x200B && cp <= 0x200F) || (cp >= 0x202A && cp <= 0x202E) ||
+           (cp >= 0x2060 && cp <= 0x206F) || (cp >= 0x20D0 && cp <= 0x20FF) ||
+           (cp >= 0xFE00 && cp <= 0xFE0F) || (cp >= 0xFE20 && cp <= 0xFE2F) ||
+           cp == 0xFEFF || (cp >= 0xE0000 && cp <= 0xE01EF);
+}
+
+/* Simple case folding for the scripts spam actually shows up in */
+static inline uint32_t fold_case(uint32_t cp) {
+    if (cp < 0xC0) return cp;
+    if (cp < 0x100) return latin1_fold[cp - 0xC0];
+    if (cp < 0x180) {
+        /* Latin Extended-A pairs - uppercase even, except where it's odd */
+        if (cp == 0x178) return 0xFF;
+        if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) return cp + (cp & 1);
+        if (cp <= 0x137 || (cp >= 0x14A && cp <= 0x177)) return cp | 1;
+        return cp;
+    }
+    if (cp >= 0x391 && cp <= 0x3AB && cp != 0x3A2) return cp + 0x20;
+    if (cp == 0x3C2) return 0x3C3;
+    if (cp >= 0x400 && cp <= 0x42F) return cp < 0x410 ? cp + 0x50 : cp + 0x20;
+    if (cp >= 0xFF01 && cp <= 0xFF5E) {
+        /* Fullwidth forms are ASCII in disguise */
+        cp -= 0xFEE0;
+        return cp >= 'A' && cp <= 'Z' ? cp + 0x20 : cp;
+    }
+    return cp;
+}
+
+/* One character at a time until pos reaches limit. A sequence may end past
+ * limit; returns where it stopped. */
+static size_t normalize_chars(fingerprint_t *fp, const uint8_t *s, size_t len, size_t pos, size_t limit) {
+    uint8_t *out = fp->buf + fp->len;
+    int pending = fp->pending_space;
+    int any = started(fp);              /* Leading whitespace is dropped */
+
+    while (pos < limit) {
+        size_t start = pos;
+        uint32_t cp = s[pos];
+        uint32_t folded;
+
+        if (cp < 0x80) {
+            pos++;
+            if (cp == ' ' || (cp >= '\t' && cp <= '\r')) {
+                pending = any;
+                continue;
+            }
+            folded = cp >= 'A' && cp <= 'Z' ? cp + 0x20 : cp;
+        } else {
+            cp = decode_utf8(s, len, &pos);
+            if (!is_ordinary(cp)) {
+                if (is_space(cp)) {
+                    pending = any;
+                    continue;
+                }
+                if (is_invisible(cp)) continue;
+            }
+            folded = fold_case(cp);
+        }
+
+        if (pending) {
+            *out++ = ' ';
+            pending = 0;
+        }
+        if (folded != cp) {
+            out += encode_utf8(folded, out);
+        } else if (start + 4 <= len) {
+            /* Unchanged - copy the sequence rather than re-encode it */
+            memcpy(out, s + start, 4);
+            out += pos - start;
+        } else {
+            while (start < pos) *out++ = s[start++];
+        }
+        any = 1;
+
+        if (out >= fp->buf + BUFFER) {
+            fp->len = (size_t)(out - fp->buf);
+            consume_stripes(fp);
+            out = fp->buf + fp->len;
+        }
+    }
+
+    fp->len = (size_t)(out - fp->buf);
+    fp->pending_space = pending;
+    return pos;
+}
+
+#if defined(__SSE2__)
+/* Bytes in [lo, hi], compared unsigned */
+static inline __m128i bytes_in_range(__m128i x, uint8_t lo, uint8_t hi) {
+    __m128i offset = _mm_sub_epi8(x, _mm_set1_epi8((char)lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8((char)(hi - lo))), offset);
+}
+
+/* Sixteen bytes go through in one step when their only whitespace is lone
+ * spaces and nothing but ASCII letters would change - lowercase Cyrillic,
+ * CJK, emoji and most other scripts included. Every lead byte not ruled out
+ * here only starts characters that normalize to themselves, and malformed
+ * bytes are copied either way, so a sequence split across blocks still comes
+ * out the same. Takes the first n bytes, reading p[16]; returns 0 when they
+ * need normalize_chars. */
+static inline int normalize_block16(fingerprint_t *fp, const uint8_t *p, size_t n) {
+    unsigned used = (1u << n) - 1;
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    __m128i next = _mm_loadu_si128((const __m128i *)(p + 1));
+
+    __m128i changes = bytes_in_range(block, 0x00, 0x1F);                            /* Controls */
+    changes = _mm_or_si128(changes, bytes_in_range(block, 0xC2, 0xC5));              /* Latin */
+    changes = _mm_or_si128(changes, bytes_in_range(block, 0xCC, 0xCF));              /* Marks, Greek */
+    changes = _mm_or_si128(changes, _mm_cmpeq_epi8(block, _mm_set1_epi8((char)0xD8))); /* U+061C */
+    changes = _mm_or_si128(changes, bytes_in_range(block, 0xE1, 0xE3));              /* Spaces, zero-width */
+    changes = _mm_or_si128(changes, _mm_cmpeq_epi8(block, _mm_set1_epi8((char)0xEF))); /* BOM, fullwidth */
+    changes = _mm_or_si128(changes, _mm_cmpeq_epi8(block, _mm_set1_epi8((char)0xF3))); /* Tags */
+
+    /* Cyrillic capitals are U+0400-U+042F, the D0 sequences below D0 B0 */
+    __m128i d0 = _mm_cmpeq_epi8(block, _mm_set1_epi8((char)0xD0));
+    changes = _mm_or_si128(changes, _mm_andnot_si128(bytes_in_range(next, 0xB0, 0xBF), d0));
+
+    /* Also out: a run of spaces to collapse, or a first space that extends
+     * one or leads the message. All in one branch, since separate tests
+     * would each go whichever way the text does and mispredict. */
+    unsigned spaces = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(' '))) & used;
+    unsigned joins = (unsigned)(fp->pending_space | !started(fp));
+    if ((((unsigned)_mm_movemask_epi8(changes) | (spaces & (spaces >> 1)) | (spaces & joins)) & used)) return 0;
+
+    __m128i upper = bytes_in_range(block, 'A', 'Z');
+    block = _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+
+    fp->buf[fp->len] = ' ';
+    fp->len += (size_t)fp->pending_space;
+    _mm_storeu_si128((__m128i *)(fp->buf + fp->len), block);
+
+    /* A space at the end might be trailing - hold it back like any other */
+    fp->pending_space = (spaces >> (n - 1)) & 1;
+    fp->len += n - (size_t)fp->pending_space;
+    if (fp->len >= BUFFER) consume_stripes(fp);
+    return 1;
+}
+#endif
+
+static void normalize(fingerprint_t *fp, const char *content, size_t length, int simhash, uint8_t *copy) {
+    const uint8_t *s = (const uint8_t *)content;
+    size_t pos = 0;
+
+    fp->acc[0] = PRIME1 + PRIME2;
+    fp->acc[1] = PRIME2;
+    fp->acc[2] = 0;
+    fp->acc[3] = 0 - PRIME1;
+    fp->hashed = 0;
+    fp->len = 0;
+    fp->pending_space = 0;
+    fp->simhash = simhash;
+    fp->copy = copy;
+    if (simhash) {
+        fp->window = 0;
+        fp->shingles = 0;
+        memset(fp->planes, 0, sizeof(fp->planes));
+    }
+
+#if defined(__SSE2__)
+    while (pos + 16 < length) {
+        if (normalize_block16(fp, s + pos, 16)) {
+            pos += 16;
+        } else {
+            pos = normalize_chars(fp, s, length, pos, pos + 16);
+        }
+    }
+
+    /* The tail gets the same treatment from a padded copy */
+    if (pos < length) {
+        uint8_t tail[32] = { 0 };
+        memcpy(tail, s + pos, length - pos);
+        if (normalize_block16(fp, tail, length - pos)) pos = length;
+    }
+#endif
+    normalize_chars(fp, s, length, pos, length);
+}
+
+uint64_t content_fingerprint(const char *content, size_t length) {
+    fingerprint_t fp;
+    normalize(&fp, content, length, 0, NULL);
+    return finish(&fp);
+}
+
+void content_hashes(const char *content, size_t length, content_hashes_t *hashes) {
+    fingerprint_t fp;
+    normalize(&fp, content, length, 1, NULL);
+    hashes->fingerprint = finish(&fp);
+
+    /* finish() leaves the last partial stripe in buf */
+    add_shingles(&fp, fp.buf, fp.len);
+    hashes->simhash = finish_simhash(&fp);
+    hashes->length = (size_t)(fp.hashed + fp.len);
+}
+
+size_t content_normalize(const char *content, size_t length, char *out) {
+    fingerprint_t fp;
+    normalize(&fp, content, length, 0, (uint8_t *)out);
+    consume_stripes(&fp);
+    return (size_t)fp.hashed;
+}
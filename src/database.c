@@ -5,25 +5,655 @@
  */
 
 #include "database.h"
+#include "leveling.h"
+#include "dense_array.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+/* SQL for every cached statement, indexed by db_stmt_id_t */
+static const char *const g_stmt_sql[DB_STMT_COUNT] = {
+    [DB_STMT_GET_GUILD_SETTINGS] =
+        "SELECT g.prefix, g.spam_filter_enabled, g.leveling_enabled, g.xp_cooldown, "
+        "p.interval_seconds, p.max_messages, p.max_duplicates "
+        "FROM guild_settings g LEFT JOIN spam_policies p ON p.guild_id = g.guild_id WHERE g.guild_id = ?",
+    [DB_STMT_SET_GUILD_SETTINGS] =
+        "INSERT OR REPLACE INTO guild_settings (guild_id, prefix, spam_filter_enabled, leveling_enabled, xp_cooldown) "
+        "VALUES (?, ?, ?, ?, ?)",
+    [DB_STMT_SET_SPAM_POLICY] =
+        "INSERT OR REPLACE INTO spam_policies (guild_id, interval_seconds, max_messages, max_duplicates) "
+        "VALUES (?, ?, ?, ?)",
+    [DB_STMT_REMOVE_SPAM_POLICY] =
+        "DELETE FROM spam_policies WHERE guild_id = ?",
+    [DB_STMT_GET_USER_XP] =
+        "SELECT xp, level FROM user_xp WHERE user_id = ? AND guild_id = ?",
+    [DB_STMT_ADD_XP] =
+        "INSERT INTO user_xp (user_id, guild_id, xp, level) VALUES (?, ?, ?, 0) "
+        "ON CONFLICT(user_id, guild_id) DO UPDATE SET xp = xp + ?",
+    [DB_STMT_SET_LEVEL] =
+        "UPDATE user_xp SET level = ? WHERE user_id = ? AND guild_id = ?",
+    [DB_STMT_UPSERT_XP] =
+        "INSERT INTO user_xp (user_id, guild_id, xp, level) VALUES (?, ?, ?, 0) "
+        "ON CONFLICT(user_id, guild_id) DO UPDATE SET xp = xp + excluded.xp "
+        "RETURNING xp, level",
+    [DB_STMT_GET_LEADERBOARD] =
+        "SELECT user_id, xp, level FROM user_xp WHERE guild_id = ? ORDER BY xp DESC LIMIT ?",
+    [DB_STMT_GET_XP_DISTRIBUTION] =
+        "SELECT xp, COUNT(*) FROM user_xp WHERE guild_id = ? AND xp > 0 GROUP BY xp ORDER BY xp",
+    [DB_STMT_LOG_MOD_ACTION] =
+        "INSERT INTO mod_actions (guild_id, moderator_id, target_id, action_type, reason, timestamp) VALUES (?, ?, ?, ?, ?, ?)",
+    [DB_STMT_GET_MOD_ACTIONS] =
+        "SELECT id, moderator_id, target_id, action_type, reason, timestamp FROM mod_actions WHERE guild_id = ? ORDER BY timestamp DESC LIMIT ?",
+    [DB_STMT_GET_MOD_STATS] =
+        "SELECT action_type, COUNT(*) FROM mod_actions WHERE guild_id = ? AND moderator_id = ? GROUP BY action_type",
+    [DB_STMT_GET_AUTO_CLEAN_CONFIG] =
+        "SELECT interval_minutes, message_count, enabled FROM auto_clean_config WHERE guild_id = ? AND channel_id = ?",
+    [DB_STMT_SET_AUTO_CLEAN_CONFIG] =
+        "INSERT OR REPLACE INTO auto_clean_config (guild_id, channel_id, interval_minutes, message_count, enabled) VALUES (?, ?, ?, ?, ?)",
+    [DB_STMT_REMOVE_AUTO_CLEAN_CONFIG] =
+        "DELETE FROM auto_clean_config WHERE guild_id = ? AND channel_id = ?",
+    [DB_STMT_GET_ALL_AUTO_CLEAN_CONFIGS] =
+        "SELECT guild_id, channel_id, interval_minutes, message_count, enabled FROM auto_clean_config WHERE enabled = 1",
+    [DB_STMT_ADD_SPAM_WARNING] =
+        "INSERT INTO spam_warnings (user_id, guild_id, warnings, last_warning) VALUES (?, ?, 1, ?) "
+        "ON CONFLICT(user_id, guild_id) DO UPDATE SET warnings = warnings + 1, last_warning = ?",
+    [DB_STMT_GET_SPAM_WARNINGS] =
+        "SELECT warnings FROM spam_warnings WHERE user_id = ? AND guild_id = ?",
+    [DB_STMT_RESET_SPAM_WARNINGS] =
+        "DELETE FROM spam_warnings WHERE user_id = ? AND guild_id = ?",
+    [DB_STMT_GET_LEVEL_ROLES] =
+        "SELECT level, role_id FROM level_role_rewards WHERE guild_id = ? ORDER BY level",
+    [DB_STMT_SET_LEVEL_ROLE] =
+        "INSERT OR REPLACE INTO level_role_rewards (guild_id, level, role_id) VALUES (?, ?, ?)",
+    [DB_STMT_REMOVE_LEVEL_ROLE] =
+        "DELETE FROM level_role_rewards WHERE guild_id = ? AND level = ?",
+    [DB_STMT_GET_MEMBER_LEVELS] =
+        "SELECT user_id, level FROM user_xp WHERE guild_id = ? AND level >= ? ORDER BY user_id",
+    [DB_STMT_GET_VOICE_XP_CONFIG] =
+        "SELECT enabled, xp_per_minute, min_users, ignore_afk FROM voice_xp_config WHERE guild_id = ?",
+    [DB_STMT_SET_VOICE_XP_CONFIG] =
+        "INSERT OR REPLACE INTO voice_xp_config (guild_id, enabled, xp_per_minute, min_users, ignore_afk) VALUES (?, ?, ?, ?, ?)",
+    [DB_STMT_LOG_ACTIVITY] =
+        "INSERT INTO activity_log (guild_id, user_id, channel_id, event_type, old_content, new_content, timestamp) VALUES (?, ?, ?, ?, ?, ?, ?)",
+    [DB_STMT_GET_ACTIVITY_LOGS] =
+        "SELECT id, user_id, channel_id, event_type, old_content, new_content, timestamp FROM activity_log WHERE guild_id = ? ORDER BY timestamp DESC LIMIT ?",
+    [DB_STMT_SAVE_DM] =
+        "INSERT INTO dm_inbox (user_id, username, content, timestamp, read_status) VALUES (?, ?, ?, ?, ?)",
+    [DB_STMT_GET_DMS] =
+        "SELECT id, user_id, username, content, timestamp, read_status FROM dm_inbox ORDER BY timestamp DESC LIMIT ?",
+    [DB_STMT_MARK_DM_READ] =
+        "UPDATE dm_inbox SET read_status = 1 WHERE id = ?",
+    [DB_STMT_GET_UNREAD_DM_COUNT] =
+        "SELECT COUNT(*) FROM dm_inbox WHERE read_status = 0",
+    [DB_STMT_ADD_BOT_BAN] =
+        "INSERT OR REPLACE INTO bot_bans (user_id, banned_by, reason, timestamp) VALUES (?, ?, ?, ?)",
+    [DB_STMT_REMOVE_BOT_BAN] =
+        "DELETE FROM bot_bans WHERE user_id = ?",
+    [DB_STMT_GET_BOT_BANS] =
+        "SELECT user_id, banned_by, reason, timestamp FROM bot_bans ORDER BY timestamp DESC LIMIT ?",
+    [DB_STMT_MARK_XP_GENERATION] =
+        "INSERT OR IGNORE INTO xp_journal_commits (generation) VALUES (?)",
+    [DB_STMT_PRUNE_XP_GENERATIONS] =
+        "DELETE FROM xp_journal_commits WHERE generation < ?",
+    [DB_STMT_IS_XP_GENERATION_COMMITTED] =
+        "SELECT 1 FROM xp_journal_commits WHERE generation = ?",
+    [DB_STMT_GET_MAX_XP_GENERATION] =
+        "SELECT MAX(generation) FROM xp_journal_commits",
+    [DB_STMT_GET_BANNED_WORDS] =
+        "SELECT word FROM banned_words WHERE guild_id = ? ORDER BY word",
+    [DB_STMT_ADD_BANNED_WORD] =
+        "INSERT OR IGNORE INTO banned_words (guild_id, word) VALUES (?, ?)",
+    [DB_STMT_REMOVE_BANNED_WORD] =
+        "DELETE FROM banned_words WHERE guild_id = ? AND word = ?",
+    [DB_STMT_GET_BANNED_WORD_GUILDS] =
+        "SELECT DISTINCT guild_id FROM banned_words",
+};
+
+/* Queries served by the read pool - slow scans that must not hold up writes */
+static const unsigned char g_stmt_on_reader[DB_STMT_COUNT] = {
+    [DB_STMT_GET_LEADERBOARD] = 1,
+    [DB_STMT_GET_XP_DISTRIBUTION] = 1,
+    [DB_STMT_GET_MEMBER_LEVELS] = 1,
+    [DB_STMT_GET_MOD_ACTIONS] = 1,
+    [DB_STMT_GET_MOD_STATS] = 1,
+    [DB_STMT_GET_ALL_AUTO_CLEAN_CONFIGS] = 1,
+    [DB_STMT_GET_ACTIVITY_LOGS] = 1,
+    [DB_STMT_GET_DMS] = 1,
+    [DB_STMT_GET_UNREAD_DM_COUNT] = 1,
+    [DB_STMT_GET_BOT_BANS] = 1,
+    [DB_STMT_GET_BANNED_WORDS] = 1,
+    [DB_STMT_GET_BANNED_WORD_GUILDS] = 1,
+};
+
+#define DB_BUSY_TIMEOUT_MS 5000
+
+static int exec_sql(yuno_database_t *database, const char *sql);
+
+static int prepare_on(sqlite3 *db, db_stmt_id_t id, sqlite3_stmt **out) {
+    if (sqlite3_prepare_v3(db, g_stmt_sql[id], -1, SQLITE_PREPARE_PERSISTENT, out, NULL) != SQLITE_OK) {
+        fprintf(stderr, "SQL prepare error: %s\n", sqlite3_errmsg(db));
+        *out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int prepare_stmt(yuno_database_t *database, db_stmt_id_t id) {
+    if (prepare_on(database->db, id, &database->stmts[id]) != 0) {
+        return -1;
+    }
+    database->stmt_prepares++;
+    return 0;
+}
+
+/* Cached statement lookup - caller must already hold database->lock */
+static sqlite3_stmt *db_stmt_get_locked(yuno_database_t *database, db_stmt_id_t id) {
+    if (database->stmts[id]) {
+        database->stmt_reuses++;
+    } else if (prepare_stmt(database, id) != 0) {
+        return NULL;
+    }
+    return database->stmts[id];
+}
+
+/* Lock the connection and hand out the cached statement - NULL if it can't be prepared */
+static sqlite3_stmt *db_stmt_acquire(yuno_database_t *database, db_stmt_id_t id) {
+    pthread_mutex_lock(&database->lock);
+
+    sqlite3_stmt *stmt = db_stmt_get_locked(database, id);
+    if (!stmt) {
+        pthread_mutex_unlock(&database->lock);
+    }
+    return stmt;
+}
+
+/* Reset the statement for the next caller and unlock the connection */
+static void db_stmt_release(yuno_database_t *database, sqlite3_stmt *stmt) {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    pthread_mutex_unlock(&database->lock);
+}
+
+/* Check out a reader and its cached statement - falls back to the writer if there is no pool */
+static sqlite3_stmt *db_read_acquire(yuno_database_t *database, db_stmt_id_t id, db_reader_t **out_reader) {
+    *out_reader = NULL;
+    if (database->reader_count == 0) {
+        return db_stmt_acquire(database, id);
+    }
+
+    pthread_mutex_lock(&database->pool_lock);
+    db_reader_t *reader = NULL;
+    for (;;) {
+        for (int i = 0; i < database->reader_count; i++) {
+            if (!database->readers[i].in_use) {
+                reader = &database->readers[i];
+                break;
+            }
+        }
+        if (reader) break;
+        database->reader_waits++;
+        pthread_cond_wait(&database->pool_cond, &database->pool_lock);
+    }
+    reader->in_use = 1;
+    pthread_mutex_unlock(&database->pool_lock);
+
+    /* The reader is ours alone until checked back in */
+    if (reader->stmts[id]) {
+        reader->stmt_reuses++;
+    } else if (prepare_on(reader->db, id, &reader->stmts[id]) == 0) {
+        reader->stmt_prepares++;
+    } else {
+        pthread_mutex_lock(&database->pool_lock);
+        reader->in_use = 0;
+        pthread_cond_signal(&database->pool_cond);
+        pthread_mutex_unlock(&database->pool_lock);
+        return NULL;
+    }
+
+    *out_reader = reader;
+    return reader->stmts[id];
+}
+
+static void db_read_release(yuno_database_t *database, db_reader_t *reader, sqlite3_stmt *stmt) {
+    if (!reader) {
+        db_stmt_release(database, stmt);
+        return;
+    }
+
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    pthread_mutex_lock(&database->pool_lock);
+    reader->in_use = 0;
+    pthread_cond_signal(&database->pool_cond);
+    pthread_mutex_unlock(&database->pool_lock);
+}
+
+static void close_reader(db_reader_t *reader) {
+    for (int i = 0; i < DB_STMT_COUNT; i++) {
+        if (reader->stmts[i]) {
+            sqlite3_finalize(reader->stmts[i]);
+            reader->stmts[i] = NULL;
+        }
+    }
+    if (reader->db) {
+        sqlite3_close(reader->db);
+        reader->db = NULL;
+    }
+}
+
+static int open_reader(db_reader_t *reader, const char *path) {
+    if (sqlite3_open_v2(path, &reader->db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        fprintf(stderr, "💔 Failed to open read connection: %s\n", sqlite3_errmsg(reader->db));
+        close_reader(reader);
+        return -1;
+    }
+    sqlite3_busy_timeout(reader->db, DB_BUSY_TIMEOUT_MS);
+
+    for (int i = 0; i < DB_STMT_COUNT; i++) {
+        if (!g_stmt_on_reader[i]) continue;
+        if (prepare_on(reader->db, (db_stmt_id_t)i, &reader->stmts[i]) != 0) {
+            close_reader(reader);
+            return -1;
+        }
+        reader->stmt_prepares++;
+    }
+    return 0;
+}
+
+/* Guild settings cache - guilds are never dropped, so entries stay put once added */
+static int settings_cache_init(settings_cache_t *cache) {
+    cache->capacity = SETTINGS_CACHE_INITIAL_CAPACITY;
+    cache->count = 0;
+    cache->entries = malloc(cache->capacity * sizeof(settings_cache_entry_t));
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    pthread_rwlock_init(&cache->lock, NULL);
+    return cache->entries && u64map_init(&cache->index, SETTINGS_CACHE_INITIAL_CAPACITY) == 0 ? 0 : -1;
+}
+
+static void settings_cache_free(settings_cache_t *cache) {
+    u64map_free(&cache->index);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+    pthread_rwlock_destroy(&cache->lock);
+}
+
+/* Returns 1 on a hit (filling out/present), 0 on a miss */
+static int settings_cache_get(settings_cache_t *cache, uint64_t guild_id, guild_settings_t *out, int *present) {
+    int hit = 0;
+
+    pthread_rwlock_rdlock(&cache->lock);
+    const uint64_t *idx = u64map_find(&cache->index, guild_id, 0);
+    if (idx) {
+        *out = cache->entries[*idx].settings;
+        *present = cache->entries[*idx].present;
+        hit = 1;
+    }
+    pthread_rwlock_unlock(&cache->lock);
+
+    atomic_fetch_add_explicit(hit ? &cache->hits : &cache->misses, 1, memory_order_relaxed);
+    return hit;
+}
+
+/* Store a guild's row - NULL records that the guild has no settings */
+static void settings_cache_put(settings_cache_t *cache, uint64_t guild_id, const guild_settings_t *settings) {
+    settings_cache_entry_t entry;
+    memset(&entry, 0, sizeof(entry));
+    if (settings) {
+        entry.settings = *settings;
+        entry.present = 1;
+    }
+
+    pthread_rwlock_wrlock(&cache->lock);
+    int inserted;
+    uint64_t *idx = u64map_insert(&cache->index, guild_id, 0, &inserted);
+    if (idx && inserted) {
+        if (dense_array_reserve((void **)&cache->entries, &cache->capacity, cache->count,
+                                sizeof(settings_cache_entry_t)) != 0) {
+            u64map_remove(&cache->index, guild_id, 0);
+            idx = NULL;
+        } else {
+            *idx = (uint64_t)cache->count++;
+        }
+    }
+    if (idx) {
+        cache->entries[*idx] = entry;
+    }
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+/* Spam policy table - allocated whole up front so entries never move */
+static inline uint64_t spam_policy_key(int interval, int max_messages, int max_duplicates) {
+    return ((uint64_t)interval << 16) | ((uint64_t)max_messages << 8) | (uint64_t)max_duplicates;
+}
+
+static int spam_policy_valid(int interval, int max_messages, int max_duplicates) {
+    return interval >= 1 && interval <= MAX_SPAM_INTERVAL &&
+           max_messages >= MIN_SPAM_LIMIT && max_messages <= MAX_SPAM_LIMIT &&
+           max_duplicates >= MIN_SPAM_LIMIT && max_duplicates <= MAX_SPAM_LIMIT;
+}
+
+/* Index of the compiled policy, compiling it on first use - 0 (the
+ * defaults) if the limits are out of range */
+static uint32_t spam_policy_intern(spam_policy_table_t *table, int interval, int max_messages, int max_duplicates) {
+    if (!spam_policy_valid(interval, max_messages, max_duplicates)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&table->lock);
+    int inserted;
+    uint64_t *slot = u64map_insert(&table->index, spam_policy_key(interval, max_messages, max_duplicates), 0,
+                                   &inserted);
+    uint32_t index = 0;
+    if (slot && !inserted) {
+        index = (uint32_t)*slot;
+    } else if (slot) {
+        /* Valid limits can't outnumber SPAM_POLICY_TABLE_SIZE, so there is always room */
+        spam_policy_t *policy = &table->policies[table->count];
+        policy->interval = (uint8_t)interval;
+        policy->max_messages = (uint8_t)max_messages;
+        policy->max_duplicates = (uint8_t)max_duplicates;
+        policy->lockdown_messages = (uint8_t)SPAM_LOCKDOWN_LIMIT(max_messages);
+        policy->lockdown_duplicates = (uint8_t)SPAM_LOCKDOWN_LIMIT(max_duplicates);
+        index = table->count++;
+        *slot = index;
+    }
+    pthread_mutex_unlock(&table->lock);
+    return index;
+}
+
+static int spam_policy_table_init(spam_policy_table_t *table) {
+    table->policies = calloc(SPAM_POLICY_TABLE_SIZE, sizeof(spam_policy_t));
+    table->count = 0;
+    pthread_mutex_init(&table->lock, NULL);
+    if (!table->policies || u64map_init(&table->index, 64) != 0) {
+        return -1;
+    }
+    /* The defaults take index 0 */
+    return spam_policy_intern(table, DEFAULT_SPAM_INTERVAL, DEFAULT_SPAM_MAX_MESSAGES,
+                              DEFAULT_SPAM_MAX_DUPLICATES) == 0 && table->count == 1 ? 0 : -1;
+}
+
+static void spam_policy_table_free(spam_policy_table_t *table) {
+    free(table->policies);
+    table->policies = NULL;
+    table->count = 0;
+    u64map_free(&table->index);
+    pthread_mutex_destroy(&table->lock);
+}
+
+/* Bot-ban index - splitmix64 finalizer feeds the Bloom probes */
+static inline uint64_t mix_id(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static inline void bloom_add(ban_filter_t *filter, uint64_t h) {
+    uint64_t step = (h >> 32) | 1;
+    for (int i = 0; i < BAN_FILTER_HASHES; i++, h += step) {
+        size_t bit = (size_t)h & (filter->bloom_bits - 1);
+        filter->bloom[bit >> 6] |= 1ULL << (bit & 63);
+    }
+}
+
+static inline int bloom_maybe(const ban_filter_t *filter, uint64_t h) {
+    uint64_t step = (h >> 32) | 1;
+    for (int i = 0; i < BAN_FILTER_HASHES; i++, h += step) {
+        size_t bit = (size_t)h & (filter->bloom_bits - 1);
+        if (!(filter->bloom[bit >> 6] & (1ULL << (bit & 63)))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Size the Bloom filter for expected bans and refill it from the set */
+static int ban_filter_rebuild(ban_filter_t *filter, size_t expected) {
+    size_t bits = BAN_FILTER_MIN_BITS;
+    while (bits < expected * BAN_FILTER_BITS_PER_BAN) bits <<= 1;
+
+    uint64_t *bloom = calloc(bits / 64, sizeof(uint64_t));
+    if (!bloom) {
+        return -1;
+    }
+
+    free(filter->bloom);
+    filter->bloom = bloom;
+    filter->bloom_bits = bits;
+    filter->stale = 0;
+
+    const u64map_slot_t *slot;
+    for (size_t i = 0; (slot = u64map_next(&filter->ids, &i)) != NULL;) {
+        bloom_add(filter, mix_id(slot->a));
+    }
+    return 0;
+}
+
+static int ban_filter_init(ban_filter_t *filter) {
+    memset(filter, 0, sizeof(ban_filter_t));
+    pthread_rwlock_init(&filter->lock, NULL);
+    if (u64map_init(&filter->ids, BAN_SET_INITIAL_CAPACITY) != 0) {
+        return -1;
+    }
+    return ban_filter_rebuild(filter, 0);
+}
+
+static void ban_filter_free(ban_filter_t *filter) {
+    free(filter->bloom);
+    u64map_free(&filter->ids);
+    filter->bloom = NULL;
+    pthread_rwlock_destroy(&filter->lock);
+}
+
+static void ban_filter_add(ban_filter_t *filter, uint64_t user_id) {
+    pthread_rwlock_wrlock(&filter->lock);
+    size_t count = u64map_count(&filter->ids) + 1;
+    if (count * BAN_FILTER_BITS_PER_BAN > filter->bloom_bits) {
+        ban_filter_rebuild(filter, count);
+    }
+    if (u64map_insert(&filter->ids, user_id, 0, NULL)) {
+        bloom_add(filter, mix_id(user_id));
+    }
+    pthread_rwlock_unlock(&filter->lock);
+}
+
+static void ban_filter_remove(ban_filter_t *filter, uint64_t user_id) {
+    pthread_rwlock_wrlock(&filter->lock);
+    if (u64map_remove(&filter->ids, user_id, 0)) {
+        /* Bloom bits can't be cleared - rebuild once removals pile up */
+        size_t count = u64map_count(&filter->ids);
+        if (++filter->stale > count / 2 + 64) {
+            ban_filter_rebuild(filter, count);
+        }
+    }
+    pthread_rwlock_unlock(&filter->lock);
+}
+
+static int ban_filter_load(yuno_database_t *database) {
+    sqlite3_stmt *stmt;
+    ban_filter_t *filter = &database->ban_filter;
+
+    /* Size the set and the filter once instead of growing both ban by ban */
+    if (sqlite3_prepare_v2(database->db, "SELECT COUNT(*) FROM bot_bans", -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    size_t count = sqlite3_step(stmt) == SQLITE_ROW ? (size_t)sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    if (u64map_reserve(&filter->ids, count) != 0 || ban_filter_rebuild(filter, count) != 0) {
+        return -1;
+    }
+
+    if (sqlite3_prepare_v2(database->db, "SELECT user_id FROM bot_bans", -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        ban_filter_add(filter, (uint64_t)sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return 0;
+}
+
 int db_open(yuno_database_t *database, const char *path) {
+    memset(database, 0, sizeof(yuno_database_t));
+    /* Recursive so a transaction can hold it from BEGIN to COMMIT while its
+     * statements take it again */
+    pthread_mutexattr_t lock_attr;
+    pthread_mutexattr_init(&lock_attr);
+    pthread_mutexattr_settype(&lock_attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&database->lock, &lock_attr);
+    pthread_mutexattr_destroy(&lock_attr);
+    pthread_mutex_init(&database->pool_lock, NULL);
+    pthread_cond_init(&database->pool_cond, NULL);
+    if (settings_cache_init(&database->settings_cache) != 0 ||
+        spam_policy_table_init(&database->spam_policies) != 0 ||
+        ban_filter_init(&database->ban_filter) != 0) {
+        return -1;
+    }
+
     int result = sqlite3_open(path, &database->db);
     if (result != SQLITE_OK) {
         fprintf(stderr, "💔 Failed to open database: %s\n", sqlite3_errmsg(database->db));
         return -1;
     }
-    return db_initialize(database);
+    sqlite3_busy_timeout(database->db, DB_BUSY_TIMEOUT_MS);
+
+    /* WAL lets the read pool run alongside the writer */
+    if (exec_sql(database, "PRAGMA journal_mode = WAL") != 0 ||
+        exec_sql(database, "PRAGMA synchronous = NORMAL") != 0) {
+        return -1;
+    }
+    if (db_initialize(database) != 0) {
+        return -1;
+    }
+
+    /* Compile every statement once up front */
+    for (int i = 0; i < DB_STMT_COUNT; i++) {
+        if (prepare_stmt(database, (db_stmt_id_t)i) != 0) {
+            return -1;
+        }
+    }
+
+    /* Mirror bot_bans in memory for the per-message ban check */
+    if (ban_filter_load(database) != 0) {
+        return -1;
+    }
+
+    /* A missing reader only costs concurrency - queries fall back to the writer */
+    for (int i = 0; i < DB_READ_POOL_SIZE; i++) {
+        if (open_reader(&database->readers[database->reader_count], path) == 0) {
+            database->reader_count++;
+        }
+    }
+    return 0;
 }
 
 void db_close(yuno_database_t *database) {
+    for (int i = 0; i < database->reader_count; i++) {
+        close_reader(&database->readers[i]);
+    }
+    database->reader_count = 0;
+
+    for (int i = 0; i < DB_STMT_COUNT; i++) {
+        if (database->stmts[i]) {
+            sqlite3_finalize(database->stmts[i]);
+            database->stmts[i] = NULL;
+        }
+    }
     if (database->db) {
         sqlite3_close(database->db);
         database->db = NULL;
     }
+    settings_cache_free(&database->settings_cache);
+    spam_policy_table_free(&database->spam_policies);
+    ban_filter_free(&database->ban_filter);
+    pthread_cond_destroy(&database->pool_cond);
+    pthread_mutex_destroy(&database->pool_lock);
+    pthread_mutex_destroy(&database->lock);
+}
+
+void db_get_settings_cache_stats(yuno_database_t *database, uint64_t *hits, uint64_t *misses, size_t *count) {
+    settings_cache_t *cache = &database->settings_cache;
+    *hits = atomic_load(&cache->hits);
+    *misses = atomic_load(&cache->misses);
+    pthread_rwlock_rdlock(&cache->lock);
+    *count = cache->count;
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+size_t db_get_spam_policy_count(yuno_database_t *database) {
+    spam_policy_table_t *table = &database->spam_policies;
+    pthread_mutex_lock(&table->lock);
+    size_t count = table->count;
+    pthread_mutex_unlock(&table->lock);
+    return count;
+}
+
+void db_get_ban_filter_stats(yuno_database_t *database, uint64_t *filtered, uint64_t *probed,
+                             uint64_t *false_positives, size_t *count) {
+    ban_filter_t *filter = &database->ban_filter;
+    *filtered = atomic_load(&filter->filtered);
+    *probed = atomic_load(&filter->probed);
+    *false_positives = atomic_load(&filter->false_positives);
+    pthread_rwlock_rdlock(&filter->lock);
+    *count = u64map_count(&filter->ids);
+    pthread_rwlock_unlock(&filter->lock);
+}
+
+/* The connection stays locked from BEGIN until COMMIT succeeds or ROLLBACK
+ * runs, so no other thread's write can land in the transaction */
+int db_begin(yuno_database_t *database) {
+    pthread_mutex_lock(&database->lock);
+    if (exec_sql(database, "BEGIN") != 0) {
+        pthread_mutex_unlock(&database->lock);
+        return -1;
+    }
+    return 0;
+}
+
+int db_commit(yuno_database_t *database) {
+    if (exec_sql(database, "COMMIT") != 0) {
+        return -1; /* Still locked - the caller rolls back */
+    }
+    pthread_mutex_unlock(&database->lock);
+    return 0;
+}
+
+int db_rollback(yuno_database_t *database) {
+    int rc = exec_sql(database, "ROLLBACK");
+    pthread_mutex_unlock(&database->lock);
+    return rc;
+}
+
+void db_get_stmt_stats(yuno_database_t *database, uint64_t *prepares, uint64_t *reuses) {
+    pthread_mutex_lock(&database->lock);
+    *prepares = database->stmt_prepares;
+    *reuses = database->stmt_reuses;
+    pthread_mutex_unlock(&database->lock);
+
+    /* Reader counters are only touched by their owner - close enough for stats */
+    for (int i = 0; i < database->reader_count; i++) {
+        *prepares += database->readers[i].stmt_prepares;
+        *reuses += database->readers[i].stmt_reuses;
+    }
+}
+
+void db_get_pool_stats(yuno_database_t *database, int *readers, int *busy, uint64_t *waits) {
+    pthread_mutex_lock(&database->pool_lock);
+    *readers = database->reader_count;
+    *busy = 0;
+    for (int i = 0; i < database->reader_count; i++) {
+        *busy += database->readers[i].in_use;
+    }
+    *waits = database->reader_waits;
+    pthread_mutex_unlock(&database->pool_lock);
 }
 
 static int exec_sql(yuno_database_t *database, const char *sql) {
@@ -37,68 +667,69 @@ static int exec_sql(yuno_database_t *database, const char *sql) {
     return 0;
 }
 
-int db_initialize(yuno_database_t *database) {
+/* Bump when the schema changes and append the matching step to g_migrations */
+#define DB_SCHEMA_VERSION 7
+
+static int create_tables(yuno_database_t *database) {
+    int rc = 0;
+
     /* Guild settings table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS guild_settings ("
-        "guild_id TEXT PRIMARY KEY,"
+        "guild_id INTEGER PRIMARY KEY,"
         "prefix TEXT DEFAULT '.',"
         "spam_filter_enabled INTEGER DEFAULT 0,"
-        "leveling_enabled INTEGER DEFAULT 1"
+        "leveling_enabled INTEGER DEFAULT 1,"
+        "xp_cooldown INTEGER DEFAULT 60"
         ")");
 
     /* User XP table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS user_xp ("
-        "user_id TEXT NOT NULL,"
-        "guild_id TEXT NOT NULL,"
+        "user_id INTEGER NOT NULL,"
+        "guild_id INTEGER NOT NULL,"
         "xp INTEGER DEFAULT 0,"
         "level INTEGER DEFAULT 0,"
         "PRIMARY KEY (user_id, guild_id)"
-        ")");
+        ") WITHOUT ROWID");
 
     /* Mod actions table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS mod_actions ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "guild_id TEXT NOT NULL,"
-        "moderator_id TEXT NOT NULL,"
-        "target_id TEXT NOT NULL,"
+        "guild_id INTEGER NOT NULL,"
+        "moderator_id INTEGER NOT NULL,"
+        "target_id INTEGER NOT NULL,"
         "action_type TEXT NOT NULL,"
         "reason TEXT,"
         "timestamp INTEGER NOT NULL"
         ")");
 
     /* Auto-clean config table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS auto_clean_config ("
-        "guild_id TEXT NOT NULL,"
-        "channel_id TEXT NOT NULL,"
+        "guild_id INTEGER NOT NULL,"
+        "channel_id INTEGER NOT NULL,"
         "interval_minutes INTEGER DEFAULT 60,"
         "message_count INTEGER DEFAULT 100,"
         "enabled INTEGER DEFAULT 1,"
         "PRIMARY KEY (guild_id, channel_id)"
-        ")");
+        ") WITHOUT ROWID");
 
     /* Spam warnings table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS spam_warnings ("
-        "user_id TEXT NOT NULL,"
-        "guild_id TEXT NOT NULL,"
+        "user_id INTEGER NOT NULL,"
+        "guild_id INTEGER NOT NULL,"
         "warnings INTEGER DEFAULT 0,"
         "last_warning INTEGER,"
         "PRIMARY KEY (user_id, guild_id)"
-        ")");
-
-    /* Create indexes */
-    exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_mod_actions_guild ON mod_actions(guild_id)");
-    exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_mod_actions_moderator ON mod_actions(moderator_id)");
-    exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_user_xp_guild ON user_xp(guild_id)");
+        ") WITHOUT ROWID");
 
     /* Voice XP config table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS voice_xp_config ("
-        "guild_id TEXT PRIMARY KEY,"
+        "guild_id INTEGER PRIMARY KEY,"
         "enabled INTEGER DEFAULT 0,"
         "xp_per_minute INTEGER DEFAULT 5,"
         "min_users INTEGER DEFAULT 2,"
@@ -106,91 +737,443 @@ int db_initialize(yuno_database_t *database) {
         ")");
 
     /* Activity log table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS activity_log ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "guild_id TEXT NOT NULL,"
-        "user_id TEXT NOT NULL,"
-        "channel_id TEXT,"
+        "guild_id INTEGER NOT NULL,"
+        "user_id INTEGER NOT NULL,"
+        "channel_id INTEGER,"
         "event_type TEXT NOT NULL,"
         "old_content TEXT,"
         "new_content TEXT,"
         "timestamp INTEGER NOT NULL"
         ")");
-    exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_activity_guild ON activity_log(guild_id)");
-    exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_activity_timestamp ON activity_log(timestamp)");
 
     /* DM inbox table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS dm_inbox ("
         "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "user_id TEXT NOT NULL,"
+        "user_id INTEGER NOT NULL,"
         "username TEXT,"
         "content TEXT,"
         "timestamp INTEGER NOT NULL,"
         "read_status INTEGER DEFAULT 0"
         ")");
-    exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_dm_timestamp ON dm_inbox(timestamp)");
 
     /* Bot-level bans table */
-    exec_sql(database,
+    rc |= exec_sql(database,
         "CREATE TABLE IF NOT EXISTS bot_bans ("
-        "user_id TEXT PRIMARY KEY,"
-        "banned_by TEXT,"
+        "user_id INTEGER PRIMARY KEY,"
+        "banned_by INTEGER,"
         "reason TEXT,"
         "timestamp INTEGER NOT NULL"
         ")");
 
-    return 0;
+    /* XP journal generations already applied - makes journal replay exactly-once */
+    rc |= exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS xp_journal_commits ("
+        "generation INTEGER PRIMARY KEY"
+        ")");
+
+    /* Level role rewards table */
+    rc |= exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS level_role_rewards ("
+        "guild_id INTEGER NOT NULL,"
+        "level INTEGER NOT NULL,"
+        "role_id INTEGER NOT NULL,"
+        "PRIMARY KEY (guild_id, level)"
+        ") WITHOUT ROWID");
+
+    /* Per-guild spam policy table - guilds without a row use the defaults */
+    rc |= exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS spam_policies ("
+        "guild_id INTEGER PRIMARY KEY,"
+        "interval_seconds INTEGER NOT NULL,"
+        "max_messages INTEGER NOT NULL,"
+        "max_duplicates INTEGER NOT NULL"
+        ")");
+
+    /* Banned words table */
+    rc |= exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS banned_words ("
+        "guild_id INTEGER NOT NULL,"
+        "word TEXT NOT NULL,"
+        "PRIMARY KEY (guild_id, word)"
+        ") WITHOUT ROWID");
+
+    return rc;
+}
+
+static int create_indexes(yuno_database_t *database) {
+    int rc = 0;
+    rc |= exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_mod_actions_guild ON mod_actions(guild_id)");
+    rc |= exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_mod_actions_moderator ON mod_actions(moderator_id)");
+    rc |= exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_user_xp_guild_xp ON user_xp(guild_id, xp DESC, level)");
+    rc |= exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_activity_guild ON activity_log(guild_id)");
+    rc |= exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_activity_timestamp ON activity_log(timestamp)");
+    rc |= exec_sql(database, "CREATE INDEX IF NOT EXISTS idx_dm_timestamp ON dm_inbox(timestamp)");
+    return rc;
+}
+
+static int get_user_version(yuno_database_t *database) {
+    sqlite3_stmt *stmt;
+    int version = 0;
+
+    if (sqlite3_prepare_v2(database->db, "PRAGMA user_version", -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return version;
+}
+
+static int table_exists(yuno_database_t *database, const char *name) {
+    sqlite3_stmt *stmt;
+    int exists = 0;
+
+    if (sqlite3_prepare_v2(database->db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        return 0;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        exists = 1;
+    }
+    sqlite3_finalize(stmt);
+    return exists;
+}
+
+/* v0 stored every snowflake as TEXT - copy each table into its INTEGER twin.
+ * The twins are the schema as it was at v1, not create_tables(): later
+ * columns and tables come from their own migrations, which would otherwise
+ * find them already there. */
+static const struct {
+    const char *table;
+    const char *create_sql;
+    const char *copy_sql;
+} g_v1_tables[] = {
+    { "guild_settings",
+      "CREATE TABLE guild_settings (guild_id INTEGER PRIMARY KEY, prefix TEXT DEFAULT '.', "
+      "spam_filter_enabled INTEGER DEFAULT 0, leveling_enabled INTEGER DEFAULT 1)",
+      "INSERT INTO guild_settings (guild_id, prefix, spam_filter_enabled, leveling_enabled) "
+      "SELECT CAST(guild_id AS INTEGER), prefix, spam_filter_enabled, leveling_enabled FROM guild_settings_v0" },
+    { "user_xp",
+      "CREATE TABLE user_xp (user_id INTEGER NOT NULL, guild_id INTEGER NOT NULL, xp INTEGER DEFAULT 0, "
+      "level INTEGER DEFAULT 0, PRIMARY KEY (user_id, guild_id)) WITHOUT ROWID",
+      "INSERT INTO user_xp SELECT CAST(user_id AS INTEGER), CAST(guild_id AS INTEGER), xp, level "
+      "FROM user_xp_v0" },
+    { "mod_actions",
+      "CREATE TABLE mod_actions (id INTEGER PRIMARY KEY AUTOINCREMENT, guild_id INTEGER NOT NULL, "
+      "moderator_id INTEGER NOT NULL, target_id INTEGER NOT NULL, action_type TEXT NOT NULL, reason TEXT, "
+      "timestamp INTEGER NOT NULL)",
+      "INSERT INTO mod_actions SELECT id, CAST(guild_id AS INTEGER), CAST(moderator_id AS INTEGER), "
+      "CAST(target_id AS INTEGER), action_type, reason, timestamp FROM mod_actions_v0" },
+    { "auto_clean_config",
+      "CREATE TABLE auto_clean_config (guild_id INTEGER NOT NULL, channel_id INTEGER NOT NULL, "
+      "interval_minutes INTEGER DEFAULT 60, message_count INTEGER DEFAULT 100, enabled INTEGER DEFAULT 1, "
+      "PRIMARY KEY (guild_id, channel_id)) WITHOUT ROWID",
+      "INSERT INTO auto_clean_config SELECT CAST(guild_id AS INTEGER), CAST(channel_id AS INTEGER), "
+      "interval_minutes, message_count, enabled FROM auto_clean_config_v0" },
+    { "spam_warnings",
+      "CREATE TABLE spam_warnings (user_id INTEGER NOT NULL, guild_id INTEGER NOT NULL, "
+      "warnings INTEGER DEFAULT 0, last_warning INTEGER, PRIMARY KEY (user_id, guild_id)) WITHOUT ROWID",
+      "INSERT INTO spam_warnings SELECT CAST(user_id AS INTEGER), CAST(guild_id AS INTEGER), warnings, "
+      "last_warning FROM spam_warnings_v0" },
+    { "voice_xp_config",
+      "CREATE TABLE voice_xp_config (guild_id INTEGER PRIMARY KEY, enabled INTEGER DEFAULT 0, "
+      "xp_per_minute INTEGER DEFAULT 5, min_users INTEGER DEFAULT 2, ignore_afk INTEGER DEFAULT 1)",
+      "INSERT INTO voice_xp_config SELECT CAST(guild_id AS INTEGER), enabled, xp_per_minute, min_users, "
+      "ignore_afk FROM voice_xp_config_v0" },
+    { "activity_log",
+      "CREATE TABLE activity_log (id INTEGER PRIMARY KEY AUTOINCREMENT, guild_id INTEGER NOT NULL, "
+      "user_id INTEGER NOT NULL, channel_id INTEGER, event_type TEXT NOT NULL, old_content TEXT, "
+      "new_content TEXT, timestamp INTEGER NOT NULL)",
+      "INSERT INTO activity_log SELECT id, CAST(guild_id AS INTEGER), CAST(user_id AS INTEGER), "
+      "CAST(channel_id AS INTEGER), event_type, old_content, new_content, timestamp FROM activity_log_v0" },
+    { "dm_inbox",
+      "CREATE TABLE dm_inbox (id INTEGER PRIMARY KEY AUTOINCREMENT, user_id INTEGER NOT NULL, username TEXT, "
+      "content TEXT, timestamp INTEGER NOT NULL, read_status INTEGER DEFAULT 0)",
+      "INSERT INTO dm_inbox SELECT id, CAST(user_id AS INTEGER), username, content, timestamp, read_status "
+      "FROM dm_inbox_v0" },
+    { "bot_bans",
+      "CREATE TABLE bot_bans (user_id INTEGER PRIMARY KEY, banned_by INTEGER, reason TEXT, "
+      "timestamp INTEGER NOT NULL)",
+      "INSERT INTO bot_bans SELECT CAST(user_id AS INTEGER), CAST(banned_by AS INTEGER), reason, timestamp "
+      "FROM bot_bans_v0" },
+};
+
+#define NUM_V1_TABLES (sizeof(g_v1_tables) / sizeof(g_v1_tables[0]))
+
+static int migrate_to_v1(yuno_database_t *database) {
+    char sql[256];
+    int present[NUM_V1_TABLES];
+    int rc = 0;
+
+    /* Move the TEXT tables (and their indexes) out of the way */
+    for (size_t i = 0; i < NUM_V1_TABLES && rc == 0; i++) {
+        present[i] = table_exists(database, g_v1_tables[i].table);
+        if (present[i]) {
+            snprintf(sql, sizeof(sql), "ALTER TABLE %s RENAME TO %s_v0",
+                g_v1_tables[i].table, g_v1_tables[i].table);
+            rc = exec_sql(database, sql);
+        }
+    }
+    if (rc != 0) return rc;
+
+    for (size_t i = 0; i < NUM_V1_TABLES && rc == 0; i++) {
+        rc = exec_sql(database, g_v1_tables[i].create_sql);
+    }
+
+    for (size_t i = 0; i < NUM_V1_TABLES && rc == 0; i++) {
+        if (!present[i]) continue;
+        rc = exec_sql(database, g_v1_tables[i].copy_sql);
+        if (rc == 0) {
+            snprintf(sql, sizeof(sql), "DROP TABLE %s_v0", g_v1_tables[i].table);
+            rc = exec_sql(database, sql);
+        }
+    }
+    if (rc != 0) return rc;
+
+    return create_indexes(database);
+}
+
+/* v2: remember which XP journal generations have been committed */
+static int migrate_to_v2(yuno_database_t *database) {
+    return exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS xp_journal_commits ("
+        "generation INTEGER PRIMARY KEY"
+        ")");
+}
+
+/* v3: leaderboard reads come straight off a covering (guild_id, xp DESC) index */
+static int migrate_to_v3(yuno_database_t *database) {
+    int rc = exec_sql(database, "DROP INDEX IF EXISTS idx_user_xp_guild");
+    if (rc == 0) {
+        rc = exec_sql(database,
+            "CREATE INDEX IF NOT EXISTS idx_user_xp_guild_xp ON user_xp(guild_id, xp DESC, level)");
+    }
+    return rc;
+}
+
+/* v4: per-guild XP cooldown */
+static int migrate_to_v4(yuno_database_t *database) {
+    return exec_sql(database, "ALTER TABLE guild_settings ADD COLUMN xp_cooldown INTEGER DEFAULT 60");
+}
+
+/* v5: roles handed out on reaching a level */
+static int migrate_to_v5(yuno_database_t *database) {
+    return exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS level_role_rewards ("
+        "guild_id INTEGER NOT NULL,"
+        "level INTEGER NOT NULL,"
+        "role_id INTEGER NOT NULL,"
+        "PRIMARY KEY (guild_id, level)"
+        ") WITHOUT ROWID");
+}
+
+/* v6: per-guild spam policies */
+static int migrate_to_v6(yuno_database_t *database) {
+    return exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS spam_policies ("
+        "guild_id INTEGER PRIMARY KEY,"
+        "interval_seconds INTEGER NOT NULL,"
+        "max_messages INTEGER NOT NULL,"
+        "max_duplicates INTEGER NOT NULL"
+        ")");
+}
+
+/* v7: per-guild banned words */
+static int migrate_to_v7(yuno_database_t *database) {
+    return exec_sql(database,
+        "CREATE TABLE IF NOT EXISTS banned_words ("
+        "guild_id INTEGER NOT NULL,"
+        "word TEXT NOT NULL,"
+        "PRIMARY KEY (guild_id, word)"
+        ") WITHOUT ROWID");
+}
+
+/* g_migrations[n] upgrades a schema at user_version n to n + 1 */
+typedef int (*db_migration_fn)(yuno_database_t *database);
+
+static const db_migration_fn g_migrations[DB_SCHEMA_VERSION] = {
+    migrate_to_v1,
+    migrate_to_v2,
+    migrate_to_v3,
+    migrate_to_v4,
+    migrate_to_v5,
+    migrate_to_v6,
+    migrate_to_v7,
+};
+
+/* Compare one query's rows on both connections - 1 if they're the same */
+static int same_rows(sqlite3 *a, sqlite3 *b, const char *sql, const char *name) {
+    sqlite3_stmt *sa = NULL, *sb = NULL;
+    int same = 0;
+
+    if (sqlite3_prepare_v2(a, sql, -1, &sa, NULL) == SQLITE_OK &&
+        sqlite3_prepare_v2(b, sql, -1, &sb, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(sa, 1, name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(sb, 1, name, -1, SQLITE_STATIC);
+        for (;;) {
+            int ra = sqlite3_step(sa), rb = sqlite3_step(sb);
+            if (ra != rb) break;
+            if (ra != SQLITE_ROW) {
+                same = ra == SQLITE_DONE;
+                break;
+            }
+            int columns = sqlite3_column_count(sa), c;
+            for (c = 0; c < columns; c++) {
+                const unsigned char *va = sqlite3_column_text(sa, c);
+                const unsigned char *vb = sqlite3_column_text(sb, c);
+                if ((va == NULL) != (vb == NULL) || (va && strcmp((const char *)va, (const char *)vb) != 0)) break;
+            }
+            if (c < columns) break;
+        }
+    }
+    sqlite3_finalize(sa);
+    sqlite3_finalize(sb);
+    return same;
+}
+
+/* After an upgrade, the tables and indexes must match what a fresh
+ * database gets - catches a migration that drifted from create_tables() */
+static int check_upgraded_schema(yuno_database_t *database) {
+    yuno_database_t fresh;
+    sqlite3_stmt *stmt;
+    int rc = 0;
+
+    memset(&fresh, 0, sizeof(fresh));
+    if (sqlite3_open(":memory:", &fresh.db) != SQLITE_OK ||
+        create_tables(&fresh) != 0 || create_indexes(&fresh) != 0) {
+        sqlite3_close(fresh.db);
+        return -1;
+    }
+
+    if (!same_rows(database->db, fresh.db,
+                   "SELECT type, name, tbl_name FROM sqlite_master "
+                   "WHERE name NOT LIKE 'sqlite_%' AND ?1 IS NOT NULL ORDER BY name", "")) {
+        fprintf(stderr, "💔 Upgraded database has different tables or indexes than a new one\n");
+        rc = -1;
+    }
+
+    if (rc == 0 && sqlite3_prepare_v2(fresh.db,
+            "SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%'",
+            -1, &stmt, NULL) == SQLITE_OK) {
+        while (rc == 0 && sqlite3_step(stmt) == SQLITE_ROW) {
+            const char *table = (const char *)sqlite3_column_text(stmt, 0);
+            if (!same_rows(database->db, fresh.db,
+                           "SELECT name, type, \"notnull\", dflt_value, pk FROM pragma_table_info(?1)", table)) {
+                fprintf(stderr, "💔 Upgraded table %s doesn't match a new database\n", table);
+                rc = -1;
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    sqlite3_close(fresh.db);
+    return rc;
+}
+
+int db_initialize(yuno_database_t *database) {
+    char sql[64];
+    int rc = 0;
+
+    if (exec_sql(database, "BEGIN IMMEDIATE") != 0) {
+        return -1;
+    }
+
+    int version = get_user_version(database);
+    if (version < 0 || version > DB_SCHEMA_VERSION) {
+        fprintf(stderr, "💔 Unsupported database schema version %d\n", version);
+        rc = -1;
+    } else if (version == 0 && !table_exists(database, "guild_settings")) {
+        /* Fresh database - create the current schema directly */
+        rc = create_tables(database);
+        if (rc == 0) rc = create_indexes(database);
+    } else {
+        for (int v = version; v < DB_SCHEMA_VERSION && rc == 0; v++) {
+            printf("💾 Migrating database schema v%d -> v%d~\n", v, v + 1);
+            rc = g_migrations[v](database);
+        }
+        if (rc == 0 && version < DB_SCHEMA_VERSION) rc = check_upgraded_schema(database);
+    }
+
+    if (rc == 0) {
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d", DB_SCHEMA_VERSION);
+        rc = exec_sql(database, sql);
+    }
+
+    if (rc != 0) {
+        exec_sql(database, "ROLLBACK");
+        fprintf(stderr, "💔 Failed to initialize database schema\n");
+        return -1;
+    }
+    return exec_sql(database, "COMMIT");
 }
 
 int db_get_guild_settings(yuno_database_t *database, uint64_t guild_id, guild_settings_t *settings) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
-    int result;
+    int present;
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
+    /* Hot path - every message lands here, so serve it from memory */
+    if (settings_cache_get(&database->settings_cache, guild_id, settings, &present)) {
+        return present ? 0 : -1;
+    }
 
-    const char *sql = "SELECT prefix, spam_filter_enabled, leveling_enabled FROM guild_settings WHERE guild_id = ?";
-    result = sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL);
-    if (result != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_GET_GUILD_SETTINGS);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
+        memset(settings, 0, sizeof(guild_settings_t));
         settings->guild_id = guild_id;
         strncpy(settings->prefix, (const char *)sqlite3_column_text(stmt, 0), MAX_PREFIX_LEN - 1);
         settings->spam_filter_enabled = sqlite3_column_int(stmt, 1);
         settings->leveling_enabled = sqlite3_column_int(stmt, 2);
-        sqlite3_finalize(stmt);
-        return 0;
+        settings->xp_cooldown = sqlite3_column_int(stmt, 3);
+        /* Compile the guild's spam policy into the table - no row means the defaults */
+        if (sqlite3_column_type(stmt, 4) != SQLITE_NULL) {
+            settings->spam_policy = spam_policy_intern(&database->spam_policies,
+                sqlite3_column_int(stmt, 4), sqlite3_column_int(stmt, 5), sqlite3_column_int(stmt, 6));
+        }
+        present = 1;
+    } else {
+        present = 0;
     }
 
-    sqlite3_finalize(stmt);
-    return -1;
+    /* Fill the cache before unlocking so a concurrent write can't be overwritten with stale data */
+    settings_cache_put(&database->settings_cache, guild_id, present ? settings : NULL);
+    db_stmt_release(database, stmt);
+    return present ? 0 : -1;
 }
 
 int db_set_guild_settings(yuno_database_t *database, const guild_settings_t *settings) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)settings->guild_id);
-
-    const char *sql = "INSERT OR REPLACE INTO guild_settings (guild_id, prefix, spam_filter_enabled, leveling_enabled) VALUES (?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_SET_GUILD_SETTINGS);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)settings->guild_id);
     sqlite3_bind_text(stmt, 2, settings->prefix, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt, 3, settings->spam_filter_enabled);
     sqlite3_bind_int(stmt, 4, settings->leveling_enabled);
+    sqlite3_bind_int(stmt, 5, settings->xp_cooldown);
 
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    return 0;
+    int rc = (sqlite3_step(stmt) == SQLITE_DONE) ? 0 : -1;
+
+    /* Write-through so the next message sees the new settings */
+    if (rc == 0) {
+        settings_cache_put(&database->settings_cache, settings->guild_id, settings);
+    }
+    db_stmt_release(database, stmt);
+    return rc;
 }
 
 int db_get_prefix(yuno_database_t *database, uint64_t guild_id, const char *default_prefix, char *out_prefix, size_t out_len) {
@@ -200,165 +1183,602 @@ int db_get_prefix(yuno_database_t *database, uint64_t guild_id, const char *defa
     } else {
         strncpy(out_prefix, default_prefix, out_len - 1);
     }
+    out_prefix[out_len - 1] = '\0';
     return 0;
 }
 
 int db_set_prefix(yuno_database_t *database, uint64_t guild_id, const char *prefix) {
     guild_settings_t settings;
     if (db_get_guild_settings(database, guild_id, &settings) != 0) {
+        memset(&settings, 0, sizeof(settings));
         settings.guild_id = guild_id;
         settings.spam_filter_enabled = 0;
         settings.leveling_enabled = 1;
+        settings.xp_cooldown = DEFAULT_XP_COOLDOWN;
     }
     strncpy(settings.prefix, prefix, MAX_PREFIX_LEN - 1);
+    settings.prefix[MAX_PREFIX_LEN - 1] = '\0';
+    return db_set_guild_settings(database, &settings);
+}
+
+int db_set_xp_cooldown(yuno_database_t *database, uint64_t guild_id, const char *default_prefix, int seconds) {
+    guild_settings_t settings;
+    if (db_get_guild_settings(database, guild_id, &settings) != 0) {
+        memset(&settings, 0, sizeof(settings));
+        settings.guild_id = guild_id;
+        strncpy(settings.prefix, default_prefix, MAX_PREFIX_LEN - 1);
+        settings.spam_filter_enabled = 0;
+        settings.leveling_enabled = 1;
+    }
+    settings.xp_cooldown = seconds;
+    return db_set_guild_settings(database, &settings);
+}
+
+int db_set_spam_policy(yuno_database_t *database, uint64_t guild_id, const char *default_prefix,
+                       int interval, int max_messages, int max_duplicates) {
+    if (!spam_policy_valid(interval, max_messages, max_duplicates)) {
+        return -1;
+    }
+
+    guild_settings_t settings;
+    if (db_get_guild_settings(database, guild_id, &settings) != 0) {
+        memset(&settings, 0, sizeof(settings));
+        settings.guild_id = guild_id;
+        strncpy(settings.prefix, default_prefix, MAX_PREFIX_LEN - 1);
+        settings.spam_filter_enabled = 0;
+        settings.leveling_enabled = 1;
+        settings.xp_cooldown = DEFAULT_XP_COOLDOWN;
+    }
+
+    sqlite3_stmt *stmt = db_stmt_acquire(database, DB_STMT_SET_SPAM_POLICY);
+    if (!stmt) {
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int(stmt, 2, interval);
+    sqlite3_bind_int(stmt, 3, max_messages);
+    sqlite3_bind_int(stmt, 4, max_duplicates);
+    int rc = (sqlite3_step(stmt) == SQLITE_DONE) ? 0 : -1;
+    db_stmt_release(database, stmt);
+    if (rc != 0) {
+        return -1;
+    }
+
+    /* Writing the settings row back points the cached entry at the new policy */
+    settings.spam_policy = spam_policy_intern(&database->spam_policies, interval, max_messages, max_duplicates);
     return db_set_guild_settings(database, &settings);
 }
 
+int db_reset_spam_policy(yuno_database_t *database, uint64_t guild_id) {
+    sqlite3_stmt *stmt = db_stmt_acquire(database, DB_STMT_REMOVE_SPAM_POLICY);
+    if (!stmt) {
+        return -1;
+    }
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    int rc = (sqlite3_step(stmt) == SQLITE_DONE) ? 0 : -1;
+    db_stmt_release(database, stmt);
+
+    guild_settings_t settings;
+    if (rc == 0 && db_get_guild_settings(database, guild_id, &settings) == 0 && settings.spam_policy != 0) {
+        settings.spam_policy = 0;
+        rc = db_set_guild_settings(database, &settings);
+    }
+    return rc;
+}
+
 int db_get_user_xp(yuno_database_t *database, uint64_t user_id, uint64_t guild_id, user_xp_t *xp) {
     sqlite3_stmt *stmt;
-    char user_str[32], guild_str[32];
-
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
 
     xp->user_id = user_id;
     xp->guild_id = guild_id;
     xp->xp = 0;
     xp->level = 0;
 
-    const char *sql = "SELECT xp, level FROM user_xp WHERE user_id = ? AND guild_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_GET_USER_XP);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)user_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)guild_id);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         xp->xp = sqlite3_column_int64(stmt, 0);
         xp->level = sqlite3_column_int(stmt, 1);
     }
 
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_add_xp(yuno_database_t *database, uint64_t user_id, uint64_t guild_id, int64_t amount) {
     sqlite3_stmt *stmt;
-    char user_str[32], guild_str[32];
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "INSERT INTO user_xp (user_id, guild_id, xp, level) VALUES (?, ?, ?, 0) "
-                      "ON CONFLICT(user_id, guild_id) DO UPDATE SET xp = xp + ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_ADD_XP);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)user_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)guild_id);
     sqlite3_bind_int64(stmt, 3, amount);
     sqlite3_bind_int64(stmt, 4, amount);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_set_level(yuno_database_t *database, uint64_t user_id, uint64_t guild_id, int level) {
     sqlite3_stmt *stmt;
-    char user_str[32], guild_str[32];
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "UPDATE user_xp SET level = ? WHERE user_id = ? AND guild_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_SET_LEVEL);
+    if (!stmt) {
         return -1;
     }
 
     sqlite3_bind_int(stmt, 1, level);
-    sqlite3_bind_text(stmt, 2, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)user_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)guild_id);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
+/* Upsert one pending entry and persist a level-up - caller holds database->lock */
+static int apply_xp_entry(yuno_database_t *database, sqlite3_stmt *upsert, const pending_xp_t *p,
+                          xp_flush_result_t *r) {
+    sqlite3_bind_int64(upsert, 1, (sqlite3_int64)p->user_id);
+    sqlite3_bind_int64(upsert, 2, (sqlite3_int64)p->guild_id);
+    sqlite3_bind_int64(upsert, 3, p->xp_amount);
+
+    int rc = sqlite3_step(upsert);
+    if (rc == SQLITE_ROW) {
+        r->user_id = p->user_id;
+        r->guild_id = p->guild_id;
+        r->channel_id = p->channel_id;
+        r->new_xp = sqlite3_column_int64(upsert, 0);
+        r->old_xp = r->new_xp - p->xp_amount;
+        r->old_level = sqlite3_column_int(upsert, 1);
+        r->new_level = level_for_xp(r->new_xp);
+        /* Drain the statement so the write is complete before the next bind */
+        rc = sqlite3_step(upsert);
+    }
+    sqlite3_reset(upsert);
+    sqlite3_clear_bindings(upsert);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(database->db));
+        return -1;
+    }
+
+    if (r->new_level <= r->old_level) {
+        r->new_level = r->old_level;
+        return 0;
+    }
+
+    sqlite3_stmt *set_level = db_stmt_get_locked(database, DB_STMT_SET_LEVEL);
+    if (!set_level) {
+        return -1;
+    }
+    sqlite3_bind_int(set_level, 1, r->new_level);
+    sqlite3_bind_int64(set_level, 2, (sqlite3_int64)p->user_id);
+    sqlite3_bind_int64(set_level, 3, (sqlite3_int64)p->guild_id);
+    rc = sqlite3_step(set_level);
+    sqlite3_reset(set_level);
+    sqlite3_clear_bindings(set_level);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+/* Record a journal generation as applied and forget ones too old to matter */
+static int mark_xp_generation(yuno_database_t *database, uint64_t generation) {
+    sqlite3_stmt *stmt = db_stmt_get_locked(database, DB_STMT_MARK_XP_GENERATION);
+    if (!stmt) return -1;
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)generation);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    if (rc != SQLITE_DONE) return -1;
+
+    if (generation <= XP_GENERATIONS_KEPT) return 0;
+
+    stmt = db_stmt_get_locked(database, DB_STMT_PRUNE_XP_GENERATIONS);
+    if (!stmt) return -1;
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)(generation - XP_GENERATIONS_KEPT));
+    rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return rc == SQLITE_DONE ? 0 : -1;
+}
+
+/* One upsert per entry, all under a single savepoint - nests inside the
+ * writer's transaction, and is its own transaction when called alone.
+ * Journal generations first..last (0 = none) are marked committed in the same savepoint. */
+int db_apply_xp_batch(yuno_database_t *database, const pending_xp_t *entries, int count,
+                      uint64_t first_generation, uint64_t last_generation, xp_flush_result_t *results) {
+    int rc = -1;
+
+    pthread_mutex_lock(&database->lock);
+
+    if (exec_sql(database, "SAVEPOINT xp_batch") != 0) {
+        pthread_mutex_unlock(&database->lock);
+        return -1;
+    }
+
+    sqlite3_stmt *upsert = db_stmt_get_locked(database, DB_STMT_UPSERT_XP);
+    if (upsert) {
+        rc = 0;
+        for (int i = 0; i < count && rc == 0; i++) {
+            rc = apply_xp_entry(database, upsert, &entries[i], &results[i]);
+        }
+    }
+    for (uint64_t g = first_generation; rc == 0 && g != 0 && g <= last_generation; g++) {
+        rc = mark_xp_generation(database, g);
+    }
+
+    if (rc != 0) {
+        exec_sql(database, "ROLLBACK TO xp_batch");
+    }
+    if (exec_sql(database, "RELEASE xp_batch") != 0) {
+        rc = -1;
+    }
+
+    pthread_mutex_unlock(&database->lock);
+    return rc;
+}
+
 int db_get_leaderboard(yuno_database_t *database, uint64_t guild_id, user_xp_t *results, int max_results, int *count) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
+    db_reader_t *reader;
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "SELECT user_id, xp, level FROM user_xp WHERE guild_id = ? ORDER BY xp DESC LIMIT ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_LEADERBOARD, &reader);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
     sqlite3_bind_int(stmt, 2, max_results);
 
     *count = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && *count < max_results) {
-        results[*count].user_id = strtoull((const char *)sqlite3_column_text(stmt, 0), NULL, 10);
+        results[*count].user_id = (uint64_t)sqlite3_column_int64(stmt, 0);
         results[*count].guild_id = guild_id;
         results[*count].xp = sqlite3_column_int64(stmt, 1);
         results[*count].level = sqlite3_column_int(stmt, 2);
         (*count)++;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return 0;
 }
 
-int db_log_mod_action(yuno_database_t *database, const mod_action_t *action) {
+/* Distinct XP values of a guild in ascending order with how many members hold each */
+int db_get_xp_distribution(yuno_database_t *database, uint64_t guild_id, int64_t **xp_values,
+                           uint32_t **member_counts, size_t *count) {
+    sqlite3_stmt *stmt;
+    db_reader_t *reader;
+    size_t capacity = 0;
+    int rc = 0;
+
+    *xp_values = NULL;
+    *member_counts = NULL;
+    *count = 0;
+
+    stmt = db_read_acquire(database, DB_STMT_GET_XP_DISTRIBUTION, &reader);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            int64_t *values = realloc(*xp_values, sizeof(int64_t) * capacity);
+            if (values) *xp_values = values;
+            uint32_t *counts = realloc(*member_counts, sizeof(uint32_t) * capacity);
+            if (counts) *member_counts = counts;
+            if (!values || !counts) {
+                rc = -1;
+                break;
+            }
+        }
+        (*xp_values)[*count] = sqlite3_column_int64(stmt, 0);
+        (*member_counts)[*count] = (uint32_t)sqlite3_column_int64(stmt, 1);
+        (*count)++;
+    }
+
+    db_read_release(database, reader, stmt);
+    if (rc != 0) {
+        free(*xp_values);
+        free(*member_counts);
+        *xp_values = NULL;
+        *member_counts = NULL;
+        *count = 0;
+    }
+    return rc;
+}
+
+/* Level role rewards */
+int db_get_level_roles(yuno_database_t *database, uint64_t guild_id, level_role_t **roles, size_t *count) {
     sqlite3_stmt *stmt;
-    char guild_str[32], mod_str[32], target_str[32];
+    size_t capacity = 0;
+    int rc = 0;
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)action->guild_id);
-    snprintf(mod_str, sizeof(mod_str), "%lu", (unsigned long)action->moderator_id);
-    snprintf(target_str, sizeof(target_str), "%lu", (unsigned long)action->target_id);
+    *roles = NULL;
+    *count = 0;
 
-    const char *sql = "INSERT INTO mod_actions (guild_id, moderator_id, target_id, action_type, reason, timestamp) VALUES (?, ?, ?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_GET_LEVEL_ROLES);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, mod_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, target_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 8;
+            level_role_t *grown = realloc(*roles, sizeof(level_role_t) * capacity);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            *roles = grown;
+        }
+        (*roles)[*count].level = sqlite3_column_int(stmt, 0);
+        (*roles)[*count].role_id = (uint64_t)sqlite3_column_int64(stmt, 1);
+        (*count)++;
+    }
+
+    db_stmt_release(database, stmt);
+    if (rc != 0) {
+        free(*roles);
+        *roles = NULL;
+        *count = 0;
+    }
+    return rc;
+}
+
+int db_set_level_role(yuno_database_t *database, uint64_t guild_id, int level, uint64_t role_id) {
+    sqlite3_stmt *stmt;
+    int rc;
+
+    stmt = db_stmt_acquire(database, DB_STMT_SET_LEVEL_ROLE);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int(stmt, 2, level);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)role_id);
+
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    db_stmt_release(database, stmt);
+    return rc;
+}
+
+int db_remove_level_role(yuno_database_t *database, uint64_t guild_id, int level) {
+    sqlite3_stmt *stmt;
+    int rc;
+
+    stmt = db_stmt_acquire(database, DB_STMT_REMOVE_LEVEL_ROLE);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int(stmt, 2, level);
+
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (rc == 0 && sqlite3_changes(database->db) == 0) {
+        rc = 1;     /* Nothing configured at that level */
+    }
+    db_stmt_release(database, stmt);
+    return rc;
+}
+
+int db_get_banned_words(yuno_database_t *database, uint64_t guild_id, banned_word_t **words, size_t *count) {
+    sqlite3_stmt *stmt;
+    db_reader_t *reader;
+    size_t capacity = 0;
+    int rc = 0;
+
+    *words = NULL;
+    *count = 0;
+
+    stmt = db_read_acquire(database, DB_STMT_GET_BANNED_WORDS, &reader);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            banned_word_t *grown = realloc(*words, sizeof(banned_word_t) * capacity);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            *words = grown;
+        }
+        const char *word = (const char *)sqlite3_column_text(stmt, 0);
+        strncpy((*words)[*count].word, word ? word : "", MAX_BANNED_WORD_LEN);
+        (*words)[*count].word[MAX_BANNED_WORD_LEN] = '\0';
+        (*count)++;
+    }
+
+    db_read_release(database, reader, stmt);
+    if (rc != 0) {
+        free(*words);
+        *words = NULL;
+        *count = 0;
+    }
+    return rc;
+}
+
+int db_add_banned_word(yuno_database_t *database, uint64_t guild_id, const char *word) {
+    sqlite3_stmt *stmt;
+    int rc;
+
+    stmt = db_stmt_acquire(database, DB_STMT_ADD_BANNED_WORD);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_text(stmt, 2, word, -1, SQLITE_TRANSIENT);
+
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (rc == 0 && sqlite3_changes(database->db) == 0) {
+        rc = 1;     /* Already on the list */
+    }
+    db_stmt_release(database, stmt);
+    return rc;
+}
+
+int db_remove_banned_word(yuno_database_t *database, uint64_t guild_id, const char *word) {
+    sqlite3_stmt *stmt;
+    int rc;
+
+    stmt = db_stmt_acquire(database, DB_STMT_REMOVE_BANNED_WORD);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_text(stmt, 2, word, -1, SQLITE_TRANSIENT);
+
+    rc = sqlite3_step(stmt) == SQLITE_DONE ? 0 : -1;
+    if (rc == 0 && sqlite3_changes(database->db) == 0) {
+        rc = 1;     /* Not on the list */
+    }
+    db_stmt_release(database, stmt);
+    return rc;
+}
+
+int db_get_banned_word_guilds(yuno_database_t *database, uint64_t **guild_ids, size_t *count) {
+    sqlite3_stmt *stmt;
+    db_reader_t *reader;
+    size_t capacity = 0;
+    int rc = 0;
+
+    *guild_ids = NULL;
+    *count = 0;
+
+    stmt = db_read_acquire(database, DB_STMT_GET_BANNED_WORD_GUILDS, &reader);
+    if (!stmt) {
+        return -1;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            uint64_t *grown = realloc(*guild_ids, sizeof(uint64_t) * capacity);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            *guild_ids = grown;
+        }
+        (*guild_ids)[(*count)++] = (uint64_t)sqlite3_column_int64(stmt, 0);
+    }
+
+    db_read_release(database, reader, stmt);
+    if (rc != 0) {
+        free(*guild_ids);
+        *guild_ids = NULL;
+        *count = 0;
+    }
+    return rc;
+}
+
+int db_get_member_levels(yuno_database_t *database, uint64_t guild_id, int min_level,
+                         uint64_t **user_ids, int **levels, size_t *count) {
+    sqlite3_stmt *stmt;
+    db_reader_t *reader;
+    size_t capacity = 0;
+    int rc = 0;
+
+    *user_ids = NULL;
+    *levels = NULL;
+    *count = 0;
+
+    stmt = db_read_acquire(database, DB_STMT_GET_MEMBER_LEVELS, &reader);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int(stmt, 2, min_level);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            uint64_t *ids = realloc(*user_ids, sizeof(uint64_t) * capacity);
+            if (ids) *user_ids = ids;
+            int *lv = realloc(*levels, sizeof(int) * capacity);
+            if (lv) *levels = lv;
+            if (!ids || !lv) {
+                rc = -1;
+                break;
+            }
+        }
+        (*user_ids)[*count] = (uint64_t)sqlite3_column_int64(stmt, 0);
+        (*levels)[*count] = sqlite3_column_int(stmt, 1);
+        (*count)++;
+    }
+
+    db_read_release(database, reader, stmt);
+    if (rc != 0) {
+        free(*user_ids);
+        free(*levels);
+        *user_ids = NULL;
+        *levels = NULL;
+        *count = 0;
+    }
+    return rc;
+}
+
+int db_log_mod_action(yuno_database_t *database, const mod_action_t *action) {
+    sqlite3_stmt *stmt;
+
+    stmt = db_stmt_acquire(database, DB_STMT_LOG_MOD_ACTION);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)action->guild_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)action->moderator_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)action->target_id);
     sqlite3_bind_text(stmt, 4, action->action_type, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 5, action->reason, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 6, action->timestamp);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_get_mod_actions(yuno_database_t *database, uint64_t guild_id, mod_action_t *results, int max_results, int *count) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
-
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
+    db_reader_t *reader;
 
-    const char *sql = "SELECT id, moderator_id, target_id, action_type, reason, timestamp FROM mod_actions WHERE guild_id = ? ORDER BY timestamp DESC LIMIT ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_MOD_ACTIONS, &reader);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
     sqlite3_bind_int(stmt, 2, max_results);
 
     *count = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && *count < max_results) {
         results[*count].id = sqlite3_column_int64(stmt, 0);
         results[*count].guild_id = guild_id;
-        results[*count].moderator_id = strtoull((const char *)sqlite3_column_text(stmt, 1), NULL, 10);
-        results[*count].target_id = strtoull((const char *)sqlite3_column_text(stmt, 2), NULL, 10);
+        results[*count].moderator_id = (uint64_t)sqlite3_column_int64(stmt, 1);
+        results[*count].target_id = (uint64_t)sqlite3_column_int64(stmt, 2);
         strncpy(results[*count].action_type, (const char *)sqlite3_column_text(stmt, 3), 31);
         const char *reason = (const char *)sqlite3_column_text(stmt, 4);
         strncpy(results[*count].reason, reason ? reason : "", MAX_REASON_LEN - 1);
@@ -366,28 +1786,25 @@ int db_get_mod_actions(yuno_database_t *database, uint64_t guild_id, mod_action_
         (*count)++;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return 0;
 }
 
 int db_get_mod_stats(yuno_database_t *database, uint64_t guild_id, uint64_t moderator_id, int *ban_count, int *kick_count, int *timeout_count) {
     sqlite3_stmt *stmt;
-    char guild_str[32], mod_str[32];
-
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-    snprintf(mod_str, sizeof(mod_str), "%lu", (unsigned long)moderator_id);
+    db_reader_t *reader;
 
     *ban_count = 0;
     *kick_count = 0;
     *timeout_count = 0;
 
-    const char *sql = "SELECT action_type, COUNT(*) FROM mod_actions WHERE guild_id = ? AND moderator_id = ? GROUP BY action_type";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_MOD_STATS, &reader);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, mod_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)moderator_id);
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         const char *type = (const char *)sqlite3_column_text(stmt, 0);
@@ -397,24 +1814,20 @@ int db_get_mod_stats(yuno_database_t *database, uint64_t guild_id, uint64_t mode
         else if (strcmp(type, "timeout") == 0) *timeout_count = count;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return 0;
 }
 
 int db_get_auto_clean_config(yuno_database_t *database, uint64_t guild_id, uint64_t channel_id, auto_clean_config_t *config) {
     sqlite3_stmt *stmt;
-    char guild_str[32], channel_str[32];
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-    snprintf(channel_str, sizeof(channel_str), "%lu", (unsigned long)channel_id);
-
-    const char *sql = "SELECT interval_minutes, message_count, enabled FROM auto_clean_config WHERE guild_id = ? AND channel_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_GET_AUTO_CLEAN_CONFIG);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, channel_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)channel_id);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         config->guild_id = guild_id;
@@ -422,153 +1835,130 @@ int db_get_auto_clean_config(yuno_database_t *database, uint64_t guild_id, uint6
         config->interval_minutes = sqlite3_column_int(stmt, 0);
         config->message_count = sqlite3_column_int(stmt, 1);
         config->enabled = sqlite3_column_int(stmt, 2);
-        sqlite3_finalize(stmt);
+        db_stmt_release(database, stmt);
         return 0;
     }
 
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return -1;
 }
 
 int db_set_auto_clean_config(yuno_database_t *database, const auto_clean_config_t *config) {
     sqlite3_stmt *stmt;
-    char guild_str[32], channel_str[32];
-
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)config->guild_id);
-    snprintf(channel_str, sizeof(channel_str), "%lu", (unsigned long)config->channel_id);
 
-    const char *sql = "INSERT OR REPLACE INTO auto_clean_config (guild_id, channel_id, interval_minutes, message_count, enabled) VALUES (?, ?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_SET_AUTO_CLEAN_CONFIG);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, channel_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)config->guild_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)config->channel_id);
     sqlite3_bind_int(stmt, 3, config->interval_minutes);
     sqlite3_bind_int(stmt, 4, config->message_count);
     sqlite3_bind_int(stmt, 5, config->enabled);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_remove_auto_clean_config(yuno_database_t *database, uint64_t guild_id, uint64_t channel_id) {
     sqlite3_stmt *stmt;
-    char guild_str[32], channel_str[32];
-
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-    snprintf(channel_str, sizeof(channel_str), "%lu", (unsigned long)channel_id);
 
-    const char *sql = "DELETE FROM auto_clean_config WHERE guild_id = ? AND channel_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_REMOVE_AUTO_CLEAN_CONFIG);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, channel_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)channel_id);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_get_all_auto_clean_configs(yuno_database_t *database, auto_clean_config_t *configs, int max_configs, int *count) {
     sqlite3_stmt *stmt;
+    db_reader_t *reader;
 
-    const char *sql = "SELECT guild_id, channel_id, interval_minutes, message_count, enabled FROM auto_clean_config WHERE enabled = 1";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_ALL_AUTO_CLEAN_CONFIGS, &reader);
+    if (!stmt) {
         return -1;
     }
 
     *count = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && *count < max_configs) {
-        configs[*count].guild_id = strtoull((const char *)sqlite3_column_text(stmt, 0), NULL, 10);
-        configs[*count].channel_id = strtoull((const char *)sqlite3_column_text(stmt, 1), NULL, 10);
+        configs[*count].guild_id = (uint64_t)sqlite3_column_int64(stmt, 0);
+        configs[*count].channel_id = (uint64_t)sqlite3_column_int64(stmt, 1);
         configs[*count].interval_minutes = sqlite3_column_int(stmt, 2);
         configs[*count].message_count = sqlite3_column_int(stmt, 3);
         configs[*count].enabled = sqlite3_column_int(stmt, 4);
         (*count)++;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return 0;
 }
 
 int db_add_spam_warning(yuno_database_t *database, uint64_t user_id, uint64_t guild_id) {
     sqlite3_stmt *stmt;
-    char user_str[32], guild_str[32];
     time_t now = time(NULL);
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "INSERT INTO spam_warnings (user_id, guild_id, warnings, last_warning) VALUES (?, ?, 1, ?) "
-                      "ON CONFLICT(user_id, guild_id) DO UPDATE SET warnings = warnings + 1, last_warning = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_ADD_SPAM_WARNING);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)user_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)guild_id);
     sqlite3_bind_int64(stmt, 3, now);
     sqlite3_bind_int64(stmt, 4, now);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_get_spam_warnings(yuno_database_t *database, uint64_t user_id, uint64_t guild_id) {
     sqlite3_stmt *stmt;
-    char user_str[32], guild_str[32];
     int warnings = 0;
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "SELECT warnings FROM spam_warnings WHERE user_id = ? AND guild_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_GET_SPAM_WARNINGS);
+    if (!stmt) {
         return 0;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)user_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)guild_id);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         warnings = sqlite3_column_int(stmt, 0);
     }
 
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return warnings;
 }
 
 int db_reset_spam_warnings(yuno_database_t *database, uint64_t user_id, uint64_t guild_id) {
     sqlite3_stmt *stmt;
-    char user_str[32], guild_str[32];
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "DELETE FROM spam_warnings WHERE user_id = ? AND guild_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_RESET_SPAM_WARNINGS);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)user_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)guild_id);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 /* Voice XP config */
 int db_get_voice_xp_config(yuno_database_t *database, uint64_t guild_id, voice_xp_config_t *config) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
-
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
 
     config->guild_id = guild_id;
     config->enabled = 0;
@@ -576,12 +1966,12 @@ int db_get_voice_xp_config(yuno_database_t *database, uint64_t guild_id, voice_x
     config->min_users = 2;
     config->ignore_afk = 1;
 
-    const char *sql = "SELECT enabled, xp_per_minute, min_users, ignore_afk FROM voice_xp_config WHERE guild_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_GET_VOICE_XP_CONFIG);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
 
     if (sqlite3_step(stmt) == SQLITE_ROW) {
         config->enabled = sqlite3_column_int(stmt, 0);
@@ -590,79 +1980,69 @@ int db_get_voice_xp_config(yuno_database_t *database, uint64_t guild_id, voice_x
         config->ignore_afk = sqlite3_column_int(stmt, 3);
     }
 
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_set_voice_xp_config(yuno_database_t *database, const voice_xp_config_t *config) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)config->guild_id);
-
-    const char *sql = "INSERT OR REPLACE INTO voice_xp_config (guild_id, enabled, xp_per_minute, min_users, ignore_afk) VALUES (?, ?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_SET_VOICE_XP_CONFIG);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)config->guild_id);
     sqlite3_bind_int(stmt, 2, config->enabled);
     sqlite3_bind_int(stmt, 3, config->xp_per_minute);
     sqlite3_bind_int(stmt, 4, config->min_users);
     sqlite3_bind_int(stmt, 5, config->ignore_afk);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 /* Activity logging */
 int db_log_activity(yuno_database_t *database, const activity_log_t *log) {
     sqlite3_stmt *stmt;
-    char guild_str[32], user_str[32], channel_str[32];
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)log->guild_id);
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)log->user_id);
-    snprintf(channel_str, sizeof(channel_str), "%lu", (unsigned long)log->channel_id);
-
-    const char *sql = "INSERT INTO activity_log (guild_id, user_id, channel_id, event_type, old_content, new_content, timestamp) VALUES (?, ?, ?, ?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_LOG_ACTIVITY);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, channel_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)log->guild_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)log->user_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite3_int64)log->channel_id);
     sqlite3_bind_text(stmt, 4, log->event_type, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 5, log->old_content, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 6, log->new_content, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 7, log->timestamp);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_get_activity_logs(yuno_database_t *database, uint64_t guild_id, activity_log_t *logs, int max_logs, int *count) {
     sqlite3_stmt *stmt;
-    char guild_str[32];
+    db_reader_t *reader;
 
-    snprintf(guild_str, sizeof(guild_str), "%lu", (unsigned long)guild_id);
-
-    const char *sql = "SELECT id, user_id, channel_id, event_type, old_content, new_content, timestamp FROM activity_log WHERE guild_id = ? ORDER BY timestamp DESC LIMIT ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_ACTIVITY_LOGS, &reader);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, guild_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)guild_id);
     sqlite3_bind_int(stmt, 2, max_logs);
 
     *count = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && *count < max_logs) {
         logs[*count].id = sqlite3_column_int64(stmt, 0);
         logs[*count].guild_id = guild_id;
-        logs[*count].user_id = strtoull((const char *)sqlite3_column_text(stmt, 1), NULL, 10);
-        logs[*count].channel_id = strtoull((const char *)sqlite3_column_text(stmt, 2), NULL, 10);
+        logs[*count].user_id = (uint64_t)sqlite3_column_int64(stmt, 1);
+        logs[*count].channel_id = (uint64_t)sqlite3_column_int64(stmt, 2);
         strncpy(logs[*count].event_type, (const char *)sqlite3_column_text(stmt, 3), 31);
         const char *old = (const char *)sqlite3_column_text(stmt, 4);
         const char *new = (const char *)sqlite3_column_text(stmt, 5);
@@ -672,38 +2052,36 @@ int db_get_activity_logs(yuno_database_t *database, uint64_t guild_id, activity_
         (*count)++;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return 0;
 }
 
 /* DM inbox */
 int db_save_dm(yuno_database_t *database, const dm_inbox_t *dm) {
     sqlite3_stmt *stmt;
-    char user_str[32];
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)dm->user_id);
-
-    const char *sql = "INSERT INTO dm_inbox (user_id, username, content, timestamp, read_status) VALUES (?, ?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_SAVE_DM);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)dm->user_id);
     sqlite3_bind_text(stmt, 2, dm->username, -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, dm->content, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 4, dm->timestamp);
     sqlite3_bind_int(stmt, 5, dm->read_status);
 
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_get_dms(yuno_database_t *database, dm_inbox_t *dms, int max_dms, int *count) {
     sqlite3_stmt *stmt;
+    db_reader_t *reader;
 
-    const char *sql = "SELECT id, user_id, username, content, timestamp, read_status FROM dm_inbox ORDER BY timestamp DESC LIMIT ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_DMS, &reader);
+    if (!stmt) {
         return -1;
     }
 
@@ -712,7 +2090,7 @@ int db_get_dms(yuno_database_t *database, dm_inbox_t *dms, int max_dms, int *cou
     *count = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && *count < max_dms) {
         dms[*count].id = sqlite3_column_int64(stmt, 0);
-        dms[*count].user_id = strtoull((const char *)sqlite3_column_text(stmt, 1), NULL, 10);
+        dms[*count].user_id = (uint64_t)sqlite3_column_int64(stmt, 1);
         const char *username = (const char *)sqlite3_column_text(stmt, 2);
         strncpy(dms[*count].username, username ? username : "", 63);
         const char *content = (const char *)sqlite3_column_text(stmt, 3);
@@ -722,30 +2100,31 @@ int db_get_dms(yuno_database_t *database, dm_inbox_t *dms, int max_dms, int *cou
         (*count)++;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return 0;
 }
 
 int db_mark_dm_read(yuno_database_t *database, int64_t dm_id) {
     sqlite3_stmt *stmt;
 
-    const char *sql = "UPDATE dm_inbox SET read_status = 1 WHERE id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_MARK_DM_READ);
+    if (!stmt) {
         return -1;
     }
 
     sqlite3_bind_int64(stmt, 1, dm_id);
     sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+    db_stmt_release(database, stmt);
     return 0;
 }
 
 int db_get_unread_dm_count(yuno_database_t *database) {
     sqlite3_stmt *stmt;
+    db_reader_t *reader;
     int count = 0;
 
-    const char *sql = "SELECT COUNT(*) FROM dm_inbox WHERE read_status = 0";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_UNREAD_DM_COUNT, &reader);
+    if (!stmt) {
         return 0;
     }
 
@@ -753,77 +2132,77 @@ int db_get_unread_dm_count(yuno_database_t *database) {
         count = sqlite3_column_int(stmt, 0);
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
     return count;
 }
 
 /* Bot-level bans */
 int db_add_bot_ban(yuno_database_t *database, const bot_ban_t *ban) {
     sqlite3_stmt *stmt;
-    char user_str[32], banned_by_str[32];
-
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)ban->user_id);
-    snprintf(banned_by_str, sizeof(banned_by_str), "%lu", (unsigned long)ban->banned_by);
 
-    const char *sql = "INSERT OR REPLACE INTO bot_bans (user_id, banned_by, reason, timestamp) VALUES (?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_ADD_BOT_BAN);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, banned_by_str, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)ban->user_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)ban->banned_by);
     sqlite3_bind_text(stmt, 3, ban->reason, -1, SQLITE_TRANSIENT);
     sqlite3_bind_int64(stmt, 4, ban->timestamp);
 
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    return 0;
+    int rc = (sqlite3_step(stmt) == SQLITE_DONE) ? 0 : -1;
+    if (rc == 0) {
+        ban_filter_add(&database->ban_filter, ban->user_id);
+    }
+    db_stmt_release(database, stmt);
+    return rc;
 }
 
 int db_remove_bot_ban(yuno_database_t *database, uint64_t user_id) {
     sqlite3_stmt *stmt;
-    char user_str[32];
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-
-    const char *sql = "DELETE FROM bot_bans WHERE user_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_stmt_acquire(database, DB_STMT_REMOVE_BOT_BAN);
+    if (!stmt) {
         return -1;
     }
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
-    return 0;
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)user_id);
+    int rc = (sqlite3_step(stmt) == SQLITE_DONE) ? 0 : -1;
+    if (rc == 0) {
+        ban_filter_remove(&database->ban_filter, user_id);
+    }
+    db_stmt_release(database, stmt);
+    return rc;
 }
 
+/* Runs for every message - answered from memory, bot_bans is only read at startup */
 int db_is_bot_banned(yuno_database_t *database, uint64_t user_id) {
-    sqlite3_stmt *stmt;
-    char user_str[32];
+    ban_filter_t *filter = &database->ban_filter;
+    uint64_t h = mix_id(user_id);
     int banned = 0;
 
-    snprintf(user_str, sizeof(user_str), "%lu", (unsigned long)user_id);
-
-    const char *sql = "SELECT 1 FROM bot_bans WHERE user_id = ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    pthread_rwlock_rdlock(&filter->lock);
+    if (!bloom_maybe(filter, h)) {
+        pthread_rwlock_unlock(&filter->lock);
+        atomic_fetch_add_explicit(&filter->filtered, 1, memory_order_relaxed);
         return 0;
     }
+    banned = u64map_find(&filter->ids, user_id, 0) != NULL;
+    pthread_rwlock_unlock(&filter->lock);
 
-    sqlite3_bind_text(stmt, 1, user_str, -1, SQLITE_TRANSIENT);
-
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-        banned = 1;
+    atomic_fetch_add_explicit(&filter->probed, 1, memory_order_relaxed);
+    if (!banned) {
+        atomic_fetch_add_explicit(&filter->false_positives, 1, memory_order_relaxed);
     }
-
-    sqlite3_finalize(stmt);
     return banned;
 }
 
 int db_get_bot_bans(yuno_database_t *database, bot_ban_t *bans, int max_bans, int *count) {
     sqlite3_stmt *stmt;
+    db_reader_t *reader;
 
-    const char *sql = "SELECT user_id, banned_by, reason, timestamp FROM bot_bans ORDER BY timestamp DESC LIMIT ?";
-    if (sqlite3_prepare_v2(database->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    stmt = db_read_acquire(database, DB_STMT_GET_BOT_BANS, &reader);
+    if (!stmt) {
         return -1;
     }
 
@@ -831,14 +2210,46 @@ int db_get_bot_bans(yuno_database_t *database, bot_ban_t *bans, int max_bans, in
 
     *count = 0;
     while (sqlite3_step(stmt) == SQLITE_ROW && *count < max_bans) {
-        bans[*count].user_id = strtoull((const char *)sqlite3_column_text(stmt, 0), NULL, 10);
-        bans[*count].banned_by = strtoull((const char *)sqlite3_column_text(stmt, 1), NULL, 10);
+        bans[*count].user_id = (uint64_t)sqlite3_column_int64(stmt, 0);
+        bans[*count].banned_by = (uint64_t)sqlite3_column_int64(stmt, 1);
         const char *reason = (const char *)sqlite3_column_text(stmt, 2);
         strncpy(bans[*count].reason, reason ? reason : "", MAX_REASON_LEN - 1);
         bans[*count].timestamp = sqlite3_column_int64(stmt, 3);
         (*count)++;
     }
 
-    sqlite3_finalize(stmt);
+    db_read_release(database, reader, stmt);
+    return 0;
+}
+
+int db_is_xp_generation_committed(yuno_database_t *database, uint64_t generation) {
+    sqlite3_stmt *stmt;
+
+    stmt = db_stmt_acquire(database, DB_STMT_IS_XP_GENERATION_COMMITTED);
+    if (!stmt) {
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)generation);
+    int committed = (sqlite3_step(stmt) == SQLITE_ROW) ? 1 : 0;
+
+    db_stmt_release(database, stmt);
+    return committed;
+}
+
+int db_get_max_xp_generation(yuno_database_t *database, uint64_t *generation) {
+    sqlite3_stmt *stmt;
+
+    stmt = db_stmt_acquire(database, DB_STMT_GET_MAX_XP_GENERATION);
+    if (!stmt) {
+        return -1;
+    }
+
+    *generation = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        *generation = (uint64_t)sqlite3_column_int64(stmt, 0);
+    }
+
+    db_stmt_release(database, stmt);
     return 0;
 }
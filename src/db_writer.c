@@ -0,0 +1,353 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Database Write-Behind Thread
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "db_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define DB_WRITE_QUEUE_MASK (DB_WRITE_QUEUE_SIZE - 1)
+#define DB_WRITER_IDLE_WAIT_MS 200
+#define DB_WRITER_FULL_WAIT_US 500     /* Between retries while the queue is full */
+
+/* XP batches whose callbacks must wait until the transaction commits */
+typedef struct {
+    xp_flush_result_t *results;
+    int count;
+    db_xp_done_fn on_done;
+    void *user_data;
+    int used;
+} xp_completion_t;
+
+static inline uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/* Multi-producer enqueue - lock-free, returns -1 if the queue is full */
+static int try_enqueue(db_writer_t *writer, const db_write_cmd_t *cmd) {
+    size_t pos = atomic_load_explicit(&writer->enqueue_pos, memory_order_relaxed);
+    db_write_cell_t *cell;
+
+    for (;;) {
+        cell = &writer->cells[pos & DB_WRITE_QUEUE_MASK];
+        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&writer->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return -1; /* Queue full */
+        } else {
+            pos = atomic_load_explicit(&writer->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->cmd = *cmd;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    sem_post(&writer->wakeup);
+    return 0;
+}
+
+/* Single-consumer peek - the cell stays owned by the writer until release_cell */
+static db_write_cell_t *peek_cell(db_writer_t *writer) {
+    size_t pos = atomic_load_explicit(&writer->dequeue_pos, memory_order_relaxed);
+    db_write_cell_t *cell = &writer->cells[pos & DB_WRITE_QUEUE_MASK];
+    size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+    return (seq == pos + 1) ? cell : NULL;
+}
+
+static void release_cell(db_writer_t *writer, db_write_cell_t *cell) {
+    size_t pos = atomic_load_explicit(&writer->dequeue_pos, memory_order_relaxed);
+    atomic_store_explicit(&writer->dequeue_pos, pos + 1, memory_order_relaxed);
+    atomic_store_explicit(&cell->seq, pos + DB_WRITE_QUEUE_SIZE, memory_order_release);
+}
+
+static int apply_command(db_writer_t *writer, const db_write_cmd_t *cmd, xp_completion_t *completion) {
+    yuno_database_t *database = writer->database;
+
+    switch (cmd->type) {
+        case DB_WRITE_SAVE_DM:
+            return db_save_dm(database, &cmd->data.dm);
+        case DB_WRITE_LOG_MOD_ACTION:
+            return db_log_mod_action(database, &cmd->data.mod_action);
+        case DB_WRITE_ADD_SPAM_WARNING:
+            return db_add_spam_warning(database, cmd->data.spam.user_id, cmd->data.spam.guild_id);
+        case DB_WRITE_RESET_SPAM_WARNINGS:
+            return db_reset_spam_warnings(database, cmd->data.spam.user_id, cmd->data.spam.guild_id);
+        case DB_WRITE_XP_BATCH: {
+            int count = cmd->data.xp.count;
+            xp_flush_result_t *results = malloc(sizeof(xp_flush_result_t) * (count > 0 ? count : 1));
+            int rc = -1;
+
+            if (results && db_apply_xp_batch(database, cmd->data.xp.entries, count,
+                                             cmd->data.xp.first_generation, cmd->data.xp.last_generation,
+                                             results) == 0) {
+                rc = 0;
+            } else {
+                free(results);
+                results = NULL;
+            }
+            completion->results = results;
+            completion->count = count;
+            completion->on_done = cmd->data.xp.on_done;
+            completion->user_data = cmd->data.xp.user_data;
+            completion->used = 1;
+            free(cmd->data.xp.entries);
+            return rc;
+        }
+    }
+    return -1;
+}
+
+/* Producers announce themselves before looking at running, and stop clears
+ * running before waiting for them to leave - so whoever gets in first sees
+ * the other, and nobody touches the ring or the semaphore once stop is done */
+static int producer_enter(db_writer_t *writer) {
+    atomic_fetch_add(&writer->producers, 1);
+    if (atomic_load(&writer->running)) return 1;
+    atomic_fetch_sub(&writer->producers, 1);
+    return 0;
+}
+
+static void producer_leave(db_writer_t *writer) {
+    atomic_fetch_sub(&writer->producers, 1);
+}
+
+/* Queue a write that mustn't be lost. A full queue means the writer is
+ * busy with a batch, so wait for it to make room; once it has stopped,
+ * write directly. Either way the write is never dropped. */
+static int enqueue(db_writer_t *writer, const db_write_cmd_t *cmd) {
+    int waited = 0;
+
+    if (producer_enter(writer)) {
+        while (atomic_load(&writer->running)) {
+            if (try_enqueue(writer, cmd) == 0) {
+                producer_leave(writer);
+                return 0;
+            }
+            if (!waited) {
+                atomic_fetch_add_explicit(&writer->waits, 1, memory_order_relaxed);
+                waited = 1;
+            }
+            sem_post(&writer->wakeup);
+            nanosleep(&(struct timespec){ .tv_nsec = DB_WRITER_FULL_WAIT_US * 1000L }, NULL);
+        }
+        producer_leave(writer);
+    }
+
+    atomic_fetch_add_explicit(&writer->direct, 1, memory_order_relaxed);
+    return apply_command(writer, cmd, NULL);
+}
+
+/* Apply up to DB_WRITE_BATCH_MAX queued commands inside one transaction */
+static void process_batch(db_writer_t *writer) {
+    static xp_completion_t completions[DB_WRITE_BATCH_MAX];
+    static db_write_cmd_t replay[DB_WRITE_BATCH_MAX];  /* Everything but XP, in case COMMIT fails */
+    int completion_count = 0;
+    int replay_count = 0;
+    int applied = 0;
+    db_write_cell_t *cell;
+
+    uint64_t start = monotonic_us();
+    int in_txn = (db_begin(writer->database) == 0);
+
+    while (applied < DB_WRITE_BATCH_MAX && (cell = peek_cell(writer)) != NULL) {
+        xp_completion_t *completion = &completions[completion_count];
+        completion->results = NULL;
+        completion->used = 0;
+
+        if (apply_command(writer, &cell->cmd, completion) != 0) {
+            fprintf(stderr, "💔 Queued database write (type %d) failed\n", (int)cell->cmd.type);
+        }
+        if (completion->used) {
+            completion_count++;
+        } else {
+            replay[replay_count++] = cell->cmd;
+        }
+        release_cell(writer, cell);
+        applied++;
+    }
+
+    int committed = in_txn ? (db_commit(writer->database) == 0) : 1;
+    if (!committed) {
+        db_rollback(writer->database);
+        atomic_fetch_add_explicit(&writer->failed_batches, 1, memory_order_relaxed);
+
+        /* XP batches go back to the batcher through their callbacks below - the
+         * rest only lived in the queue, so write them again one at a time */
+        for (int i = 0; i < replay_count; i++) {
+            if (apply_command(writer, &replay[i], NULL) != 0) {
+                fprintf(stderr, "💔 Database write (type %d) lost after its batch was rolled back\n",
+                        (int)replay[i].type);
+            }
+        }
+    }
+
+    uint64_t elapsed = monotonic_us() - start;
+    atomic_fetch_add_explicit(&writer->commands, (uint_fast64_t)applied, memory_order_relaxed);
+    atomic_fetch_add_explicit(&writer->batches, 1, memory_order_relaxed);
+    atomic_store_explicit(&writer->last_commit_us, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&writer->total_commit_us, elapsed, memory_order_relaxed);
+    if (elapsed > atomic_load_explicit(&writer->max_commit_us, memory_order_relaxed)) {
+        atomic_store_explicit(&writer->max_commit_us, elapsed, memory_order_relaxed);
+    }
+
+    /* Only hand out XP results that actually made it to disk */
+    for (int i = 0; i < completion_count; i++) {
+        xp_completion_t *completion = &completions[i];
+        if (completion->on_done) {
+            if (committed && completion->results) {
+                completion->on_done(completion->user_data, completion->results, completion->count);
+            } else {
+                completion->on_done(completion->user_data, NULL, -1);
+            }
+        }
+        free(completion->results);
+    }
+}
+
+static void *writer_loop(void *arg) {
+    db_writer_t *writer = arg;
+
+    for (;;) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += DB_WRITER_IDLE_WAIT_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while (sem_timedwait(&writer->wakeup, &deadline) != 0 && errno == EINTR) {
+        }
+        /* One drain covers every post made so far */
+        while (sem_trywait(&writer->wakeup) == 0) {
+        }
+
+        while (peek_cell(writer)) {
+            process_batch(writer);
+        }
+
+        if (!atomic_load(&writer->running) && !peek_cell(writer)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+int db_writer_start(db_writer_t *writer, yuno_database_t *database) {
+    memset(writer, 0, sizeof(db_writer_t));
+    writer->database = database;
+
+    for (size_t i = 0; i < DB_WRITE_QUEUE_SIZE; i++) {
+        atomic_init(&writer->cells[i].seq, i);
+    }
+    atomic_init(&writer->enqueue_pos, 0);
+    atomic_init(&writer->dequeue_pos, 0);
+
+    if (sem_init(&writer->wakeup, 0, 0) != 0) {
+        return -1;
+    }
+
+    atomic_store(&writer->running, 1);
+    if (pthread_create(&writer->thread, NULL, writer_loop, writer) != 0) {
+        atomic_store(&writer->running, 0);
+        sem_destroy(&writer->wakeup);
+        return -1;
+    }
+    return 0;
+}
+
+void db_writer_stop(db_writer_t *writer) {
+    if (!atomic_load(&writer->running)) return;
+
+    /* New writes go direct from here on - wait out the ones already queueing */
+    atomic_store(&writer->running, 0);
+    while (atomic_load(&writer->producers) > 0) {
+        nanosleep(&(struct timespec){ .tv_nsec = DB_WRITER_FULL_WAIT_US * 1000L }, NULL);
+    }
+    sem_post(&writer->wakeup);
+    pthread_join(writer->thread, NULL);
+
+    /* The writer may have checked the ring just before the last of them landed */
+    while (peek_cell(writer)) {
+        process_batch(writer);
+    }
+    sem_destroy(&writer->wakeup);
+}
+
+int db_writer_save_dm(db_writer_t *writer, const dm_inbox_t *dm) {
+    db_write_cmd_t cmd = { .type = DB_WRITE_SAVE_DM };
+    cmd.data.dm = *dm;
+    return enqueue(writer, &cmd);
+}
+
+int db_writer_log_mod_action(db_writer_t *writer, const mod_action_t *action) {
+    db_write_cmd_t cmd = { .type = DB_WRITE_LOG_MOD_ACTION };
+    cmd.data.mod_action = *action;
+    return enqueue(writer, &cmd);
+}
+
+int db_writer_add_spam_warning(db_writer_t *writer, uint64_t user_id, uint64_t guild_id) {
+    db_write_cmd_t cmd = { .type = DB_WRITE_ADD_SPAM_WARNING };
+    cmd.data.spam.user_id = user_id;
+    cmd.data.spam.guild_id = guild_id;
+    return enqueue(writer, &cmd);
+}
+
+int db_writer_reset_spam_warnings(db_writer_t *writer, uint64_t user_id, uint64_t guild_id) {
+    db_write_cmd_t cmd = { .type = DB_WRITE_RESET_SPAM_WARNINGS };
+    cmd.data.spam.user_id = user_id;
+    cmd.data.spam.guild_id = guild_id;
+    return enqueue(writer, &cmd);
+}
+
+int db_writer_submit_xp(db_writer_t *writer, pending_xp_t *entries, int count,
+                        uint64_t first_generation, uint64_t last_generation,
+                        db_xp_done_fn on_done, void *user_data) {
+    db_write_cmd_t cmd = { .type = DB_WRITE_XP_BATCH };
+    cmd.data.xp.entries = entries;
+    cmd.data.xp.count = count;
+    cmd.data.xp.first_generation = first_generation;
+    cmd.data.xp.last_generation = last_generation;
+    cmd.data.xp.on_done = on_done;
+    cmd.data.xp.user_data = user_data;
+
+    /* The batcher keeps the entries and retries, so don't wait here */
+    int rc = -1;
+    if (producer_enter(writer)) {
+        rc = try_enqueue(writer, &cmd);
+        producer_leave(writer);
+    }
+    if (rc != 0) {
+        atomic_fetch_add_explicit(&writer->dropped, 1, memory_order_relaxed);
+    }
+    return rc;
+}
+
+void db_writer_get_stats(db_writer_t *writer, db_writer_stats_t *stats) {
+    size_t enq = atomic_load_explicit(&writer->enqueue_pos, memory_order_relaxed);
+    size_t deq = atomic_load_explicit(&writer->dequeue_pos, memory_order_relaxed);
+
+    stats->queue_depth = enq > deq ? (uint64_t)(enq - deq) : 0;
+    stats->commands = atomic_load(&writer->commands);
+    stats->dropped = atomic_load(&writer->dropped);
+    stats->waits = atomic_load(&writer->waits);
+    stats->direct = atomic_load(&writer->direct);
+    stats->batches = atomic_load(&writer->batches);
+    stats->failed_batches = atomic_load(&writer->failed_batches);
+    stats->last_commit_us = atomic_load(&writer->last_commit_us);
+    stats->max_commit_us = atomic_load(&writer->max_commit_us);
+    stats->avg_commit_us = stats->batches > 0 ? atomic_load(&writer->total_commit_us) / stats->batches : 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Leaderboard Cache
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "leaderboard.h"
+#include "dense_array.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Caller holds the lock - NULL if the guild isn't cached */
+static leaderboard_entry_t *find_entry(leaderboard_cache_t *cache, uint64_t guild_id) {
+    const uint64_t *idx = u64map_find(&cache->index, guild_id, 0);
+    return idx ? &cache->entries[*idx] : NULL;
+}
+
+/* Caller holds the write lock and has checked the guild isn't cached */
+static void insert_entry(leaderboard_cache_t *cache, const leaderboard_entry_t *entry) {
+    if (dense_array_reserve((void **)&cache->entries, &cache->capacity, cache->count,
+                            sizeof(leaderboard_entry_t)) != 0) {
+        return;
+    }
+    uint64_t *idx = u64map_insert(&cache->index, entry->guild_id, 0, NULL);
+    if (!idx) return;
+
+    *idx = (uint64_t)cache->count;
+    cache->entries[cache->count++] = *entry;
+}
+
+/* Move one member to their new xp and bubble them up - returns 1 if the ranks changed */
+static int update_rank(leaderboard_entry_t *entry, const xp_flush_result_t *r) {
+    int pos = -1;
+
+    for (int i = 0; i < entry->count; i++) {
+        if (entry->top[i].user_id == r->user_id) {
+            pos = i;
+            break;
+        }
+    }
+
+    if (pos < 0) {
+        if (entry->count < LEADERBOARD_TOP_N) {
+            pos = entry->count++;
+        } else if (r->new_xp > entry->top[LEADERBOARD_TOP_N - 1].xp) {
+            pos = LEADERBOARD_TOP_N - 1; /* Pushes the last rank out */
+        } else {
+            return 0;
+        }
+    }
+
+    user_xp_t moved = {
+        .user_id = r->user_id,
+        .guild_id = r->guild_id,
+        .xp = r->new_xp,
+        .level = r->new_level
+    };
+    while (pos > 0 && entry->top[pos - 1].xp < moved.xp) {
+        entry->top[pos] = entry->top[pos - 1];
+        pos--;
+    }
+    entry->top[pos] = moved;
+    return 1;
+}
+
+int leaderboard_init(leaderboard_cache_t *cache) {
+    cache->capacity = LEADERBOARD_INITIAL_CAPACITY;
+    cache->count = 0;
+    cache->entries = malloc(cache->capacity * sizeof(leaderboard_entry_t));
+    atomic_init(&cache->apply_seq, 0);
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->updates, 0);
+    pthread_rwlock_init(&cache->lock, NULL);
+    return cache->entries && u64map_init(&cache->index, LEADERBOARD_INITIAL_CAPACITY) == 0 ? 0 : -1;
+}
+
+void leaderboard_free(leaderboard_cache_t *cache) {
+    u64map_free(&cache->index);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->count = 0;
+    pthread_rwlock_destroy(&cache->lock);
+}
+
+int leaderboard_get(leaderboard_cache_t *cache, yuno_database_t *database, uint64_t guild_id,
+                    user_xp_t *results, int max_results, int *count) {
+    *count = 0;
+    if (max_results > LEADERBOARD_TOP_N) max_results = LEADERBOARD_TOP_N;
+
+    pthread_rwlock_rdlock(&cache->lock);
+    leaderboard_entry_t *entry = find_entry(cache, guild_id);
+    if (entry) {
+        *count = entry->count < max_results ? entry->count : max_results;
+        memcpy(results, entry->top, sizeof(user_xp_t) * (size_t)*count);
+    }
+    pthread_rwlock_unlock(&cache->lock);
+
+    if (entry) {
+        atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+        return 0;
+    }
+    atomic_fetch_add_explicit(&cache->misses, 1, memory_order_relaxed);
+
+    /* Cold guild - read its top ranks straight off the covering index */
+    leaderboard_entry_t loaded = { .guild_id = guild_id };
+    uint64_t seq = atomic_load(&cache->apply_seq);
+    if (db_get_leaderboard(database, guild_id, loaded.top, LEADERBOARD_TOP_N, &loaded.count) != 0) {
+        return -1;
+    }
+
+    *count = loaded.count < max_results ? loaded.count : max_results;
+    memcpy(results, loaded.top, sizeof(user_xp_t) * (size_t)*count);
+
+    /* A flush that landed during the read may be missing from it - don't cache
+     * the snapshot then, the next request loads again */
+    pthread_rwlock_wrlock(&cache->lock);
+    if (atomic_load(&cache->apply_seq) == seq && !find_entry(cache, guild_id)) {
+        insert_entry(cache, &loaded);
+    }
+    pthread_rwlock_unlock(&cache->lock);
+    return 0;
+}
+
+void leaderboard_apply(leaderboard_cache_t *cache, const xp_flush_result_t *results, int count) {
+    uint64_t updates = 0;
+
+    pthread_rwlock_wrlock(&cache->lock);
+    atomic_fetch_add(&cache->apply_seq, 1);
+    for (int i = 0; i < count; i++) {
+        leaderboard_entry_t *entry = find_entry(cache, results[i].guild_id);
+        if (entry) {
+            updates += (uint64_t)update_rank(entry, &results[i]);
+        }
+    }
+    pthread_rwlock_unlock(&cache->lock);
+
+    atomic_fetch_add_explicit(&cache->updates, updates, memory_order_relaxed);
+}
+
+void leaderboard_invalidate(leaderboard_cache_t *cache, uint64_t guild_id) {
+    pthread_rwlock_wrlock(&cache->lock);
+    atomic_fetch_add(&cache->apply_seq, 1);
+
+    const uint64_t *idx = u64map_find(&cache->index, guild_id, 0);
+    if (idx) {
+        /* Swap the last guild into its place */
+        size_t at = (size_t)*idx;
+        u64map_remove(&cache->index, guild_id, 0);
+        size_t last = --cache->count;
+        if (at != last) {
+            cache->entries[at] = cache->entries[last];
+            *u64map_find(&cache->index, cache->entries[at].guild_id, 0) = (uint64_t)at;
+        }
+    }
+    pthread_rwlock_unlock(&cache->lock);
+}
+
+void leaderboard_get_stats(leaderboard_cache_t *cache, uint64_t *hits, uint64_t *misses,
+                           uint64_t *updates, size_t *guilds) {
+    *hits = atomic_load(&cache->hits);
+    *misses = atomic_load(&cache->misses);
+    *updates = atomic_load(&cache->updates);
+    pthread_rwlock_rdlock(&cache->lock);
+    *guilds = cache->count;
+    pthread_rwlock_unlock(&cache->lock);
+}
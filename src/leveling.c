@@ -0,0 +1,39 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Leveling Curve
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "leveling.h"
+#include <math.h>
+
+#define LEVEL_MAX 303700049     /* Highest level whose threshold fits in int64_t */
+
+int level_for_xp(int64_t xp) {
+    if (xp <= 0) return 0;
+
+    /* L^2 <= xp / 100 exactly when 100 * L^2 <= xp, since L^2 is an integer.
+     * A double root is exact up to level 2^23 (about 7e15 XP); past that it
+     * can be one off, and the integer compares settle it for all of int64_t. */
+    int64_t q = xp / LEVEL_XP_FACTOR;
+    int64_t level = (int64_t)sqrt((double)q);
+    level -= level * level > q;
+    level += (level + 1) * (level + 1) <= q;
+    return (int)level;
+}
+
+int64_t level_threshold(int level) {
+    if (level <= 0) return 0;
+    if (level > LEVEL_MAX) return INT64_MAX;
+    return (int64_t)LEVEL_XP_FACTOR * level * level;
+}
+
+int level_progress(int64_t xp, int level) {
+    int64_t next = level_threshold(level < LEVEL_MAX ? level + 1 : LEVEL_MAX);
+    if (xp <= 0) return 0;
+    if (xp >= next) return 100;
+
+    /* Stay clear of xp * 100 overflowing near the top of the range */
+    if (xp <= INT64_MAX / 100) return (int)(xp * 100 / next);
+    return (int)(xp / (next / 100));
+}
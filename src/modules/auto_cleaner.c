@@ -7,35 +7,21 @@
 #include "modules/auto_cleaner.h"
 #include "bot.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-/* Hash function for guild+channel - O(1) lookup */
-static inline uint32_t hash_guild_channel(uint64_t guild_id, uint64_t channel_id) {
-    uint64_t h = guild_id ^ (channel_id * 2654435761ULL);
-    return (uint32_t)(h % CLEANER_HASH_SIZE);
-}
-
 int auto_cleaner_init(auto_cleaner_t *cleaner) {
     memset(cleaner, 0, sizeof(auto_cleaner_t));
-
-    /* Initialize hash table buckets to -1 (empty) */
-    for (int i = 0; i < CLEANER_HASH_SIZE; i++) {
-        cleaner->hash_table[i] = -1;
-    }
-
-    /* Initialize free list */
-    for (int i = 0; i < MAX_AUTO_CLEAN_CHANNELS - 1; i++) {
-        cleaner->delays[i].hash_next = i + 1;
-        cleaner->delays[i].in_use = 0;
-    }
-    cleaner->delays[MAX_AUTO_CLEAN_CHANNELS - 1].hash_next = -1;
-    cleaner->free_head = 0;
-
-    return 0;
+    return u64map_init(&cleaner->index, 64);
 }
 
 void auto_cleaner_cleanup(auto_cleaner_t *cleaner) {
     cleaner->running = 0;
+    free(cleaner->delays);
+    u64map_free(&cleaner->index);
+    cleaner->delays = NULL;
+    cleaner->delay_count = 0;
+    cleaner->delay_capacity = 0;
 }
 
 int auto_cleaner_start(auto_cleaner_t *cleaner) {
@@ -51,41 +37,34 @@ void auto_cleaner_stop(auto_cleaner_t *cleaner) {
 
 /* O(1) lookup using hash table */
 static channel_delay_t *find_delay_entry(auto_cleaner_t *cleaner, uint64_t guild_id, uint64_t channel_id) {
-    uint32_t bucket = hash_guild_channel(guild_id, channel_id);
-    int idx = cleaner->hash_table[bucket];
-
-    while (idx >= 0) {
-        channel_delay_t *entry = &cleaner->delays[idx];
-        if (entry->in_use && entry->guild_id == guild_id && entry->channel_id == channel_id) {
-            return entry;
-        }
-        idx = entry->hash_next;
-    }
-    return NULL;
+    const uint64_t *idx = u64map_find(&cleaner->index, guild_id, channel_id);
+    return idx ? &cleaner->delays[*idx] : NULL;
 }
 
-/* Allocate new entry from free list */
+/* Allocate new entry, growing the array as needed */
 static channel_delay_t *alloc_delay_entry(auto_cleaner_t *cleaner, uint64_t guild_id, uint64_t channel_id) {
-    if (cleaner->free_head < 0) {
-        return NULL; /* No space */
+    if (cleaner->delay_count == cleaner->delay_capacity) {
+        int capacity = cleaner->delay_capacity ? cleaner->delay_capacity * 2 : 16;
+        channel_delay_t *delays = realloc(cleaner->delays, sizeof(channel_delay_t) * capacity);
+        if (!delays) {
+            return NULL; /* No space */
+        }
+        cleaner->delays = delays;
+        cleaner->delay_capacity = capacity;
     }
 
-    int idx = cleaner->free_head;
-    channel_delay_t *entry = &cleaner->delays[idx];
-    cleaner->free_head = entry->hash_next;
+    uint64_t *idx = u64map_insert(&cleaner->index, guild_id, channel_id, NULL);
+    if (!idx) {
+        return NULL;
+    }
+    *idx = (uint64_t)cleaner->delay_count;
 
     /* Initialize entry */
+    channel_delay_t *entry = &cleaner->delays[cleaner->delay_count++];
     entry->guild_id = guild_id;
     entry->channel_id = channel_id;
     entry->delay_count = 0;
     entry->delayed_until = 0;
-    entry->in_use = 1;
-
-    /* Add to hash table */
-    uint32_t bucket = hash_guild_channel(guild_id, channel_id);
-    entry->hash_next = cleaner->hash_table[bucket];
-    cleaner->hash_table[bucket] = idx;
-    cleaner->delay_count++;
 
     return entry;
 }
@@ -0,0 +1,268 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Guild Roles Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "modules/guild_roles.h"
+#include "bot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static guild_roles_t g_guild_roles;
+static yuno_bot_t *g_guild_roles_bot = NULL;
+
+static uint64_t parse_permissions(const char *text) {
+    return text ? strtoull(text, NULL, 10) : 0;
+}
+
+/* ---- Guilds - every helper below expects g_guild_roles.lock held ---- */
+
+static guild_roles_guild_t *guild_find(uint64_t guild_id) {
+    const uint64_t *idx = u64map_find(&g_guild_roles.index, guild_id, 0);
+    return idx ? &g_guild_roles.guilds[*idx] : NULL;
+}
+
+static guild_roles_guild_t *guild_get(uint64_t guild_id) {
+    guild_roles_guild_t *guild = guild_find(guild_id);
+    if (guild) return guild;
+
+    if (g_guild_roles.guild_count == g_guild_roles.guild_capacity) {
+        size_t capacity = g_guild_roles.guild_capacity ? g_guild_roles.guild_capacity * 2 : 64;
+        guild_roles_guild_t *grown = realloc(g_guild_roles.guilds, capacity * sizeof(guild_roles_guild_t));
+        if (!grown) return NULL;
+        g_guild_roles.guilds = grown;
+        g_guild_roles.guild_capacity = capacity;
+    }
+
+    uint64_t *value = u64map_insert(&g_guild_roles.index, guild_id, 0, NULL);
+    if (!value) return NULL;
+    *value = (uint64_t)g_guild_roles.guild_count;
+
+    guild = &g_guild_roles.guilds[g_guild_roles.guild_count++];
+    memset(guild, 0, sizeof(guild_roles_guild_t));
+    guild->guild_id = guild_id;
+    return guild;
+}
+
+static void guild_free(guild_roles_guild_t *guild) {
+    free(guild->roles);
+    free(guild->bot_roles);
+}
+
+static guild_role_t *role_find(guild_roles_guild_t *guild, uint64_t role_id) {
+    for (size_t i = 0; i < guild->role_count; i++) {
+        if (guild->roles[i].role_id == role_id) return &guild->roles[i];
+    }
+    return NULL;
+}
+
+static void role_put(guild_roles_guild_t *guild, const struct discord_role *role) {
+    guild_role_t *slot = role_find(guild, role->id);
+    if (!slot) {
+        if (guild->role_count == guild->role_capacity) {
+            size_t capacity = guild->role_capacity ? guild->role_capacity * 2 : 16;
+            guild_role_t *grown = realloc(guild->roles, capacity * sizeof(guild_role_t));
+            if (!grown) return;
+            guild->roles = grown;
+            guild->role_capacity = capacity;
+        }
+        slot = &guild->roles[guild->role_count++];
+        slot->role_id = role->id;
+    }
+    slot->permissions = parse_permissions(role->permissions);
+    slot->position = role->position;
+}
+
+static void bot_roles_set(guild_roles_guild_t *guild, const struct snowflakes *roles) {
+    size_t count = roles ? (size_t)roles->size : 0;
+    uint64_t *copy = NULL;
+
+    if (count > 0) {
+        copy = malloc(count * sizeof(uint64_t));
+        if (!copy) return;
+        memcpy(copy, roles->array, count * sizeof(uint64_t));
+    }
+    free(guild->bot_roles);
+    guild->bot_roles = copy;
+    guild->bot_role_count = count;
+}
+
+/* ---- Lifecycle ---- */
+
+int guild_roles_init(yuno_bot_t *bot) {
+    memset(&g_guild_roles, 0, sizeof(g_guild_roles));
+    if (u64map_init(&g_guild_roles.index, 64) != 0) {
+        return -1;
+    }
+    pthread_mutex_init(&g_guild_roles.lock, NULL);
+    g_guild_roles_bot = bot;
+    return 0;
+}
+
+void guild_roles_cleanup(void) {
+    if (!g_guild_roles_bot) return;
+
+    for (size_t i = 0; i < g_guild_roles.guild_count; i++) {
+        guild_free(&g_guild_roles.guilds[i]);
+    }
+    free(g_guild_roles.guilds);
+    u64map_free(&g_guild_roles.index);
+    pthread_mutex_destroy(&g_guild_roles.lock);
+    g_guild_roles_bot = NULL;
+}
+
+/* ---- Events ---- */
+
+void guild_roles_on_ready(const struct discord_ready *event) {
+    if (!g_guild_roles_bot || !event->user) return;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    g_guild_roles.self_id = event->user->id;
+    pthread_mutex_unlock(&g_guild_roles.lock);
+}
+
+void guild_roles_on_guild(const struct discord_guild *guild) {
+    if (!g_guild_roles_bot) return;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    guild_roles_guild_t *cached = guild_get(guild->id);
+    if (cached) {
+        cached->owner_id = guild->owner_id;
+
+        /* Both events carry the full role list - start over so deleted roles go */
+        cached->role_count = 0;
+        for (int i = 0; guild->roles && i < guild->roles->size; i++) {
+            role_put(cached, &guild->roles->array[i]);
+        }
+
+        /* Only guild create lists members, and the bot is always among them */
+        for (int i = 0; guild->members && i < guild->members->size; i++) {
+            const struct discord_guild_member *member = &guild->members->array[i];
+            if (member->user && member->user->id == g_guild_roles.self_id) {
+                bot_roles_set(cached, member->roles);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+}
+
+void guild_roles_on_guild_delete(const struct discord_guild *guild) {
+    if (!g_guild_roles_bot) return;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    const uint64_t *idx = u64map_find(&g_guild_roles.index, guild->id, 0);
+    if (idx) {
+        size_t at = (size_t)*idx;
+        guild_free(&g_guild_roles.guilds[at]);
+        u64map_remove(&g_guild_roles.index, guild->id, 0);
+
+        size_t last = --g_guild_roles.guild_count;
+        if (at != last) {
+            g_guild_roles.guilds[at] = g_guild_roles.guilds[last];
+            *u64map_find(&g_guild_roles.index, g_guild_roles.guilds[at].guild_id, 0) = (uint64_t)at;
+        }
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+}
+
+void guild_roles_on_role(uint64_t guild_id, const struct discord_role *role) {
+    if (!g_guild_roles_bot || !role) return;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    guild_roles_guild_t *guild = guild_find(guild_id);
+    if (guild) role_put(guild, role);
+    pthread_mutex_unlock(&g_guild_roles.lock);
+}
+
+void guild_roles_on_role_delete(uint64_t guild_id, uint64_t role_id) {
+    if (!g_guild_roles_bot) return;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    guild_roles_guild_t *guild = guild_find(guild_id);
+    guild_role_t *role = guild ? role_find(guild, role_id) : NULL;
+    if (role) {
+        *role = guild->roles[--guild->role_count];
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+}
+
+/* Other members' updates don't matter - their roles come with each command */
+void guild_roles_on_member_update(uint64_t guild_id, uint64_t user_id, const struct snowflakes *roles) {
+    if (!g_guild_roles_bot) return;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    if (user_id == g_guild_roles.self_id) {
+        guild_roles_guild_t *guild = guild_find(guild_id);
+        if (guild) bot_roles_set(guild, roles);
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+}
+
+/* ---- Queries ---- */
+
+uint64_t guild_roles_permissions(uint64_t guild_id, uint64_t user_id, const struct snowflakes *roles) {
+    uint64_t permissions = 0;
+    if (!g_guild_roles_bot) return 0;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    guild_roles_guild_t *guild = guild_find(guild_id);
+    if (guild) {
+        if (guild->owner_id == user_id) {
+            permissions = UINT64_MAX;
+        } else {
+            /* @everyone shares the guild's id */
+            const guild_role_t *everyone = role_find(guild, guild_id);
+            if (everyone) permissions = everyone->permissions;
+            for (int i = 0; roles && i < roles->size; i++) {
+                const guild_role_t *role = role_find(guild, roles->array[i]);
+                if (role) permissions |= role->permissions;
+            }
+            if (permissions & GUILD_PERM_ADMINISTRATOR) permissions = UINT64_MAX;
+        }
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+    return permissions;
+}
+
+/* Position of the highest of roles - @everyone sits at 0 */
+static int top_position(guild_roles_guild_t *guild, const uint64_t *roles, size_t count) {
+    int top = 0;
+    for (size_t i = 0; i < count; i++) {
+        const guild_role_t *held = role_find(guild, roles[i]);
+        if (held && held->position > top) top = held->position;
+    }
+    return top;
+}
+
+int guild_roles_bot_outranks(uint64_t guild_id, uint64_t role_id) {
+    int result = -1;
+    if (!g_guild_roles_bot) return -1;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    guild_roles_guild_t *guild = guild_find(guild_id);
+    const guild_role_t *role = guild ? role_find(guild, role_id) : NULL;
+    if (role) {
+        result = role->position < top_position(guild, guild->bot_roles, guild->bot_role_count);
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+    return result;
+}
+
+int guild_roles_member_outranks(uint64_t guild_id, uint64_t user_id, const struct snowflakes *roles,
+                                uint64_t role_id) {
+    int result = -1;
+    if (!g_guild_roles_bot) return -1;
+
+    pthread_mutex_lock(&g_guild_roles.lock);
+    guild_roles_guild_t *guild = guild_find(guild_id);
+    const guild_role_t *role = guild ? role_find(guild, role_id) : NULL;
+    if (role) {
+        result = guild->owner_id == user_id ||
+                 role->position < top_position(guild, roles ? roles->array : NULL, roles ? (size_t)roles->size : 0);
+    }
+    pthread_mutex_unlock(&g_guild_roles.lock);
+    return result;
+}
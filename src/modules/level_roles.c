@@ -0,0 +1,502 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Level Role Rewards Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "modules/level_roles.h"
+#include "bot.h"
+#include "dense_array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+static level_roles_t g_roles;
+static yuno_bot_t *g_roles_bot = NULL;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* GCRA - a bucket may send while its theoretical arrival time is less than
+ * a burst ahead of now, and each send pushes it one interval further */
+static inline int bucket_ready(uint64_t next_ms, uint64_t now, uint64_t interval, uint64_t burst) {
+    return next_ms <= now + (burst - 1) * interval;
+}
+
+static inline void bucket_take(uint64_t *next_ms, uint64_t now, uint64_t interval) {
+    *next_ms = (*next_ms > now ? *next_ms : now) + interval;
+}
+
+/* ---- guild_id -> index - every helper below expects g_roles.lock held ---- */
+
+static int32_t guild_find(uint64_t guild_id) {
+    const uint64_t *idx = u64map_find(&g_roles.guild_index, guild_id, 0);
+    return idx ? (int32_t)*idx : -1;
+}
+
+/* Guilds are never dropped, so indices stay put once handed out */
+static int32_t guild_get(uint64_t guild_id, int create) {
+    int32_t idx = guild_find(guild_id);
+    if (idx >= 0 || !create) return idx;
+
+    if (dense_array_reserve((void **)&g_roles.guilds, &g_roles.guild_capacity, g_roles.guild_count,
+                            sizeof(level_roles_guild_t)) != 0) {
+        return -1;
+    }
+    uint64_t *slot = u64map_insert(&g_roles.guild_index, guild_id, 0, NULL);
+    if (!slot) return -1;
+
+    idx = (int32_t)g_roles.guild_count++;
+    *slot = (uint64_t)idx;
+    g_roles.guilds[idx] = (level_roles_guild_t){ .guild_id = guild_id };
+    return idx;
+}
+
+static void resync_finish(level_roles_guild_t *guild) {
+    if (guild->resync) g_roles.resyncing--;
+    free(guild->resync_users);
+    free(guild->resync_levels);
+    guild->resync_users = NULL;
+    guild->resync_levels = NULL;
+    guild->resync_count = 0;
+    guild->resync_loaded = 0;
+    guild->resync_after = 0;
+    guild->resync = 0;
+}
+
+/* ---- Pending changes - (user, role) -> remove flag of the newest change.
+ * Role ids are unique across guilds, so the guild needn't be part of the key. ---- */
+
+/* Queue a change unless one for the same member and role is already waiting.
+ * Level-ups override the waiting change; a resync's view may be older. */
+static void enqueue(level_roles_guild_t *guild, uint64_t user_id, uint64_t role_id, int remove, int override) {
+    uint64_t *waiting = u64map_find(&g_roles.pending, user_id, role_id);
+    if (waiting) {
+        if (override) *waiting = (uint64_t)remove;
+        g_roles.deduped++;
+        return;
+    }
+
+    if (guild->queued == guild->queue_capacity) {
+        size_t capacity = guild->queue_capacity ? guild->queue_capacity * 2 : 64;
+        role_ref_t *queue = malloc(sizeof(role_ref_t) * capacity);
+        if (!queue) return;
+        for (size_t i = 0; i < guild->queued; i++) {
+            queue[i] = guild->queue[(guild->head + i) % guild->queue_capacity];
+        }
+        free(guild->queue);
+        guild->queue = queue;
+        guild->queue_capacity = capacity;
+        guild->head = 0;
+    }
+
+    uint64_t *change = u64map_insert(&g_roles.pending, user_id, role_id, NULL);
+    if (!change) return;
+    *change = (uint64_t)remove;
+
+    guild->queue[(guild->head + guild->queued) % guild->queue_capacity] = (role_ref_t){ user_id, role_id };
+    guild->queued++;
+}
+
+/* Load a guild's rewards from the database - drops the lock while reading.
+ * Returns the guild's index once its rewards are current, -1 on error. */
+static int32_t load_rewards(uint64_t guild_id) {
+    for (;;) {
+        int32_t idx = guild_get(guild_id, 1);
+        if (idx < 0) return -1;
+        if (g_roles.guilds[idx].loaded) return idx;
+
+        uint32_t generation = g_roles.guilds[idx].generation;
+        level_role_t *rewards;
+        size_t count;
+
+        pthread_mutex_unlock(&g_roles.lock);
+        int rc = db_get_level_roles(&g_roles_bot->database, guild_id, &rewards, &count);
+        pthread_mutex_lock(&g_roles.lock);
+        if (rc != 0) return -1;
+
+        level_roles_guild_t *guild = &g_roles.guilds[guild_find(guild_id)];
+        if (guild->generation != generation) {
+            /* Changed while we were reading - go again */
+            free(rewards);
+            continue;
+        }
+        free(guild->rewards);
+        guild->rewards = rewards;
+        guild->reward_count = count;
+        guild->loaded = 1;
+        return guild_find(guild_id);
+    }
+}
+
+/* ---- Level-ups ---- */
+
+/* Grant every reward in (old_level, new_level] */
+static void grant_range(level_roles_guild_t *guild, uint64_t user_id, int old_level, int new_level) {
+    size_t lo = 0, hi = guild->reward_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (guild->rewards[mid].level <= old_level) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t i = lo; i < guild->reward_count && guild->rewards[i].level <= new_level; i++) {
+        enqueue(guild, user_id, guild->rewards[i].role_id, 0, 1);
+    }
+}
+
+static void resolve_ups(void) {
+    while (g_roles.up_count > 0) {
+        level_roles_up_t *ups = g_roles.ups;
+        size_t count = g_roles.up_count;
+        g_roles.ups = NULL;
+        g_roles.up_count = 0;
+        g_roles.up_capacity = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            int32_t idx = load_rewards(ups[i].guild_id);
+            if (idx < 0) continue;
+            grant_range(&g_roles.guilds[idx], ups[i].user_id, ups[i].old_level, ups[i].new_level);
+        }
+        free(ups);
+    }
+}
+
+void level_roles_on_flushed(const xp_flush_result_t *results, int count) {
+    if (!g_roles_bot) return;
+    int queued = 0;
+
+    pthread_mutex_lock(&g_roles.lock);
+    for (int i = 0; i < count; i++) {
+        if (results[i].new_level <= results[i].old_level) continue;
+
+        /* Guilds known to have no rewards never reach the role thread */
+        int32_t idx = guild_find(results[i].guild_id);
+        if (idx >= 0 && g_roles.guilds[idx].loaded && g_roles.guilds[idx].reward_count == 0) continue;
+
+        if (dense_array_reserve((void **)&g_roles.ups, &g_roles.up_capacity, g_roles.up_count,
+                                sizeof(level_roles_up_t)) != 0) {
+            break;
+        }
+        g_roles.ups[g_roles.up_count++] = (level_roles_up_t){
+            .guild_id = results[i].guild_id,
+            .user_id = results[i].user_id,
+            .old_level = results[i].old_level,
+            .new_level = results[i].new_level,
+        };
+        queued++;
+    }
+    if (queued) pthread_cond_signal(&g_roles.wakeup);
+    pthread_mutex_unlock(&g_roles.lock);
+}
+
+/* ---- Resync ---- */
+
+void level_roles_resync(uint64_t guild_id) {
+    if (!g_roles_bot) return;
+
+    pthread_mutex_lock(&g_roles.lock);
+    int32_t idx = guild_get(guild_id, 1);
+    if (idx >= 0) {
+        level_roles_guild_t *guild = &g_roles.guilds[idx];
+        resync_finish(guild);
+        guild->generation++;
+        guild->loaded = 0;
+        guild->resync = 1;
+        g_roles.resyncing++;
+        g_roles.resyncs++;
+        pthread_cond_signal(&g_roles.wakeup);
+    }
+    pthread_mutex_unlock(&g_roles.lock);
+}
+
+static int member_level(const level_roles_guild_t *guild, uint64_t user_id) {
+    size_t lo = 0, hi = guild->resync_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (guild->resync_users[mid] < user_id) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < guild->resync_count && guild->resync_users[lo] == user_id ? guild->resync_levels[lo] : -1;
+}
+
+static int member_has_role(const struct discord_guild_member *member, uint64_t role_id) {
+    for (int i = 0; member->roles && i < member->roles->size; i++) {
+        if (member->roles->array[i] == role_id) return 1;
+    }
+    return 0;
+}
+
+/* Queue only the differences between what a page of members holds and what
+ * their levels earn them. A role on several levels goes by its lowest. */
+static void reconcile_page(level_roles_guild_t *guild, const struct discord_guild_members *members) {
+    for (int i = 0; i < members->size; i++) {
+        const struct discord_guild_member *member = &members->array[i];
+        if (!member->user) continue;
+        guild->resync_after = member->user->id;
+        if (member->user->bot) continue;
+
+        int level = member_level(guild, member->user->id);
+        for (size_t r = 0; r < guild->reward_count; r++) {
+            uint64_t role_id = guild->rewards[r].role_id;
+            size_t first = 0;
+            while (guild->rewards[first].role_id != role_id) first++;
+            if (first != r) continue;
+
+            int want = level >= guild->rewards[r].level;
+            if (want != member_has_role(member, role_id)) {
+                enqueue(guild, member->user->id, role_id, !want, 0);
+            }
+        }
+    }
+}
+
+/* Fetch and reconcile one page of members for the first guild awaiting a
+ * resync. Pages spend the guild's budget like any other change. */
+static void resync_step(uint64_t now) {
+    int32_t idx = -1;
+    for (size_t i = 0; i < g_roles.guild_count; i++) {
+        if (g_roles.guilds[i].resync) {
+            idx = (int32_t)i;
+            break;
+        }
+    }
+    if (idx < 0) return;
+
+    uint64_t guild_id = g_roles.guilds[idx].guild_id;
+    if (!bucket_ready(g_roles.guilds[idx].next_ms, now, LEVEL_ROLES_GUILD_INTERVAL_MS, LEVEL_ROLES_GUILD_BURST) ||
+        !bucket_ready(g_roles.global_next_ms, now, LEVEL_ROLES_GLOBAL_INTERVAL_MS, LEVEL_ROLES_GLOBAL_BURST)) {
+        return;
+    }
+
+    idx = load_rewards(guild_id);
+    if (idx < 0) return;
+    level_roles_guild_t *guild = &g_roles.guilds[idx];
+    uint32_t generation = guild->generation;
+
+    if (!guild->resync) return;
+    if (guild->reward_count == 0) {
+        resync_finish(guild);
+        return;
+    }
+
+    if (!guild->resync_loaded) {
+        uint64_t *users;
+        int *levels;
+        size_t count;
+        int min_level = guild->rewards[0].level;
+
+        pthread_mutex_unlock(&g_roles.lock);
+        int rc = db_get_member_levels(&g_roles_bot->database, guild_id, min_level, &users, &levels, &count);
+        pthread_mutex_lock(&g_roles.lock);
+
+        guild = &g_roles.guilds[guild_find(guild_id)];
+        if (rc != 0) {
+            fprintf(stderr, "💔 Level role resync of guild %lu couldn't read levels\n", (unsigned long)guild_id);
+            if (guild->generation == generation) resync_finish(guild);
+            return;
+        }
+        if (guild->generation != generation || !guild->resync) {
+            free(users);
+            free(levels);
+            return;
+        }
+        guild->resync_users = users;
+        guild->resync_levels = levels;
+        guild->resync_count = count;
+        guild->resync_loaded = 1;
+    }
+
+    uint64_t after = guild->resync_after;
+    bucket_take(&guild->next_ms, now, LEVEL_ROLES_GUILD_INTERVAL_MS);
+    bucket_take(&g_roles.global_next_ms, now, LEVEL_ROLES_GLOBAL_INTERVAL_MS);
+    g_roles.pages++;
+
+    struct discord_guild_members members = { 0 };
+    pthread_mutex_unlock(&g_roles.lock);
+    CCORDcode code = discord_list_guild_members(g_roles_bot->client, guild_id,
+        &(struct discord_list_guild_members){ .limit = LEVEL_ROLES_PAGE_SIZE, .after = after },
+        &(struct discord_ret_guild_members){ .sync = &members });
+    pthread_mutex_lock(&g_roles.lock);
+
+    guild = &g_roles.guilds[guild_find(guild_id)];
+    if (code != CCORD_OK) {
+        fprintf(stderr, "💔 Level role resync of guild %lu failed listing members (%d)\n",
+                (unsigned long)guild_id, (int)code);
+        if (guild->generation == generation) resync_finish(guild);
+        return;
+    }
+
+    if (guild->generation == generation && guild->resync) {
+        reconcile_page(guild, &members);
+        if (members.size < LEVEL_ROLES_PAGE_SIZE) {
+            resync_finish(guild);
+        }
+    }
+    discord_guild_members_cleanup(&members);
+}
+
+/* ---- Drain ---- */
+
+/* Send what the buckets allow, taking guilds in turn so one guild's resync
+ * can't starve another's level-ups */
+static void drain(uint64_t now) {
+    role_change_t batch[LEVEL_ROLES_SEND_BATCH];
+    size_t n = 0;
+
+    while (n < LEVEL_ROLES_SEND_BATCH && u64map_count(&g_roles.pending) > 0 &&
+           bucket_ready(g_roles.global_next_ms, now, LEVEL_ROLES_GLOBAL_INTERVAL_MS, LEVEL_ROLES_GLOBAL_BURST)) {
+        level_roles_guild_t *guild = NULL;
+        for (size_t tried = 0; tried < g_roles.guild_count; tried++) {
+            level_roles_guild_t *g = &g_roles.guilds[g_roles.cursor++ % g_roles.guild_count];
+            if (g->queued > 0 &&
+                bucket_ready(g->next_ms, now, LEVEL_ROLES_GUILD_INTERVAL_MS, LEVEL_ROLES_GUILD_BURST)) {
+                guild = g;
+                break;
+            }
+        }
+        if (!guild) break;
+
+        role_ref_t ref = guild->queue[guild->head];
+        guild->head = (guild->head + 1) % guild->queue_capacity;
+        guild->queued--;
+
+        const uint64_t *change = u64map_find(&g_roles.pending, ref.user_id, ref.role_id);
+        if (!change) continue;
+        batch[n++] = (role_change_t){
+            .guild_id = guild->guild_id, .user_id = ref.user_id, .role_id = ref.role_id,
+            .remove = (uint8_t)*change
+        };
+        u64map_remove(&g_roles.pending, ref.user_id, ref.role_id);
+
+        bucket_take(&guild->next_ms, now, LEVEL_ROLES_GUILD_INTERVAL_MS);
+        bucket_take(&g_roles.global_next_ms, now, LEVEL_ROLES_GLOBAL_INTERVAL_MS);
+    }
+    if (n == 0) return;
+
+    uint64_t granted = 0, removed = 0, failed = 0;
+    pthread_mutex_unlock(&g_roles.lock);
+    for (size_t i = 0; i < n; i++) {
+        const role_change_t *c = &batch[i];
+        CCORDcode code = c->remove
+            ? discord_remove_guild_member_role(g_roles_bot->client, c->guild_id, c->user_id, c->role_id, NULL, NULL)
+            : discord_add_guild_member_role(g_roles_bot->client, c->guild_id, c->user_id, c->role_id, NULL, NULL);
+        if (code != CCORD_OK) failed++;
+        else if (c->remove) removed++;
+        else granted++;
+    }
+    pthread_mutex_lock(&g_roles.lock);
+    g_roles.granted += granted;
+    g_roles.removed += removed;
+    g_roles.failed += failed;
+}
+
+/* ---- Lifecycle ---- */
+
+int level_roles_init(yuno_bot_t *bot) {
+    memset(&g_roles, 0, sizeof(level_roles_t));
+
+    if (u64map_init(&g_roles.guild_index, LEVEL_ROLES_INDEX_INITIAL_CAPACITY) != 0 ||
+        u64map_init(&g_roles.pending, LEVEL_ROLES_INDEX_INITIAL_CAPACITY) != 0) {
+        level_roles_cleanup();
+        return -1;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_roles.wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&g_roles.lock, NULL);
+    g_roles_bot = bot;
+    return 0;
+}
+
+void level_roles_cleanup(void) {
+    for (size_t i = 0; i < g_roles.guild_count; i++) {
+        level_roles_guild_t *guild = &g_roles.guilds[i];
+        free(guild->rewards);
+        free(guild->queue);
+        free(guild->resync_users);
+        free(guild->resync_levels);
+    }
+    free(g_roles.guilds);
+    u64map_free(&g_roles.guild_index);
+    u64map_free(&g_roles.pending);
+    free(g_roles.ups);
+    g_roles.guilds = NULL;
+    g_roles.ups = NULL;
+    g_roles.guild_count = g_roles.guild_capacity = 0;
+    g_roles.up_count = g_roles.up_capacity = 0;
+    g_roles.resyncing = 0;
+    g_roles_bot = NULL;
+}
+
+static void *level_roles_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_roles.lock);
+    while (g_roles.running) {
+        if (g_roles.up_count == 0 && u64map_count(&g_roles.pending) == 0 && g_roles.resyncing == 0) {
+            pthread_cond_wait(&g_roles.wakeup, &g_roles.lock);
+        } else {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_nsec += LEVEL_ROLES_POLL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            while (g_roles.running &&
+                   pthread_cond_timedwait(&g_roles.wakeup, &g_roles.lock, &deadline) != ETIMEDOUT) {
+            }
+        }
+        if (!g_roles.running) break;
+
+        resolve_ups();
+        resync_step(now_ms());
+        drain(now_ms());
+    }
+    pthread_mutex_unlock(&g_roles.lock);
+    return NULL;
+}
+
+int level_roles_start(void) {
+    g_roles.running = 1;
+    if (pthread_create(&g_roles.thread, NULL, level_roles_thread, NULL) != 0) {
+        g_roles.running = 0;
+        return -1;
+    }
+    printf("🎀 Level role rewards started~\n");
+    return 0;
+}
+
+void level_roles_stop(void) {
+    pthread_mutex_lock(&g_roles.lock);
+    if (!g_roles.running) {
+        pthread_mutex_unlock(&g_roles.lock);
+        return;
+    }
+    g_roles.running = 0;
+    pthread_cond_signal(&g_roles.wakeup);
+    pthread_mutex_unlock(&g_roles.lock);
+
+    pthread_join(g_roles.thread, NULL);
+}
+
+void level_roles_get_stats(level_roles_stats_t *stats) {
+    pthread_mutex_lock(&g_roles.lock);
+    stats->guilds = g_roles.guild_count;
+    stats->queued = u64map_count(&g_roles.pending);
+    stats->granted = g_roles.granted;
+    stats->removed = g_roles.removed;
+    stats->deduped = g_roles.deduped;
+    stats->failed = g_roles.failed;
+    stats->resyncs = g_roles.resyncs;
+    stats->pages = g_roles.pages;
+    pthread_mutex_unlock(&g_roles.lock);
+}
@@ -0,0 +1,567 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Raid Guard Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "modules/raid_guard.h"
+#include "bot.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#define DISCORD_EPOCH_MS 1420070400000ULL
+
+static raid_guard_t g_guard;
+static yuno_bot_t *g_guard_bot = NULL;
+
+static const uint32_t g_limits[RAID_SIGNALS][RATE_RESOLUTIONS] = {
+    RAID_JOIN_LIMITS,
+    RAID_NEW_ACCOUNT_LIMITS,
+    RAID_MENTION_LIMITS,
+};
+static const char *g_signal_names[RAID_SIGNALS] = { "joins", "messages from new accounts", "mentions" };
+static const int g_window_seconds[RATE_RESOLUTIONS] = { 1, 10, 60 };
+
+/* What tripped a lockdown, printed once the lock is dropped */
+typedef struct {
+    int started;
+    int signal;
+    int resolution;
+    uint32_t count;
+} raid_trip_t;
+
+/* A channel change made with the lock dropped */
+typedef struct {
+    int guild;
+    uint64_t guild_id;
+    uint64_t channel_id;
+    int slow;                   /* Or restore */
+    int32_t restore;            /* Rate limit to put back, or the one found when slowing */
+    int changed;
+    int ok;
+} raid_task_t;
+
+static uint32_t now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+static int is_new_account(uint64_t user_id) {
+    uint64_t created_ms = (user_id >> 22) + DISCORD_EPOCH_MS;
+    uint64_t now_ms = (uint64_t)time(NULL) * 1000;
+    return now_ms < created_ms + (uint64_t)RAID_GUARD_NEW_ACCOUNT_DAYS * 86400 * 1000;
+}
+
+/* ---- Guilds - every helper below expects g_guard.lock held ---- */
+
+/* Evictable guilds are kept most recently active first, so the one to
+ * reuse is always the tail */
+static void lru_unlink(int i) {
+    raid_guard_guild_t *guild = &g_guard.guilds[i];
+    if (guild->lru_prev >= 0) g_guard.guilds[guild->lru_prev].lru_next = guild->lru_next;
+    else g_guard.lru_head = guild->lru_next;
+    if (guild->lru_next >= 0) g_guard.guilds[guild->lru_next].lru_prev = guild->lru_prev;
+    else g_guard.lru_tail = guild->lru_prev;
+    guild->listed = 0;
+}
+
+static void lru_push(int i) {
+    raid_guard_guild_t *guild = &g_guard.guilds[i];
+    guild->lru_prev = -1;
+    guild->lru_next = g_guard.lru_head;
+    if (g_guard.lru_head >= 0) g_guard.guilds[g_guard.lru_head].lru_prev = i;
+    else g_guard.lru_tail = i;
+    g_guard.lru_head = i;
+    guild->listed = 1;
+}
+
+/* Take a guild off the list while a lockdown or its channels pin it, and
+ * put it back once nothing does */
+static void lru_settle(raid_guard_guild_t *guild) {
+    int i = (int)(guild - g_guard.guilds);
+    int evictable = !guild->locked && !guild->held;
+    if (evictable && !guild->listed) lru_push(i);
+    else if (!evictable && guild->listed) lru_unlink(i);
+}
+
+/* The guild's record. Once the table is full the least recently active
+ * guild that isn't in a lockdown gives up its record - after a quiet minute
+ * its rates are all zero anyway. */
+static raid_guard_guild_t *get_guild(uint64_t guild_id, uint32_t now) {
+    const uint64_t *idx = u64map_find(&g_guard.index, guild_id, 0);
+    if (idx) {
+        int i = (int)*idx;
+        if (g_guard.guilds[i].listed && g_guard.lru_head != i) {
+            lru_unlink(i);
+            lru_push(i);
+        }
+        return &g_guard.guilds[i];
+    }
+
+    int slot;
+    if (g_guard.guild_count < RAID_GUARD_MAX_GUILDS) {
+        slot = g_guard.guild_count++;
+    } else {
+        slot = g_guard.lru_tail;
+        if (slot < 0) {
+            g_guard.untracked++;
+            return NULL;
+        }
+        lru_unlink(slot);
+        u64map_remove(&g_guard.index, g_guard.guilds[slot].guild_id, 0);
+    }
+
+    /* Sized at init to hold every guild, so this never allocates */
+    uint64_t *value = u64map_insert(&g_guard.index, guild_id, 0, NULL);
+    if (!value) {
+        g_guard.untracked++;
+        return NULL;
+    }
+    *value = (uint64_t)slot;
+
+    raid_guard_guild_t *guild = &g_guard.guilds[slot];
+    memset(guild, 0, sizeof(raid_guard_guild_t));
+    guild->guild_id = guild_id;
+    guild->lock_slot = -1;
+    for (int s = 0; s < RAID_SIGNALS; s++) {
+        rate_window_reset(&guild->rates[s], now);
+    }
+    lru_push(slot);
+    return guild;
+}
+
+/* ---- Lockdowns readable without the lock - writers hold it ---- */
+
+static size_t lock_home(uint64_t guild_id) {
+    return (size_t)((guild_id * 0x9E3779B97F4A7C15ULL) >> 32) & (RAID_GUARD_LOCK_SLOTS - 1);
+}
+
+static void lock_slot_write(raid_lock_slot_t *slot, uint64_t guild_id, uint32_t until) {
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&slot->guild_id, guild_id, memory_order_relaxed);
+    atomic_store_explicit(&slot->until, until, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+/* Publish when the guild's lockdown ends - a free slot near its home, or
+ * none, in which case raid_guard_locked falls back to the lock */
+static void publish_lockdown(raid_guard_guild_t *guild) {
+    if (guild->lock_slot < 0) {
+        size_t home = lock_home(guild->guild_id);
+        for (int p = 0; p < RAID_GUARD_LOCK_PROBES; p++) {
+            size_t i = (home + (size_t)p) & (RAID_GUARD_LOCK_SLOTS - 1);
+            /* Expired but not yet lifted still belongs to its guild */
+            if (atomic_load_explicit(&g_guard.locks[i].until, memory_order_relaxed) == 0) {
+                guild->lock_slot = (int16_t)i;
+                break;
+            }
+        }
+        if (guild->lock_slot < 0) {
+            atomic_fetch_add(&g_guard.lock_overflow, 1);
+            return;
+        }
+    }
+    lock_slot_write(&g_guard.locks[guild->lock_slot], guild->guild_id, guild->until);
+}
+
+static void retract_lockdown(raid_guard_guild_t *guild) {
+    if (guild->lock_slot < 0) {
+        atomic_fetch_sub(&g_guard.lock_overflow, 1);
+        return;
+    }
+    lock_slot_write(&g_guard.locks[guild->lock_slot], guild->guild_id, 0);
+    guild->lock_slot = -1;
+}
+
+static void slow_channel(raid_guard_guild_t *guild, raid_channel_t *channel) {
+    if (g_guard.slowmode_seconds <= 0 || channel->state != RAID_CHANNEL_IDLE) return;
+    channel->state = RAID_CHANNEL_SLOW;
+    guild->held++;
+    g_guard.pending++;
+    pthread_cond_signal(&g_guard.wakeup);
+}
+
+/* Remember where the guild is talking, slowing it straight away mid-lockdown */
+static void note_channel(raid_guard_guild_t *guild, uint64_t channel_id) {
+    for (int i = 0; i < RAID_GUARD_CHANNELS; i++) {
+        if (guild->channels[i].channel_id == channel_id) {
+            if (guild->locked) slow_channel(guild, &guild->channels[i]);
+            return;
+        }
+    }
+
+    /* Replace the oldest one the lockdown isn't holding */
+    for (int tried = 0; tried < RAID_GUARD_CHANNELS; tried++) {
+        raid_channel_t *channel = &guild->channels[guild->channel_next];
+        guild->channel_next = (uint8_t)((guild->channel_next + 1) % RAID_GUARD_CHANNELS);
+        if (channel->state == RAID_CHANNEL_IDLE) {
+            channel->channel_id = channel_id;
+            if (guild->locked) slow_channel(guild, channel);
+            return;
+        }
+    }
+}
+
+/* Count n events and start or extend a lockdown when a limit is reached */
+static void record(raid_guard_guild_t *guild, int signal, uint32_t n, uint32_t now, raid_trip_t *trip) {
+    uint32_t counts[RATE_RESOLUTIONS];
+    guild->last_event = now;
+    rate_window_add(&guild->rates[signal], now, n);
+    rate_window_read(&guild->rates[signal], now, counts);
+
+    int over = -1;
+    for (int r = 0; r < RATE_RESOLUTIONS && over < 0; r++) {
+        if (counts[r] >= g_limits[signal][r]) over = r;
+    }
+    if (over < 0) return;
+
+    uint32_t until = now + g_guard.lockdown_seconds;
+    if (guild->locked) {
+        /* Counted at most once a second */
+        if (guild->until != until) {
+            g_guard.extended++;
+            guild->until = until;
+            if (guild->lock_slot >= 0) publish_lockdown(guild);
+        }
+        return;
+    }
+
+    guild->locked = 1;
+    guild->cause = (uint8_t)signal;
+    guild->until = until;
+    lru_settle(guild);
+    publish_lockdown(guild);
+    atomic_fetch_add(&g_guard.locked_count, 1);
+    g_guard.lockdowns++;
+    for (int i = 0; i < RAID_GUARD_CHANNELS; i++) {
+        if (guild->channels[i].channel_id != 0) slow_channel(guild, &guild->channels[i]);
+    }
+
+    trip->started = 1;
+    trip->signal = signal;
+    trip->resolution = over;
+    trip->count = counts[over];
+}
+
+static void report(uint64_t guild_id, const raid_trip_t *trip) {
+    if (!trip->started) return;
+    printf("🚨 Lockdown in guild %lu: %u %s in %ds - XP paused, spam filter tightened",
+           (unsigned long)guild_id, trip->count, g_signal_names[trip->signal],
+           g_window_seconds[trip->resolution]);
+    if (g_guard.slowmode_seconds > 0) {
+        printf(", %ds slowmode", g_guard.slowmode_seconds);
+    }
+    printf(" for %us\n", g_guard.lockdown_seconds);
+}
+
+/* ---- Events ---- */
+
+void raid_guard_on_member_join(const struct discord_guild_member *member) {
+    if (!g_guard_bot || !g_guard.guilds || !member->user || member->user->bot) return;
+
+    raid_trip_t trip = { 0 };
+    uint32_t now = now_seconds();
+    pthread_mutex_lock(&g_guard.lock);
+    raid_guard_guild_t *guild = get_guild(member->guild_id, now);
+    if (guild) record(guild, RAID_JOINS, 1, now, &trip);
+    pthread_mutex_unlock(&g_guard.lock);
+
+    report(member->guild_id, &trip);
+}
+
+void raid_guard_on_message(const struct discord_message *msg) {
+    if (!g_guard_bot || !g_guard.guilds || !msg->author) return;
+
+    uint32_t mentions = (uint32_t)((msg->mentions ? msg->mentions->size : 0) +
+                                   (msg->mention_roles ? msg->mention_roles->size : 0) +
+                                   (msg->mention_everyone ? RAID_GUARD_EVERYONE_MENTIONS : 0));
+    int new_account = is_new_account(msg->author->id);
+
+    raid_trip_t trip = { 0 };
+    uint32_t now = now_seconds();
+    pthread_mutex_lock(&g_guard.lock);
+    raid_guard_guild_t *guild = get_guild(msg->guild_id, now);
+    if (guild) {
+        note_channel(guild, msg->channel_id);
+        if (new_account) record(guild, RAID_NEW_ACCOUNT_MESSAGES, 1, now, &trip);
+        if (mentions) record(guild, RAID_MENTIONS, mentions, now, &trip);
+    }
+    pthread_mutex_unlock(&g_guard.lock);
+
+    report(msg->guild_id, &trip);
+}
+
+/* Runs for every message, so it reads the published lockdowns instead of
+ * taking the lock - which it only does for lockdowns that found no slot */
+int raid_guard_locked(uint64_t guild_id) {
+    /* Nearly always nobody is */
+    if (atomic_load_explicit(&g_guard.locked_count, memory_order_relaxed) == 0) return 0;
+
+    uint32_t now = now_seconds();
+    size_t home = lock_home(guild_id);
+    for (int p = 0; p < RAID_GUARD_LOCK_PROBES; p++) {
+        raid_lock_slot_t *slot = &g_guard.locks[(home + (size_t)p) & (RAID_GUARD_LOCK_SLOTS - 1)];
+        unsigned seq;
+        uint64_t id;
+        uint32_t until;
+        do {
+            seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+            id = atomic_load_explicit(&slot->guild_id, memory_order_relaxed);
+            until = atomic_load_explicit(&slot->until, memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+        } while ((seq & 1) || atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq);
+
+        if (id == guild_id && until != 0) return (int32_t)(now - until) < 0;
+    }
+    if (atomic_load_explicit(&g_guard.lock_overflow, memory_order_relaxed) == 0) return 0;
+
+    pthread_mutex_lock(&g_guard.lock);
+    const uint64_t *idx = u64map_find(&g_guard.index, guild_id, 0);
+    int locked = idx && g_guard.guilds[*idx].locked;
+    pthread_mutex_unlock(&g_guard.lock);
+    return locked;
+}
+
+/* ---- Lockdown upkeep - runs on the guard's thread ---- */
+
+/* End lockdowns that have run their course (all of them when stopping) and
+ * queue their channels to get their rate limits back */
+static void lift_expired(uint32_t now, int all) {
+    if (atomic_load(&g_guard.locked_count) == 0) return;
+
+    for (int i = 0; i < g_guard.guild_count; i++) {
+        raid_guard_guild_t *guild = &g_guard.guilds[i];
+        if (!guild->locked || (!all && (int32_t)(now - guild->until) < 0)) continue;
+
+        guild->locked = 0;
+        retract_lockdown(guild);
+        atomic_fetch_sub(&g_guard.locked_count, 1);
+        for (int c = 0; c < RAID_GUARD_CHANNELS; c++) {
+            raid_channel_t *channel = &guild->channels[c];
+            if (channel->state == RAID_CHANNEL_SLOW) {
+                channel->state = RAID_CHANNEL_IDLE;
+                guild->held--;
+                g_guard.pending--;
+            } else if (channel->state == RAID_CHANNEL_SLOWED) {
+                channel->state = RAID_CHANNEL_RESTORE;
+                g_guard.pending++;
+            }
+        }
+        lru_settle(guild);
+        printf("✓ Lockdown lifted in guild %lu (started by %s)\n",
+               (unsigned long)guild->guild_id, g_signal_names[guild->cause]);
+    }
+}
+
+/* Slow a channel unless it already is at least that slow, or put back the
+ * rate limit it had - unless a moderator set another one in the meantime */
+static void run_task(raid_task_t *task) {
+    struct discord *client = g_guard_bot->client;
+    struct discord_channel channel = { 0 };
+    CCORDcode code = discord_get_channel(client, task->channel_id,
+                                         &(struct discord_ret_channel){ .sync = &channel });
+    if (code != CCORD_OK) {
+        task->ok = 0;
+        return;
+    }
+    int current = channel.rate_limit_per_user;
+    discord_channel_cleanup(&channel);
+
+    int target = task->slow ? g_guard.slowmode_seconds : task->restore;
+    if (task->slow) task->restore = current;
+    task->changed = task->slow ? current < target : current == g_guard.slowmode_seconds;
+    task->ok = 1;
+    if (task->changed) {
+        code = discord_modify_channel(client, task->channel_id,
+                                      &(struct discord_modify_channel){ .rate_limit_per_user = target }, NULL);
+        task->ok = code == CCORD_OK;
+    }
+}
+
+static raid_channel_t *find_channel(raid_guard_guild_t *guild, uint64_t channel_id) {
+    for (int i = 0; i < RAID_GUARD_CHANNELS; i++) {
+        if (guild->channels[i].channel_id == channel_id) return &guild->channels[i];
+    }
+    return NULL;
+}
+
+/* Send one batch of waiting channel changes with the lock dropped. Guilds
+ * with channels held can't be reused meanwhile and only this thread ends
+ * lockdowns, so the channels are as we left them when the results come
+ * back. Returns how many were sent. */
+static int send_batch(void) {
+    raid_task_t batch[RAID_GUARD_BATCH];
+    int n = 0;
+
+    for (int i = 0; i < g_guard.guild_count && n < RAID_GUARD_BATCH && g_guard.pending > 0; i++) {
+        raid_guard_guild_t *guild = &g_guard.guilds[i];
+        for (int c = 0; c < RAID_GUARD_CHANNELS && n < RAID_GUARD_BATCH && guild->held; c++) {
+            const raid_channel_t *channel = &guild->channels[c];
+            if (channel->state != RAID_CHANNEL_SLOW && channel->state != RAID_CHANNEL_RESTORE) continue;
+            batch[n++] = (raid_task_t){
+                .guild = i, .guild_id = guild->guild_id, .channel_id = channel->channel_id,
+                .slow = channel->state == RAID_CHANNEL_SLOW, .restore = channel->restore
+            };
+        }
+    }
+    if (n == 0) return 0;
+
+    pthread_mutex_unlock(&g_guard.lock);
+    for (int i = 0; i < n; i++) {
+        run_task(&batch[i]);
+    }
+    pthread_mutex_lock(&g_guard.lock);
+
+    for (int i = 0; i < n; i++) {
+        const raid_task_t *task = &batch[i];
+        raid_guard_guild_t *guild = &g_guard.guilds[task->guild];
+        raid_channel_t *channel = find_channel(guild, task->channel_id);
+        if (guild->guild_id != task->guild_id || !channel) continue;
+
+        g_guard.failed += !task->ok;
+        if (task->slow) {
+            g_guard.slowed += task->ok && task->changed;
+            if (channel->state == RAID_CHANNEL_SLOW && task->ok && task->changed) {
+                channel->state = RAID_CHANNEL_SLOWED;
+                channel->restore = task->restore;
+                g_guard.pending--;
+            } else if (channel->state == RAID_CHANNEL_SLOW) {
+                /* Already slow enough, or out of our hands */
+                channel->state = RAID_CHANNEL_IDLE;
+                guild->held--;
+                g_guard.pending--;
+            }
+        } else if (channel->state == RAID_CHANNEL_RESTORE) {
+            g_guard.restored += task->ok && task->changed;
+            channel->state = RAID_CHANNEL_IDLE;
+            guild->held--;
+            g_guard.pending--;
+        }
+        lru_settle(guild);
+    }
+    return n;
+}
+
+static void *raid_guard_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_guard.lock);
+    while (g_guard.running) {
+        if (atomic_load(&g_guard.locked_count) == 0 && g_guard.pending == 0) {
+            pthread_cond_wait(&g_guard.wakeup, &g_guard.lock);
+        } else if (g_guard.pending == 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += RAID_GUARD_POLL_SECONDS;
+            while (g_guard.running && g_guard.pending == 0 &&
+                   pthread_cond_timedwait(&g_guard.wakeup, &g_guard.lock, &deadline) != ETIMEDOUT) {
+            }
+        }
+        if (!g_guard.running) break;
+
+        lift_expired(now_seconds(), 0);
+        send_batch();
+    }
+    pthread_mutex_unlock(&g_guard.lock);
+    return NULL;
+}
+
+/* ---- Lifecycle ---- */
+
+int raid_guard_init(yuno_bot_t *bot) {
+    memset(&g_guard, 0, sizeof(raid_guard_t));
+    atomic_init(&g_guard.locked_count, 0);
+    atomic_init(&g_guard.lock_overflow, 0);
+    g_guard.lru_head = g_guard.lru_tail = -1;
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_guard.wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&g_guard.lock, NULL);
+
+    /* 0 turns lockdowns off - nothing to count for */
+    if (bot->config.raid_lockdown_seconds <= 0) {
+        return 0;
+    }
+    g_guard.lockdown_seconds = (uint32_t)bot->config.raid_lockdown_seconds;
+    g_guard.slowmode_seconds = bot->config.raid_slowmode_seconds;
+    if (g_guard.slowmode_seconds < 0) g_guard.slowmode_seconds = 0;
+    if (g_guard.slowmode_seconds > 21600) g_guard.slowmode_seconds = 21600;   /* Discord's maximum */
+
+    g_guard.guilds = calloc(RAID_GUARD_MAX_GUILDS, sizeof(raid_guard_guild_t));
+    if (!g_guard.guilds || u64map_init(&g_guard.index, RAID_GUARD_MAX_GUILDS * 4 / 3 + 1) != 0) {
+        free(g_guard.guilds);
+        g_guard.guilds = NULL;
+        return -1;
+    }
+
+    g_guard_bot = bot;
+    printf("🚧 Raid guard watching joins, new accounts and mentions - lockdowns last %us",
+           g_guard.lockdown_seconds);
+    if (g_guard.slowmode_seconds > 0) {
+        printf(" with %ds slowmode", g_guard.slowmode_seconds);
+    }
+    printf("\n");
+    return 0;
+}
+
+int raid_guard_start(void) {
+    if (!g_guard.guilds) return 0;
+
+    g_guard.running = 1;
+    if (pthread_create(&g_guard.thread, NULL, raid_guard_thread, NULL) != 0) {
+        g_guard.running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* Lockdowns end with the bot - channels get their rate limits back first */
+void raid_guard_stop(void) {
+    pthread_mutex_lock(&g_guard.lock);
+    if (!g_guard.running) {
+        pthread_mutex_unlock(&g_guard.lock);
+        return;
+    }
+    g_guard.running = 0;
+    pthread_cond_signal(&g_guard.wakeup);
+    pthread_mutex_unlock(&g_guard.lock);
+    pthread_join(g_guard.thread, NULL);
+
+    pthread_mutex_lock(&g_guard.lock);
+    lift_expired(now_seconds(), 1);
+    while (send_batch() > 0) {
+    }
+    pthread_mutex_unlock(&g_guard.lock);
+}
+
+void raid_guard_cleanup(void) {
+    free(g_guard.guilds);
+    g_guard.guilds = NULL;
+    g_guard.guild_count = 0;
+    u64map_free(&g_guard.index);
+    pthread_mutex_destroy(&g_guard.lock);
+    pthread_cond_destroy(&g_guard.wakeup);
+    g_guard_bot = NULL;
+}
+
+void raid_guard_get_stats(raid_guard_stats_t *stats) {
+    pthread_mutex_lock(&g_guard.lock);
+    stats->guilds = g_guard.guild_count;
+    stats->locked = atomic_load(&g_guard.locked_count);
+    stats->lockdowns = g_guard.lockdowns;
+    stats->extended = g_guard.extended;
+    stats->slowed = g_guard.slowed;
+    stats->restored = g_guard.restored;
+    stats->failed = g_guard.failed;
+    stats->untracked = g_guard.untracked;
+    pthread_mutex_unlock(&g_guard.lock);
+}
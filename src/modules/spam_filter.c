@@ -6,204 +6,491 @@
 
 #include "modules/spam_filter.h"
 #include "bot.h"
+#include "content_hash.h"
+#include "modules/raid_guard.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+/* A policy's limits have to fit in what a history remembers */
+_Static_assert(MAX_SPAM_LIMIT <= SPAM_HISTORY_LEN, "spam policy limits exceed the history length");
+
 static spam_filter_t g_filter;
 static yuno_bot_t *g_spam_bot = NULL;
 
-/* Hash function for user+guild combination - O(1) lookup */
-static inline uint32_t hash_user_guild(uint64_t user_id, uint64_t guild_id) {
-    /* FNV-1a inspired hash for two uint64s */
-    uint64_t h = 14695981039346656037ULL;
-    h ^= user_id;
-    h *= 1099511628211ULL;
-    h ^= guild_id;
-    h *= 1099511628211ULL;
-    return (uint32_t)(h % SPAM_HASH_SIZE);
-}
-
 void spam_filter_init(yuno_bot_t *bot) {
     memset(&g_filter, 0, sizeof(spam_filter_t));
-    g_spam_bot = bot;
 
-    /* Initialize hash table buckets to -1 (empty) */
-    for (int i = 0; i < SPAM_HASH_SIZE; i++) {
-        g_filter.hash_table[i] = -1;
+    long budget_kb = bot->config.spam_memory_kb > 0 ? bot->config.spam_memory_kb : SPAM_DEFAULT_MEMORY_KB;
+    long max_users = budget_kb * 1024 / (long)SPAM_BYTES_PER_HISTORY;
+    if (max_users < SPAM_MIN_USERS) max_users = SPAM_MIN_USERS;
+    if (max_users > INT32_MAX / 2) max_users = INT32_MAX / 2;
+    g_filter.max_users = (int)max_users;
+
+    int percent = bot->config.spam_guild_quota_percent;
+    if (percent < 1 || percent > 100) percent = SPAM_DEFAULT_GUILD_PERCENT;
+    g_filter.guild_quota = (int)(max_users * percent / 100);
+    if (g_filter.guild_quota < SPAM_GUILD_MIN_QUOTA) g_filter.guild_quota = SPAM_GUILD_MIN_QUOTA;
+    if (g_filter.guild_quota > g_filter.max_users) g_filter.guild_quota = g_filter.max_users;
+
+    /* One similar poster would be every message */
+    int raid_users = bot->config.raid_similar_users;
+    if (raid_users < 0) raid_users = 0;
+    if (raid_users == 1) raid_users = 2;
+    if (raid_users > NEAR_DUP_MAX_USERS) raid_users = NEAR_DUP_MAX_USERS;
+    g_filter.raid_users = raid_users;
+    g_filter.raid_seconds = bot->config.raid_similar_seconds > 0 ? (uint32_t)bot->config.raid_similar_seconds
+                                                                 : SPAM_DEFAULT_RAID_SECONDS;
+
+    long raid_kb = bot->config.raid_memory_kb > 0 ? bot->config.raid_memory_kb : SPAM_DEFAULT_RAID_MEMORY_KB;
+    long windows = raid_kb * 1024 / (long)sizeof(spam_raid_window_t);
+    if (windows < 1) windows = 1;
+    if (windows > INT32_MAX / 2) windows = INT32_MAX / 2;
+    g_filter.raid_window_limit = raid_users ? (int)windows : 0;
+
+    int initial = g_filter.max_users < SPAM_INITIAL_USERS ? g_filter.max_users : SPAM_INITIAL_USERS;
+    g_filter.users = malloc(sizeof(user_message_history_t) * initial);
+    if (!g_filter.users ||
+        u64map_init(&g_filter.index, (size_t)initial) != 0 ||
+        u64map_init(&g_filter.guild_index, 64) != 0) {
+        fprintf(stderr, "💔 Failed to initialize spam filter\n");
+        free(g_filter.users);
+        u64map_free(&g_filter.index);
+        u64map_free(&g_filter.guild_index);
+        memset(&g_filter, 0, sizeof(spam_filter_t));
+        return;
     }
+    g_filter.user_capacity = initial;
+    g_filter.epoch = time(NULL);
 
-    /* Initialize free list - chain all entries together */
-    for (int i = 0; i < MAX_TRACKED_USERS - 1; i++) {
-        g_filter.users[i].hash_next = i + 1;
-        g_filter.users[i].in_use = 0;
+    pthread_mutex_init(&g_filter.lock, NULL);
+    g_spam_bot = bot;
+    printf("🛡️ Spam filter tracking up to %d histories in %ld KB, %d per guild\n",
+           g_filter.max_users, budget_kb, g_filter.guild_quota);
+    if (raid_users) {
+        printf("🚨 Raid signal at %d accounts posting alike within %us, watching up to %d guilds in %ld KB\n",
+               raid_users, g_filter.raid_seconds, g_filter.raid_window_limit, raid_kb);
     }
-    g_filter.users[MAX_TRACKED_USERS - 1].hash_next = -1;
-    g_filter.free_head = 0;
 }
 
 void spam_filter_cleanup(void) {
-    g_filter.user_count = 0;
+    if (!g_spam_bot) return;
     g_spam_bot = NULL;
+    pthread_mutex_destroy(&g_filter.lock);
+    free(g_filter.users);
+    free(g_filter.guilds);
+    free(g_filter.raid_windows);
+    u64map_free(&g_filter.index);
+    u64map_free(&g_filter.guild_index);
+    memset(&g_filter, 0, sizeof(spam_filter_t));
+}
+
+/* The history keeps 32 bits of a fingerprint */
+static inline uint32_t fold_fingerprint(uint64_t hash) {
+    return (uint32_t)(hash ^ (hash >> 32));
 }
 
-/* DJB2 hash for content strings */
 uint32_t hash_content(const char *content) {
-    uint32_t hash = 5381;
-    int c;
-    while ((c = *content++)) {
-        hash = ((hash << 5) + hash) + c;
-    }
-    return hash;
+    return fold_fingerprint(content_fingerprint(content, strlen(content)));
 }
 
 /* O(1) average case lookup using hash table */
 static user_message_history_t *find_user_entry(uint64_t user_id, uint64_t guild_id) {
-    uint32_t bucket = hash_user_guild(user_id, guild_id);
-    int idx = g_filter.hash_table[bucket];
+    const uint64_t *idx = u64map_find(&g_filter.index, user_id, guild_id);
+    return idx ? &g_filter.users[*idx] : NULL;
+}
+
+static spam_guild_t *find_guild(uint64_t guild_id) {
+    const uint64_t *idx = u64map_find(&g_filter.guild_index, guild_id, 0);
+    return idx ? &g_filter.guilds[*idx] : NULL;
+}
+
+/* Find or add a guild record - pointers into guilds[] move when one is added or dropped */
+static spam_guild_t *get_guild(uint64_t guild_id) {
+    spam_guild_t *guild = find_guild(guild_id);
+    if (guild) return guild;
 
-    while (idx >= 0) {
-        user_message_history_t *entry = &g_filter.users[idx];
-        if (entry->in_use && entry->user_id == user_id && entry->guild_id == guild_id) {
-            return entry;
+    if (g_filter.guild_count == g_filter.guild_capacity) {
+        int capacity = g_filter.guild_capacity ? g_filter.guild_capacity * 2 : 64;
+        spam_guild_t *guilds = realloc(g_filter.guilds, sizeof(spam_guild_t) * capacity);
+        if (!guilds) {
+            return NULL;
         }
-        idx = entry->hash_next;
+        g_filter.guilds = guilds;
+        g_filter.guild_capacity = capacity;
     }
-    return NULL;
+
+    uint64_t *idx = u64map_insert(&g_filter.guild_index, guild_id, 0, NULL);
+    if (!idx) {
+        return NULL;
+    }
+    *idx = (uint64_t)g_filter.guild_count;
+
+    guild = &g_filter.guilds[g_filter.guild_count++];
+    guild->guild_id = guild_id;
+    guild->count = 0;
+    guild->hand = -1;
+    guild->window = -1;
+    return guild;
 }
 
-/* Allocate a new user entry from free list */
-static user_message_history_t *alloc_user_entry(uint64_t user_id, uint64_t guild_id) {
-    int idx;
+static void release_raid_window(int idx) {
+    int last = --g_filter.raid_window_count;
+    if (idx != last) {
+        g_filter.raid_windows[idx] = g_filter.raid_windows[last];
+        find_guild(g_filter.raid_windows[idx].guild_id)->window = idx;
+    }
+}
+
+/* Drop a guild record once its last history is gone */
+static void release_guild(spam_guild_t *guild) {
+    if (guild->count > 0) return;
+
+    if (guild->window >= 0) release_raid_window(guild->window);
 
-    if (g_filter.free_head >= 0) {
-        /* Get from free list */
-        idx = g_filter.free_head;
-        g_filter.free_head = g_filter.users[idx].hash_next;
+    u64map_remove(&g_filter.guild_index, guild->guild_id, 0);
+    int last = --g_filter.guild_count;
+    spam_guild_t *moved = &g_filter.guilds[last];
+    if (guild != moved) {
+        *guild = *moved;
+        *u64map_find(&g_filter.guild_index, guild->guild_id, 0) = (uint64_t)(guild - g_filter.guilds);
+    }
+}
+
+/* Add a history to its guild's ring, just behind the guild's hand */
+static void ring_link(spam_guild_t *guild, int idx) {
+    user_message_history_t *entry = &g_filter.users[idx];
+    if (guild->count == 0) {
+        entry->guild_prev = entry->guild_next = idx;
+        guild->hand = idx;
     } else {
-        /* No free entries - evict oldest (LRU would be better but this is simpler) */
-        /* Find first in-use entry and evict it */
-        for (idx = 0; idx < MAX_TRACKED_USERS; idx++) {
-            if (g_filter.users[idx].in_use) {
-                /* Remove from hash table */
-                uint32_t old_bucket = hash_user_guild(
-                    g_filter.users[idx].user_id,
-                    g_filter.users[idx].guild_id
-                );
-
-                int *prev = &g_filter.hash_table[old_bucket];
-                while (*prev >= 0) {
-                    if (*prev == idx) {
-                        *prev = g_filter.users[idx].hash_next;
-                        break;
-                    }
-                    prev = &g_filter.users[*prev].hash_next;
-                }
-                g_filter.user_count--;
-                break;
-            }
+        user_message_history_t *next = &g_filter.users[guild->hand];
+        entry->guild_next = guild->hand;
+        entry->guild_prev = next->guild_prev;
+        g_filter.users[next->guild_prev].guild_next = idx;
+        next->guild_prev = idx;
+    }
+    guild->count++;
+}
+
+/* Take a history out of its guild's ring, dropping the guild if it was the last */
+static void ring_unlink(int idx) {
+    user_message_history_t *entry = &g_filter.users[idx];
+    spam_guild_t *guild = find_guild(entry->guild_id);
+    if (--guild->count > 0) {
+        g_filter.users[entry->guild_prev].guild_next = entry->guild_next;
+        g_filter.users[entry->guild_next].guild_prev = entry->guild_prev;
+        if (guild->hand == idx) guild->hand = entry->guild_next;
+    }
+    release_guild(guild);
+}
+
+/* Drop an entry that is already out of the index and its ring, moving the
+ * last one into its place */
+static void remove_user_at_unindexed(int idx) {
+    int last = --g_filter.user_count;
+    if (idx == last) return;
+
+    user_message_history_t *entry = &g_filter.users[idx];
+    *entry = g_filter.users[last];
+    *u64map_find(&g_filter.index, entry->user_id, entry->guild_id) = (uint64_t)idx;
+
+    if (entry->guild_next == last) {
+        entry->guild_prev = entry->guild_next = idx;
+    } else {
+        g_filter.users[entry->guild_prev].guild_next = idx;
+        g_filter.users[entry->guild_next].guild_prev = idx;
+    }
+    spam_guild_t *guild = find_guild(entry->guild_id);
+    if (guild->hand == last) guild->hand = idx;
+}
+
+static void remove_user_at(int idx) {
+    user_message_history_t *entry = &g_filter.users[idx];
+    u64map_remove(&g_filter.index, entry->user_id, entry->guild_id);
+    ring_unlink(idx);
+    remove_user_at_unindexed(idx);
+}
+
+static void count_eviction(const user_message_history_t *entry, uint32_t now) {
+    g_filter.evictions++;
+    if (entry->history.count > 0 && now - spam_history_last(&entry->history) <= DEFAULT_SPAM_INTERVAL) {
+        g_filter.evicted_active++;
+    }
+}
+
+/* CLOCK - the hand lowers each history's count until it finds one at zero.
+ * Every message raises the count (up to SPAM_CLOCK_MAX) and the hand only
+ * lowers what messages raised, so a pick is amortized O(1). A newcomer
+ * starts at 1, so the hand has to pass it once before it can go: two
+ * accounts taking turns can't keep pushing each other's history out. */
+static int pick_victim(uint32_t now) {
+    for (;;) {
+        if (g_filter.clock_hand >= g_filter.user_count) {
+            g_filter.clock_hand = 0;
+        }
+        user_message_history_t *entry = &g_filter.users[g_filter.clock_hand];
+        if (entry->clock == 0) {
+            count_eviction(entry, now);
+            return g_filter.clock_hand;
         }
-        if (idx >= MAX_TRACKED_USERS) {
-            return NULL; /* Should never happen */
+        entry->clock--;
+        g_filter.second_chances++;
+        g_filter.clock_hand++;
+    }
+}
+
+/* The same sweep over one guild's ring, for a guild at its quota */
+static int pick_guild_victim(spam_guild_t *guild, uint32_t now) {
+    for (;;) {
+        user_message_history_t *entry = &g_filter.users[guild->hand];
+        if (entry->clock == 0) {
+            count_eviction(entry, now);
+            g_filter.quota_evictions++;
+            return guild->hand;
         }
+        entry->clock--;
+        g_filter.second_chances++;
+        guild->hand = entry->guild_next;
+    }
+}
+
+static int grow_users(void) {
+    int capacity = g_filter.user_capacity * 2;
+    if (capacity > g_filter.max_users) capacity = g_filter.max_users;
+    user_message_history_t *users = realloc(g_filter.users, sizeof(user_message_history_t) * capacity);
+    if (!users) {
+        return -1;
+    }
+    g_filter.users = users;
+    g_filter.user_capacity = capacity;
+    return 0;
+}
+
+/* Allocate a new user entry. A guild at its quota replaces one of its own
+ * histories; otherwise the array grows up to max_users and then the oldest
+ * unused history anywhere makes room. */
+static user_message_history_t *alloc_user_entry(uint64_t user_id, uint64_t guild_id, uint32_t now) {
+    spam_guild_t *guild = get_guild(guild_id);
+    if (!guild) return NULL;
+
+    int idx;
+    if (guild->count >= g_filter.guild_quota) {
+        /* Same guild, so the slot keeps its place in the ring */
+        idx = pick_guild_victim(guild, now);
+        user_message_history_t *victim = &g_filter.users[idx];
+        u64map_remove(&g_filter.index, victim->user_id, victim->guild_id);
+    } else {
+        if (g_filter.user_count >= g_filter.max_users) {
+            idx = pick_victim(now);
+            user_message_history_t *victim = &g_filter.users[idx];
+            u64map_remove(&g_filter.index, victim->user_id, victim->guild_id);
+            ring_unlink(idx);
+
+            /* Dropping the victim's guild may have moved ours */
+            guild = get_guild(guild_id);
+            if (!guild) {
+                remove_user_at_unindexed(idx);
+                return NULL;
+            }
+        } else {
+            if (g_filter.user_count == g_filter.user_capacity && grow_users() != 0) {
+                release_guild(guild);
+                return NULL;
+            }
+            idx = g_filter.user_count++;
+        }
+        ring_link(guild, idx);
     }
 
     /* Initialize the entry */
     user_message_history_t *entry = &g_filter.users[idx];
     entry->user_id = user_id;
     entry->guild_id = guild_id;
-    entry->history_head = 0;
-    entry->history_count = 0;
-    entry->in_use = 1;
-
-    /* Add to hash table */
-    uint32_t bucket = hash_user_guild(user_id, guild_id);
-    entry->hash_next = g_filter.hash_table[bucket];
-    g_filter.hash_table[bucket] = idx;
-    g_filter.user_count++;
+    spam_history_reset(&entry->history);
+    entry->warnings = -1;
+    entry->clock = 1;           /* Its first message - survives one pass of the hand */
+
+    uint64_t *slot = u64map_insert(&g_filter.index, user_id, guild_id, NULL);
+    if (!slot) {
+        ring_unlink(idx);
+        remove_user_at_unindexed(idx);
+        return NULL;
+    }
+    *slot = (uint64_t)idx;
 
     return entry;
 }
 
-/* Check rate spam using circular buffer - no cleanup needed */
-static int is_rate_spam(const user_message_history_t *user, time_t now) {
-    int recent_count = 0;
-    int count = user->history_count;
-    int idx = user->history_head;
-
-    for (int i = 0; i < count; i++) {
-        /* Go backwards in circular buffer */
-        idx = (idx - 1 + MAX_MESSAGE_HISTORY) % MAX_MESSAGE_HISTORY;
-        if (now - user->history[idx].timestamp <= SPAM_INTERVAL_SECONDS) {
-            recent_count++;
-        }
+static int grow_raid_windows(void) {
+    int capacity = g_filter.raid_window_capacity ? g_filter.raid_window_capacity * 2 : 8;
+    if (capacity > g_filter.raid_window_limit) capacity = g_filter.raid_window_limit;
+    spam_raid_window_t *windows = realloc(g_filter.raid_windows, sizeof(spam_raid_window_t) * capacity);
+    if (!windows) {
+        return -1;
     }
-    return recent_count >= MAX_MESSAGES_PER_INTERVAL;
+    g_filter.raid_windows = windows;
+    g_filter.raid_window_capacity = capacity;
+    return 0;
 }
 
-/* Check duplicate spam using circular buffer */
-static int is_duplicate_spam(const user_message_history_t *user, uint32_t content_hash) {
-    int duplicates = 0;
-    int count = user->history_count;
-    int idx = user->history_head;
-
-    for (int i = 0; i < count; i++) {
-        idx = (idx - 1 + MAX_MESSAGE_HISTORY) % MAX_MESSAGE_HISTORY;
-        if (user->history[idx].content_hash == content_hash) {
-            duplicates++;
+/* The guild's window of recent messages, set up on its first message. Once
+ * raid_memory_kb is spent, the window used longest ago moves over - a guild
+ * being raided posts too often to lose its own. */
+static spam_raid_window_t *get_raid_window(spam_guild_t *guild, uint32_t now) {
+    if (guild->window < 0) {
+        int idx;
+        if (g_filter.raid_window_count < g_filter.raid_window_limit) {
+            if (g_filter.raid_window_count == g_filter.raid_window_capacity && grow_raid_windows() != 0) {
+                return NULL;
+            }
+            idx = g_filter.raid_window_count++;
+        } else {
+            idx = 0;
+            for (int i = 1; i < g_filter.raid_window_count; i++) {
+                if ((int32_t)(g_filter.raid_windows[i].last_used - g_filter.raid_windows[idx].last_used) < 0) {
+                    idx = i;
+                }
+            }
+            find_guild(g_filter.raid_windows[idx].guild_id)->window = -1;
+            g_filter.window_moves++;
         }
-    }
-    return duplicates >= DUPLICATE_THRESHOLD;
-}
 
-/* Add message to circular buffer - O(1) operation, no memmove! */
-static inline void add_message_to_history(user_message_history_t *user, time_t now, uint32_t content_hash) {
-    user->history[user->history_head].timestamp = now;
-    user->history[user->history_head].content_hash = content_hash;
-    user->history_head = (user->history_head + 1) % MAX_MESSAGE_HISTORY;
-    if (user->history_count < MAX_MESSAGE_HISTORY) {
-        user->history_count++;
+        spam_raid_window_t *window = &g_filter.raid_windows[idx];
+        window->guild_id = guild->guild_id;
+        window->raiding = 0;
+        near_dup_reset(&window->recent);
+        guild->window = idx;
     }
+
+    spam_raid_window_t *window = &g_filter.raid_windows[guild->window];
+    window->last_used = now;
+    return window;
 }
 
-int spam_filter_check(uint64_t user_id, uint64_t guild_id, const char *content) {
+/* Seconds since the filter started - what the histories store */
+static inline uint32_t filter_now(void) {
     time_t now = time(NULL);
-    uint32_t content_hash = hash_content(content);
+    return now > g_filter.epoch ? (uint32_t)(now - g_filter.epoch) : 0;
+}
+
+int spam_filter_check(uint64_t user_id, uint64_t guild_id, const char *content, const spam_policy_t *policy) {
+    if (!g_spam_bot) return 0;
+
+    content_hashes_t hashes;
+    content_hashes(content, strlen(content), &hashes);
+    uint32_t content_hash = fold_fingerprint(hashes.fingerprint);
+
+    /* A raid lockdown tightens both limits */
+    int lockdown = raid_guard_locked(guild_id);
+    int max_messages = lockdown ? policy->lockdown_messages : policy->max_messages;
+    int max_duplicates = lockdown ? policy->lockdown_duplicates : policy->max_duplicates;
+
+    pthread_mutex_lock(&g_filter.lock);
+    uint32_t now = filter_now();
 
     /* O(1) lookup instead of O(n) */
     user_message_history_t *user = find_user_entry(user_id, guild_id);
 
-    if (!user) {
-        user = alloc_user_entry(user_id, guild_id);
-        if (!user) return 0; /* Allocation failed, don't flag as spam */
+    if (user) {
+        if (user->clock < SPAM_CLOCK_MAX) user->clock++;
+    } else {
+        user = alloc_user_entry(user_id, guild_id, now);
+        if (!user) {
+            pthread_mutex_unlock(&g_filter.lock);
+            return 0; /* Allocation failed, don't flag as spam */
+        }
     }
 
-    /* Add message to circular buffer - O(1) instead of O(n) memmove */
-    add_message_to_history(user, now, content_hash);
+    spam_history_add(&user->history, now, content_hash);
+
+    /* Rate and duplicate checks in one pass over the history */
+    int recent, duplicates;
+    spam_history_count(&user->history, now, policy->interval, content_hash, &recent, &duplicates);
+    int spam = recent >= max_messages || duplicates >= max_duplicates ? SPAM_FLAG_USER : 0;
+
+    /* Then across members - many accounts each posting the same thing once */
+    int similar = 0;
+    int report = 0;
+    spam_guild_t *guild = g_filter.raid_users ? find_guild(guild_id) : NULL;
+    if (guild && hashes.length >= SPAM_RAID_MIN_LENGTH) {
+        spam_raid_window_t *window = get_raid_window(guild, now);
+        if (window) {
+            similar = near_dup_add(&window->recent, user_id, hashes.simhash, now,
+                                   g_filter.raid_seconds, g_filter.raid_users);
+            if (similar >= g_filter.raid_users) {
+                spam |= SPAM_FLAG_RAID;
+                g_filter.raid_flagged++;
+                report = !window->raiding || now - window->last_signal > g_filter.raid_seconds;
+                g_filter.raid_signals += report;
+                window->raiding = 1;
+                window->last_signal = now;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_filter.lock);
 
-    /* Check for spam */
-    if (is_rate_spam(user, now) || is_duplicate_spam(user, content_hash)) {
-        return 1;
+    if (report) {
+        printf("🚨 Raid signal in guild %lu: %d accounts posted near-identical messages within %us\n",
+               (unsigned long)guild_id, similar, g_filter.raid_seconds);
     }
+    return spam;
+}
 
-    return 0;
+/* Count one more warning and return the total, starting over once it reaches
+ * max_warnings. Writes are queued, so the database may lag behind - it's only
+ * read the first time a member is warned after their history was made. */
+static int add_warning(yuno_bot_t *bot, uint64_t user_id, uint64_t guild_id, int max_warnings) {
+    int warnings = -1;
+
+    pthread_mutex_lock(&g_filter.lock);
+    user_message_history_t *user = find_user_entry(user_id, guild_id);
+    if (user && user->warnings >= 0) {
+        warnings = ++user->warnings;
+        if (user->warnings >= max_warnings) user->warnings = 0;
+    }
+    pthread_mutex_unlock(&g_filter.lock);
+    if (warnings >= 0) return warnings;
+
+    /* Not under the lock - every message goes through it */
+    int stored = db_get_spam_warnings(&bot->database, user_id, guild_id);
+
+    pthread_mutex_lock(&g_filter.lock);
+    user = find_user_entry(user_id, guild_id);
+    if (user) {
+        if (user->warnings < 0) user->warnings = stored;
+        warnings = ++user->warnings;
+        if (user->warnings >= max_warnings) user->warnings = 0;
+    } else {
+        warnings = stored + 1;
+    }
+    pthread_mutex_unlock(&g_filter.lock);
+    return warnings;
 }
 
-int spam_filter_handle(yuno_bot_t *bot, const struct discord_message *msg) {
+int spam_filter_handle(yuno_bot_t *bot, const struct discord_message *msg, const spam_policy_t *policy) {
     /* Check if message is spam */
-    if (!spam_filter_check(msg->author->id, msg->guild_id, msg->content)) {
+    int flags = spam_filter_check(msg->author->id, msg->guild_id, msg->content, policy);
+    if (!flags) {
         return 0; /* Not spam */
     }
 
     /* Delete the spam message */
     discord_delete_message(bot->client, msg->channel_id, msg->id, NULL);
 
-    /* Add warning to database */
-    db_add_spam_warning(&bot->database, msg->author->id, msg->guild_id);
-    int warnings = db_get_spam_warnings(&bot->database, msg->author->id, msg->guild_id);
+    /* Only caught as one of a raid's accounts - those rarely post twice, and
+     * warning each of them in chat would add to the flood */
+    if (!(flags & SPAM_FLAG_USER)) {
+        return 1;
+    }
 
-    /* Check if user should be punished */
+    /* Add warning - counted here, the database write is only queued */
     int max_warnings = bot->config.spam_max_warnings;
+    int warnings = add_warning(bot, msg->author->id, msg->guild_id, max_warnings);
+    db_writer_add_spam_warning(&bot->db_writer, msg->author->id, msg->guild_id);
+
+    /* Check if user should be punished */
     if (warnings >= max_warnings) {
         /* Timeout the user for 10 minutes */
         time_t timeout_until = time(NULL) + (10 * 60);
@@ -225,7 +512,7 @@ int spam_filter_handle(yuno_bot_t *bot, const struct discord_message *msg) {
         discord_create_message(bot->client, msg->channel_id, &response, NULL);
 
         /* Reset warnings */
-        db_reset_spam_warnings(&bot->database, msg->author->id, msg->guild_id);
+        db_writer_reset_spam_warnings(&bot->db_writer, msg->author->id, msg->guild_id);
     } else {
         /* Warn the user */
         char warn_msg[256];
@@ -241,24 +528,43 @@ int spam_filter_handle(yuno_bot_t *bot, const struct discord_message *msg) {
 }
 
 void spam_filter_clear_user(uint64_t user_id, uint64_t guild_id) {
-    uint32_t bucket = hash_user_guild(user_id, guild_id);
-    int *prev = &g_filter.hash_table[bucket];
-
-    while (*prev >= 0) {
-        int idx = *prev;
-        user_message_history_t *entry = &g_filter.users[idx];
-
-        if (entry->in_use && entry->user_id == user_id && entry->guild_id == guild_id) {
-            /* Remove from hash chain */
-            *prev = entry->hash_next;
-
-            /* Add to free list */
-            entry->in_use = 0;
-            entry->hash_next = g_filter.free_head;
-            g_filter.free_head = idx;
-            g_filter.user_count--;
-            return;
+    if (!g_spam_bot) return;
+
+    pthread_mutex_lock(&g_filter.lock);
+    const uint64_t *idx = u64map_find(&g_filter.index, user_id, guild_id);
+    if (idx) {
+        remove_user_at((int)*idx);
+    }
+    pthread_mutex_unlock(&g_filter.lock);
+}
+
+void spam_filter_get_stats(spam_filter_stats_t *stats) {
+    memset(stats, 0, sizeof(spam_filter_stats_t));
+    if (!g_spam_bot) return;
+
+    pthread_mutex_lock(&g_filter.lock);
+    stats->tracked = g_filter.user_count;
+    stats->allocated = g_filter.user_capacity;
+    stats->max_users = g_filter.max_users;
+    stats->guilds = g_filter.guild_count;
+    stats->guild_quota = g_filter.guild_quota;
+    for (int i = 0; i < g_filter.guild_count; i++) {
+        if (g_filter.guilds[i].count > stats->largest_guild) {
+            stats->largest_guild = g_filter.guilds[i].count;
         }
-        prev = &entry->hash_next;
     }
+    stats->bytes = sizeof(user_message_history_t) * (size_t)g_filter.user_capacity +
+                   sizeof(spam_guild_t) * (size_t)g_filter.guild_capacity +
+                   (sizeof(u64map_slot_t) + 1) * (g_filter.index.capacity + g_filter.guild_index.capacity) +
+                   sizeof(spam_raid_window_t) * (size_t)g_filter.raid_window_capacity;
+    stats->evictions = g_filter.evictions;
+    stats->quota_evictions = g_filter.quota_evictions;
+    stats->evicted_active = g_filter.evicted_active;
+    stats->second_chances = g_filter.second_chances;
+    stats->raid_windows = g_filter.raid_window_count;
+    stats->raid_window_limit = g_filter.raid_window_limit;
+    stats->raid_signals = g_filter.raid_signals;
+    stats->raid_flagged = g_filter.raid_flagged;
+    stats->window_moves = g_filter.window_moves;
+    pthread_mutex_unlock(&g_filter.lock);
 }
@@ -5,6 +5,11 @@
  */
 
 #include "modules/terminal.h"
+#include "modules/voice_xp.h"
+#include "modules/level_roles.h"
+#include "modules/spam_filter.h"
+#include "modules/raid_guard.h"
+#include "modules/word_filter.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,6 +49,7 @@ void terminal_cmd_help(void) {
     printf("║  botunban <id> - Unban a user from the bot                ║\n");
     printf("║  botbanlist    - List all bot-banned users                ║\n");
     printf("║  status <msg>  - Set bot status message                   ║\n");
+    printf("║  stats         - Show internal performance counters       ║\n");
     printf("║  quit/exit     - Shutdown the bot                         ║\n");
     printf("╚═══════════════════════════════════════════════════════════╝\n");
 }
@@ -188,6 +194,125 @@ void terminal_cmd_status(const char *args) {
     printf("(Actual status update depends on Concord API implementation)\n");
 }
 
+void terminal_cmd_stats(void) {
+    uint64_t prepares, reuses;
+    db_get_stmt_stats(&g_terminal_bot->database, &prepares, &reuses);
+
+    printf("\n📈 Internal Stats:\n");
+    printf("─────────────────────────────────────────\n");
+    printf("SQL statements: %lu prepared, %lu reused (%.1f reuses per prepare)\n",
+        (unsigned long)prepares, (unsigned long)reuses,
+        prepares > 0 ? (double)reuses / (double)prepares : 0.0);
+
+    uint64_t hits, misses;
+    size_t cached;
+    db_get_settings_cache_stats(&g_terminal_bot->database, &hits, &misses, &cached);
+    printf("Guild settings cache: %zu guilds, %lu hits, %lu misses (%.1f%% hit rate)\n",
+        cached, (unsigned long)hits, (unsigned long)misses,
+        hits + misses > 0 ? 100.0 * (double)hits / (double)(hits + misses) : 0.0);
+    printf("Spam policies: %zu compiled\n", db_get_spam_policy_count(&g_terminal_bot->database));
+
+    uint64_t filtered, probed, false_positives;
+    size_t bans;
+    db_get_ban_filter_stats(&g_terminal_bot->database, &filtered, &probed, &false_positives, &bans);
+    printf("Bot-ban filter: %zu bans, %lu skipped by Bloom, %lu set lookups (%lu false positives)\n",
+        bans, (unsigned long)filtered, (unsigned long)probed, (unsigned long)false_positives);
+
+    uint64_t lb_hits, lb_misses, lb_updates;
+    size_t lb_guilds;
+    leaderboard_get_stats(&g_terminal_bot->leaderboard, &lb_hits, &lb_misses, &lb_updates, &lb_guilds);
+    printf("Leaderboard cache: %zu guilds, %lu hits, %lu loads, %lu rank updates from flushes\n",
+        lb_guilds, (unsigned long)lb_hits, (unsigned long)lb_misses, (unsigned long)lb_updates);
+
+    uint64_t rank_hits, rank_loads;
+    size_t rank_guilds, rank_nodes;
+    rank_index_get_stats(&g_terminal_bot->ranks, &rank_hits, &rank_loads, &rank_guilds, &rank_nodes);
+    printf("Rank index: %zu guilds, %zu tree nodes, %lu lookups, %lu loads\n",
+        rank_guilds, rank_nodes, (unsigned long)rank_hits, (unsigned long)rank_loads);
+
+    uint64_t cd_allowed, cd_suppressed;
+    size_t cd_tracked;
+    xp_cooldown_get_stats(&g_terminal_bot->xp_cooldown, &cd_allowed, &cd_suppressed, &cd_tracked);
+    printf("XP cooldown: %zu members cooling down, %lu awards, %lu messages skipped\n",
+        cd_tracked, (unsigned long)cd_allowed, (unsigned long)cd_suppressed);
+
+    voice_xp_stats_t voice;
+    voice_xp_get_stats(&voice);
+    printf("Voice XP: %zu members in %zu channels, %lu paid last tick, %lu XP over %lu ticks\n",
+        voice.members, voice.channels, (unsigned long)voice.last_awarded,
+        (unsigned long)voice.total_xp, (unsigned long)voice.ticks);
+
+    level_roles_stats_t roles;
+    level_roles_get_stats(&roles);
+    printf("Level roles: %zu queued, %lu granted, %lu removed, %lu deduped, %lu failed, %lu resyncs (%lu pages)\n",
+        roles.queued, (unsigned long)roles.granted, (unsigned long)roles.removed,
+        (unsigned long)roles.deduped, (unsigned long)roles.failed,
+        (unsigned long)roles.resyncs, (unsigned long)roles.pages);
+
+    spam_filter_stats_t spam;
+    spam_filter_get_stats(&spam);
+    printf("Spam filter: %d/%d histories (%d allocated, %zu KB), %d guilds, largest %d of %d allowed\n",
+        spam.tracked, spam.max_users, spam.allocated, spam.bytes / 1024,
+        spam.guilds, spam.largest_guild, spam.guild_quota);
+    printf("Spam evictions: %lu (%lu by guild quota, %lu mid-interval), %lu second chances\n",
+        (unsigned long)spam.evictions, (unsigned long)spam.quota_evictions,
+        (unsigned long)spam.evicted_active, (unsigned long)spam.second_chances);
+    printf("Raid signals: %lu (%lu messages removed), %d/%d guilds watched, %lu windows moved\n",
+        (unsigned long)spam.raid_signals, (unsigned long)spam.raid_flagged,
+        spam.raid_windows, spam.raid_window_limit, (unsigned long)spam.window_moves);
+
+    raid_guard_stats_t guard;
+    raid_guard_get_stats(&guard);
+    printf("Raid lockdowns: %lu (%d active, %lu extended), %lu channels slowed, %lu restored, %lu failed\n",
+        (unsigned long)guard.lockdowns, guard.locked, (unsigned long)guard.extended,
+        (unsigned long)guard.slowed, (unsigned long)guard.restored, (unsigned long)guard.failed);
+    printf("Raid guard: %d guilds counted, %lu events dropped\n", guard.guilds, (unsigned long)guard.untracked);
+
+    word_filter_stats_t words;
+    word_filter_get_stats(&words);
+    printf("Word filter: %d guilds (%zu KB), %lu scans, %lu matches, scan last %luns / avg %luns / max %luns\n",
+        words.guilds, words.bytes / 1024, (unsigned long)words.scans, (unsigned long)words.matches,
+        (unsigned long)words.last_scan_ns, (unsigned long)words.avg_scan_ns, (unsigned long)words.max_scan_ns);
+    printf("Word lists: %zu queued, %lu rebuilt, %lu failed, last build %luus\n",
+        words.queued, (unsigned long)words.rebuilds, (unsigned long)words.failed,
+        (unsigned long)words.last_build_us);
+
+    int readers, busy;
+    uint64_t waits;
+    db_get_pool_stats(&g_terminal_bot->database, &readers, &busy, &waits);
+    printf("Read pool: %d/%d connections busy, %lu checkouts waited\n",
+        busy, readers, (unsigned long)waits);
+
+    db_writer_stats_t writer;
+    db_writer_get_stats(&g_terminal_bot->db_writer, &writer);
+    printf("DB writer: %lu queued, %lu applied, %lu XP batches turned away, %lu waited for room, %lu written directly\n",
+        (unsigned long)writer.queue_depth, (unsigned long)writer.commands, (unsigned long)writer.dropped,
+        (unsigned long)writer.waits, (unsigned long)writer.direct);
+    printf("DB commits: %lu ok, %lu failed, latency last %luus / avg %luus / max %luus\n",
+        (unsigned long)writer.batches, (unsigned long)writer.failed_batches,
+        (unsigned long)writer.last_commit_us, (unsigned long)writer.avg_commit_us,
+        (unsigned long)writer.max_commit_us);
+
+    xp_batcher_stats_t xp;
+    xp_batcher_get_stats(&g_terminal_bot->xp_batcher, &xp);
+    printf("XP batcher: %d pending (capacity %d), %lu batches / %lu entries flushed\n",
+        xp.pending, xp.capacity, (unsigned long)xp.flushes, (unsigned long)xp.entries);
+    printf("XP flush: %lu dropped, %lu requeued, latency last %luus / avg %luus / max %luus\n",
+        (unsigned long)xp.dropped, (unsigned long)xp.requeued, (unsigned long)xp.last_flush_us,
+        (unsigned long)xp.avg_flush_us, (unsigned long)xp.max_flush_us);
+    printf("Level-ups: %lu announced in %lu messages, %lu sends saved\n",
+        (unsigned long)xp.level_ups, (unsigned long)xp.level_up_messages,
+        (unsigned long)(xp.level_ups - xp.level_up_messages));
+    if (xp.journal_enabled) {
+        printf("XP journal: %lu records, %lu syncs, %lu errors, %lu replayed at startup\n",
+            (unsigned long)xp.journal_records, (unsigned long)xp.journal_syncs,
+            (unsigned long)xp.journal_errors, (unsigned long)xp.journal_replayed);
+    } else {
+        printf("XP journal: disabled\n");
+    }
+    printf("─────────────────────────────────────────\n");
+}
+
 static void *terminal_loop(void *arg) {
     (void)arg;
     char line[1024];
@@ -227,6 +352,8 @@ static void *terminal_loop(void *arg) {
             terminal_cmd_botbanlist();
         } else if (strcmp(cmd, "status") == 0) {
             terminal_cmd_status(args);
+        } else if (strcmp(cmd, "stats") == 0) {
+            terminal_cmd_stats();
         } else if (strcmp(cmd, "quit") == 0 || strcmp(cmd, "exit") == 0) {
             printf("💔 Shutting down...\n");
             bot_stop(g_terminal_bot);
@@ -0,0 +1,486 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Voice XP Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "modules/voice_xp.h"
+#include "bot.h"
+#include "modules/raid_guard.h"
+#include "dense_array.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+static voice_xp_t g_voice;
+static yuno_bot_t *g_voice_bot = NULL;
+
+/* What the tick needs to know about a member, copied out under the lock */
+typedef struct {
+    uint64_t user_id;
+    uint64_t guild_id;
+    uint64_t channel_id;
+    int humans;
+    uint8_t in_afk;
+    uint8_t deafened;
+} voice_candidate_t;
+
+static uint32_t now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+/* ---- (a, b) -> index into one of the dense arrays ---- */
+
+static int32_t index_find(const u64map_t *index, uint64_t a, uint64_t b) {
+    const uint64_t *idx = u64map_find(index, a, b);
+    return idx ? (int32_t)*idx : -1;
+}
+
+/* Insert or repoint a key */
+static int index_put(u64map_t *index, uint64_t a, uint64_t b, int32_t idx) {
+    uint64_t *slot = u64map_insert(index, a, b, NULL);
+    if (!slot) return -1;
+    *slot = (uint64_t)idx;
+    return 0;
+}
+
+/* ---- Occupancy - every helper below expects g_voice.lock held ---- */
+
+static int32_t guild_get(uint64_t guild_id, int create) {
+    int32_t idx = index_find(&g_voice.guild_index, guild_id, 0);
+    if (idx >= 0 || !create) return idx;
+
+    if (dense_array_reserve((void **)&g_voice.guilds, &g_voice.guild_capacity, g_voice.guild_count,
+                            sizeof(voice_guild_t)) != 0) {
+        return -1;
+    }
+    idx = (int32_t)g_voice.guild_count;
+    if (index_put(&g_voice.guild_index, guild_id, 0, idx) != 0) return -1;
+
+    g_voice.guilds[idx] = (voice_guild_t){ .guild_id = guild_id };
+    g_voice.guild_count++;
+    return idx;
+}
+
+static void guild_remove(uint64_t guild_id) {
+    int32_t idx = index_find(&g_voice.guild_index, guild_id, 0);
+    if (idx < 0) return;
+
+    u64map_remove(&g_voice.guild_index, guild_id, 0);
+    size_t last = --g_voice.guild_count;
+    if ((size_t)idx != last) {
+        g_voice.guilds[idx] = g_voice.guilds[last];
+        index_put(&g_voice.guild_index, g_voice.guilds[idx].guild_id, 0, idx);
+    }
+}
+
+static int channel_enter(uint64_t channel_id, uint64_t guild_id, int is_bot) {
+    int32_t idx = index_find(&g_voice.channel_index, channel_id, 0);
+
+    if (idx < 0) {
+        if (dense_array_reserve((void **)&g_voice.channels, &g_voice.channel_capacity,
+                                g_voice.channel_count, sizeof(voice_channel_t)) != 0) {
+            return -1;
+        }
+        idx = (int32_t)g_voice.channel_count;
+        if (index_put(&g_voice.channel_index, channel_id, 0, idx) != 0) return -1;
+
+        g_voice.channels[idx] = (voice_channel_t){ .channel_id = channel_id, .guild_id = guild_id };
+        g_voice.channel_count++;
+    }
+
+    g_voice.channels[idx].occupants++;
+    g_voice.channels[idx].humans += !is_bot;
+    return 0;
+}
+
+static void channel_leave(uint64_t channel_id, int is_bot) {
+    int32_t idx = index_find(&g_voice.channel_index, channel_id, 0);
+    if (idx < 0) return;
+
+    voice_channel_t *channel = &g_voice.channels[idx];
+    channel->humans -= !is_bot;
+    if (--channel->occupants > 0) return;
+
+    /* Empty - swap the last channel into its place */
+    u64map_remove(&g_voice.channel_index, channel_id, 0);
+    size_t last = --g_voice.channel_count;
+    if ((size_t)idx != last) {
+        g_voice.channels[idx] = g_voice.channels[last];
+        index_put(&g_voice.channel_index, g_voice.channels[idx].channel_id, 0, idx);
+    }
+}
+
+/* Drop a member whose channel has already been left */
+static void member_forget(size_t idx) {
+    voice_member_t *member = &g_voice.members[idx];
+
+    int32_t guild = guild_get(member->guild_id, 0);
+    if (guild >= 0) g_voice.guilds[guild].members--;
+
+    u64map_remove(&g_voice.member_index, member->guild_id, member->user_id);
+    size_t last = --g_voice.member_count;
+    if (idx != last) {
+        g_voice.members[idx] = g_voice.members[last];
+        index_put(&g_voice.member_index, g_voice.members[idx].guild_id, g_voice.members[idx].user_id,
+                  (int32_t)idx);
+    }
+}
+
+static void member_remove_at(size_t idx) {
+    channel_leave(g_voice.members[idx].channel_id, g_voice.members[idx].is_bot);
+    member_forget(idx);
+}
+
+/* Correct a tracked member's bot flag, and their channel's human count with it */
+static void member_set_bot(voice_member_t *member, int is_bot) {
+    if (is_bot < 0 || member->is_bot == (uint8_t)is_bot) return;
+
+    int32_t channel = index_find(&g_voice.channel_index, member->channel_id, 0);
+    if (channel >= 0) {
+        g_voice.channels[channel].humans += is_bot ? -1 : 1;
+    }
+    member->is_bot = (uint8_t)is_bot;
+}
+
+/* Join, move or re-flag a member. Moving channels keeps their join time.
+ * is_bot is -1 when the event didn't say - a newcomer then counts as human. */
+static void member_update(uint64_t guild_id, uint64_t user_id, uint64_t channel_id,
+                          int is_bot, int deafened, uint32_t now) {
+    int32_t idx = index_find(&g_voice.member_index, guild_id, user_id);
+
+    if (idx >= 0) {
+        voice_member_t *member = &g_voice.members[idx];
+        member->deafened = (uint8_t)deafened;
+        member_set_bot(member, is_bot);
+        if (member->channel_id != channel_id) {
+            channel_leave(member->channel_id, member->is_bot);
+            if (channel_enter(channel_id, guild_id, member->is_bot) != 0) {
+                /* Can't track the new channel - forget the member until they move again */
+                member_forget((size_t)idx);
+                return;
+            }
+            member->channel_id = channel_id;
+        }
+        return;
+    }
+
+    is_bot = is_bot > 0;
+    int32_t guild = guild_get(guild_id, 1);
+    if (guild < 0 ||
+        dense_array_reserve((void **)&g_voice.members, &g_voice.member_capacity, g_voice.member_count,
+                            sizeof(voice_member_t)) != 0) {
+        return;
+    }
+    idx = (int32_t)g_voice.member_count;
+    if (index_put(&g_voice.member_index, guild_id, user_id, idx) != 0) return;
+    if (channel_enter(channel_id, guild_id, is_bot) != 0) {
+        u64map_remove(&g_voice.member_index, guild_id, user_id);
+        return;
+    }
+
+    g_voice.members[idx] = (voice_member_t){
+        .user_id = user_id,
+        .guild_id = guild_id,
+        .channel_id = channel_id,
+        .joined = now,
+        .is_bot = (uint8_t)is_bot,
+        .deafened = (uint8_t)deafened
+    };
+    g_voice.member_count++;
+    g_voice.guilds[guild].members++;
+}
+
+/* -1 when the state carries no member - guild create leaves it out */
+static int state_is_bot(const struct discord_voice_state *state) {
+    if (!state->member || !state->member->user) return -1;
+    return state->member->user->bot;
+}
+
+/* ---- Lifecycle ---- */
+
+int voice_xp_init(yuno_bot_t *bot) {
+    memset(&g_voice, 0, sizeof(voice_xp_t));
+    g_voice_bot = bot;
+
+    if (u64map_init(&g_voice.member_index, VOICE_INDEX_INITIAL_CAPACITY) != 0 ||
+        u64map_init(&g_voice.channel_index, VOICE_INDEX_INITIAL_CAPACITY) != 0 ||
+        u64map_init(&g_voice.guild_index, VOICE_INDEX_INITIAL_CAPACITY) != 0) {
+        voice_xp_cleanup();
+        return -1;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_voice.wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&g_voice.lock, NULL);
+    g_voice.last_tick = now_seconds();
+    return 0;
+}
+
+void voice_xp_cleanup(void) {
+    u64map_free(&g_voice.member_index);
+    u64map_free(&g_voice.channel_index);
+    u64map_free(&g_voice.guild_index);
+    free(g_voice.members);
+    free(g_voice.channels);
+    free(g_voice.guilds);
+    g_voice.members = NULL;
+    g_voice.channels = NULL;
+    g_voice.guilds = NULL;
+    g_voice.member_count = g_voice.channel_count = g_voice.guild_count = 0;
+    g_voice.member_capacity = g_voice.channel_capacity = g_voice.guild_capacity = 0;
+    g_voice_bot = NULL;
+}
+
+static void *voice_xp_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_voice.lock);
+    while (g_voice.running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += VOICE_XP_TICK_SECONDS;
+
+        while (g_voice.running &&
+               pthread_cond_timedwait(&g_voice.wakeup, &g_voice.lock, &deadline) != ETIMEDOUT) {
+        }
+        if (!g_voice.running) break;
+
+        pthread_mutex_unlock(&g_voice.lock);
+        voice_xp_tick();
+        pthread_mutex_lock(&g_voice.lock);
+    }
+    pthread_mutex_unlock(&g_voice.lock);
+    return NULL;
+}
+
+int voice_xp_start(void) {
+    g_voice.running = 1;
+    if (pthread_create(&g_voice.thread, NULL, voice_xp_thread, NULL) != 0) {
+        g_voice.running = 0;
+        return -1;
+    }
+    printf("🎙️ Voice XP started~\n");
+    return 0;
+}
+
+void voice_xp_stop(void) {
+    pthread_mutex_lock(&g_voice.lock);
+    if (!g_voice.running) {
+        pthread_mutex_unlock(&g_voice.lock);
+        return;
+    }
+    g_voice.running = 0;
+    pthread_cond_signal(&g_voice.wakeup);
+    pthread_mutex_unlock(&g_voice.lock);
+
+    pthread_join(g_voice.thread, NULL);
+}
+
+/* ---- Events ---- */
+
+void voice_xp_on_voice_state(const struct discord_voice_state *state) {
+    if (!g_voice_bot || state->guild_id == 0) return;
+
+    pthread_mutex_lock(&g_voice.lock);
+    if (state->channel_id == 0) {
+        int32_t idx = index_find(&g_voice.member_index, state->guild_id, state->user_id);
+        if (idx >= 0) member_remove_at((size_t)idx);
+    } else {
+        member_update(state->guild_id, state->user_id, state->channel_id, state_is_bot(state),
+                      state->deaf || state->self_deaf, now_seconds());
+    }
+    pthread_mutex_unlock(&g_voice.lock);
+}
+
+void voice_xp_on_guild_create(const struct discord_guild *guild) {
+    if (!g_voice_bot) return;
+    uint32_t now = now_seconds();
+
+    /* Voice states inside a guild create carry neither the guild id nor the
+     * member - who's a bot comes from the guild's member list instead */
+    u64map_t bots;
+    int have_bots = guild->members && u64map_init(&bots, U64MAP_MIN_CAPACITY) == 0;
+    for (int i = 0; have_bots && i < guild->members->size; i++) {
+        const struct discord_user *user = guild->members->array[i].user;
+        if (user && user->bot) u64map_insert(&bots, user->id, 0, NULL);
+    }
+
+    pthread_mutex_lock(&g_voice.lock);
+    if (guild->voice_states) {
+        u64map_reserve(&g_voice.member_index, g_voice.member_count + (size_t)guild->voice_states->size);
+    }
+    int32_t idx = guild_get(guild->id, 1);
+    if (idx >= 0) {
+        g_voice.guilds[idx].afk_channel_id = guild->afk_channel_id;
+
+        /* Resumed after an outage - the snapshot below replaces whatever we had */
+        if (g_voice.guilds[idx].members > 0) {
+            for (size_t i = g_voice.member_count; i-- > 0;) {
+                if (g_voice.members[i].guild_id == guild->id) {
+                    member_remove_at(i);
+                }
+            }
+        }
+    }
+
+    for (int i = 0; guild->voice_states && i < guild->voice_states->size; i++) {
+        const struct discord_voice_state *state = &guild->voice_states->array[i];
+        if (state->channel_id != 0) {
+            int is_bot = state_is_bot(state);
+            if (is_bot < 0 && have_bots) is_bot = u64map_find(&bots, state->user_id, 0) != NULL;
+            member_update(guild->id, state->user_id, state->channel_id, is_bot,
+                          state->deaf || state->self_deaf, now);
+        }
+    }
+    pthread_mutex_unlock(&g_voice.lock);
+
+    if (have_bots) u64map_free(&bots);
+}
+
+void voice_xp_on_member_update(uint64_t guild_id, const struct discord_user *user) {
+    if (!g_voice_bot || !user) return;
+
+    pthread_mutex_lock(&g_voice.lock);
+    int32_t idx = index_find(&g_voice.member_index, guild_id, user->id);
+    if (idx >= 0) member_set_bot(&g_voice.members[idx], user->bot);
+    pthread_mutex_unlock(&g_voice.lock);
+}
+
+/* Left, kicked or gone unavailable - no more voice states will come for it, so nobody
+ * in there may keep earning. An outage's guild create brings the members back. */
+void voice_xp_on_guild_delete(const struct discord_guild *guild) {
+    if (!g_voice_bot) return;
+
+    pthread_mutex_lock(&g_voice.lock);
+    for (size_t i = g_voice.member_count; i-- > 0;) {
+        if (g_voice.members[i].guild_id == guild->id) {
+            member_remove_at(i);
+        }
+    }
+
+    /* Members take their channels with them - this only catches a count gone astray */
+    for (size_t i = g_voice.channel_count; i-- > 0;) {
+        if (g_voice.channels[i].guild_id == guild->id) {
+            uint64_t channel_id = g_voice.channels[i].channel_id;
+            u64map_remove(&g_voice.channel_index, channel_id, 0);
+            size_t last = --g_voice.channel_count;
+            if (i != last) {
+                g_voice.channels[i] = g_voice.channels[last];
+                index_put(&g_voice.channel_index, g_voice.channels[i].channel_id, 0, (int32_t)i);
+            }
+        }
+    }
+
+    guild_remove(guild->id);
+    pthread_mutex_unlock(&g_voice.lock);
+}
+
+/* ---- Tick ---- */
+
+static int compare_candidates(const void *a, const void *b) {
+    uint64_t ga = ((const voice_candidate_t *)a)->guild_id;
+    uint64_t gb = ((const voice_candidate_t *)b)->guild_id;
+    return (ga > gb) - (ga < gb);
+}
+
+void voice_xp_tick(void) {
+    yuno_bot_t *bot = g_voice_bot;
+    if (!bot) return;
+
+    uint32_t now = now_seconds();
+
+    /* Copy out who sat through the whole interval, then drop the lock before
+     * touching the database so voice events never wait on it */
+    pthread_mutex_lock(&g_voice.lock);
+    uint32_t since = g_voice.last_tick;
+    g_voice.last_tick = now;
+
+    voice_candidate_t *candidates = malloc(sizeof(voice_candidate_t) * (g_voice.member_count + 1));
+    size_t count = 0;
+    for (size_t i = 0; candidates && i < g_voice.member_count; i++) {
+        const voice_member_t *member = &g_voice.members[i];
+        if (member->is_bot || member->joined > since) continue;
+
+        int32_t channel = index_find(&g_voice.channel_index, member->channel_id, 0);
+        int32_t guild = guild_get(member->guild_id, 0);
+        candidates[count++] = (voice_candidate_t){
+            .user_id = member->user_id,
+            .guild_id = member->guild_id,
+            .channel_id = member->channel_id,
+            .humans = channel >= 0 ? g_voice.channels[channel].humans : 0,
+            .in_afk = guild >= 0 && g_voice.guilds[guild].afk_channel_id == member->channel_id,
+            .deafened = member->deafened
+        };
+    }
+    pthread_mutex_unlock(&g_voice.lock);
+
+    if (!candidates) {
+        fprintf(stderr, "💔 Voice XP tick skipped - out of memory\n");
+        return;
+    }
+
+    /* One config read per guild, then every payout goes to the batcher in one go */
+    qsort(candidates, count, sizeof(voice_candidate_t), compare_candidates);
+
+    pending_xp_t *entries = malloc(sizeof(pending_xp_t) * (count + 1));
+    int awarded = 0;
+    uint64_t xp_total = 0;
+    voice_xp_config_t config = { .enabled = 0 };
+    time_t added_at = time(NULL);
+
+    for (size_t i = 0; entries && i < count; i++) {
+        const voice_candidate_t *c = &candidates[i];
+        if (i == 0 || c->guild_id != candidates[i - 1].guild_id) {
+            /* A guild in a raid lockdown earns nothing until it ends */
+            if (db_get_voice_xp_config(&bot->database, c->guild_id, &config) != 0 ||
+                raid_guard_locked(c->guild_id)) {
+                config.enabled = 0;
+            }
+        }
+
+        if (!config.enabled || config.xp_per_minute <= 0) continue;
+        if (c->humans < config.min_users) continue;
+        if (config.ignore_afk && (c->in_afk || c->deafened)) continue;
+
+        entries[awarded++] = (pending_xp_t){
+            .user_id = c->user_id,
+            .guild_id = c->guild_id,
+            .channel_id = c->channel_id,
+            .xp_amount = config.xp_per_minute,
+            .added_at = added_at
+        };
+        xp_total += (uint64_t)config.xp_per_minute;
+    }
+
+    if (awarded > 0) {
+        xp_batcher_add_many(bot, entries, awarded);
+    }
+    free(entries);
+    free(candidates);
+
+    pthread_mutex_lock(&g_voice.lock);
+    g_voice.ticks++;
+    g_voice.last_awarded = (uint64_t)awarded;
+    g_voice.total_awarded += (uint64_t)awarded;
+    g_voice.total_xp += xp_total;
+    pthread_mutex_unlock(&g_voice.lock);
+}
+
+void voice_xp_get_stats(voice_xp_stats_t *stats) {
+    pthread_mutex_lock(&g_voice.lock);
+    stats->members = g_voice.member_count;
+    stats->channels = g_voice.channel_count;
+    stats->ticks = g_voice.ticks;
+    stats->last_awarded = g_voice.last_awarded;
+    stats->total_awarded = g_voice.total_awarded;
+    stats->total_xp = g_voice.total_xp;
+    pthread_mutex_unlock(&g_voice.lock);
+}
@@ -0,0 +1,369 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Banned Word Filter Module
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "modules/word_filter.h"
+#include "bot.h"
+#include "content_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+_Static_assert(MAX_BANNED_WORD_LEN <= WORD_MAX_LENGTH, "stored words must fit the automaton");
+
+static word_filter_t g_words;
+static yuno_bot_t *g_words_bot = NULL;
+
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void release(word_filter_set_t *set) {
+    if (set && atomic_fetch_sub(&set->refs, 1) == 1) {
+        word_automaton_free(&set->automaton);
+        free(set);
+    }
+}
+
+/* ---- Guild table - callers hold g_words.lock for writing ---- */
+
+static word_filter_guild_t *add_guild(uint64_t guild_id) {
+    if (g_words.guild_count == g_words.guild_capacity) {
+        int capacity = g_words.guild_capacity * 2;
+        word_filter_guild_t *guilds = realloc(g_words.guilds, sizeof(word_filter_guild_t) * (size_t)capacity);
+        if (!guilds) return NULL;
+        g_words.guilds = guilds;
+        g_words.guild_capacity = capacity;
+    }
+
+    int inserted;
+    uint64_t *slot = u64map_insert(&g_words.index, guild_id, 0, &inserted);
+    if (!slot) return NULL;
+    *slot = (uint64_t)g_words.guild_count;
+
+    word_filter_guild_t *guild = &g_words.guilds[g_words.guild_count++];
+    guild->guild_id = guild_id;
+    guild->set = NULL;
+    return guild;
+}
+
+/* Swap a guild's compiled list for set (NULL = no words). Scans already
+ * running finish on the old one. */
+static int install(uint64_t guild_id, word_filter_set_t *set) {
+    if (set && set->automaton.words == 0) {
+        release(set);
+        set = NULL;
+    }
+
+    pthread_rwlock_wrlock(&g_words.lock);
+    const uint64_t *idx = u64map_find(&g_words.index, guild_id, 0);
+    word_filter_guild_t *guild = idx ? &g_words.guilds[*idx] : (set ? add_guild(guild_id) : NULL);
+    word_filter_set_t *old = NULL;
+    if (guild) {
+        old = guild->set;
+        guild->set = set;
+        atomic_fetch_add(&g_words.active, (set != NULL) - (old != NULL));
+    }
+    pthread_rwlock_unlock(&g_words.lock);
+
+    if (!guild) {
+        release(set);
+        return set ? -1 : 0;
+    }
+    release(old);
+    return 0;
+}
+
+/* ---- Rebuilds ---- */
+
+static void queue_rebuild(uint64_t guild_id) {
+    pthread_mutex_lock(&g_words.queue_lock);
+    size_t i = 0;
+    while (i < g_words.dirty_count && g_words.dirty[i] != guild_id) i++;
+    if (i == g_words.dirty_count) {
+        if (g_words.dirty_count == g_words.dirty_capacity) {
+            size_t capacity = g_words.dirty_capacity ? g_words.dirty_capacity * 2 : 16;
+            uint64_t *dirty = realloc(g_words.dirty, sizeof(uint64_t) * capacity);
+            if (!dirty) {
+                g_words.failed++;
+                pthread_mutex_unlock(&g_words.queue_lock);
+                return;
+            }
+            g_words.dirty = dirty;
+            g_words.dirty_capacity = capacity;
+        }
+        g_words.dirty[g_words.dirty_count++] = guild_id;
+        pthread_cond_signal(&g_words.wakeup);
+    }
+    pthread_mutex_unlock(&g_words.queue_lock);
+}
+
+/* Compile the guild's list as it is in the database now. An edit made
+ * while this runs queues the guild again, so the newest list always wins. */
+static void rebuild(uint64_t guild_id) {
+    uint64_t started = monotonic_ns();
+    banned_word_t *words;
+    size_t count;
+    word_filter_set_t *set = NULL;
+
+    int ok = db_get_banned_words(&g_words_bot->database, guild_id, &words, &count) == 0;
+    if (ok && count > 0) {
+        const char **list = malloc(sizeof(const char *) * count);
+        set = calloc(1, sizeof(word_filter_set_t));
+        if (list && set) {
+            for (size_t i = 0; i < count; i++) list[i] = words[i].word;
+            ok = word_automaton_build(&set->automaton, list, count) == 0;
+        } else {
+            ok = 0;
+        }
+        free(list);
+        if (ok) {
+            atomic_init(&set->refs, 1);
+        } else {
+            free(set);
+            set = NULL;
+        }
+    }
+    free(words);
+    if (ok && install(guild_id, set) != 0) ok = 0;
+
+    uint64_t elapsed_us = (monotonic_ns() - started) / 1000;
+    pthread_mutex_lock(&g_words.queue_lock);
+    if (ok) {
+        g_words.rebuilds++;
+        g_words.last_build_us = elapsed_us;
+    } else {
+        g_words.failed++;
+        fprintf(stderr, "💔 Couldn't rebuild the word filter for guild %lu\n", (unsigned long)guild_id);
+    }
+    pthread_mutex_unlock(&g_words.queue_lock);
+}
+
+static void *word_filter_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_words.queue_lock);
+    while (g_words.running) {
+        if (g_words.dirty_count == 0) {
+            pthread_cond_wait(&g_words.wakeup, &g_words.queue_lock);
+            continue;
+        }
+        uint64_t guild_id = g_words.dirty[--g_words.dirty_count];
+        pthread_mutex_unlock(&g_words.queue_lock);
+
+        rebuild(guild_id);
+
+        pthread_mutex_lock(&g_words.queue_lock);
+    }
+    pthread_mutex_unlock(&g_words.queue_lock);
+    return NULL;
+}
+
+/* ---- Lifecycle ---- */
+
+int word_filter_init(yuno_bot_t *bot) {
+    memset(&g_words, 0, sizeof(word_filter_t));
+    atomic_init(&g_words.active, 0);
+    atomic_init(&g_words.scans, 0);
+    atomic_init(&g_words.matches, 0);
+    atomic_init(&g_words.last_scan_ns, 0);
+    atomic_init(&g_words.max_scan_ns, 0);
+    atomic_init(&g_words.total_scan_ns, 0);
+    pthread_rwlock_init(&g_words.lock, NULL);
+    pthread_mutex_init(&g_words.queue_lock, NULL);
+    pthread_cond_init(&g_words.wakeup, NULL);
+
+    g_words.guild_capacity = WORD_FILTER_INITIAL_GUILDS;
+    g_words.guilds = malloc(sizeof(word_filter_guild_t) * WORD_FILTER_INITIAL_GUILDS);
+    if (!g_words.guilds || u64map_init(&g_words.index, WORD_FILTER_INITIAL_GUILDS) != 0) {
+        free(g_words.guilds);
+        g_words.guilds = NULL;
+        return -1;
+    }
+
+    g_words_bot = bot;
+    return 0;
+}
+
+int word_filter_start(void) {
+    if (!g_words_bot) return 0;
+
+    /* Every guild with a list starts out queued */
+    uint64_t *guild_ids;
+    size_t count;
+    if (db_get_banned_word_guilds(&g_words_bot->database, &guild_ids, &count) != 0) {
+        return -1;
+    }
+    pthread_mutex_lock(&g_words.queue_lock);
+    free(g_words.dirty);
+    g_words.dirty = guild_ids;
+    g_words.dirty_count = count;
+    g_words.dirty_capacity = count;
+    g_words.running = 1;
+    pthread_mutex_unlock(&g_words.queue_lock);
+
+    if (pthread_create(&g_words.thread, NULL, word_filter_thread, NULL) != 0) {
+        g_words.running = 0;
+        return -1;
+    }
+    if (count > 0) {
+        printf("🚫 Compiling banned word lists for %zu guilds~\n", count);
+    }
+    return 0;
+}
+
+void word_filter_stop(void) {
+    pthread_mutex_lock(&g_words.queue_lock);
+    if (!g_words.running) {
+        pthread_mutex_unlock(&g_words.queue_lock);
+        return;
+    }
+    g_words.running = 0;
+    pthread_cond_signal(&g_words.wakeup);
+    pthread_mutex_unlock(&g_words.queue_lock);
+    pthread_join(g_words.thread, NULL);
+}
+
+void word_filter_cleanup(void) {
+    for (int i = 0; i < g_words.guild_count; i++) {
+        release(g_words.guilds[i].set);
+    }
+    free(g_words.guilds);
+    g_words.guilds = NULL;
+    g_words.guild_count = 0;
+    atomic_store(&g_words.active, 0);
+    u64map_free(&g_words.index);
+    free(g_words.dirty);
+    g_words.dirty = NULL;
+    g_words.dirty_count = 0;
+    pthread_rwlock_destroy(&g_words.lock);
+    pthread_mutex_destroy(&g_words.queue_lock);
+    pthread_cond_destroy(&g_words.wakeup);
+    g_words_bot = NULL;
+}
+
+/* ---- Editing ---- */
+
+/* Store words the way they are matched, so case and spacing variants are
+ * one entry - -1 if too long or there's nothing to match */
+static int normalize_word(const char *word, char out[MAX_BANNED_WORD_LEN + 1]) {
+    size_t length = strlen(word);
+    if (length > MAX_BANNED_WORD_LEN) return -1;
+    length = content_normalize(word, length, out);
+    out[length] = '\0';
+
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)out[i];
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80) return 0;
+    }
+    return -1;
+}
+
+int word_filter_add(uint64_t guild_id, const char *word) {
+    char normalized[MAX_BANNED_WORD_LEN + 1];
+    banned_word_t *words;
+    size_t count;
+
+    if (!g_words_bot) return -1;
+    if (normalize_word(word, normalized) != 0) return 2;
+
+    if (db_get_banned_words(&g_words_bot->database, guild_id, &words, &count) != 0) {
+        return -1;
+    }
+    free(words);
+    if (count >= WORD_FILTER_MAX_WORDS) return 2;
+
+    int rc = db_add_banned_word(&g_words_bot->database, guild_id, normalized);
+    if (rc == 0) queue_rebuild(guild_id);
+    return rc;
+}
+
+int word_filter_remove(uint64_t guild_id, const char *word) {
+    char normalized[MAX_BANNED_WORD_LEN + 1];
+
+    if (!g_words_bot) return -1;
+    if (normalize_word(word, normalized) != 0) return 1;
+
+    int rc = db_remove_banned_word(&g_words_bot->database, guild_id, normalized);
+    if (rc == 0) queue_rebuild(guild_id);
+    return rc;
+}
+
+/* ---- Scanning ---- */
+
+int word_filter_check(uint64_t guild_id, const char *content) {
+    /* Most bots have no lists at all - skip even the lookup */
+    if (atomic_load_explicit(&g_words.active, memory_order_relaxed) == 0) return 0;
+
+    word_filter_set_t *set = NULL;
+    pthread_rwlock_rdlock(&g_words.lock);
+    const uint64_t *idx = u64map_find(&g_words.index, guild_id, 0);
+    if (idx) {
+        set = g_words.guilds[*idx].set;
+        if (set) atomic_fetch_add_explicit(&set->refs, 1, memory_order_relaxed);
+    }
+    pthread_rwlock_unlock(&g_words.lock);
+    if (!set) return 0;
+
+    uint64_t started = monotonic_ns();
+    int found = word_automaton_scan(&set->automaton, content, strlen(content)) >= 0;
+    uint64_t elapsed = monotonic_ns() - started;
+    release(set);
+
+    atomic_fetch_add_explicit(&g_words.scans, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_words.matches, (uint_fast64_t)found, memory_order_relaxed);
+    atomic_store_explicit(&g_words.last_scan_ns, elapsed, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_words.total_scan_ns, elapsed, memory_order_relaxed);
+    if (elapsed > atomic_load_explicit(&g_words.max_scan_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&g_words.max_scan_ns, elapsed, memory_order_relaxed);
+    }
+    return found;
+}
+
+int word_filter_handle(yuno_bot_t *bot, const struct discord_message *msg) {
+    if (!word_filter_check(msg->guild_id, msg->content)) {
+        return 0;
+    }
+
+    discord_delete_message(bot->client, msg->channel_id, msg->id, NULL);
+
+    char notice[128];
+    snprintf(notice, sizeof(notice), "<@%lu> That word isn't allowed here~ 💢",
+             (unsigned long)msg->author->id);
+    struct discord_create_message response = { .content = notice };
+    discord_create_message(bot->client, msg->channel_id, &response, NULL);
+    return 1;
+}
+
+void word_filter_get_stats(word_filter_stats_t *stats) {
+    memset(stats, 0, sizeof(word_filter_stats_t));
+    if (!g_words_bot) return;
+
+    pthread_rwlock_rdlock(&g_words.lock);
+    for (int i = 0; i < g_words.guild_count; i++) {
+        const word_filter_set_t *set = g_words.guilds[i].set;
+        if (set) {
+            stats->guilds++;
+            stats->bytes += (size_t)set->automaton.size * sizeof(word_cell_t);
+        }
+    }
+    pthread_rwlock_unlock(&g_words.lock);
+
+    stats->scans = atomic_load(&g_words.scans);
+    stats->matches = atomic_load(&g_words.matches);
+    stats->last_scan_ns = atomic_load(&g_words.last_scan_ns);
+    stats->max_scan_ns = atomic_load(&g_words.max_scan_ns);
+    stats->avg_scan_ns = stats->scans > 0 ? atomic_load(&g_words.total_scan_ns) / stats->scans : 0;
+
+    pthread_mutex_lock(&g_words.queue_lock);
+    stats->queued = g_words.dirty_count;
+    stats->rebuilds = g_words.rebuilds;
+    stats->failed = g_words.failed;
+    stats->last_build_us = g_words.last_build_us;
+    pthread_mutex_unlock(&g_words.queue_lock);
+}
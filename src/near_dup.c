@@ -0,0 +1,64 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Near-Duplicate Message Window
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "near_dup.h"
+#include <string.h>
+
+void near_dup_reset(near_dup_window_t *window) {
+    memset(window, 0, sizeof(near_dup_window_t));
+}
+
+/* Without -mpopcnt the builtin is a library call */
+static inline int bit_count(uint64_t x) {
+    x -= (x >> 1) & 0x5555555555555555ULL;
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+static inline unsigned bucket_of(uint64_t simhash, int band) {
+    return (unsigned)(simhash >> (NEAR_DUP_BAND_BITS * band)) & (NEAR_DUP_BUCKETS - 1);
+}
+
+int near_dup_add(near_dup_window_t *window, uint64_t user_id, uint64_t simhash,
+                 uint32_t now, uint32_t interval, int limit) {
+    uint64_t users[NEAR_DUP_MAX_USERS];
+    int distinct = 1;
+
+    if (limit > NEAR_DUP_MAX_USERS) limit = NEAR_DUP_MAX_USERS;
+    users[0] = user_id;
+
+    /* Newest first down each bucket, stopping at the first message that is
+     * too old or already overwritten */
+    for (int band = 0; band < NEAR_DUP_BANDS && distinct < limit; band++) {
+        uint32_t n = window->heads[band][bucket_of(simhash, band)];
+        while (n != 0 && window->count - n < NEAR_DUP_WINDOW && distinct < limit) {
+            const near_dup_entry_t *entry = &window->entries[n % NEAR_DUP_WINDOW];
+            if ((int32_t)(now - entry->time) > (int32_t)interval) break;
+
+            if (bit_count(entry->simhash ^ simhash) <= NEAR_DUP_MAX_DISTANCE) {
+                int seen = 0;
+                for (int i = 0; i < distinct && !seen; i++) {
+                    seen = users[i] == entry->user_id;
+                }
+                if (!seen) users[distinct++] = entry->user_id;
+            }
+            n = entry->next[band];
+        }
+    }
+
+    uint32_t n = ++window->count;
+    near_dup_entry_t *entry = &window->entries[n % NEAR_DUP_WINDOW];
+    entry->simhash = simhash;
+    entry->user_id = user_id;
+    entry->time = now;
+    for (int band = 0; band < NEAR_DUP_BANDS; band++) {
+        uint32_t *head = &window->heads[band][bucket_of(simhash, band)];
+        entry->next[band] = *head;
+        *head = n;
+    }
+    return distinct;
+}
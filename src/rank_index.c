@@ -0,0 +1,346 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Rank Index
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "rank_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NIL 0u
+#define N(t, i) ((t)->nodes[i])
+
+static uint32_t tree_rand(rank_tree_t *tree) {
+    uint32_t x = tree->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    tree->rng = x;
+    return x;
+}
+
+static inline void pull(rank_tree_t *tree, uint32_t i) {
+    N(tree, i).size = N(tree, i).members + N(tree, N(tree, i).left).size + N(tree, N(tree, i).right).size;
+}
+
+static rank_tree_t *tree_create(uint32_t capacity, uint32_t seed) {
+    rank_tree_t *tree = calloc(1, sizeof(rank_tree_t));
+    if (!tree) return NULL;
+
+    tree->capacity = capacity < 16 ? 16 : capacity;
+    tree->nodes = calloc(tree->capacity, sizeof(rank_node_t));
+    if (!tree->nodes) {
+        free(tree);
+        return NULL;
+    }
+    tree->used = 1; /* Slot 0 is nil: size 0, no children */
+    tree->rng = seed | 1;
+    return tree;
+}
+
+static void tree_destroy(rank_tree_t *tree) {
+    if (!tree) return;
+    free(tree->nodes);
+    free(tree);
+}
+
+/* May move nodes[] - callers index through the tree, never hold node pointers */
+static uint32_t node_alloc(rank_tree_t *tree, int64_t xp, uint32_t members) {
+    uint32_t i;
+
+    if (tree->free_list != NIL) {
+        i = tree->free_list;
+        tree->free_list = N(tree, i).left;
+    } else {
+        if (tree->used == tree->capacity) {
+            rank_node_t *nodes = realloc(tree->nodes, sizeof(rank_node_t) * tree->capacity * 2);
+            if (!nodes) {
+                tree->broken = 1;
+                return NIL;
+            }
+            tree->nodes = nodes;
+            tree->capacity *= 2;
+        }
+        i = tree->used++;
+    }
+
+    N(tree, i).xp = xp;
+    N(tree, i).members = members;
+    N(tree, i).size = members;
+    N(tree, i).left = NIL;
+    N(tree, i).right = NIL;
+    N(tree, i).priority = tree_rand(tree);
+    return i;
+}
+
+static void node_free(rank_tree_t *tree, uint32_t i) {
+    N(tree, i).left = tree->free_list;
+    tree->free_list = i;
+}
+
+static uint32_t rotate_right(rank_tree_t *tree, uint32_t n) {
+    uint32_t l = N(tree, n).left;
+    N(tree, n).left = N(tree, l).right;
+    N(tree, l).right = n;
+    pull(tree, n);
+    pull(tree, l);
+    return l;
+}
+
+static uint32_t rotate_left(rank_tree_t *tree, uint32_t n) {
+    uint32_t r = N(tree, n).right;
+    N(tree, n).right = N(tree, r).left;
+    N(tree, r).left = n;
+    pull(tree, n);
+    pull(tree, r);
+    return r;
+}
+
+static uint32_t tree_insert(rank_tree_t *tree, uint32_t n, int64_t xp) {
+    if (n == NIL) {
+        return node_alloc(tree, xp, 1);
+    }
+
+    if (xp == N(tree, n).xp) {
+        N(tree, n).members++;
+        N(tree, n).size++;
+        return n;
+    }
+
+    if (xp < N(tree, n).xp) {
+        uint32_t l = tree_insert(tree, N(tree, n).left, xp);
+        N(tree, n).left = l;
+        if (l != NIL && N(tree, l).priority > N(tree, n).priority) {
+            return rotate_right(tree, n);
+        }
+    } else {
+        uint32_t r = tree_insert(tree, N(tree, n).right, xp);
+        N(tree, n).right = r;
+        if (r != NIL && N(tree, r).priority > N(tree, n).priority) {
+            return rotate_left(tree, n);
+        }
+    }
+    pull(tree, n);
+    return n;
+}
+
+/* Join two treaps where every xp in a is below every xp in b */
+static uint32_t tree_merge(rank_tree_t *tree, uint32_t a, uint32_t b) {
+    if (a == NIL) return b;
+    if (b == NIL) return a;
+
+    if (N(tree, a).priority > N(tree, b).priority) {
+        N(tree, a).right = tree_merge(tree, N(tree, a).right, b);
+        pull(tree, a);
+        return a;
+    }
+    N(tree, b).left = tree_merge(tree, a, N(tree, b).left);
+    pull(tree, b);
+    return b;
+}
+
+static uint32_t tree_erase(rank_tree_t *tree, uint32_t n, int64_t xp) {
+    if (n == NIL) {
+        tree->broken = 1; /* Value we never saw - the index is out of sync */
+        return NIL;
+    }
+
+    if (xp < N(tree, n).xp) {
+        N(tree, n).left = tree_erase(tree, N(tree, n).left, xp);
+    } else if (xp > N(tree, n).xp) {
+        N(tree, n).right = tree_erase(tree, N(tree, n).right, xp);
+    } else if (N(tree, n).members > 1) {
+        N(tree, n).members--;
+    } else {
+        uint32_t joined = tree_merge(tree, N(tree, n).left, N(tree, n).right);
+        node_free(tree, n);
+        return joined;
+    }
+    pull(tree, n);
+    return n;
+}
+
+/* Members holding strictly more than xp */
+static uint64_t tree_count_above(const rank_tree_t *tree, int64_t xp) {
+    uint64_t above = 0;
+    uint32_t n = tree->root;
+
+    while (n != NIL) {
+        const rank_node_t *node = &tree->nodes[n];
+        if (xp < node->xp) {
+            above += node->members + tree->nodes[node->right].size;
+            n = node->left;
+        } else if (xp > node->xp) {
+            n = node->right;
+        } else {
+            above += tree->nodes[node->right].size;
+            break;
+        }
+    }
+    return above;
+}
+
+static void fix_sizes(rank_tree_t *tree, uint32_t n) {
+    if (n == NIL) return;
+    fix_sizes(tree, N(tree, n).left);
+    fix_sizes(tree, N(tree, n).right);
+    pull(tree, n);
+}
+
+/* Build from ascending distinct values in O(n) - the treap is the Cartesian
+ * tree of the values under random priorities, assembled with a stack */
+static rank_tree_t *tree_build(const int64_t *xp_values, const uint32_t *member_counts, size_t count,
+                               uint32_t seed) {
+    rank_tree_t *tree = tree_create((uint32_t)count + 1, seed);
+    if (!tree) return NULL;
+
+    uint32_t *stack = malloc(sizeof(uint32_t) * (count + 1));
+    if (!stack) {
+        tree_destroy(tree);
+        return NULL;
+    }
+
+    size_t depth = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t n = node_alloc(tree, xp_values[i], member_counts[i]);
+        uint32_t last = NIL;
+
+        while (depth > 0 && N(tree, stack[depth - 1]).priority < N(tree, n).priority) {
+            last = stack[--depth];
+        }
+        N(tree, n).left = last;
+        if (depth > 0) {
+            N(tree, stack[depth - 1]).right = n;
+        }
+        stack[depth++] = n;
+    }
+    tree->root = depth > 0 ? stack[0] : NIL;
+    free(stack);
+
+    fix_sizes(tree, tree->root);
+    return tree;
+}
+
+/* Caller holds the lock - NULL if the guild isn't loaded */
+static rank_tree_t *find_tree(const rank_index_t *index, uint64_t guild_id) {
+    const uint64_t *tree = u64map_find(&index->trees, guild_id, 0);
+    return tree ? (rank_tree_t *)(uintptr_t)*tree : NULL;
+}
+
+int rank_index_init(rank_index_t *index) {
+    atomic_init(&index->apply_seq, 0);
+    atomic_init(&index->in_flight, 0);
+    atomic_init(&index->hits, 0);
+    atomic_init(&index->loads, 0);
+    pthread_rwlock_init(&index->lock, NULL);
+    return u64map_init(&index->trees, RANK_INDEX_INITIAL_CAPACITY);
+}
+
+void rank_index_free(rank_index_t *index) {
+    const u64map_slot_t *slot;
+    for (size_t i = 0; (slot = u64map_next(&index->trees, &i)) != NULL;) {
+        tree_destroy((rank_tree_t *)(uintptr_t)slot->value);
+    }
+    u64map_free(&index->trees);
+    pthread_rwlock_destroy(&index->lock);
+}
+
+int rank_index_get(rank_index_t *index, yuno_database_t *database, uint64_t guild_id, int64_t xp,
+                   uint64_t *rank, uint64_t *members) {
+    *rank = 0;
+    *members = 0;
+
+    pthread_rwlock_rdlock(&index->lock);
+    rank_tree_t *tree = find_tree(index, guild_id);
+    if (tree) {
+        *members = N(tree, tree->root).size;
+        *rank = xp > 0 ? tree_count_above(tree, xp) + 1 : 0;
+    }
+    pthread_rwlock_unlock(&index->lock);
+
+    if (tree) {
+        atomic_fetch_add_explicit(&index->hits, 1, memory_order_relaxed);
+        return 0;
+    }
+
+    /* Cold guild - build its tree from the XP distribution on the covering index */
+    uint64_t seq = atomic_load(&index->apply_seq);
+    int quiet = atomic_load(&index->in_flight) == 0;
+
+    int64_t *xp_values;
+    uint32_t *member_counts;
+    size_t count;
+    if (db_get_xp_distribution(database, guild_id, &xp_values, &member_counts, &count) != 0) {
+        return -1;
+    }
+    tree = tree_build(xp_values, member_counts, count, (uint32_t)(guild_id ^ (guild_id >> 32)));
+    free(xp_values);
+    free(member_counts);
+    if (!tree) {
+        return -1;
+    }
+    atomic_fetch_add_explicit(&index->loads, 1, memory_order_relaxed);
+
+    *members = N(tree, tree->root).size;
+    *rank = xp > 0 ? tree_count_above(tree, xp) + 1 : 0;
+
+    /* Only keep the tree if no XP batch could have raced the read - otherwise a
+     * flush might be applied on top of a snapshot that already contains it */
+    pthread_rwlock_wrlock(&index->lock);
+    if (quiet && atomic_load(&index->in_flight) == 0 && atomic_load(&index->apply_seq) == seq) {
+        int inserted;
+        uint64_t *slot = u64map_insert(&index->trees, guild_id, 0, &inserted);
+        if (slot && inserted) {
+            *slot = (uint64_t)(uintptr_t)tree;
+            tree = NULL;
+        }
+    }
+    pthread_rwlock_unlock(&index->lock);
+
+    tree_destroy(tree);
+    return 0;
+}
+
+void rank_index_flush_begin(rank_index_t *index) {
+    atomic_fetch_add(&index->in_flight, 1);
+    atomic_fetch_add(&index->apply_seq, 1);
+}
+
+void rank_index_flush_end(rank_index_t *index, const xp_flush_result_t *results, int count) {
+    pthread_rwlock_wrlock(&index->lock);
+    for (int i = 0; results && i < count; i++) {
+        const xp_flush_result_t *r = &results[i];
+        if (r->new_xp == r->old_xp) continue;
+
+        rank_tree_t *tree = find_tree(index, r->guild_id);
+        if (!tree) continue;
+
+        /* Members start counting once they have XP */
+        if (r->old_xp > 0) tree->root = tree_erase(tree, tree->root, r->old_xp);
+        if (r->new_xp > 0) tree->root = tree_insert(tree, tree->root, r->new_xp);
+
+        if (tree->broken) {
+            /* Reloaded on the next lookup */
+            u64map_remove(&index->trees, r->guild_id, 0);
+            tree_destroy(tree);
+        }
+    }
+    atomic_fetch_add(&index->apply_seq, 1);
+    atomic_fetch_sub(&index->in_flight, 1);
+    pthread_rwlock_unlock(&index->lock);
+}
+
+void rank_index_get_stats(rank_index_t *index, uint64_t *hits, uint64_t *loads, size_t *guilds, size_t *nodes) {
+    *hits = atomic_load(&index->hits);
+    *loads = atomic_load(&index->loads);
+    *nodes = 0;
+
+    pthread_rwlock_rdlock(&index->lock);
+    *guilds = u64map_count(&index->trees);
+    const u64map_slot_t *slot;
+    for (size_t i = 0; (slot = u64map_next(&index->trees, &i)) != NULL;) {
+        *nodes += ((const rank_tree_t *)(uintptr_t)slot->value)->used - 1;
+    }
+    pthread_rwlock_unlock(&index->lock);
+}
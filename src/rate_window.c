@@ -0,0 +1,60 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Multi-Resolution Event Rate
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "rate_window.h"
+#include <string.h>
+
+void rate_window_reset(rate_window_t *window, uint32_t now) {
+    memset(window, 0, sizeof(rate_window_t));
+    window->now = now;
+}
+
+/* Empty the buckets time has moved past - after a long gap that is all of
+ * them, so the work is bounded however long the window sat idle */
+static void advance(rate_window_t *window, uint32_t now) {
+    if ((int32_t)(now - window->now) <= 0) return;
+
+    uint32_t gap = now - window->now;
+    if (gap >= RATE_WINDOW_SECONDS) {
+        memset(window->seconds, 0, sizeof(window->seconds));
+        window->ten_total = 0;
+    } else {
+        for (uint32_t t = window->now + 1; t != now + 1; t++) {
+            uint32_t *bucket = &window->seconds[t % RATE_WINDOW_SECONDS];
+            window->ten_total -= *bucket;
+            *bucket = 0;
+        }
+    }
+
+    uint32_t tens_gap = now / 10 - window->now / 10;
+    if (tens_gap >= RATE_WINDOW_TENS) {
+        memset(window->tens, 0, sizeof(window->tens));
+        window->minute_total = 0;
+    } else {
+        for (uint32_t t = window->now / 10 + 1; t != now / 10 + 1; t++) {
+            uint32_t *bucket = &window->tens[t % RATE_WINDOW_TENS];
+            window->minute_total -= *bucket;
+            *bucket = 0;
+        }
+    }
+
+    window->now = now;
+}
+
+void rate_window_add(rate_window_t *window, uint32_t now, uint32_t n) {
+    advance(window, now);
+    window->seconds[window->now % RATE_WINDOW_SECONDS] += n;
+    window->tens[window->now / 10 % RATE_WINDOW_TENS] += n;
+    window->ten_total += n;
+    window->minute_total += n;
+}
+
+void rate_window_read(rate_window_t *window, uint32_t now, uint32_t counts[RATE_RESOLUTIONS]) {
+    advance(window, now);
+    counts[RATE_1S] = window->seconds[window->now % RATE_WINDOW_SECONDS];
+    counts[RATE_10S] = window->ten_total;
+    counts[RATE_60S] = window->minute_total;
+}
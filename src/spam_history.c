@@ -0,0 +1,99 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Spam Message History
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "spam_history.h"
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void spam_history_reset(spam_history_t *history) {
+    memset(history, 0, sizeof(spam_history_t));
+}
+
+void spam_history_add(spam_history_t *history, uint32_t now, uint32_t hash) {
+    history->times[history->head] = now;
+    history->hashes[history->head] = hash;
+    history->head = history->head + 1 == SPAM_HISTORY_LEN ? 0 : history->head + 1;
+    if (history->count < SPAM_HISTORY_LEN) {
+        history->count++;
+    }
+}
+
+uint32_t spam_history_last(const spam_history_t *history) {
+    return history->times[history->head ? history->head - 1 : SPAM_HISTORY_LEN - 1];
+}
+
+#if defined(__SSE2__)
+static const int32_t lane_ids[SPAM_HISTORY_LANES] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+/* Lanes [offset, offset + 4) - a compare leaves -1 in each matching lane, so
+ * subtracting it counts. Lanes past count are masked off, and ages compare
+ * signed so a clock step backwards still counts as recent. */
+static inline void count_lanes4(const spam_history_t *history, int offset, __m128i now, __m128i interval,
+                                __m128i hash, __m128i count, __m128i *recent, __m128i *duplicates) {
+    __m128i valid = _mm_cmpgt_epi32(count, _mm_loadu_si128((const __m128i *)(lane_ids + offset)));
+    __m128i age = _mm_sub_epi32(now, _mm_loadu_si128((const __m128i *)(history->times + offset)));
+    __m128i stale = _mm_cmpgt_epi32(age, interval);
+    __m128i same = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(history->hashes + offset)), hash);
+
+    *recent = _mm_sub_epi32(*recent, _mm_andnot_si128(stale, valid));
+    *duplicates = _mm_sub_epi32(*duplicates, _mm_and_si128(same, valid));
+}
+
+/* Both horizontal sums at once - recent in the low pair, duplicates in the high */
+static inline void sum_counts(__m128i recent, __m128i duplicates, int *recent_out, int *duplicates_out) {
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi64(recent, duplicates), _mm_unpackhi_epi64(recent, duplicates));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    *recent_out = _mm_cvtsi128_si32(sum);
+    *duplicates_out = _mm_cvtsi128_si32(_mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 2, 2, 2)));
+}
+#endif
+
+void spam_history_count(const spam_history_t *history, uint32_t now, uint32_t interval,
+                        uint32_t hash, int *recent, int *duplicates) {
+#if defined(__AVX2__)
+    __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(history->count),
+                                       _mm256_loadu_si256((const __m256i *)lane_ids));
+    __m256i age = _mm256_sub_epi32(_mm256_set1_epi32((int)now),
+                                   _mm256_loadu_si256((const __m256i *)history->times));
+    __m256i stale = _mm256_cmpgt_epi32(age, _mm256_set1_epi32((int)interval));
+    __m256i same = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)history->hashes),
+                                      _mm256_set1_epi32((int)hash));
+    __m256i recent8 = _mm256_andnot_si256(stale, valid);
+    __m256i duplicates8 = _mm256_and_si256(same, valid);
+
+    /* Fold the eight lanes to four (still negative) and finish with the last vector */
+    __m128i recent4 = _mm_sub_epi32(_mm_setzero_si128(),
+        _mm_add_epi32(_mm256_castsi256_si128(recent8), _mm256_extracti128_si256(recent8, 1)));
+    __m128i duplicates4 = _mm_sub_epi32(_mm_setzero_si128(),
+        _mm_add_epi32(_mm256_castsi256_si128(duplicates8), _mm256_extracti128_si256(duplicates8, 1)));
+    count_lanes4(history, 8, _mm_set1_epi32((int)now), _mm_set1_epi32((int)interval),
+                 _mm_set1_epi32((int)hash), _mm_set1_epi32(history->count), &recent4, &duplicates4);
+    sum_counts(recent4, duplicates4, recent, duplicates);
+#elif defined(__SSE2__)
+    __m128i now4 = _mm_set1_epi32((int)now);
+    __m128i interval4 = _mm_set1_epi32((int)interval);
+    __m128i hash4 = _mm_set1_epi32((int)hash);
+    __m128i count4 = _mm_set1_epi32(history->count);
+    __m128i recent4 = _mm_setzero_si128();
+    __m128i duplicates4 = _mm_setzero_si128();
+    for (int offset = 0; offset < SPAM_HISTORY_LANES; offset += 4) {
+        count_lanes4(history, offset, now4, interval4, hash4, count4, &recent4, &duplicates4);
+    }
+    sum_counts(recent4, duplicates4, recent, duplicates);
+#else
+    *recent = 0;
+    *duplicates = 0;
+    for (int i = 0; i < history->count; i++) {
+        *recent += (int32_t)(now - history->times[i]) <= (int32_t)interval;
+        *duplicates += history->hashes[i] == hash;
+    }
+#endif
+}
@@ -0,0 +1,231 @@
+/*
+ * Yuno Gasai 2 (C Edition) - (u64, u64) Hash Map
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "u64map.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CTRL_EMPTY 0x80                 /* Full slots hold a 7-bit tag, so the high bit means empty */
+
+static inline uint64_t hash_key(uint64_t a, uint64_t b) {
+    uint64_t h = (a ^ (b * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 31);
+}
+
+static inline uint8_t hash_tag(uint64_t h) {
+    return (uint8_t)(h >> 57);
+}
+
+/* Bitmasks over one group of control bytes - bit i is ctrl[i] */
+#if defined(__SSE2__)
+static inline uint32_t group_match(const uint8_t *ctrl, uint8_t tag) {
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+}
+
+static inline uint32_t group_empty(const uint8_t *ctrl) {
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+#else
+static inline uint32_t group_match(const uint8_t *ctrl, uint8_t tag) {
+    uint32_t mask = 0;
+    for (int i = 0; i < U64MAP_GROUP; i++) {
+        mask |= (uint32_t)(ctrl[i] == tag) << i;
+    }
+    return mask;
+}
+
+static inline uint32_t group_empty(const uint8_t *ctrl) {
+    uint32_t mask = 0;
+    for (int i = 0; i < U64MAP_GROUP; i++) {
+        mask |= (uint32_t)(ctrl[i] >> 7) << i;
+    }
+    return mask;
+}
+#endif
+
+/* Control bytes past the end repeat the first group so a probe near the end
+ * can load a whole group without wrapping */
+static inline void set_ctrl(u64map_t *map, size_t i, uint8_t value) {
+    map->ctrl[i] = value;
+    if (i < U64MAP_GROUP - 1) {
+        map->ctrl[map->capacity + i] = value;
+    }
+}
+
+/* First empty slot at or after the key's home */
+static inline size_t find_empty(const u64map_t *map, uint64_t h) {
+    size_t mask = map->capacity - 1;
+    size_t pos = (size_t)h & mask;
+    for (;;) {
+        uint32_t empty = group_empty(map->ctrl + pos);
+        if (empty) {
+            return (pos + (size_t)__builtin_ctz(empty)) & mask;
+        }
+        pos = (pos + U64MAP_GROUP) & mask;
+    }
+}
+
+/* Slot holding the key, or capacity if absent - then *empty (if given) is
+ * where the key would go, the first empty slot of its run */
+static inline size_t find_slot(const u64map_t *map, uint64_t a, uint64_t b, uint64_t h, size_t *empty) {
+    size_t mask = map->capacity - 1;
+    size_t pos = (size_t)h & mask;
+    uint8_t tag = hash_tag(h);
+
+    for (;;) {
+        const uint8_t *group = map->ctrl + pos;
+        for (uint32_t match = group_match(group, tag); match; match &= match - 1) {
+            size_t i = (pos + (size_t)__builtin_ctz(match)) & mask;
+            if (map->slots[i].a == a && map->slots[i].b == b) {
+                return i;
+            }
+        }
+        /* A key never sits past the first empty slot of its run */
+        uint32_t free_mask = group_empty(group);
+        if (free_mask) {
+            if (empty) *empty = (pos + (size_t)__builtin_ctz(free_mask)) & mask;
+            return map->capacity;
+        }
+        pos = (pos + U64MAP_GROUP) & mask;
+    }
+}
+
+static int alloc_table(u64map_t *map, size_t capacity) {
+    uint8_t *ctrl = malloc(capacity + U64MAP_GROUP - 1);
+    u64map_slot_t *slots = malloc(sizeof(u64map_slot_t) * capacity);
+    if (!ctrl || !slots) {
+        free(ctrl);
+        free(slots);
+        return -1;
+    }
+    memset(ctrl, CTRL_EMPTY, capacity + U64MAP_GROUP - 1);
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->capacity = capacity;
+    return 0;
+}
+
+static int resize(u64map_t *map, size_t capacity) {
+    u64map_t old = *map;
+    if (alloc_table(map, capacity) != 0) {
+        *map = old;
+        return -1;
+    }
+
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.ctrl[i] & CTRL_EMPTY) continue;
+        uint64_t h = hash_key(old.slots[i].a, old.slots[i].b);
+        size_t j = find_empty(map, h);
+        map->slots[j] = old.slots[i];
+        set_ctrl(map, j, hash_tag(h));
+    }
+
+    free(old.ctrl);
+    free(old.slots);
+    return 0;
+}
+
+int u64map_init(u64map_t *map, size_t capacity) {
+    size_t rounded = U64MAP_MIN_CAPACITY;
+    while (rounded < capacity) {
+        rounded *= 2;
+    }
+
+    memset(map, 0, sizeof(u64map_t));
+    map->min_capacity = rounded;
+    return alloc_table(map, rounded);
+}
+
+void u64map_free(u64map_t *map) {
+    free(map->ctrl);
+    free(map->slots);
+    map->ctrl = NULL;
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+}
+
+void u64map_clear(u64map_t *map) {
+    memset(map->ctrl, CTRL_EMPTY, map->capacity + U64MAP_GROUP - 1);
+    map->count = 0;
+}
+
+int u64map_reserve(u64map_t *map, size_t count) {
+    size_t capacity = map->capacity;
+    while (count * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+    return capacity == map->capacity ? 0 : resize(map, capacity);
+}
+
+uint64_t *u64map_find(const u64map_t *map, uint64_t a, uint64_t b) {
+    size_t i = find_slot(map, a, b, hash_key(a, b), NULL);
+    return i < map->capacity ? &map->slots[i].value : NULL;
+}
+
+uint64_t *u64map_insert(u64map_t *map, uint64_t a, uint64_t b, int *inserted) {
+    uint64_t h = hash_key(a, b);
+    size_t empty = 0;
+    size_t i = find_slot(map, a, b, h, &empty);
+    if (inserted) *inserted = 0;
+    if (i < map->capacity) {
+        return &map->slots[i].value;
+    }
+
+    if ((map->count + 1) * 4 > map->capacity * 3) {
+        if (resize(map, map->capacity * 2) != 0) {
+            return NULL;
+        }
+        empty = find_empty(map, h);
+    }
+
+    i = empty;
+    map->slots[i] = (u64map_slot_t){ .a = a, .b = b, .value = 0 };
+    set_ctrl(map, i, hash_tag(h));
+    map->count++;
+    if (inserted) *inserted = 1;
+    return &map->slots[i].value;
+}
+
+int u64map_remove(u64map_t *map, uint64_t a, uint64_t b) {
+    size_t i = find_slot(map, a, b, hash_key(a, b), NULL);
+    if (i == map->capacity) return 0;
+
+    /* Backward shift - pull later members of the run into the hole unless
+     * that would move them in front of their home slot */
+    size_t mask = map->capacity - 1;
+    for (size_t j = (i + 1) & mask; !(map->ctrl[j] & CTRL_EMPTY); j = (j + 1) & mask) {
+        size_t home = (size_t)hash_key(map->slots[j].a, map->slots[j].b) & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            map->slots[i] = map->slots[j];
+            set_ctrl(map, i, map->ctrl[j]);
+            i = j;
+        }
+    }
+    set_ctrl(map, i, CTRL_EMPTY);
+    map->count--;
+
+    /* Shrinking is best effort - the old table is still valid if it fails */
+    if (map->capacity > map->min_capacity && map->count * 8 < map->capacity) {
+        resize(map, map->capacity / 2);
+    }
+    return 1;
+}
+
+const u64map_slot_t *u64map_next(const u64map_t *map, size_t *pos) {
+    while (*pos < map->capacity) {
+        size_t i = (*pos)++;
+        if (!(map->ctrl[i] & CTRL_EMPTY)) {
+            return &map->slots[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,265 @@
+/*
+ * Yuno Gasai 2 (C Edition) - Banned Word Automaton
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "word_automaton.h"
+#include "content_hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SCAN_STACK_BYTES 4096       /* Longer messages normalize into the heap */
+
+/* Symbol of each byte of normalized text */
+static const uint8_t g_symbols[256] = {
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,   1,
+     28,  29,  30,  31,  32,  33,  34,  35,  36,  37,   1,   1,   1,   1,   1,   1,
+      1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,  16,
+     17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,   1,   1,   1,   1,   1,
+      1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,  16,
+     17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,   1,   1,   1,   1,   1,
+     38,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51,  52,  53,
+     54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,
+     70,  71,  72,  73,  74,  75,  76,  77,  78,  79,  80,  81,  82,  83,  84,  85,
+     86,  87,  88,  89,  90,  91,  92,  93,  94,  95,  96,  97,  98,  99, 100, 101,
+    102, 103, 104, 105, 106, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116, 117,
+    118, 119, 120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133,
+    134, 135, 136, 137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 149,
+    150, 151, 152, 153, 154, 155, 156, 157, 158, 159, 160, 161, 162, 163, 164, 165,
+};
+
+/* Trie the double array is laid out from */
+typedef struct {
+    int32_t child;                  /* First child, -1 = none */
+    int32_t sibling;
+    int32_t word;                   /* Ending here, -1 = none */
+    int32_t state;                  /* Cell it was placed in */
+    uint8_t symbol;
+} trie_node_t;
+
+typedef struct {
+    trie_node_t *nodes;
+    size_t count;
+    size_t capacity;
+} trie_t;
+
+/* A word's symbols with separator runs collapsed and one separator at each
+ * end - 0 if it has nothing else or is too long */
+static size_t word_symbols(const char *word, uint8_t *out) {
+    char text[WORD_MAX_LENGTH];
+    size_t length = strlen(word);
+    if (length > WORD_MAX_LENGTH) return 0;
+    length = content_normalize(word, length, text);
+
+    size_t n = 0;
+    out[n++] = WORD_SEPARATOR;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = g_symbols[(uint8_t)text[i]];
+        if (c == WORD_SEPARATOR && out[n - 1] == WORD_SEPARATOR) continue;
+        out[n++] = c;
+    }
+    if (out[n - 1] != WORD_SEPARATOR) out[n++] = WORD_SEPARATOR;
+    return n > 1 ? n : 0;
+}
+
+static int32_t trie_add_node(trie_t *trie, uint8_t symbol) {
+    if (trie->count == trie->capacity) {
+        size_t capacity = trie->capacity ? trie->capacity * 2 : 256;
+        trie_node_t *nodes = realloc(trie->nodes, capacity * sizeof(trie_node_t));
+        if (!nodes) return -1;
+        trie->nodes = nodes;
+        trie->capacity = capacity;
+    }
+    trie_node_t *node = &trie->nodes[trie->count];
+    node->child = -1;
+    node->sibling = -1;
+    node->word = -1;
+    node->state = -1;
+    node->symbol = symbol;
+    return (int32_t)trie->count++;
+}
+
+/* Walk or extend the trie along symbols, marking the end as word */
+static int trie_insert(trie_t *trie, const uint8_t *symbols, size_t n, int32_t word) {
+    int32_t at = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t next = trie->nodes[at].child;
+        while (next >= 0 && trie->nodes[next].symbol != symbols[i]) {
+            next = trie->nodes[next].sibling;
+        }
+        if (next < 0) {
+            next = trie_add_node(trie, symbols[i]);
+            if (next < 0) return -1;
+            trie->nodes[next].sibling = trie->nodes[at].child;
+            trie->nodes[at].child = next;
+        }
+        at = next;
+    }
+    /* A repeat keeps the first index */
+    if (trie->nodes[at].word < 0) trie->nodes[at].word = word;
+    return 0;
+}
+
+/* Grow the cells so index fits, new ones free */
+static int reserve_cells(word_automaton_t *automaton, uint32_t *capacity, uint32_t index) {
+    if (index < *capacity) return 0;
+    uint32_t grown = *capacity ? *capacity : 1024;
+    while (grown <= index) grown *= 2;
+    word_cell_t *cells = realloc(automaton->cells, (size_t)grown * sizeof(word_cell_t));
+    if (!cells) return -1;
+    for (uint32_t i = *capacity; i < grown; i++) {
+        cells[i].base = 0;
+        cells[i].check = -1;
+        cells[i].fail = 0;
+        cells[i].match = -1;
+    }
+    automaton->cells = cells;
+    *capacity = grown;
+    return 0;
+}
+
+/* Move from state s on symbol c, following failure links until some state
+ * has one - the root always takes it, staying put if it has no such child */
+static inline int32_t step(const word_cell_t *cells, uint32_t size, int32_t s, uint32_t c) {
+    for (;;) {
+        uint32_t t = (uint32_t)cells[s].base + c;
+        if (t < size && cells[t].check == s) return (int32_t)t;
+        if (s == 0) return 0;
+        s = cells[s].fail;
+    }
+}
+
+/* Place each node's children in the first run of free cells that fits
+ * them all, breadth first, then link every state to its longest suffix */
+static int layout(word_automaton_t *automaton, trie_t *trie) {
+    uint32_t capacity = 0;
+    int32_t *order = malloc(trie->count * sizeof(int32_t));
+    if (!order || reserve_cells(automaton, &capacity, WORD_ALPHABET) != 0) {
+        free(order);
+        return -1;
+    }
+
+    automaton->cells[0].check = -2;
+    trie->nodes[0].state = 0;
+    uint32_t used = 1;              /* One past the highest cell taken */
+    uint32_t next_free = 1;         /* Lowest cell that might be free */
+    size_t head = 0, tail = 0;
+    order[tail++] = 0;
+
+    while (head < tail) {
+        trie_node_t *node = &trie->nodes[order[head++]];
+        if (node->child < 0) continue;
+
+        uint8_t low = 255, high = 0;
+        for (int32_t c = node->child; c >= 0; c = trie->nodes[c].sibling) {
+            if (trie->nodes[c].symbol < low) low = trie->nodes[c].symbol;
+            if (trie->nodes[c].symbol > high) high = trie->nodes[c].symbol;
+        }
+
+        uint32_t base = next_free > low ? next_free - low : 0;
+        for (;; base++) {
+            if (reserve_cells(automaton, &capacity, base + high) != 0) {
+                free(order);
+                return -1;
+            }
+            int32_t c = node->child;
+            while (c >= 0 && automaton->cells[base + trie->nodes[c].symbol].check == -1) {
+                c = trie->nodes[c].sibling;
+            }
+            if (c < 0) break;
+        }
+
+        automaton->cells[node->state].base = (int32_t)base;
+        for (int32_t c = node->child; c >= 0; c = trie->nodes[c].sibling) {
+            uint32_t t = base + trie->nodes[c].symbol;
+            automaton->cells[t].check = node->state;
+            trie->nodes[c].state = (int32_t)t;
+            if (t + 1 > used) used = t + 1;
+            order[tail++] = c;
+        }
+        while (next_free < capacity && automaton->cells[next_free].check != -1) next_free++;
+    }
+
+    /* Shallower states come first, so each suffix is linked before it is needed */
+    automaton->size = used;
+    word_cell_t *cells = automaton->cells;
+    for (size_t i = 0; i < tail; i++) {
+        const trie_node_t *node = &trie->nodes[order[i]];
+        for (int32_t c = node->child; c >= 0; c = trie->nodes[c].sibling) {
+            const trie_node_t *child = &trie->nodes[c];
+            int32_t fail = node->state == 0 ? 0 : step(cells, used, cells[node->state].fail, child->symbol);
+            cells[child->state].fail = fail;
+            cells[child->state].match = child->word >= 0 ? child->word : cells[fail].match;
+        }
+    }
+    automaton->states = (uint32_t)tail;
+    free(order);
+
+    /* Give back the slack past the last state */
+    word_cell_t *trimmed = realloc(automaton->cells, (size_t)used * sizeof(word_cell_t));
+    if (trimmed) automaton->cells = trimmed;
+    return 0;
+}
+
+int word_automaton_build(word_automaton_t *automaton, const char *const *words, size_t count) {
+    uint8_t symbols[WORD_MAX_LENGTH + 2];
+    trie_t trie = { NULL, 0, 0 };
+
+    memset(automaton, 0, sizeof(word_automaton_t));
+    if (trie_add_node(&trie, 0) < 0) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t n = word_symbols(words[i], symbols);
+        if (n == 0) continue;
+        if (trie_insert(&trie, symbols, n, (int32_t)i) != 0) {
+            free(trie.nodes);
+            return -1;
+        }
+        automaton->words++;
+    }
+
+    int rc = layout(automaton, &trie);
+    free(trie.nodes);
+    if (rc != 0) {
+        word_automaton_free(automaton);
+    }
+    return rc;
+}
+
+void word_automaton_free(word_automaton_t *automaton) {
+    free(automaton->cells);
+    memset(automaton, 0, sizeof(word_automaton_t));
+}
+
+int word_automaton_scan(const word_automaton_t *automaton, const char *content, size_t length) {
+    if (automaton->words == 0) return -1;
+
+    char stack[SCAN_STACK_BYTES];
+    char *text = length <= sizeof(stack) ? stack : malloc(length);
+    if (!text) return -1;
+    size_t n = content_normalize(content, length, text);
+
+    /* The message is wrapped in separators like the words are */
+    const word_cell_t *cells = automaton->cells;
+    uint32_t size = automaton->size;
+    int32_t s = step(cells, size, 0, WORD_SEPARATOR);
+    uint8_t prev = WORD_SEPARATOR;
+    int found = -1;
+
+    for (size_t i = 0; i < n && found < 0; i++) {
+        uint8_t c = g_symbols[(uint8_t)text[i]];
+        if (c == WORD_SEPARATOR && prev == WORD_SEPARATOR) continue;
+        prev = c;
+        s = step(cells, size, s, c);
+        found = cells[s].match;
+    }
+    if (found < 0 && prev != WORD_SEPARATOR) {
+        found = cells[step(cells, size, s, WORD_SEPARATOR)].match;
+    }
+
+    if (text != stack) free(text);
+    return found;
+}
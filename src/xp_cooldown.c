@@ -0,0 +1,122 @@
+/*
+ * Yuno Gasai 2 (C Edition) - XP Cooldowns
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "xp_cooldown.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static uint32_t now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+/* An entry packs when its cooldown started above when it ends */
+static inline uint64_t pack_entry(uint32_t start, uint32_t expires) {
+    return (uint64_t)start << 32 | expires;
+}
+
+static inline uint32_t entry_expires(uint64_t entry) {
+    return (uint32_t)entry;
+}
+
+/* Drop every expired entry - caller holds the lock */
+static int sweep(xp_cooldown_t *cooldown, uint32_t now) {
+    const u64map_slot_t *slot;
+    size_t count = 0;
+    for (size_t i = 0; (slot = u64map_next(&cooldown->entries, &i)) != NULL;) {
+        count += entry_expires(slot->value) > now;
+    }
+
+    u64map_t live;
+    if (u64map_init(&live, XP_COOLDOWN_INITIAL_CAPACITY * 4 / 3) != 0 || u64map_reserve(&live, count) != 0) {
+        u64map_free(&live);
+        return -1;
+    }
+
+    for (size_t i = 0; (slot = u64map_next(&cooldown->entries, &i)) != NULL;) {
+        if (entry_expires(slot->value) > now) {
+            *u64map_insert(&live, slot->a, slot->b, NULL) = slot->value;
+        }
+    }
+
+    u64map_free(&cooldown->entries);
+    cooldown->entries = live;
+    cooldown->sweep_at = u64map_count(&live) * 2;
+    if (cooldown->sweep_at < XP_COOLDOWN_INITIAL_CAPACITY) {
+        cooldown->sweep_at = XP_COOLDOWN_INITIAL_CAPACITY;
+    }
+    return 0;
+}
+
+int xp_cooldown_init(xp_cooldown_t *cooldown) {
+    cooldown->sweep_at = XP_COOLDOWN_INITIAL_CAPACITY;
+    atomic_init(&cooldown->allowed, 0);
+    atomic_init(&cooldown->suppressed, 0);
+    pthread_mutex_init(&cooldown->lock, NULL);
+    return u64map_init(&cooldown->entries, XP_COOLDOWN_INITIAL_CAPACITY * 4 / 3);
+}
+
+void xp_cooldown_free(xp_cooldown_t *cooldown) {
+    u64map_free(&cooldown->entries);
+    pthread_mutex_destroy(&cooldown->lock);
+}
+
+int xp_cooldown_try(xp_cooldown_t *cooldown, uint64_t user_id, uint64_t guild_id, int cooldown_seconds) {
+    if (cooldown_seconds <= 0) {
+        atomic_fetch_add_explicit(&cooldown->allowed, 1, memory_order_relaxed);
+        return 1;
+    }
+
+    uint32_t now = now_seconds();
+    uint32_t expires = now + (uint32_t)cooldown_seconds;
+
+    pthread_mutex_lock(&cooldown->lock);
+    uint64_t *entry = u64map_find(&cooldown->entries, user_id, guild_id);
+    if (entry) {
+        /* A cooldown the guild has since lowered ends early, at its start
+         * plus the new length */
+        uint32_t start = (uint32_t)(*entry >> 32);
+        uint32_t ends = entry_expires(*entry);
+        if (start + (uint32_t)cooldown_seconds < ends) ends = start + (uint32_t)cooldown_seconds;
+
+        int ready = now >= ends;
+        if (ready) *entry = pack_entry(now, expires);
+        pthread_mutex_unlock(&cooldown->lock);
+        atomic_fetch_add_explicit(ready ? &cooldown->allowed : &cooldown->suppressed, 1, memory_order_relaxed);
+        return ready;
+    }
+
+    /* Sweeping is best effort - the map still grows if it fails */
+    if (u64map_count(&cooldown->entries) >= cooldown->sweep_at) {
+        sweep(cooldown, now);
+    }
+
+    entry = u64map_insert(&cooldown->entries, user_id, guild_id, NULL);
+    if (entry) *entry = pack_entry(now, expires);
+    pthread_mutex_unlock(&cooldown->lock);
+
+    /* Out of memory - let the XP through rather than drop it */
+    atomic_fetch_add_explicit(&cooldown->allowed, 1, memory_order_relaxed);
+    return 1;
+}
+
+void xp_cooldown_get_stats(xp_cooldown_t *cooldown, uint64_t *allowed, uint64_t *suppressed, size_t *tracked) {
+    *allowed = atomic_load(&cooldown->allowed);
+    *suppressed = atomic_load(&cooldown->suppressed);
+
+    uint32_t now = now_seconds();
+    *tracked = 0;
+    pthread_mutex_lock(&cooldown->lock);
+    const u64map_slot_t *slot;
+    for (size_t i = 0; (slot = u64map_next(&cooldown->entries, &i)) != NULL;) {
+        if (entry_expires(slot->value) > now) {
+            (*tracked)++;
+        }
+    }
+    pthread_mutex_unlock(&cooldown->lock);
+}
@@ -0,0 +1,383 @@
+/*
+ * Yuno Gasai 2 (C Edition) - XP Journal
+ * Copyright (C) 2025 blubskye
+ * SPDX-License-Identifier: AGPL-3.0-or-later
+ */
+
+#include "xp_journal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define XP_RECORD_CRC_BYTES offsetof(xp_journal_record_t, crc)
+
+/* CRC-32 (IEEE) - table built once on first use */
+static uint32_t g_crc_table[256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_table_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32_bytes(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    pthread_once(&g_crc_once, crc_table_init);
+    while (len--) {
+        crc = g_crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void generation_path(const char *base_path, uint64_t generation, char *out, size_t out_len) {
+    snprintf(out, out_len, "%s.%lu", base_path, (unsigned long)generation);
+}
+
+static int open_generation(xp_journal_t *journal, uint64_t generation) {
+    char path[MAX_PATH_LEN + 32];
+    generation_path(journal->base_path, generation, path, sizeof(path));
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "💔 Failed to open XP journal %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    journal->fd = fd;
+    journal->generation = generation;
+    journal->generation_records = 0;
+    return 0;
+}
+
+/* Take everything appended so far - the caller writes it out without the lock */
+static size_t take_buffered(xp_journal_t *journal, xp_journal_record_t **records) {
+    pthread_mutex_lock(&journal->lock);
+    size_t count = journal->buffered_count;
+    xp_journal_record_t *taken = journal->buffered;
+    size_t taken_capacity = journal->buffered_capacity;
+
+    journal->buffered = journal->spare;
+    journal->buffered_capacity = journal->spare_capacity;
+    journal->buffered_count = 0;
+    journal->spare = taken;
+    journal->spare_capacity = taken_capacity;
+    pthread_mutex_unlock(&journal->lock);
+
+    *records = taken;
+    return count;
+}
+
+/* One write() for every record appended since the last one */
+static int write_buffered(xp_journal_t *journal) {
+    xp_journal_record_t *records;
+    size_t count = take_buffered(journal, &records);
+    if (count == 0) return 0;
+
+    const char *p = (const char *)records;
+    size_t left = count * sizeof(xp_journal_record_t);
+    while (left > 0) {
+        ssize_t n = write(journal->fd, p, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            atomic_fetch_add_explicit(&journal->write_errors, 1, memory_order_relaxed);
+            return -1;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+    return 1;
+}
+
+/* Write what's buffered and make it durable - nothing to do if nothing was */
+static void sync_buffered(xp_journal_t *journal) {
+    if (write_buffered(journal) <= 0) return;
+
+    if (fdatasync(journal->fd) == 0) {
+        atomic_fetch_add_explicit(&journal->syncs, 1, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&journal->write_errors, 1, memory_order_relaxed);
+    }
+}
+
+void xp_journal_init(xp_journal_t *journal) {
+    memset(journal, 0, sizeof(xp_journal_t));
+    journal->fd = -1;
+    pthread_mutex_init(&journal->lock, NULL);
+}
+
+int xp_journal_open(xp_journal_t *journal, const char *database_path, uint64_t generation) {
+    snprintf(journal->base_path, sizeof(journal->base_path), "%s%s", database_path, XP_JOURNAL_SUFFIX);
+    return open_generation(journal, generation);
+}
+
+void xp_journal_close(xp_journal_t *journal) {
+    if (journal->fd >= 0) {
+        write_buffered(journal);
+        close(journal->fd);
+        journal->fd = -1;
+        if (journal->generation_records == 0) {
+            xp_journal_discard(journal, journal->generation);
+        }
+    }
+
+    free(journal->buffered);
+    free(journal->spare);
+    journal->buffered = journal->spare = NULL;
+    journal->buffered_count = journal->buffered_capacity = journal->spare_capacity = 0;
+    pthread_mutex_destroy(&journal->lock);
+}
+
+int xp_journal_enabled(const xp_journal_t *journal) {
+    return journal->fd >= 0;
+}
+
+int xp_journal_append(xp_journal_t *journal, const pending_xp_t *entry) {
+    if (journal->fd < 0) return 0;
+
+    xp_journal_record_t record = {
+        .user_id = entry->user_id,
+        .guild_id = entry->guild_id,
+        .channel_id = entry->channel_id,
+        .xp_amount = entry->xp_amount,
+        .magic = XP_JOURNAL_MAGIC
+    };
+    record.crc = crc32_bytes(&record, XP_RECORD_CRC_BYTES);
+
+    pthread_mutex_lock(&journal->lock);
+    if (journal->buffered_count == journal->buffered_capacity) {
+        size_t capacity = journal->buffered_capacity ? journal->buffered_capacity * 2 : XP_JOURNAL_INITIAL_RECORDS;
+        xp_journal_record_t *grown = realloc(journal->buffered, capacity * sizeof(xp_journal_record_t));
+        if (!grown) {
+            pthread_mutex_unlock(&journal->lock);
+            atomic_fetch_add_explicit(&journal->write_errors, 1, memory_order_relaxed);
+            return -1;
+        }
+        journal->buffered = grown;
+        journal->buffered_capacity = capacity;
+    }
+    journal->buffered[journal->buffered_count++] = record;
+    pthread_mutex_unlock(&journal->lock);
+
+    journal->generation_records++;
+    atomic_fetch_add_explicit(&journal->records, 1, memory_order_relaxed);
+    return 0;
+}
+
+uint64_t xp_journal_rotate(xp_journal_t *journal) {
+    if (journal->fd < 0) return 0;
+
+    uint64_t closed = journal->generation;
+    int had_records = journal->generation_records > 0;
+
+    /* Everything buffered belongs to the closing generation - appends wait on the caller's lock.
+     * No later sync touches this fd, so make them durable before it closes. */
+    sync_buffered(journal);
+    close(journal->fd);
+    journal->fd = -1;
+    if (open_generation(journal, closed + 1) != 0) {
+        atomic_fetch_add_explicit(&journal->write_errors, 1, memory_order_relaxed);
+    }
+
+    /* Nothing to commit for an empty generation - drop it right away */
+    if (!had_records) {
+        xp_journal_discard(journal, closed);
+        return 0;
+    }
+    return closed;
+}
+
+void xp_journal_sync(xp_journal_t *journal) {
+    if (journal->fd < 0) return;
+    sync_buffered(journal);
+}
+
+void xp_journal_discard(xp_journal_t *journal, uint64_t generation) {
+    char path[MAX_PATH_LEN + 32];
+
+    if (generation == 0) return;
+    generation_path(journal->base_path, generation, path, sizeof(path));
+    unlink(path);
+}
+
+static int compare_generations(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Find every <base>.<generation> file left in the database directory */
+static int list_generations(const char *base_path, uint64_t **out, int *out_count) {
+    char dir[MAX_PATH_LEN];
+    const char *name;
+    const char *slash = strrchr(base_path, '/');
+
+    if (slash) {
+        snprintf(dir, sizeof(dir), "%.*s", (int)(slash - base_path), base_path);
+        if (dir[0] == '\0') strcpy(dir, "/");
+        name = slash + 1;
+    } else {
+        strcpy(dir, ".");
+        name = base_path;
+    }
+    size_t name_len = strlen(name);
+
+    *out = NULL;
+    *out_count = 0;
+
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+
+    int capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (strncmp(ent->d_name, name, name_len) != 0 || ent->d_name[name_len] != '.') continue;
+
+        const char *digits = ent->d_name + name_len + 1;
+        char *end;
+        if (*digits < '0' || *digits > '9') continue;
+        uint64_t generation = strtoull(digits, &end, 10);
+        if (*end != '\0' || generation == 0) continue;
+
+        if (*out_count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            uint64_t *grown = realloc(*out, sizeof(uint64_t) * capacity);
+            if (!grown) break;
+            *out = grown;
+        }
+        (*out)[(*out_count)++] = generation;
+    }
+    closedir(d);
+
+    if (*out_count > 1) {
+        qsort(*out, *out_count, sizeof(uint64_t), compare_generations);
+    }
+    return 0;
+}
+
+/* Read the valid prefix of a generation - a torn tail from a crash is ignored */
+static int read_generation(const char *path, pending_xp_t **out, int *out_count) {
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    *out = NULL;
+    *out_count = 0;
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t max_records = (size_t)st.st_size / sizeof(xp_journal_record_t);
+    if (max_records == 0) {
+        close(fd);
+        return 0;
+    }
+
+    xp_journal_record_t *records = malloc(max_records * sizeof(xp_journal_record_t));
+    pending_xp_t *entries = malloc(max_records * sizeof(pending_xp_t));
+    if (!records || !entries) {
+        free(records);
+        free(entries);
+        close(fd);
+        return -1;
+    }
+
+    ssize_t got = read(fd, records, max_records * sizeof(xp_journal_record_t));
+    close(fd);
+    size_t available = got > 0 ? (size_t)got / sizeof(xp_journal_record_t) : 0;
+    int64_t now = time(NULL);
+
+    int count = 0;
+    for (size_t i = 0; i < available; i++) {
+        const xp_journal_record_t *record = &records[i];
+        if (record->magic != XP_JOURNAL_MAGIC ||
+            record->crc != crc32_bytes(record, XP_RECORD_CRC_BYTES)) {
+            fprintf(stderr, "💔 XP journal %s is damaged after %d records - ignoring the rest\n", path, count);
+            break;
+        }
+        entries[count].user_id = record->user_id;
+        entries[count].guild_id = record->guild_id;
+        entries[count].channel_id = record->channel_id;
+        entries[count].xp_amount = record->xp_amount;
+        entries[count].added_at = now;
+        count++;
+    }
+    free(records);
+
+    *out = entries;
+    *out_count = count;
+    return 0;
+}
+
+int xp_journal_replay(xp_journal_t *journal, const char *database_path, yuno_database_t *database,
+                      uint64_t *next_generation) {
+    char base_path[MAX_PATH_LEN];
+    char path[MAX_PATH_LEN + 32];
+    uint64_t *generations;
+    int generation_count;
+    uint64_t last = 0;
+    int rc = 0;
+
+    snprintf(base_path, sizeof(base_path), "%s%s", database_path, XP_JOURNAL_SUFFIX);
+    if (db_get_max_xp_generation(database, &last) != 0) {
+        return -1;
+    }
+    list_generations(base_path, &generations, &generation_count);
+
+    for (int i = 0; i < generation_count; i++) {
+        uint64_t generation = generations[i];
+        generation_path(base_path, generation, path, sizeof(path));
+        if (generation > last) last = generation;
+
+        /* Committed before the crash, just never deleted */
+        int committed = db_is_xp_generation_committed(database, generation);
+        if (committed == 1) {
+            unlink(path);
+            continue;
+        }
+
+        pending_xp_t *entries;
+        int count;
+        if (committed < 0 || read_generation(path, &entries, &count) != 0) {
+            fprintf(stderr, "💔 Failed to read XP journal %s - keeping it for the next start\n", path);
+            rc = -1;
+            continue;
+        }
+
+        if (count > 0) {
+            xp_flush_result_t *results = malloc(sizeof(xp_flush_result_t) * count);
+            if (!results || db_apply_xp_batch(database, entries, count, generation, generation, results) != 0) {
+                fprintf(stderr, "💔 Failed to replay XP journal %s - keeping it for the next start\n", path);
+                free(results);
+                free(entries);
+                rc = -1;
+                continue;
+            }
+            free(results);
+            atomic_fetch_add_explicit(&journal->replayed, (uint_fast64_t)count, memory_order_relaxed);
+        }
+        free(entries);
+        unlink(path);
+    }
+    free(generations);
+
+    if (atomic_load(&journal->replayed) > 0) {
+        printf("💾 Replayed %lu XP entries from the journal~\n", (unsigned long)atomic_load(&journal->replayed));
+    }
+
+    *next_generation = last + 1;
+    return rc;
+}